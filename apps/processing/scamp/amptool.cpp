@@ -44,6 +44,17 @@ using namespace Seiscomp::DataModel;
 using namespace Private;
 
 #define _T(name) database()->convertColumnName(name)
+
+
+namespace {
+
+
+// Sent by the timeout monitor to flush the buffered records of the
+// shards in the main thread
+const int FlushShardsNotification = -1;
+
+
+}
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
 
@@ -148,6 +159,12 @@ void AmpTool::createCommandLineDescription() {
 	commandline().addOption("Reprocess", "commit",
 	                        "Send amplitude updates to the messaging otherwise"
 	                        "an XML document will be output.");
+	commandline().addOption("Reprocess", "batch-size",
+	                        "Number of picks to reprocess at once. The "
+	                        "amplitudes of a batch are loaded with one query "
+	                        "and the data of each stream is requested once "
+	                        "per merged time window.",
+	                        &_reprocessBatchSize, true);
 
 	commandline().addGroup("Output");
 	commandline().addOption("Output", "formatted,f",
@@ -166,6 +183,11 @@ bool AmpTool::validateParameters() {
 
 	_testMode = commandline().hasOption("test");
 
+	if ( _reprocessBatchSize < 1 ) {
+		cerr << "Invalid batch size: " << _reprocessBatchSize << endl;
+		return false;
+	}
+
 	if ( !_originID.empty() && _testMode )
 		setMessagingEnabled(false);
 
@@ -209,6 +231,16 @@ bool AmpTool::initConfiguration() {
 	try { _runningAcquisitionTimeout = configGetDouble("amptool.runningAcquisitionTimeout"); }
 	catch ( ... ) {}
 
+	try {
+		int threads = configGetInt("amptool.threads");
+		if ( threads < 1 ) {
+			SEISCOMP_ERROR("amptool.threads: expected a value >= 1");
+			return false;
+		}
+		_threads = static_cast<size_t>(threads);
+	}
+	catch ( ... ) {}
+
 	_dumpRecords = commandline().hasOption("dump-records");
 	_reprocessAmplitudes = commandline().hasOption("reprocess");
 	_picks = commandline().hasOption("picks");
@@ -285,6 +317,8 @@ bool AmpTool::init() {
 	_timer.setTimeout(1);
 	_timer.setCallback(bind(&AmpTool::handleTimeout, this));
 
+	_workers.start(_threads);
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -385,6 +419,14 @@ bool AmpTool::run() {
 
 		cerr << picks.size() << endl;
 
+		if ( _reprocessBatchSize > 1 ) {
+			// Picks of a batch should be close in time to share the
+			// data requests
+			picks.sort([](const PickPtr &a, const PickPtr &b) {
+				return a->time().value() < b->time().value();
+			});
+		}
+
 		_report << std::endl;
 		_report << "Reprocessing report" << std::endl;
 		_report << "-------------------" << std::endl;
@@ -395,67 +437,98 @@ bool AmpTool::run() {
 		int ampsRecomputed = 0;
 		int messagesSent = 0;
 
-		int idx = 1;
-		for ( PickList::iterator it = picks.begin(); it != picks.end(); ++it, ++idx ) {
-			PickPtr pick = *it;
-			SingleAmplitudeMap dbAmps;
+		// The processors of many picks share the streams of a batch
+		_skipEarlyRecords = _reprocessBatchSize > 1;
 
+		int idx = 1;
+		for ( PickList::iterator batchStart = picks.begin(); batchStart != picks.end(); ) {
 			if ( isExitRequested() ) break;
 
+			PickList::iterator batchEnd = batchStart;
+			set<string> batchPickIDs;
+			Core::Time batchStartTime = (*batchStart)->time().value();
+			Core::Time batchEndTime = batchStartTime;
+			for ( int n = 0; n < _reprocessBatchSize && batchEnd != picks.end(); ++n, ++batchEnd ) {
+				batchPickIDs.insert((*batchEnd)->publicID());
+				batchStartTime = std::min(batchStartTime, (*batchEnd)->time().value());
+				batchEndTime = std::max(batchEndTime, (*batchEnd)->time().value());
+			}
+
 			// Clear all processors
 			_processors.clear();
 
 			// Clear all station time windows
 			_stationRequests.clear();
 
-			_report << "   + " << pick->publicID() << std::endl;
-			cerr << "[" << idx << "]" << " " << (*it)->publicID() << endl;
-			db_it = query()->getAmplitudesForPick((*it)->publicID());
+			// Load the amplitudes of all picks of the batch at once. The
+			// time condition selects a superset, Pick.time_value does not
+			// carry the fraction of seconds.
+			map<string, list<AmplitudePtr>> batchAmps;
+			std::string ampQuery;
+			ampQuery += "select PAmplitude." + _T("publicID") + ", Amplitude.* "
+			            "from Amplitude,PublicObject as PAmplitude,Pick,PublicObject as PPick "
+			            "where Amplitude._oid=PAmplitude._oid and Pick._oid=PPick._oid and "
+			            "Amplitude." + _T("pickID") + "=PPick." + _T("publicID") +
+			            " and Pick." + _T("time_value") + ">='" + batchStartTime.toString("%F %T") + "'"
+			            " and Pick." + _T("time_value") + "<='" + batchEndTime.toString("%F %T") + "'";
+
+			db_it = query()->getObjectIterator(ampQuery, Amplitude::TypeInfo());
 			while ( (obj = db_it.get()) ) {
-				Amplitude *amp = static_cast<Amplitude*>(obj.get());
-				cerr << "  [" << setw(10) << left << amp->type() << "]  ";
-
-				AmplitudeProcessorPtr proc = AmplitudeProcessorFactory::Create(amp->type().c_str());
-				if ( !proc ) {
-					if ( _amplitudeTypes.find(amp->type()) == _amplitudeTypes.end() )
-						cerr << "No processor";
-					else {
-						cerr << "No processor but enabled";
-						++errors;
-					}
+				AmplitudePtr amp = static_cast<Amplitude*>(obj.get());
+				if ( batchPickIDs.find(amp->pickID()) != batchPickIDs.end() ) {
+					batchAmps[amp->pickID()].push_back(amp);
 				}
-				else {
-					cerr << "Fetch data";
-					dbAmps[amp->type()] = amp;
-					proc->setTrigger(pick->time().value());
-					proc->setReferencingPickID(pick->publicID());
-					proc->setPublishFunction(bind(&AmpTool::storeLocalAmplitude, this, placeholders::_1, placeholders::_2));
-					_report << "     + Data" << std::endl;
-					addProcessor(proc.get(), NULL, pick.get(), None, None, None);
-				}
-
-				cerr << endl;
 				++db_it;
 			}
 
 			db_it.close();
 
-			cerr << "  --------------------------------" << endl;
+			// pickID -> type -> amplitude
+			map<string, SingleAmplitudeMap> dbAmps;
+
+			for ( PickList::iterator it = batchStart; it != batchEnd; ++it, ++idx ) {
+				PickPtr pick = *it;
+
+				_report << "   + " << pick->publicID() << std::endl;
+				cerr << "[" << idx << "]" << " " << pick->publicID() << endl;
 
-			if ( _stationRequests.empty() ) continue;
+				for ( const auto &amp : batchAmps[pick->publicID()] ) {
+					cerr << "  [" << setw(10) << left << amp->type() << "]  ";
+
+					AmplitudeProcessorPtr proc = AmplitudeProcessorFactory::Create(amp->type().c_str());
+					if ( !proc ) {
+						if ( _amplitudeTypes.find(amp->type()) == _amplitudeTypes.end() )
+							cerr << "No processor";
+						else {
+							cerr << "No processor but enabled";
+							++errors;
+						}
+					}
+					else {
+						cerr << "Fetch data";
+						dbAmps[pick->publicID()][amp->type()] = amp;
+						proc->setTrigger(pick->time().value());
+						proc->setReferencingPickID(pick->publicID());
+						proc->setPublishFunction(bind(&AmpTool::storeLocalAmplitude, this, placeholders::_1, placeholders::_2));
+						_report << "     + Data" << std::endl;
+						addProcessor(proc.get(), NULL, pick.get(), None, None, None);
+					}
 
-			for ( RequestMap::iterator it = _stationRequests.begin(); it != _stationRequests.end(); ++it ) {
-				StationRequest &req = it->second;
-				for ( WaveformIDSet::iterator wit = req.streams.begin(); wit != req.streams.end(); ++wit ) {
-					const WaveformStreamID &wsid = *wit;
-					recordStream()->addStream(wsid.networkCode(), wsid.stationCode(),
-					                          wsid.locationCode(), wsid.channelCode(),
-					                          req.timeWindow.startTime(),
-					                          req.timeWindow.endTime());
+					cerr << endl;
 				}
+			}
+
+			cerr << "  --------------------------------" << endl;
+
+			if ( _stationRequests.empty() ) {
+				batchStart = batchEnd;
+				continue;
+			}
 
-				_report << " + TimeWindow (" << it->first << "): " << req.timeWindow.startTime().toString("%F %T")
-				        << ", " << req.timeWindow.endTime().toString("%F %T") << std::endl;
+			size_t requests = addStreamRequests();
+			if ( _reprocessBatchSize > 1 ) {
+				cerr << "  " << requests << " stream requests for " << batchPickIDs.size()
+				     << " picks" << endl;
 			}
 
 			_reprocessMap.clear();
@@ -463,49 +536,65 @@ bool AmpTool::run() {
 
 			list<AmplitudePtr> updates;
 
-			for ( AmplitudeMap::iterator it = dbAmps.begin();
-			      it != dbAmps.end(); ++it ) {
-				AmplitudePtr oldAmp = it->second;
-				AmplitudePtr newAmp = _reprocessMap[oldAmp->type()];
-
-				cerr << "  [" << setw(10) << left << oldAmp->type() << "]  " << oldAmp->amplitude().value() << "  ";
-				if ( newAmp ) {
-					if ( newAmp->amplitude().value() != oldAmp->amplitude().value() ) {
-						*oldAmp = *newAmp;
-						if ( ep )
-							ep->add(oldAmp.get());
+			for ( PickList::iterator it = batchStart; it != batchEnd; ++it ) {
+				auto pit = dbAmps.find((*it)->publicID());
+				if ( pit == dbAmps.end() ) continue;
+
+				if ( _reprocessBatchSize > 1 )
+					cerr << "  " << pit->first << endl;
+
+				for ( auto &[type, oldAmp] : pit->second ) {
+					AmplitudePtr newAmp = _reprocessMap[{pit->first, type}];
+
+					cerr << "  [" << setw(10) << left << oldAmp->type() << "]  " << oldAmp->amplitude().value() << "  ";
+					if ( newAmp ) {
+						if ( newAmp->amplitude().value() != oldAmp->amplitude().value() ) {
+							*oldAmp = *newAmp;
+							if ( ep )
+								ep->add(oldAmp.get());
+							else
+								updates.push_back(oldAmp);
+							cerr << "->  " << newAmp->amplitude().value();
+						}
 						else
-							updates.push_back(oldAmp);
-						cerr << "->  " << newAmp->amplitude().value();
-					}
-					else
-						cerr << "  no changes";
+							cerr << "  no changes";
 
-					++ampsRecomputed;
-				}
-				else {
-					cerr << "-";
-					++errors;
+						++ampsRecomputed;
+					}
+					else {
+						cerr << "-";
+						++errors;
+					}
+					cerr << endl;
 				}
-				cerr << endl;
 			}
 
 			if ( !updates.empty() ) {
 				if ( !_testMode ) {
+					// Do not let the messages of large batches grow too much
 					NotifierMessagePtr nmsg = new NotifierMessage;
 					for ( list<AmplitudePtr>::iterator it = updates.begin();
 					      it != updates.end(); ++it ) {
 						nmsg->attach(new Notifier("EventParameters", OP_UPDATE, it->get()));
+						if ( nmsg->size() >= 100 ) {
+							connection()->send(nmsg.get());
+							++messagesSent;
+							nmsg = new NotifierMessage;
+						}
 					}
 
-					connection()->send(nmsg.get());
-					++messagesSent;
+					if ( !nmsg->empty() ) {
+						connection()->send(nmsg.get());
+						++messagesSent;
+					}
 				}
 				else {
 					cerr << "  --------------------------------" << endl;
 					cerr << "  Test mode, nothing sent" << endl;
 				}
 			}
+
+			batchStart = batchEnd;
 		}
 
 		if ( ep ) {
@@ -594,6 +683,8 @@ bool AmpTool::run() {
 void AmpTool::done() {
 	Seiscomp::Client::StreamApplication::done();
 
+	_workers.stop();
+
 	if ( _errorChannel ) delete _errorChannel;
 	if ( _errorOutput ) delete _errorOutput;
 
@@ -953,12 +1044,18 @@ void AmpTool::process(Origin *origin, Pick *pickInput) {
 	_noDataTimer.restart();
 	_hasRecordsReceived = false;
 
+	if ( _workers.threadCount() > 1 ) {
+		distributeProcessors();
+	}
+
 	SEISCOMP_INFO("Starting timeout monitor");
 	_timer.start();
 	readRecords(false);
 	if ( _timer.isActive() ) {
 		_timer.stop();
 	}
+
+	collectShards();
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1216,6 +1313,62 @@ void AmpTool::printReport() {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t AmpTool::addStreamRequests() {
+	// Stream ID -> stream
+	map<string, WaveformStreamID> streams;
+	for ( const auto &item : _stationRequests ) {
+		for ( const auto &wsid : item.second.streams ) {
+			streams[Private::toStreamID(wsid)] = wsid;
+		}
+	}
+
+	size_t requests = 0;
+
+	for ( const auto &slot : _processors ) {
+		auto sit = streams.find(slot.first);
+		if ( sit == streams.end() ) continue;
+
+		vector<Core::TimeWindow> windows;
+		for ( const auto &proc : slot.second ) {
+			windows.push_back(proc->safetyTimeWindow());
+		}
+
+		sort(windows.begin(), windows.end(),
+		     [](const Core::TimeWindow &a, const Core::TimeWindow &b) {
+			return a.startTime() < b.startTime();
+		});
+
+		// Merge overlapping and adjacent time windows
+		vector<Core::TimeWindow> merged;
+		for ( const auto &tw : windows ) {
+			if ( !merged.empty() && tw.startTime() <= merged.back().endTime() ) {
+				if ( tw.endTime() > merged.back().endTime() )
+					merged.back().setEndTime(tw.endTime());
+			}
+			else
+				merged.push_back(tw);
+		}
+
+		const WaveformStreamID &wsid = sit->second;
+		for ( const auto &tw : merged ) {
+			recordStream()->addStream(wsid.networkCode(), wsid.stationCode(),
+			                          wsid.locationCode(), wsid.channelCode(),
+			                          tw.startTime(), tw.endTime());
+
+			_report << " + TimeWindow (" << slot.first << "): " << tw.startTime().toString("%F %T")
+			        << ", " << tw.endTime().toString("%F %T") << std::endl;
+			++requests;
+		}
+	}
+
+	return requests;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void AmpTool::feed(Seiscomp::DataModel::Pick *pick) {
 	if ( isAgencyIDAllowed(objectAgencyID(pick)) )
@@ -1465,7 +1618,7 @@ void AmpTool::storeLocalAmplitude(const Seiscomp::Processing::AmplitudeProcessor
 	AmplitudePtr amp = createAmplitude(proc, res);
 	if ( !amp ) return;
 
-	_reprocessMap[amp->type()] = amp;
+	_reprocessMap[{amp->pickID(), amp->type()}] = amp;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1496,36 +1649,79 @@ bool AmpTool::storeRecord(Record *rec) {
 void AmpTool::handleRecord(Record *rec) {
 	Seiscomp::RecordPtr tmp(rec);
 
-	std::string streamID = rec->streamID();
+	{
+		boost::mutex::scoped_lock l(_bufferMutex);
+		if ( !_shards.empty() ) {
+			dispatchRecord(rec);
+			return;
+		}
+	}
+
+	ProcessingEvents events;
+	feedRecord(_processors, rec, 0, events);
+	applyEvents(events);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
 
-	ProcessorMap::iterator slot_it = _processors.find(streamID);
-	if ( slot_it == _processors.end() ) return;
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void AmpTool::feedRecord(ProcessorMap &processors, const Record *rec,
+                         size_t sequence, ProcessingEvents &events) {
+	ProcessorMap::iterator slot_it = processors.find(rec->streamID());
+	if ( slot_it == processors.end() ) return;
 
 	for ( ProcessorSlot::iterator it = slot_it->second.begin(); it != slot_it->second.end(); ) {
+		// In batch reprocessing the processors of many picks share a
+		// stream, do not let them buffer data long before their window
+		if ( _skipEarlyRecords
+		  && rec->endTime() <= (*it)->safetyTimeWindow().startTime() ) {
+			++it;
+			continue;
+		}
+
 		(*it)->feed(rec);
 		if ( (*it)->status() == WaveformProcessor::InProgress ) {
 			// processor still needs some time (progress = (*it)->statusValue())
 			++it;
 		}
 		else if ( (*it)->status() == WaveformProcessor::Finished ) {
-			_result << "   + " << (*it)->type() << ", " << slot_it->first.c_str() << std::endl;
+			std::ostringstream os;
+			os << "   + " << (*it)->type() << ", " << slot_it->first.c_str() << std::endl;
 			if ( (*it)->noiseOffset() )
-				_result << "     + noiseOffset = " << *(*it)->noiseOffset() << std::endl;
+				os << "     + noiseOffset = " << *(*it)->noiseOffset() << std::endl;
 			else
-				_result << "     - noiseOffset" << std::endl;
+				os << "     - noiseOffset" << std::endl;
 
 			if ( (*it)->noiseAmplitude() )
-				_result << "     + noiseAmplitude = " << *(*it)->noiseAmplitude() << std::endl;
+				os << "     + noiseAmplitude = " << *(*it)->noiseAmplitude() << std::endl;
 			else
-				_result << "     - noiseAmplitude" << std::endl;
+				os << "     - noiseAmplitude" << std::endl;
+
+			ProcessingEvent event;
+			event.sequence = sequence;
+			event.type = ProcessingEvent::Finished;
+			event.proc = *it;
+			event.text = os.str();
+			events.push_back(event);
+
 			// processor finished successfully
 			it = slot_it->second.erase(it);
 		}
 		else if ( (*it)->isFinished() ) {
-			_result << "   - " << (*it)->type() << ", " << slot_it->first.c_str() << " ("
-			        << (*it)->status().toString()
-			        << ")" << std::endl;
-			createDummyAmplitude(it->get());
+			std::ostringstream os;
+			os << "   - " << (*it)->type() << ", " << slot_it->first.c_str() << " ("
+			   << (*it)->status().toString()
+			   << ")" << std::endl;
+
+			ProcessingEvent event;
+			event.sequence = sequence;
+			event.type = ProcessingEvent::Failed;
+			event.proc = *it;
+			event.text = os.str();
+			events.push_back(event);
+
 			it = slot_it->second.erase(it);
 		}
 		else
@@ -1533,7 +1729,182 @@ void AmpTool::handleRecord(Record *rec) {
 	}
 
 	if ( slot_it->second.empty() )
-		_processors.erase(slot_it);
+		processors.erase(slot_it);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void AmpTool::applyEvents(const ProcessingEvents &events) {
+	for ( const auto &event : events ) {
+		switch ( event.type ) {
+			case ProcessingEvent::NewAmplitude:
+				emitAmplitude(event.proc.get(), event.result);
+				break;
+			case ProcessingEvent::Finished:
+				_result << event.text;
+				break;
+			case ProcessingEvent::Failed:
+				_result << event.text;
+				createDummyAmplitude(event.proc.get());
+				break;
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void AmpTool::distributeProcessors() {
+	boost::mutex::scoped_lock l(_bufferMutex);
+
+	_shards.clear();
+	_streamShards.clear();
+
+	if ( _processors.empty() ) return;
+
+	// Processors of the horizontal components are fed by the records of
+	// two streams, hence all streams of a station go to the same shard.
+	// Stations are dealt out in stream ID order to keep the assignment
+	// reproducible.
+	map<string, size_t> stationShards;
+	for ( const auto &slot : _processors ) {
+		string station = slot.first.substr(0, slot.first.find('.', slot.first.find('.') + 1));
+		stationShards.emplace(station, stationShards.size() % _workers.threadCount());
+	}
+
+	_shards.resize(std::min(stationShards.size(), _workers.threadCount()));
+
+	for ( auto &slot : _processors ) {
+		string station = slot.first.substr(0, slot.first.find('.', slot.first.find('.') + 1));
+		Shard *shard = &_shards[stationShards[station]];
+
+		for ( auto &proc : slot.second ) {
+			proc->setPublishFunction(bind(&AmpTool::collectAmplitude, this, shard, placeholders::_1, placeholders::_2));
+		}
+
+		_streamShards[slot.first] = shard;
+		shard->processors[slot.first] = slot.second;
+	}
+
+	_processors.clear();
+	_bufferedRecords = 0;
+
+	SEISCOMP_DEBUG("Distributed the processors of %d stations to %d shards",
+	               static_cast<int>(stationShards.size()),
+	               static_cast<int>(_shards.size()));
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void AmpTool::dispatchRecord(Record *rec) {
+	auto it = _streamShards.find(rec->streamID());
+	if ( it == _streamShards.end() ) return;
+
+	if ( !_bufferedRecords ) {
+		_bufferTimer.restart();
+	}
+
+	it->second->records.emplace_back(_recordSequence++, rec);
+	++_bufferedRecords;
+
+	// Records are processed in batches to keep the synchronization
+	// overhead low but no result should be delayed for long. If no
+	// further record arrives, the flush requested by handleTimeout
+	// processes the batch.
+	if ( _bufferedRecords >= 64 * _shards.size()
+	  || (double)_bufferTimer.elapsed() >= 1.0 ) {
+		processShards();
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void AmpTool::processShards() {
+	if ( !_bufferedRecords ) return;
+
+	_workers.run(_shards.size(), [this](size_t from, size_t to) {
+		for ( size_t i = from; i < to; ++i ) {
+			Shard &shard = _shards[i];
+			for ( auto &[sequence, rec] : shard.records ) {
+				shard.sequence = sequence;
+				feedRecord(shard.processors, rec.get(), sequence, shard.events);
+			}
+			shard.records.clear();
+		}
+	});
+
+	_bufferedRecords = 0;
+
+	// Apply the results in the order of the records as if all records
+	// had been processed by this thread. A record is fed by one shard
+	// only, so the events of a shard are already ordered.
+	ProcessingEvents events;
+	for ( auto &shard : _shards ) {
+		events.insert(events.end(), shard.events.begin(), shard.events.end());
+		shard.events.clear();
+	}
+
+	std::stable_sort(events.begin(), events.end(),
+	                 [](const ProcessingEvent &a, const ProcessingEvent &b) {
+		return a.sequence < b.sequence;
+	});
+
+	applyEvents(events);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void AmpTool::collectShards() {
+	boost::mutex::scoped_lock l(_bufferMutex);
+
+	if ( _shards.empty() ) return;
+
+	processShards();
+
+	for ( auto &shard : _shards ) {
+		for ( auto &slot : shard.processors ) {
+			for ( auto &proc : slot.second ) {
+				proc->setPublishFunction(bind(&AmpTool::emitAmplitude, this, placeholders::_1, placeholders::_2));
+			}
+
+			_processors[slot.first] = slot.second;
+		}
+	}
+
+	_shards.clear();
+	_streamShards.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void AmpTool::collectAmplitude(Shard *shard, const AmplitudeProcessor *proc,
+                               const AmplitudeProcessor::Result &res) {
+	// Called by a worker thread, the amplitude is created and sent by
+	// the main thread
+	ProcessingEvent event;
+	event.sequence = shard->sequence;
+	event.type = ProcessingEvent::NewAmplitude;
+	event.proc = proc;
+	event.result = res;
+	event.record = res.record;
+	shard->events.push_back(event);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1557,6 +1928,35 @@ void AmpTool::handleTimeout() {
 		_noDataTimer.restart();
 
 	_hasRecordsReceived = false;
+
+	// Do not hold back the results of buffered records while the
+	// record stream does not deliver. The shards are processed and the
+	// amplitudes are sent by the main thread, hence only a flush is
+	// requested. At most one request is pending, the timer must not
+	// block on a full queue.
+	if ( !_flushRequested.exchange(true) ) {
+		sendNotification(Client::Notification(FlushShardsNotification));
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool AmpTool::dispatchNotification(int type, BaseObject *obj) {
+	if ( type != FlushShardsNotification ) {
+		return false;
+	}
+
+	_flushRequested = false;
+
+	boost::mutex::scoped_lock l(_bufferMutex);
+	if ( !_shards.empty() ) {
+		processShards();
+	}
+
+	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1568,6 +1968,8 @@ void AmpTool::acquisitionFinished() {
 	_timer.stop();
 	SEISCOMP_INFO("Stopped timeout monitor");
 
+	collectShards();
+
 	{
 		boost::mutex::scoped_lock l(_acquisitionMutex);
 		closeStream();
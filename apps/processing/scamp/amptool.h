@@ -18,16 +18,19 @@
 #define SEISCOMP_APPLICATIONS_AMPTOOL_H__
 
 #include <seiscomp/client/streamapplication.h>
+#include <seiscomp/core/record.h>
 #include <seiscomp/processing/amplitudeprocessor.h>
 #include <seiscomp/datamodel/publicobjectcache.h>
 #include <seiscomp/datamodel/eventparameters.h>
 #include <seiscomp/datamodel/amplitude.h>
 #include <seiscomp/utils/timer.h>
+#include <seiscomp/private/workerpool.h>
 
 #define SEISCOMP_COMPONENT AmpTool
 #include <seiscomp/logging/log.h>
 
 #include <boost/thread/mutex.hpp>
+#include <atomic>
 #include <map>
 #include <sstream>
 
@@ -64,6 +67,7 @@ class AmpTool : public Seiscomp::Client::StreamApplication {
 		bool storeRecord(Seiscomp::Record *rec);
 		void handleRecord(Seiscomp::Record *rec);
 		void handleTimeout();
+		bool dispatchNotification(int type, Seiscomp::Core::BaseObject *obj) override;
 
 		void acquisitionFinished();
 
@@ -76,6 +80,9 @@ class AmpTool : public Seiscomp::Client::StreamApplication {
 		typedef std::multimap<std::string, Seiscomp::DataModel::AmplitudePtr> AmplitudeMap;
 		typedef std::pair<AmplitudeMap::iterator, AmplitudeMap::iterator>     AmplitudeRange;
 		typedef std::map<std::string, Seiscomp::DataModel::AmplitudePtr>      SingleAmplitudeMap;
+		// (pickID, type) -> amplitude
+		typedef std::map<std::pair<std::string, std::string>,
+		                 Seiscomp::DataModel::AmplitudePtr>                   ReprocessMap;
 
 		void process(Seiscomp::DataModel::Origin *origin = nullptr, Seiscomp::DataModel::Pick *pick = nullptr);
 
@@ -104,6 +111,10 @@ class AmpTool : public Seiscomp::Client::StreamApplication {
 
 		void printReport();
 
+		//! Requests the streams of all processors, one request per stream
+		//! and merged safety time window. Returns the number of requests.
+		size_t addStreamRequests();
+
 		Seiscomp::DataModel::AmplitudePtr createAmplitude(const Seiscomp::Processing::AmplitudeProcessor *,
 		                                                  const Seiscomp::Processing::AmplitudeProcessor::Result &);
 
@@ -133,6 +144,59 @@ class AmpTool : public Seiscomp::Client::StreamApplication {
 		typedef Seiscomp::DataModel::PublicObjectTimeSpanBuffer               Cache;
 		typedef Seiscomp::DataModel::EventParametersPtr                       EventParametersPtr;
 
+		// The outcome of feeding a record to a processor. Worker threads
+		// collect them, the main thread applies them in record order.
+		struct ProcessingEvent {
+			enum Type {
+				NewAmplitude,
+				Finished,
+				Failed
+			};
+
+			size_t                                                 sequence;
+			Type                                                   type;
+			Seiscomp::Processing::AmplitudeProcessorCPtr           proc;
+			Seiscomp::Processing::AmplitudeProcessor::Result       result;
+			Seiscomp::RecordCPtr                                   record;
+			std::string                                            text;
+		};
+
+		typedef std::vector<ProcessingEvent>                                  ProcessingEvents;
+
+		// The processors of the streams of a subset of stations which are
+		// fed by one worker thread at a time
+		struct Shard {
+			ProcessorMap                                           processors;
+			std::vector<std::pair<size_t, Seiscomp::RecordPtr>>    records;
+			ProcessingEvents                                       events;
+			// The sequence number of the record being fed
+			size_t                                                 sequence{0};
+		};
+
+		typedef std::vector<Shard>                                            Shards;
+
+		//! Feeds a record to the processors of its stream and records the
+		//! processors which have finished
+		void feedRecord(ProcessorMap &processors, const Seiscomp::Record *rec,
+		                size_t sequence, ProcessingEvents &events);
+		void applyEvents(const ProcessingEvents &events);
+
+		//! Moves the processors into the shards of the worker threads
+		void distributeProcessors();
+		//! Buffers a record for the shard of its station, called with
+		//! _bufferMutex held
+		void dispatchRecord(Seiscomp::Record *rec);
+		//! Feeds all buffered records to the shards and applies their
+		//! results in record order, called with _bufferMutex held
+		void processShards();
+		//! Processes all buffered records and moves the remaining
+		//! processors back from the shards
+		void collectShards();
+		void collectAmplitude(Shard *shard,
+		                      const Seiscomp::Processing::AmplitudeProcessor *,
+		                      const Seiscomp::Processing::AmplitudeProcessor::Result &);
+
+
 		StreamMap                  _streams;
 		double                     _fExpiry{1.0};
 		bool                       _fetchMissingAmplitudes{true};
@@ -183,7 +247,24 @@ class AmpTool : public Seiscomp::Client::StreamApplication {
 		std::stringstream           _report;
 		std::stringstream           _result;
 
-		SingleAmplitudeMap          _reprocessMap;
+		ReprocessMap                _reprocessMap;
+		int                         _reprocessBatchSize{1};
+		// Processors skip records which end before their safety time
+		// window, only set while reprocessing batches of picks
+		bool                        _skipEarlyRecords{false};
+
+		size_t                      _threads{1};
+		Seiscomp::Private::WorkerPool _workers;
+		Shards                      _shards;
+		// Stream ID -> shard
+		std::map<std::string, Shard*> _streamShards;
+		size_t                      _recordSequence{0};
+		size_t                      _bufferedRecords{0};
+		Seiscomp::Util::StopWatch   _bufferTimer;
+		// Guards the shards and their buffered records
+		boost::mutex                _bufferMutex;
+		// Set while a flush requested by the timeout monitor is pending
+		std::atomic<bool>           _flushRequested{false};
 
 		ObjectLog                  *_inputPicks;
 		ObjectLog                  *_inputAmps;
@@ -25,10 +25,13 @@
 #include <seiscomp/core/datamessage.h>
 #include <seiscomp/io/archive/xmlarchive.h>
 #include <algorithm>
+#include <cstdio>
 #include <list>
+#include <sstream>
 
 #include "app.h"
 #include "datamodel.h"
+#include "objectreader.h"
 #include "sc3adapters.h"
 #include "scutil.h"
 #include "util.h"
@@ -115,6 +118,14 @@ void App::createCommandLineDescription() {
 	                        "from messaging and must be provided. Results are "
 	                        "sent in XML to stdout." ,
 	                        &_inputEPFile, false);
+	commandline().addOption("Input", "replay",
+	                        "Name of input XML file (SCML) with picks, amplitudes "
+	                        "and origins to replay as fast as possible. The "
+	                        "objects are read one by one in order of their "
+	                        "creation time, which also drives the clock. Implies "
+	                        "--offline. Reported origins are written to the "
+	                        "origin log.",
+	                        &_replayFile, false);
 
 	commandline().addGroup("Settings");
 	commandline().addOption("Settings", "allow-rejected-picks",
@@ -229,6 +240,11 @@ void App::createCommandLineDescription() {
 	commandline().addGroup("Output");
 	commandline().addOption("Output", "formatted,f",
 	                        "Use formatted XML output. Otherwise XML is unformatted.");
+	commandline().addOption("Output", "origin-log",
+	                        "Name of the file the origins reported with --replay "
+	                        "are written to, one line per origin. Use '-' for "
+	                        "stdout.",
+	                        &_originLogFile);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -255,6 +271,17 @@ bool App::validateParameters() {
 		_config.offline = true;
 	}
 
+	if ( !_replayFile.empty() ) {
+		if ( !_inputEPFile.empty() || !_inputFileXML.empty() ) {
+			std::cerr << "--replay cannot be combined with --ep or --input" << std::endl;
+			return false;
+		}
+
+		_config.offline = true;
+		_config.playback = true;
+		_config.test = true;
+	}
+
 
 	if ( _config.offline ) {
 		setMessagingEnabled(false);
@@ -485,9 +512,25 @@ bool App::initConfiguration() {
 	try { _config.dynamicPickThresholdInterval = configGetDouble("autoloc.dynamicPickThresholdInterval"); }
 	catch ( ... ) {}
 
+	try {
+		int threads = configGetInt("autoloc.threads");
+		if ( threads < 1 ) {
+			SEISCOMP_ERROR("autoloc.threads must be at least 1");
+			return false;
+		}
+		_config.threads = threads;
+	}
+	catch ( ... ) {}
+
 	try { _gridConfigFile = Environment::Instance()->absolutePath(configGetString("autoloc.grid")); }
 	catch (...) { _gridConfigFile = Environment::Instance()->shareDir() + "/scautoloc/grid.conf"; }
 
+	try { _config.gridCacheFile = configGetString("autoloc.gridCache"); }
+	catch (...) { _config.gridCacheFile = "@ROOTDIR@/var/cache/scautoloc/grid.cache"; }
+	if ( !_config.gridCacheFile.empty() ) {
+		_config.gridCacheFile = Environment::Instance()->absolutePath(_config.gridCacheFile);
+	}
+
 	try { _config.staConfFile = Environment::Instance()->absolutePath(configGetString("autoloc.stationConfig")); }
 	catch (...) { _config.staConfFile = Environment::Instance()->shareDir() + "/scautoloc/station.conf"; }
 
@@ -586,7 +629,7 @@ bool App::init() {
 	}
 
 	if ( _config.playback ) {
-		if ( _inputEPFile.empty() ) {
+		if ( _inputEPFile.empty() && _replayFile.empty() ) {
 			// XML playback, set timer to 1 sec
 			enableTimer(1);
 		}
@@ -986,6 +1029,81 @@ bool App::runFromEPFile(const char *filename) {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool App::runReplay(const char *filename) {
+	SEISCOMP_INFO("App::runReplay");
+
+	if ( _originLogFile.empty() || _originLogFile == "-" )
+		_originLog = &std::cout;
+	else {
+		_originLogStream.open(_originLogFile.c_str());
+		if ( !_originLogStream.is_open() ) {
+			SEISCOMP_ERROR("unable to open origin log: %s", _originLogFile.c_str());
+			return false;
+		}
+		_originLog = &_originLogStream;
+	}
+
+	Core::Time startTime = Core::Time::UTC();
+
+	ObjectReader reader;
+	if ( !reader.open(filename) )
+		return false;
+
+	std::cerr << "Read from file: " << reader.size() << " object(s) in "
+	          << static_cast<double>(Core::Time::UTC() - startTime) << " s" << std::endl;
+
+	// The clock is driven by the creation times of the objects only.
+	// There are no timers and no delays, each object is processed as
+	// soon as the previous one is done.
+	size_t pickCount = 0, amplitudeCount = 0, originCount = 0;
+	startTime = Core::Time::UTC();
+
+	DataModel::PublicObjectPtr o;
+	while ( !isExitRequested() && (o = reader.next()) ) {
+		if ( DataModel::Pick::Cast(o.get()) )
+			++pickCount;
+		else if ( DataModel::Amplitude::Cast(o.get()) )
+			++amplitudeCount;
+		else if ( DataModel::Origin::Cast(o.get()) )
+			++originCount;
+
+		addObject("", o.get());
+		++objectCount;
+	}
+
+	_flush();
+	_originLog->flush();
+
+	double elapsed = static_cast<double>(Core::Time::UTC() - startTime);
+	if ( elapsed <= 0 )
+		elapsed = 1E-6;
+
+	std::ostringstream report;
+	report << "Replayed " << pickCount << " pick(s), " << amplitudeCount
+	       << " amplitude(s) and " << originCount << " origin(s) in "
+	       << elapsed << " s: " << (pickCount / elapsed) << " picks/s, "
+	       << _reportedOrigins << " origin(s) reported, "
+	       << (_reportedOrigins / elapsed) << " origins/s";
+	SEISCOMP_INFO_S(report.str());
+	std::cerr << report.str() << std::endl;
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool App::fileInput() const {
+	return !_inputFileXML.empty() || !_inputEPFile.empty() || !_replayFile.empty();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void App::sync(const Seiscomp::Core::Time &t) {
 	syncTime = t;
@@ -998,7 +1116,7 @@ void App::sync(const Seiscomp::Core::Time &t) {
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 const Seiscomp::Core::Time App::now() const {
 
-	if (_inputFileXML.size() || _inputEPFile.size())
+	if ( fileInput() )
 		return syncTime;
 
 	return Core::Time::UTC();
@@ -1022,6 +1140,9 @@ bool App::run() {
 	if ( !_inputEPFile.empty() )
 		return runFromEPFile(_inputEPFile.c_str());
 
+	if ( !_replayFile.empty() )
+		return runReplay(_replayFile.c_str());
+
 	// normal online mode
 	if ( ! Autoloc3::config().offline )
 		return Application::run();
@@ -1196,7 +1317,7 @@ bool App::feed(DataModel::Pick *scpick) {
 		SEISCOMP_WARNING_S("Pick " + pickID + ": missing evaluation status");
 	}
 
-	if (_inputFileXML.size() || _inputEPFile.size()) {
+	if ( fileInput() ) {
 		try {
 			const Core::Time &creationTime = scpick->creationInfo().creationTime();
 			sync(creationTime);
@@ -1254,7 +1375,7 @@ bool App::feed(DataModel::Amplitude *scampl) {
 
 	const std::string &amplID = scampl->publicID();
 
-	if (_inputFileXML.size() || _inputEPFile.size()) {
+	if ( fileInput() ) {
 		try {
 			const Core::Time &creationTime = scampl->creationInfo().creationTime();
 			sync(creationTime);
@@ -1397,6 +1518,23 @@ bool App::_report(const ::Autoloc::Origin *origin) {
 	// Log object flow
 	logObject(_outputOrgs, now());
 
+	if ( _originLog ) {
+		// One line per reported origin: report time, origin ID,
+		// origin time, location, RMS, defining phases, arrivals
+		// and score
+		char line[256];
+		snprintf(line, sizeof(line), "%s %-6lu %s %7.3f %8.3f %5.1f %5.2f %3ld %3ld %6.1f%s",
+		         now().toString("%FT%T.%2f").c_str(), origin->id,
+		         ::Autoloc::time2str(origin->time).c_str(),
+		         origin->hypocenter.lat, origin->hypocenter.lon, origin->hypocenter.dep,
+		         origin->rms(), long(origin->definingPhaseCount()),
+		         long(origin->arrivals.size()), ::Autoloc::originScore(origin),
+		         origin->preliminary ? " preliminary" : "");
+		*_originLog << line << '\n';
+		++_reportedOrigins;
+		return true;
+	}
+
 	if ( _config.offline || _config.test ) {
 		std::string reportStr = ::Autoloc::printDetailed(origin);
 		SEISCOMP_INFO("Reporting origin %ld\n%s", origin->id, reportStr.c_str());
@@ -17,6 +17,7 @@
 #ifndef SEISCOMP_APPLICATIONS_LOCATOR__
 #define SEISCOMP_APPLICATIONS_LOCATOR__
 
+#include <fstream>
 #include <queue>
 #include <seiscomp/datamodel/pick.h>
 #include <seiscomp/datamodel/amplitude.h>
@@ -70,6 +71,11 @@ class App : public Client::Application, protected ::Autoloc::Autoloc3
 //		bool runFromPickFile();
 		bool runFromXMLFile(const char *fname);
 		bool runFromEPFile(const char *fname);
+		bool runReplay(const char *fname);
+
+		// Whether the objects are read from a file rather than
+		// received from messaging
+		bool fileInput() const;
 
 		void sync(const Core::Time &time);
 		const Core::Time now() const;
@@ -83,6 +89,12 @@ class App : public Client::Application, protected ::Autoloc::Autoloc3
 	private:
 		std::string _inputFileXML; // for XML playback
 		std::string _inputEPFile;  // for offline processing
+		std::string _replayFile;   // for fast offline replay
+		std::string _originLogFile{"-"};
+		std::ofstream _originLogStream;
+		// compact log of the origins reported during replay
+		std::ostream *_originLog{nullptr};
+		size_t _reportedOrigins{0};
 		std::string _stationLocationFile;
 		std::string _gridConfigFile{"@DATADIR@/scautoloc/grid.conf"};
 		std::string _amplTypeAbs{"mb"};
@@ -14,8 +14,10 @@
 
 #define SEISCOMP_COMPONENT Autoloc
 #include <seiscomp/logging/log.h>
+#include <seiscomp/datamodel/publicobject.h>
 #include <seiscomp/seismology/ttt.h>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 
 #include "util.h"
@@ -127,10 +129,32 @@ bool Autoloc3::init()
 		    return false;
 	}
 
+	GridSearch::Config nucleatorConfig = _nucleator.config();
+	nucleatorConfig.threads = _config.threads;
+	_nucleator.setConfig(nucleatorConfig);
+
 	_nucleator.setSeiscompConfig(_config.scconfig);
         if ( ! _nucleator.init())
                 return false;
 
+	// Additional locators for concurrent relocations
+	_locators.clear();
+	if (_config.threads > 1) {
+		for (size_t i=0; i<_config.threads; i++) {
+			std::unique_ptr<Locator> locator(new Locator);
+			locator->setSeiscompConfig(_config.scconfig);
+			if ( ! locator->init()) {
+				SEISCOMP_ERROR("Autoloc::init(): Failed to initialize relocator");
+				return false;
+			}
+			locator->setMinimumDepth(_config.minimumDepth);
+			for (const auto &item : _stations)
+				locator->setStation(item.second.get());
+			_locators.push_back(std::move(locator));
+		}
+	}
+	_workers.start(_config.threads);
+
 	SEISCOMP_DEBUG("Setting configured locator profile: %s", _config.locatorProfile.c_str());
 	setLocatorProfile(_config.locatorProfile);
 
@@ -400,8 +424,11 @@ bool Autoloc3::_store(const Pick *pick)
 		_now = pick->time;
 
 	// physically store the pick
-	if ( !Autoloc3::pick(pick->id) )
+	if ( !Autoloc3::pick(pick->id) ) {
 		pickPool[ pick->id ] = pick;
+		_pickTimes.insert(PickTimeIndex::value_type(pick->time, pick));
+		_stationPickTimes[pick->station()].insert(PickTimeIndex::value_type(pick->time, pick));
+	}
 
 	return true;
 }
@@ -410,6 +437,35 @@ bool Autoloc3::_store(const Pick *pick)
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+std::vector<const Pick*> Autoloc3::_pickRange(Time from, Time to, const Station *station) const
+{
+	std::vector<const Pick*> picks;
+
+	const PickTimeIndex *index = &_pickTimes;
+	if (station) {
+		auto it = _stationPickTimes.find(station);
+		if (it == _stationPickTimes.end())
+			return picks;
+		index = &it->second;
+	}
+
+	auto last = index->upper_bound(to);
+	for (auto it = index->lower_bound(from); it != last; ++it)
+		picks.push_back(it->second);
+
+	// Keep the order of the pick pool such that the results
+	// don't depend on the order of pick arrival
+	std::sort(picks.begin(), picks.end(),
+	          [](const Pick *a, const Pick *b) { return a->id < b->id; });
+
+	return picks;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool Autoloc3::feed(const Pick *pick)
 {
@@ -743,12 +799,7 @@ bool Autoloc3::_tooManyRecentPicks(const Pick *newPick) const
 		return true;
 	}
 
-	for (const auto& item : pickPool) {
-
-		const Pick *oldPick = item.second.get();
-
-		if (oldPick->station() != newPick->station())
-			continue;
+	for (const Pick *oldPick : _pickRange(newPick->time - timeSpan, newPick->time, newPick->station())) {
 
 		if ( !_config.useManualPicks && manual(oldPick) && !_config.useManualOrigins )
 			continue;
@@ -884,9 +935,7 @@ Origin *Autoloc3::merge(const Origin *origin1, const Origin *origin2)
 bool Autoloc3::_followsBiggerPick(const Pick *newPick) const
 {
 	// Check whether this pick is within a short time after an XXL pick from the same station
-	for (auto& item : pickPool) {
-
-		const Pick *pick = item.second.get();
+	for (const Pick *pick : _pickRange(newPick->time - _config.xxlDeadTime, newPick->time, newPick->station())) {
 
 		if (pick == newPick)
 			continue;
@@ -894,9 +943,6 @@ bool Autoloc3::_followsBiggerPick(const Pick *newPick) const
 		if ( ! pick->xxl)
 			continue;
 
-		if (pick->station() != newPick->station())
-			continue;
-
 		double dt = newPick->time - pick->time;
 		if (dt < 0 || dt > _config.xxlDeadTime)
 			continue;
@@ -986,9 +1032,8 @@ OriginPtr Autoloc3::_xxlPreliminaryOrigin(const Pick *newPick)
 	std::vector<const Pick*> xxlpicks;
 	const Pick *earliest = newPick;
 	xxlpicks.push_back(newPick);
-	for (auto& item: pickPool) {
-
-		const Pick *oldPick = item.second.get();
+	double maxDt = 10+13.7*_config.xxlMaxStaDist;
+	for (const Pick *oldPick : _pickRange(newPick->time - maxDt, newPick->time + maxDt)) {
 
 		if ( ! oldPick->xxl )
 			continue;
@@ -1002,7 +1047,7 @@ OriginPtr Autoloc3::_xxlPreliminaryOrigin(const Pick *newPick)
 		double dt = newPick->time - oldPick->time;
 		double dx = distance(oldPick->station(), newPick->station());
 
-		if ( std::abs(dt) > 10+13.7*_config.xxlMaxStaDist )
+		if ( std::abs(dt) > maxDt )
 			continue;
 
 		if ( dx > _config.xxlMaxStaDist )
@@ -2296,9 +2341,14 @@ bool Autoloc3::_addMorePicks(Origin *origin, bool keepDepth)
 		have.insert(x);
 	}
 
+	// Only picks within the time span of mightBeAssociated() can be
+	// associated. As the origin may be relocated with every pick added
+	// the range is extended by a generous margin.
+	double margin = 600;
+	std::vector<const Pick*> candidates = _pickRange(origin->time - 10 - margin, origin->time + 1300 + margin);
+
 	int picksAdded = 0;
-	for (auto& item: pickPool) {
-		const Pick *pick = item.second.get();
+	for (const Pick *pick : candidates) {
 
 		if ( ! pick->station() ) // better if blacklisted
 			continue;
@@ -2406,35 +2456,29 @@ bool Autoloc3::_enhanceScore(Origin *origin, size_t maxloops)
 		double bestScore = currentScore;
 		int    bestExcluded = -1;
 
+		std::vector<size_t> candidates;
 		size_t arrivalCount = origin->arrivals.size();
 		for (size_t i=0; i<arrivalCount; i++) {
+			if ( ! origin->arrivals[i].excluded)
+				candidates.push_back(i);
+		}
 
-			Arrival &arr = origin->arrivals[i];
-			if (arr.excluded)
-				continue;
-
-			OriginPtr copy = new Origin(*origin);
-			copy->arrivals[i].excluded = Arrival::ManuallyExcluded;
+		// The candidates are evaluated in arrival order so that the
+		// first of several equally good exclusions is chosen
+		// regardless of the number of threads
+		std::vector<OriginPtr> relocated = _relocateExcluding(origin, candidates);
+		for (size_t k=0; k<candidates.size(); k++) {
 
-			_relocator.useFixedDepth(false);
-			OriginPtr relo = _relocator.relocate(copy.get());
-			if ( ! relo) {
-				// try again, now using fixed depth (this sometimes helps)
-				// TODO: figure out why this sometimes helps and whether there is a better way
-				_relocator.useFixedDepth(true);
-				relo = _relocator.relocate(copy.get());
-				if ( ! relo)
-					continue;
-			}
+			const Origin *relo = relocated[k].get();
+			if ( ! relo)
+				continue;
 
-			double score = _score(relo.get());
+			double score = _score(relo);
 
 			if (score > bestScore) {
 				bestScore = score;
-				bestExcluded = i;
+				bestExcluded = int(candidates[k]);
 			}
-
-			arr.excluded = Arrival::NotExcluded;
 		}
 
 		if (bestExcluded == -1)
@@ -2474,6 +2518,69 @@ bool Autoloc3::_enhanceScore(Origin *origin, size_t maxloops)
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+std::vector<OriginPtr> Autoloc3::_relocateExcluding(const Origin *origin, const std::vector<size_t> &arrivals)
+{
+	std::vector<OriginPtr> result(arrivals.size());
+
+	// Locator::relocate() changes the fixed depth on a retry with the
+	// minimum depth. Every candidate starts from the fixed depth of the
+	// main locator such that the results do not depend on the candidates
+	// relocated before by the same locator, hence on the number of
+	// threads.
+	const double fixedDepth = _relocator.fixedDepth();
+
+	auto relocate = [origin, fixedDepth](Locator &locator, size_t i) {
+		OriginPtr copy = new Origin(*origin);
+		copy->arrivals[i].excluded = Arrival::ManuallyExcluded;
+
+		locator.setFixedDepth(fixedDepth, false);
+		OriginPtr relo = locator.relocate(copy.get());
+		if ( ! relo) {
+			// try again, now using fixed depth (this sometimes helps)
+			// TODO: figure out why this sometimes helps and whether there is a better way
+			locator.useFixedDepth(true);
+			relo = locator.relocate(copy.get());
+		}
+
+		return relo;
+	};
+
+	if (_locators.empty() || arrivals.size() < 2) {
+		for (size_t k=0; k<arrivals.size(); k++)
+			result[k] = relocate(_relocator, arrivals[k]);
+
+		// leave the main locator as the threads do
+		_relocator.setFixedDepth(fixedDepth, false);
+		return result;
+	}
+
+	// Every thread relocates with its own locator and takes the next
+	// pending arrival until all are done.
+	std::atomic<size_t> next {0};
+
+	bool registrationEnabled = Seiscomp::DataModel::PublicObject::IsRegistrationEnabled();
+	_workers.run(_locators.size(), [&](size_t from, size_t to) {
+		// The SC origins created during relocation are temporary.
+		// Don't register them in the global object pool which is
+		// not thread-safe.
+		Seiscomp::DataModel::PublicObject::SetRegistrationEnabled(false);
+
+		for (size_t t=from; t<to; t++) {
+			Locator &locator = *_locators[t];
+			for (size_t k=next++; k<arrivals.size(); k=next++)
+				result[k] = relocate(locator, arrivals[k]);
+		}
+	});
+	Seiscomp::DataModel::PublicObject::SetRegistrationEnabled(registrationEnabled);
+
+	return result;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void Autoloc3::_rename_P_PKP(Origin *origin)
 {
@@ -2905,6 +3012,8 @@ bool Autoloc3::setStation(Station *station) {
         _stations.insert(StationMap::value_type(key, station));
 
 	_relocator.setStation(station);
+	for (auto &locator : _locators)
+		locator->setStation(station);
 	_nucleator.setStation(station);
 
         SEISCOMP_DEBUG("Initialized station %-8s", key.c_str());
@@ -2920,6 +3029,8 @@ bool Autoloc3::setStation(Station *station) {
 void Autoloc3::setLocatorProfile(const std::string &profile) {
 	_nucleator.setLocatorProfile(profile);
 	_relocator.setProfile(profile);
+	for (auto &locator : _locators)
+		locator->setProfile(profile);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -2938,6 +3049,7 @@ void Autoloc3::setConfig(const Config &config) {
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool Autoloc3::setGridFile(const std::string &gridfile)
 {
+	_nucleator.setCacheFile(_config.gridCacheFile);
 	if ( ! _nucleator.setGridFile(gridfile))
 		return false;
 
@@ -2994,6 +3106,8 @@ void Autoloc3::reset()
 	_origins.clear();
 	_lastSent.clear();
 	pickPool.clear();
+	_pickTimes.clear();
+	_stationPickTimes.clear();
 	_blacklist.clear();
 	_newOrigins.clear();
 //	cleanup(now());
@@ -3011,6 +3125,7 @@ void Autoloc3::shutdown()
 	reset();
 	_associator.shutdown();
 	_nucleator.shutdown();
+	_workers.stop();
 
 	if (Pick::count()) {
 		SEISCOMP_WARNING("remaining pick count   = %d (should be zero)", Pick::count());
@@ -3043,13 +3158,32 @@ void Autoloc3::cleanup(Time minTime)
 	size_t beforeOriginCount = Origin::count();
 	size_t beforeObjectCount = Seiscomp::DataModel::PublicObject::ObjectCount();
 
-	PickPool tempPickPool;
-	for (auto& item : pickPool) {
-		if (item.second->time < minTime)
-			continue;
-		tempPickPool[item.first] = item.second;
+	// The oldest picks are at the front of the time index, so only
+	// the expired picks are visited
+	while ( ! _pickTimes.empty() && _pickTimes.begin()->first < minTime) {
+		const Pick *pick = _pickTimes.begin()->second;
+
+		auto sit = _stationPickTimes.find(pick->station());
+		if (sit != _stationPickTimes.end()) {
+			PickTimeIndex &index = sit->second;
+			auto range = index.equal_range(pick->time);
+			for (auto it = range.first; it != range.second; ++it) {
+				if (it->second == pick) {
+					index.erase(it);
+					break;
+				}
+			}
+
+			if (index.empty())
+				_stationPickTimes.erase(sit);
+		}
+
+		_pickTimes.erase(_pickTimes.begin());
+
+		// the pool may hold the last reference to the pick
+		std::string id = pick->id;
+		pickPool.erase(id);
 	}
-	pickPool = tempPickPool;
 
 	OriginVector _originsTmp;
 	for (OriginPtr origin : _origins) {
@@ -18,7 +18,11 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
+
+#include <seiscomp/private/workerpool.h>
 
 #include "datamodel.h"
 #include "nucleator.h"
@@ -160,6 +164,10 @@ class Autoloc3 {
 
 			double cleanupInterval{3600.0};
 
+			// Number of threads used for CPU intensive processing
+			// steps such as the grid search. 1 means no extra threads.
+			size_t threads{1};
+
 			double publicationIntervalTimeSlope{0.5};
 			double publicationIntervalTimeIntercept{0.0};
 			size_t publicationIntervalPickCount{20};
@@ -195,6 +203,10 @@ class Autoloc3 {
 			// The station configuration file
 			std::string staConfFile{"@DATADIR@/scautoloc/station.conf"};
 
+			// Binary cache of the nucleator grid and station set up.
+			// Empty means no cache.
+			std::string gridCacheFile{""};
+
 			// misc. experimental options
 			bool aggressivePKP{true};
 			bool reportAllPhases{true};
@@ -323,6 +335,12 @@ class Autoloc3 {
 		// Returns true if the score could be enhanced.
 		bool _enhanceScore(Origin *, size_t maxloops=0);
 
+		// Relocate the origin with each of the given arrivals
+		// excluded in turn. The relocations are done concurrently if
+		// several threads are configured. The results are returned
+		// in the order of the arrivals, null if a relocation failed.
+		std::vector<OriginPtr> _relocateExcluding(const Origin *, const std::vector<size_t> &arrivals);
+
 		// Rename P <-> PKP accoring to distance/traveltime
 		// FIXME: This is a hack we would want to avoid.
 		void _rename_P_PKP(Origin *);
@@ -387,6 +405,11 @@ class Autoloc3 {
 		// store a pick in internal buffer
 		bool _store(const Pick*);
 
+		// Returns the picks of the pick pool with a time within
+		// [from, to], only those of one station if specified. The
+		// picks are returned in the order of the pick pool.
+		std::vector<const Pick*> _pickRange(Time from, Time to, const Station *station=nullptr) const;
+
 		// store an origin in internal buffer
 		bool _store(Origin*);
 
@@ -484,6 +507,12 @@ class Autoloc3 {
 		GridSearch _nucleator;
 		Locator    _relocator;
 
+		// One locator per thread for concurrent relocations. The
+		// locators are only used if more than one thread is
+		// configured.
+		std::vector<std::unique_ptr<Locator>> _locators;
+		Seiscomp::Private::WorkerPool _workers;
+
 	private:
 		// origins that were created/modified during the last
 		// feed() call
@@ -500,6 +529,13 @@ class Autoloc3 {
 	protected:
 		typedef std::map<std::string, PickCPtr> PickPool;
 		PickPool pickPool;
+
+		// Time ordered indexes of the picks in the pick pool, overall
+		// and per station. The picks are owned by the pick pool.
+		typedef std::multimap<Time, const Pick*> PickTimeIndex;
+		PickTimeIndex _pickTimes;
+		std::map<const Station*, PickTimeIndex> _stationPickTimes;
+
 		std::string   _pickLogFilePrefix;
 		std::string   _pickLogFileName;
 		std::ofstream _pickLogFile;
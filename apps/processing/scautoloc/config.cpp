@@ -129,6 +129,8 @@ void Autoloc3::Config::dump() const {
 	SEISCOMP_INFO("    reportAllPhases                  %s",     reportAllPhases ? "true":"false");
 	SEISCOMP_INFO("    pickLogFile                      %s",     pickLogFile.size() ? pickLogFile.c_str() : "pick logging is disabled");
 	SEISCOMP_INFO("    dynamicPickThresholdInterval     %g",     dynamicPickThresholdInterval);
+	SEISCOMP_INFO("    threads                          %d",     int(threads));
+	SEISCOMP_INFO("    gridCacheFile                    %s",     gridCacheFile.size() ? gridCacheFile.c_str() : "grid cache is disabled");
 	SEISCOMP_INFO("  offline                            %s",     offline ? "true":"false");
 	SEISCOMP_INFO("  test                               %s",     test ? "true":"false");
 	SEISCOMP_INFO("  playback                           %s",     playback ? "true":"false");
@@ -21,6 +21,7 @@
 #include <cmath>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <set>
 #include <seiscomp/math/mean.h>
 #include "datamodel.h"
@@ -40,7 +41,8 @@ Station::Station(const std::string &code, const std::string &net, double lat, do
 
 
 
-static size_t _pickCount=0;
+// Picks and origins may be created and destroyed in worker threads
+static std::atomic<size_t> _pickCount {0};
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 Pick::Pick(const std::string &id, const std::string &label, const std::string &net, const std::string &sta, const Time &time)
@@ -149,7 +151,7 @@ bool ArrivalVector::sort()
 
 
 
-static size_t _originCount {0};
+static std::atomic<size_t> _originCount {0};
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 Origin::Origin(double lat, double lon, double dep, const Time &time)
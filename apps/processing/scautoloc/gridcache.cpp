@@ -0,0 +1,475 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+
+#define SEISCOMP_COMPONENT Autoloc
+#include <seiscomp/logging/log.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gridcache.h"
+
+
+namespace Autoloc {
+
+
+namespace {
+
+
+// File layout, all in native byte order:
+//
+//   Header
+//   GridRecord    x gridPointCount
+//   StationRecord x stationCount
+//   uint32        x entryCount   grid point index
+//   float         x entryCount   distance
+//   float         x entryCount   azimuth
+//   float         x entryCount   travel time
+//   float         x entryCount   horizontal slowness
+//   uint8         x entryCount   phase
+//
+// The version must be incremented with every change of the layout
+// or of the way the entries are computed.
+const char     Magic[8]  = { 'S', 'C', 'A', 'L', 'G', 'R', 'I', 'D' };
+const uint32_t Version   = 2;
+const uint32_t ByteOrder = 0x01020304;
+
+const size_t KeyLength = 32;
+
+
+struct Header {
+	char     magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t gridHash;
+	uint64_t travelTimeHash;
+	uint64_t gridPointCount;
+	uint64_t stationCount;
+	uint64_t entryCount;
+};
+
+struct GridRecord {
+	double   lat, lon, dep;
+	double   radius;
+	double   maxStaDist;
+	uint64_t nmin;
+};
+
+struct StationRecord {
+	// NET.STA, zero padded
+	char     key[KeyLength];
+	// what the entries of the station depend on
+	double   lat, lon;
+	double   maxNucDist;
+	uint64_t begin, end;
+};
+
+// The per entry arrays of a mapped file
+struct Entries {
+	const uint32_t        *gridpoint;
+	const float           *distance;
+	const float           *azimuth;
+	const float           *ttime;
+	const float           *hslow;
+	const NucleationPhase *phase;
+};
+
+const size_t EntrySize = sizeof(uint32_t) + 4*sizeof(float) + sizeof(uint8_t);
+
+static_assert(sizeof(Header) == 56, "unexpected grid cache header size");
+static_assert(sizeof(GridRecord) == 48, "unexpected grid cache record size");
+static_assert(sizeof(StationRecord) == 72, "unexpected grid cache record size");
+static_assert(sizeof(unsigned int) == sizeof(uint32_t), "unexpected grid point index size");
+static_assert(sizeof(NucleationPhase) == sizeof(uint8_t), "unexpected phase size");
+
+
+const Header *header(const char *data)
+{
+	return reinterpret_cast<const Header*>(data);
+}
+
+
+size_t entryOffset(const Header &h)
+{
+	return sizeof(Header)
+	     + h.gridPointCount * sizeof(GridRecord)
+	     + h.stationCount * sizeof(StationRecord);
+}
+
+
+const StationRecord *stationRecords(const char *data)
+{
+	return reinterpret_cast<const StationRecord*>(
+		data + sizeof(Header) + header(data)->gridPointCount * sizeof(GridRecord));
+}
+
+
+Entries entries(const char *data)
+{
+	const Header &h = *header(data);
+	const size_t n = h.entryCount;
+
+	Entries e;
+	e.gridpoint = reinterpret_cast<const uint32_t*>(data + entryOffset(h));
+	e.distance  = reinterpret_cast<const float*>(e.gridpoint + n);
+	e.azimuth   = e.distance + n;
+	e.ttime     = e.azimuth + n;
+	e.hslow     = e.ttime + n;
+	e.phase     = reinterpret_cast<const NucleationPhase*>(e.hslow + n);
+	return e;
+}
+
+
+}
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+GridCache::~GridCache()
+{
+	close();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool GridCache::open(const std::string &filename)
+{
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Header)) {
+		::close(fd);
+		SEISCOMP_WARNING_S("Ignoring invalid grid cache " + filename);
+		return false;
+	}
+
+	void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		SEISCOMP_WARNING_S("Failed to map grid cache " + filename);
+		return false;
+	}
+
+	_data = static_cast<const char*>(data);
+	_size = st.st_size;
+
+	const Header &h = *header(_data);
+	if (memcmp(h.magic, Magic, sizeof(Magic)) != 0 ||
+	    h.version != Version || h.byteOrder != ByteOrder ||
+	    // guard the size computation against garbage
+	    h.gridPointCount > _size || h.stationCount > _size ||
+	    h.entryCount > _size ||
+	    entryOffset(h) + h.entryCount * EntrySize != _size) {
+		SEISCOMP_WARNING_S("Ignoring invalid or outdated grid cache " + filename);
+		close();
+		return false;
+	}
+
+	// Validate everything once, the stations are read one by one
+	// later on and a damaged file must not leave a partially filled
+	// table behind.
+	const StationRecord *records = stationRecords(_data);
+	uint64_t expectedBegin = 0;
+	for (size_t i=0; i<h.stationCount; i++) {
+		const StationRecord &r = records[i];
+		if (r.key[KeyLength-1] != '\0' || r.begin != expectedBegin ||
+		    r.end < r.begin || r.end > h.entryCount ||
+		    ! _index.insert(std::make_pair(std::string(r.key), i)).second) {
+			SEISCOMP_WARNING("Grid cache: invalid station record %d", int(i));
+			close();
+			return false;
+		}
+		expectedBegin = r.end;
+	}
+
+	if (expectedBegin != h.entryCount) {
+		SEISCOMP_WARNING("Grid cache: inconsistent entry count");
+		close();
+		return false;
+	}
+
+	const Entries e = entries(_data);
+	for (size_t i=0; i<h.entryCount; i++) {
+		if (e.gridpoint[i] >= h.gridPointCount ||
+		    e.phase[i] > NucleationPhase::Other) {
+			SEISCOMP_WARNING("Grid cache: invalid entry %d", int(i));
+			close();
+			return false;
+		}
+	}
+
+	_key.grid = h.gridHash;
+	_key.travelTimes = h.travelTimeHash;
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void GridCache::close()
+{
+	_index.clear();
+
+	if ( ! _data)
+		return;
+
+	munmap(const_cast<char*>(_data), _size);
+	_data = nullptr;
+	_size = 0;
+	_key = Key();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+const GridCache::Key &GridCache::key() const
+{
+	return _key;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t GridCache::gridPointCount() const
+{
+	return _data ? header(_data)->gridPointCount : 0;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t GridCache::stationCount() const
+{
+	return _data ? header(_data)->stationCount : 0;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool GridCache::readGrid(Grid &grid) const
+{
+	if ( ! _data)
+		return false;
+
+	const Header &h = *header(_data);
+	const GridRecord *records =
+		reinterpret_cast<const GridRecord*>(_data + sizeof(Header));
+
+	grid.clear();
+	grid.reserve(h.gridPointCount);
+	for (size_t i=0; i<h.gridPointCount; i++) {
+		const GridRecord &r = records[i];
+		GridPoint *gp = new GridPoint(r.lat, r.lon, r.dep);
+		gp->_nmin = r.nmin;
+		gp->_radius = r.radius;
+		gp->maxStaDist = r.maxStaDist;
+		grid.push_back(gp);
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+StationTable::StationID GridCache::readStation(const Station *station,
+                                               StationTable &table) const
+{
+	if ( ! _data)
+		return StationTable::NoStation;
+
+	std::map<std::string, size_t>::const_iterator it =
+		_index.find(station->net + "." + station->code);
+	if (it == _index.end())
+		return StationTable::NoStation;
+
+	const StationRecord &r = stationRecords(_data)[it->second];
+	if (r.lat != station->lat || r.lon != station->lon ||
+	    r.maxNucDist != station->maxNucDist) {
+		SEISCOMP_DEBUG("Grid cache: station %s changed", r.key);
+		return StationTable::NoStation;
+	}
+
+	const Entries e = entries(_data);
+	StationTable::StationID id = table.addStation(station);
+	for (size_t i=r.begin; i<r.end; i++)
+		table.append(e.gridpoint[i], e.distance[i], e.azimuth[i],
+		             e.ttime[i], e.hslow[i], e.phase[i]);
+
+	return id;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool GridCache::write(const std::string &filename, const Key &key,
+                      const Grid &grid, const StationTable &table,
+                      const GridCache *previous)
+{
+	std::vector<GridRecord> gridRecords(grid.size());
+	for (size_t i=0; i<grid.size(); i++) {
+		const GridPoint *gp = grid[i].get();
+		GridRecord &r = gridRecords[i];
+		r.lat = gp->hypocenter.lat;
+		r.lon = gp->hypocenter.lon;
+		r.dep = gp->hypocenter.dep;
+		r.radius = gp->_radius;
+		r.maxStaDist = gp->maxStaDist;
+		r.nmin = gp->_nmin;
+	}
+
+	std::vector<StationRecord> records(table.stationCount());
+	std::set<std::string> keys;
+	for (size_t i=0; i<table.stationCount(); i++) {
+		const Station *station = table.station(i);
+		const std::string key = station->net + "." + station->code;
+		StationRecord &r = records[i];
+		if (key.size() >= KeyLength) {
+			SEISCOMP_WARNING_S("Grid cache: station code too long: " + key);
+			return false;
+		}
+		memset(r.key, 0, KeyLength);
+		memcpy(r.key, key.c_str(), key.size());
+		r.lat = station->lat;
+		r.lon = station->lon;
+		r.maxNucDist = station->maxNucDist;
+		r.begin = table.begin(i);
+		r.end = table.end(i);
+		keys.insert(key);
+	}
+
+	// Stations of a previous cache with the same key which are not in
+	// the table, e.g. stations which did not pick since the last start.
+	// Their entries are appended in the order of their records.
+	std::vector<const StationRecord*> kept;
+	if (previous && previous->isOpen() &&
+	    previous->key().grid == key.grid &&
+	    previous->key().travelTimes == key.travelTimes) {
+		const StationRecord *previousRecords = stationRecords(previous->_data);
+		uint64_t begin = table.size();
+		for (size_t i=0; i<previous->stationCount(); i++) {
+			const StationRecord &p = previousRecords[i];
+			if (keys.count(p.key))
+				continue;
+			kept.push_back(&p);
+			records.push_back(p);
+			records.back().begin = begin;
+			records.back().end = begin += p.end - p.begin;
+		}
+	}
+
+	Header h;
+	memcpy(h.magic, Magic, sizeof(Magic));
+	h.version = Version;
+	h.byteOrder = ByteOrder;
+	h.gridHash = key.grid;
+	h.travelTimeHash = key.travelTimes;
+	h.gridPointCount = grid.size();
+	h.stationCount = records.size();
+	h.entryCount = records.empty() ? 0 : records.back().end;
+
+	const std::string tmpname = filename + ".tmp";
+	std::ofstream ofile(tmpname.c_str(), std::ios::binary | std::ios::trunc);
+	if ( ! ofile.is_open()) {
+		SEISCOMP_WARNING_S("Failed to write grid cache " + tmpname);
+		return false;
+	}
+
+	auto put = [&ofile](const void *data, size_t size) {
+		ofile.write(static_cast<const char*>(data), size);
+	};
+
+	// One entry array after the other, first the entries of the table
+	// and then those of the kept stations
+	auto putEntries = [&](const void *tableData, const void *previousData, size_t size) {
+		put(tableData, table.size()*size);
+		for (const StationRecord *p : kept)
+			put(static_cast<const char*>(previousData) + p->begin*size,
+			    (p->end - p->begin)*size);
+	};
+
+	Entries e{};
+	if ( ! kept.empty())
+		e = entries(previous->_data);
+
+	put(&h, sizeof(h));
+	put(gridRecords.data(), gridRecords.size()*sizeof(GridRecord));
+	put(records.data(), records.size()*sizeof(StationRecord));
+	putEntries(table.gridpoint.data(), e.gridpoint, sizeof(uint32_t));
+	putEntries(table.distance.data(), e.distance, sizeof(float));
+	putEntries(table.azimuth.data(), e.azimuth, sizeof(float));
+	putEntries(table.ttime.data(), e.ttime, sizeof(float));
+	putEntries(table.hslow.data(), e.hslow, sizeof(float));
+	putEntries(table.phase.data(), e.phase, sizeof(NucleationPhase));
+	ofile.close();
+
+	if ( ! ofile.good() || rename(tmpname.c_str(), filename.c_str()) != 0) {
+		SEISCOMP_WARNING_S("Failed to write grid cache " + filename);
+		unlink(tmpname.c_str());
+		return false;
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+uint64_t GridCache::hash(const void *data, size_t size, uint64_t seed)
+{
+	const unsigned char *p = static_cast<const unsigned char*>(data);
+	uint64_t h = seed;
+	for (size_t i=0; i<size; i++) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+}
@@ -0,0 +1,104 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+
+
+#ifndef _SEISCOMP_AUTOLOC_GRIDCACHE_
+#define _SEISCOMP_AUTOLOC_GRIDCACHE_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "nucleator.h"
+
+
+namespace Autoloc {
+
+
+// Binary cache of the nucleator grid and the station table.
+//
+// The grid file and the station/grid point pairs of the stations set
+// up so far are written to a versioned binary file, which is mapped
+// into memory when scautoloc starts again. The cache is only used if
+// the grid file and the travel time table are the same as when the
+// cache was written, which is checked by means of hash values stored
+// in the file header. A cached station is only used if its location
+// and its maximum nucleation distance did not change.
+class GridCache
+{
+	public:
+		struct Key {
+			// hash of the grid file content
+			uint64_t grid{0};
+			// hash of reference travel times
+			uint64_t travelTimes{0};
+		};
+
+	public:
+		GridCache() = default;
+		GridCache(const GridCache&) = delete;
+		GridCache &operator=(const GridCache&) = delete;
+		~GridCache();
+
+	public:
+		// Map a cache file read-only into memory. Returns false if
+		// the file does not exist or is not a valid cache file of
+		// the current format version.
+		bool open(const std::string &filename);
+		void close();
+
+		bool isOpen() const { return _data != nullptr; }
+
+		// The key the cache was written with
+		const Key &key() const;
+
+		size_t gridPointCount() const;
+		size_t stationCount() const;
+
+		// Create the grid points from the cache
+		bool readGrid(Grid &grid) const;
+
+		// Add a cached station with its entries to the table. Returns
+		// NoStation if the station is not in the cache or if it has
+		// been moved or got another maximum nucleation distance.
+		StationTable::StationID readStation(const Station *station,
+		                                    StationTable &table) const;
+
+	public:
+		// Write grid and station table to a cache file. The stations
+		// of a previous cache which are not in the table are written
+		// as well. The file is written under a temporary name first
+		// and then renamed such that a concurrently starting instance
+		// never sees a partial file.
+		static bool write(const std::string &filename, const Key &key,
+		                  const Grid &grid, const StationTable &table,
+		                  const GridCache *previous=nullptr);
+
+		// 64 bit FNV-1a hash, 'seed' allows to hash several chunks
+		static uint64_t hash(const void *data, size_t size,
+		                     uint64_t seed=14695981039346656037ULL);
+
+	private:
+		const char *_data{nullptr};
+		size_t      _size{0};
+		Key         _key;
+		// record index of each cached station by NET.STA
+		std::map<std::string, size_t> _index;
+};
+
+
+}
+
+#endif
@@ -65,6 +65,10 @@ class Locator {
 			_sclocator->useFixedDepth(use);
 		}
 
+		double fixedDepth() const {
+			return _sclocator->fixedDepth();
+		}
+
 	public:
 		Origin *relocate(const Origin *origin);
 
@@ -16,6 +16,8 @@
 #define SEISCOMP_COMPONENT Autoloc
 #include <seiscomp/logging/log.h>
 #include <seiscomp/core/strings.h>
+#include <seiscomp/core/datetime.h>
+#include <seiscomp/utils/files.h>
 
 #include <iostream>
 #include <fstream>
@@ -24,12 +26,17 @@
 #include <vector>
 #include <set>
 #include <list>
+#include <deque>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
 #include <cmath>
 
 #include "util.h"
 #include "sc3adapters.h"
 #include "locator.h"
 #include "nucleator.h"
+#include "gridcache.h"
 
 
 namespace Autoloc {
@@ -46,6 +53,89 @@ static std::string station_key (const Station *station)
 
 typedef std::set<PickCPtr> PickSet;
 
+
+// The grid cache is written as soon as a station was set up. Stations
+// set up within this number of seconds after that are collected before
+// the cache is written again.
+static const double CacheWriteInterval = 60;
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+StationTable::StationID StationTable::id(const Station *station) const
+{
+	std::map<std::string, StationID>::const_iterator
+		it = _ids.find(station_key(station));
+	if (it == _ids.end())
+		return NoStation;
+	return (*it).second;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+StationTable::StationID StationTable::addStation(const Station *station)
+{
+	StationID id = _stations.size();
+	_ids[station_key(station)] = id;
+	_stations.push_back(station);
+	_offsets.push_back(gridpoint.size());
+	return id;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void StationTable::append(unsigned int gp, float dist, float azi,
+                          float tt, float slo, NucleationPhase ph)
+{
+	gridpoint.push_back(gp);
+	distance.push_back(dist);
+	azimuth.push_back(azi);
+	ttime.push_back(tt);
+	hslow.push_back(slo);
+	phase.push_back(ph);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t StationTable::memoryUsage() const
+{
+	return gridpoint.capacity() * sizeof(unsigned int)
+	     + (distance.capacity() + azimuth.capacity()
+	        + ttime.capacity() + hslow.capacity()) * sizeof(float)
+	     + phase.capacity() * sizeof(NucleationPhase)
+	     + _offsets.capacity() * sizeof(size_t)
+	     + _stations.capacity() * sizeof(const Station*);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void StationTable::clear()
+{
+	gridpoint.clear();
+	distance.clear();
+	azimuth.clear();
+	ttime.clear();
+	hslow.clear();
+	phase.clear();
+	_ids.clear();
+	_stations.clear();
+	_offsets.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void Nucleator::setStation(const Station *station)
 {
@@ -81,6 +171,7 @@ void GridSearch::setStation(const Station *station)
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 GridSearch::GridSearch()
+: _cache(new GridCache)
 {
 //	_stations = 0;
 	_abort = false;
@@ -90,6 +181,15 @@ GridSearch::GridSearch()
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+GridSearch::~GridSearch()
+{
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void GridSearch::setSeiscompConfig(const Seiscomp::Config::Config *scconfig) {
 	_scconfig = scconfig;
@@ -108,6 +208,8 @@ bool GridSearch::init()
 		return false;
 	}
 
+	_workers.start(_config.threads);
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -150,11 +252,12 @@ int GridSearch::cleanup(const Time& minTime)
 
 
 
-static size_t _projectedPickCount {0};
+// GridPoint::feed() may be called concurrently for different grid points
+static std::atomic<size_t> _projectedPickCount {0};
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 ProjectedPick::ProjectedPick(const Time &t)
-	: _projectedTime(t)
+	: distance(0), azimuth(0), hslow(0), _projectedTime(t)
 {
 	_projectedPickCount++;
 }
@@ -164,8 +267,9 @@ ProjectedPick::ProjectedPick(const Time &t)
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-ProjectedPick::ProjectedPick(PickCPtr p, StationWrapperCPtr w)
-	: p(p), wrapper(w), _projectedTime(p->time - w->ttime)
+ProjectedPick::ProjectedPick(PickCPtr p, const StationTable &table, size_t entry)
+	: p(p), distance(table.distance[entry]), azimuth(table.azimuth[entry]),
+	  hslow(table.hslow[entry]), _projectedTime(p->time - table.ttime[entry])
 {
 	_projectedPickCount++;
 }
@@ -176,7 +280,8 @@ ProjectedPick::ProjectedPick(PickCPtr p, StationWrapperCPtr w)
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 ProjectedPick::ProjectedPick(const ProjectedPick &other)
-	: p(other.p), wrapper(other.wrapper), _projectedTime(other._projectedTime)
+	: p(other.p), distance(other.distance), azimuth(other.azimuth),
+	  hslow(other.hslow), _projectedTime(other._projectedTime)
 {
 	_projectedPickCount++;
 }
@@ -205,10 +310,50 @@ size_t ProjectedPick::Count()
 
 
 
+// Scratch buffers of the cluster test in GridPoint::feed(), holding the
+// picks of the time window around the new pick. Grid points are fed
+// concurrently, so there is one set of buffers per thread, which is
+// reused for all grid points processed by that thread.
+struct ClusterScratch {
+	std::vector<double>        time, azimuth, slowness;
+	std::vector<unsigned char> isNew, flag;
+
+	void resize(size_t n) {
+		time.resize(n);
+		azimuth.resize(n);
+		slowness.resize(n);
+		isNew.resize(n);
+		flag.resize(n);
+	}
+};
+
+static thread_local ClusterScratch _clusterScratch;
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-GridPoint::GridPoint(double latitude, double longitude, double depth)
-	: hypocenter(latitude, longitude, depth), _radius(4), _dt(50), maxStaDist(180), _nmin(6)
+// Test whether the projected picks i and k with index i <= k belong to
+// the same cluster. The tolerance grows with the slowness and the
+// azimuth difference. Note that the azimuth difference is not symmetric
+// in i and k, so the order matters.
+//
+// For azimuths within [0,360] the argument of the original
+// fmod(x, 360.) lies within [-180,540] and its result is exactly
+// x or x-360. The select below therefore yields bit for bit the same
+// result at a fraction of the cost.
+static inline bool clustered(double t_i, double azi_i, double slo_i,
+                             double t_k, double azi_k, double slo_k,
+                             double radius)
 {
+	const double dt0 = 4; // XXX
+
+	double x = (azi_k-azi_i)+180.;
+	x -= x >= 360. ? 360. : 0.;
+	double azi_diff = std::abs(x-180.);
+	double dtmax = radius*(slo_i+slo_k) * azi_diff/90. + dt0;
+
+	return std::abs(t_i-t_k) < dtmax;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -216,124 +361,132 @@ GridPoint::GridPoint(double latitude, double longitude, double depth)
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-const Origin*
-GridPoint::feed(const Pick* pick)
+// Flag all picks clustered with (any instance of) the new pick and
+// return the number of flagged picks.
+static size_t clusterFlags(ClusterScratch &s, size_t n, double radius)
 {
-	// find the station corresponding to the pick
-	const std::string key = station_key(pick->station());
+	const double *t = s.time.data(), *azi = s.azimuth.data(), *slo = s.slowness.data();
+	unsigned char *flag = s.flag.data();
 
-	std::map<std::string, StationWrapperCPtr>::const_iterator
-		xit = _wrappers.find(key);
-	if (xit==_wrappers.end())
-		// this grid cell may be out of range for that station
-		return nullptr;
-	StationWrapperCPtr wrapper = (*xit).second;
-	if ( ! wrapper->station ) {
-		SEISCOMP_ERROR("Nucleator: station '%s' not found", key.c_str());
-		return nullptr;
+	std::fill(s.flag.begin(), s.flag.begin()+n, 0);
+
+	for (size_t y=0; y<n; y++) {
+		if ( ! s.isNew[y])
+			continue;
 
+		for (size_t x=0; x<y; x++)
+			flag[x] |= clustered(t[x], azi[x], slo[x], t[y], azi[y], slo[y], radius);
+		for (size_t x=y; x<n; x++)
+			flag[x] |= clustered(t[y], azi[y], slo[y], t[x], azi[x], slo[x], radius);
 	}
 
-	// At this point we hold a "wrapper" which wraps a station and adds a
-	// fews grid-point specific attributes such as the distance from this
-	// gridpoint to the station etc.
+	size_t sum = 0;
+	for (size_t x=0; x<n; x++)
+		sum += flag[x];
 
-	// If the station distance exceeds the maximum station distance
-	// configured for the grid point...
-	if ( wrapper->distance > maxStaDist )
-		return nullptr;
+	return sum;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
-	// If the station distance exceeds the maximum nucleation distance
-	// configured for the station...
-	if ( wrapper->distance > wrapper->station->maxNucDist )
-		return nullptr;
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+// Count the picks clustered with pick x. As in the full pairwise test
+// the pick counts twice with itself.
+static size_t clusterCount(const ClusterScratch &s, size_t x, size_t n, double radius)
+{
+	const double *t = s.time.data(), *azi = s.azimuth.data(), *slo = s.slowness.data();
+	size_t count = 0;
+
+	for (size_t k=0; k<x; k++)
+		count += clustered(t[k], azi[k], slo[k], t[x], azi[x], slo[x], radius);
+	for (size_t k=x; k<n; k++)
+		count += clustered(t[x], azi[x], slo[x], t[k], azi[k], slo[k], radius);
+	count += clustered(t[x], azi[x], slo[x], t[x], azi[x], slo[x], radius);
+
+	return count;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+GridPoint::GridPoint(double latitude, double longitude, double depth)
+	: hypocenter(latitude, longitude, depth), _radius(4), _dt(50), maxStaDist(180), _nmin(6)
+{
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+const Origin*
+GridPoint::feed(const Pick* pick, const StationTable &table, size_t entry)
+{
+	// The table entry holds a few grid-point specific attributes of the
+	// station of the pick such as the distance from this gridpoint to
+	// the station etc. It only exists if the station is within range of
+	// this grid point, i.e. within maxStaDist and maxNucDist.
 
 	// back-project pick to hypothetical origin time
-	ProjectedPick pp(pick, wrapper);
+	ProjectedPick pp(pick, table, entry);
 
-	// store newly inserted pick
-	/* std::multiset<ProjectedPick>::iterator latest = */ _picks.insert(pp);
+	// store newly inserted pick behind all picks with the same or an
+	// earlier projected time
+	_picks.insert(std::upper_bound(_picks.begin(), _picks.end(), pp), pp);
 
 	// roughly test if there is a cluster around the new pick
-	std::vector<ProjectedPick> pps;
-	std::multiset<ProjectedPick>::iterator it,
-		lower  = _picks.lower_bound(pp.projectedTime() - _dt),
-		upper  = _picks.upper_bound(pp.projectedTime() + _dt);
-	for (it=lower; it!=upper; ++it)
-		pps.push_back(*it);
-	size_t npick = pps.size();
+	const Time tmin = pp.projectedTime() - _dt, tmax = pp.projectedTime() + _dt;
+	std::deque<ProjectedPick>::const_iterator
+		lower = std::lower_bound(_picks.begin(), _picks.end(), tmin,
+			[](const ProjectedPick &p, const Time &t) { return p.projectedTime() < t; }),
+		upper = std::upper_bound(lower, _picks.cend(), tmax,
+			[](const Time &t, const ProjectedPick &p) { return t < p.projectedTime(); });
+	size_t npick = upper - lower;
 
 	// if the number of picks around the new pick is too low...
 	if (npick < _nmin)
 		return nullptr;
 
 	// now take a closer look at how tightly clustered the picks are
-	double dt0 = 4; // XXX
-	std::vector<size_t> _cnt(npick);
-	std::vector<size_t> _flg(npick);
+	ClusterScratch &scratch = _clusterScratch;
+	scratch.resize(npick);
 	for (size_t i=0; i<npick; i++) {
-		_cnt[i] = _flg[i] = 0;
-	}
-	for (size_t i=0; i<npick; i++) {
-
-		ProjectedPick &ppi = pps[i];
-		double t_i   = ppi.projectedTime();
-		double azi_i = ppi.wrapper->azimuth;
-		double slo_i = ppi.wrapper->hslow;
-
-		for (size_t k=i; k<npick; k++) {
-
-			ProjectedPick &ppk = pps[k];
-			double t_k   = ppk.projectedTime();
-			double azi_k = ppk.wrapper->azimuth;
-			double slo_k = ppk.wrapper->hslow;
-
-			double azi_diff = std::abs(fmod(((azi_k-azi_i)+180.), 360.)-180.);
-			double dtmax = _radius*(slo_i+slo_k) * azi_diff/90. + dt0;
-
-			if (std::abs(t_i-t_k) < dtmax) {
-				_cnt[i]++;
-				_cnt[k]++;
-
-				if (ppi.p == pp.p || ppk.p == pp.p)
-					_flg[k] = _flg[i] = 1;
-			}
-		}
+		const ProjectedPick &ppi = *(lower+i);
+		scratch.time[i]     = ppi.projectedTime();
+		scratch.azimuth[i]  = ppi.azimuth;
+		scratch.slowness[i] = ppi.hslow;
+		scratch.isNew[i]    = ppi.p == pp.p;
 	}
 
-	size_t sum=0;
-	for (size_t i=0; i<npick; i++)
-		sum += _flg[i];
-	if (sum < _nmin)
+	// Flag all picks clustered with the new pick. Unless there are
+	// enough of them there is no need to look at the other pairs.
+	if (clusterFlags(scratch, npick, _radius) < _nmin)
 		return nullptr;
 
-	std::vector<ProjectedPick> group;
 	size_t cntmax = 0;
 	Time otime;
+	std::vector<const ProjectedPick*> group;
 	for (size_t i=0; i<npick; i++) {
-		if ( ! _flg[i])
+		if ( ! scratch.flag[i])
 			continue;
-		group.push_back(pps[i]);
-		if (_cnt[i] > cntmax) {
-			cntmax = _cnt[i];
-			otime = pps[i].projectedTime();
+		group.push_back(&*(lower+i));
+		size_t cnt = clusterCount(scratch, i, npick, _radius);
+		if (cnt > cntmax) {
+			cntmax = cnt;
+			otime = scratch.time[i];
 		}
 	}
 
-
-// vvvvvvvvvvvvv Iteration
-
-	std::vector<double> ptime(npick);
-	for (size_t i=0; i<npick; i++) {
-		ptime[i] = pps[i].projectedTime();
-	}
-
 	Origin* _origin = new Origin(hypocenter.lat, hypocenter.lon, hypocenter.dep, otime);
 
 	// add Picks/Arrivals to that newly created Origin
 	std::set<std::string> stations;
 	for (size_t i=0; i<group.size(); i++) {
-		const ProjectedPick &pp = group[i];
+		const ProjectedPick &pp = *group[i];
 
 		PickCPtr pick = pp.p;
 		const std::string key = station_key(pick->station());
@@ -342,12 +495,10 @@ GridPoint::feed(const Pick* pick)
 			continue;
 		stations.insert(key);
 
-		StationWrapperCPtr sw( _wrappers[key]);
-
 		Arrival arr(pick.get());
 		arr.residual = pp.projectedTime() - otime;
-		arr.distance = sw->distance;
-		arr.azimuth  = sw->azimuth;
+		arr.distance = pp.distance;
+		arr.azimuth  = pp.azimuth;
 		arr.excluded = Arrival::NotExcluded;
 		arr.phase = (pick->time - otime < 960.) ? "P" : "PKP";
 //		arr.weight   = 1;
@@ -371,12 +522,11 @@ int GridPoint::cleanup(const Time& minTime)
 {
 	int count = 0;
 
-	// this is for counting only
-	std::multiset<ProjectedPick>::iterator it, upper=_picks.upper_bound(minTime);
-	for (it=_picks.begin(); it!=upper; ++it)
+	// the picks are sorted by projected time
+	while ( ! _picks.empty() && _picks.front().projectedTime() <= minTime ) {
+		_picks.pop_front();
 		count++;
-
-	_picks.erase(_picks.begin(), upper);
+	}
 
 	return count;
 }
@@ -386,7 +536,24 @@ int GridPoint::cleanup(const Time& minTime)
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-bool GridPoint::setupStation(const Station *station)
+static NucleationPhase nucleationPhase(const std::string &phase)
+{
+	if (phase == "P")
+		return NucleationPhase::P;
+	if (phase == "Pdiff")
+		return NucleationPhase::Pdiff;
+	if (phase.substr(0,2) == "PK")
+		return NucleationPhase::PKP;
+	return NucleationPhase::Other;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool GridPoint::setupStation(const Station *station, unsigned int index,
+                             StationTable &table) const
 {
 	double delta=0, az=0, baz=0;
 	delazi(&hypocenter, station, delta, az, baz);
@@ -397,13 +564,16 @@ bool GridPoint::setupStation(const Station *station)
 	if ( delta > station->maxNucDist )
 		return false;
 
+	// A pick from a station beyond the maximum station distance
+	// of the grid point would be ignored anyway
+	if ( delta > maxStaDist )
+		return false;
+
 	TravelTime tt;
 	if ( ! travelTimeP(hypocenter.lat, hypocenter.lon, hypocenter.dep, station->lat, station->lon, 0, delta, tt))
 		return false;
 
-	StationWrapperCPtr sw = new StationWrapper(station, tt.phase, delta, az, tt.time, tt.dtdd);
-	std::string key = station_key (sw->station);
-	_wrappers[key] = sw;
+	table.append(index, delta, az, tt.time, tt.dtdd, nucleationPhase(tt.phase));
 
 	return true;
 }
@@ -642,29 +812,36 @@ bool GridSearch::feed(const Pick *pick)
 	}
 
 
-	// Has the station been configured already? If not, do it now.
-
-	bool stationSetupNeeded = false;
-	if (_configuredStations.find(net_sta) == _configuredStations.end()) {
-		_configuredStations.insert(net_sta);
-		stationSetupNeeded = true;
-		SEISCOMP_DEBUG_S("GridSearch: setting up station " + net_sta);
-	}
-
-	std::map<PickSet, OriginPtr> pickSetOriginMap;
+	// Only the grid points within range of the station need to be
+	// visited. The station is set up here if not done already.
+	StationTable::StationID id = _setupStation(pick->station());
+	const size_t begin = _stationTable.begin(id);
+	const size_t end = _stationTable.end(id);
 
 	// Main loop
 	//
-	// Feed the new pick into the individual grid points
-	// and save all "candidate" origins in originVector
+	// Feed the new pick into the individual grid points. The grid points
+	// are independent of each other and are processed by the worker pool.
+	// Each candidate origin is stored in the slot of its grid point such
+	// that the merging below sees them in grid order, independent of the
+	// number of threads. Several chunks per thread balance the uneven
+	// work load of the grid points.
+
+	std::vector<OriginCPtr> candidates(end-begin);
+	const size_t chunk = (end-begin) / (8*_workers.threadCount());
+	_workers.run(end-begin, [&](size_t from, size_t to) {
+		for (size_t i=from; i<to; i++) {
+			const size_t entry = begin + i;
+			GridPoint *gp = _grid[_stationTable.gridpoint[entry]].get();
+			candidates[i] = gp->feed(pick, _stationTable, entry);
+		}
+	}, chunk);
 
-	double maxScore = 0;
-	for (GridPointPtr &gp : _grid) {
+	std::map<PickSet, OriginPtr> pickSetOriginMap;
 
-		if (stationSetupNeeded)
-			gp->setupStation(pick->station());
+	double maxScore = 0;
+	for (OriginCPtr &origin : candidates) {
 
-		OriginCPtr origin = gp->feed(pick);
 		if ( ! origin)
 			continue;
 
@@ -764,12 +941,87 @@ bool GridSearch::feed(const Pick *pick)
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+StationTable::StationID GridSearch::_setupStation(const Station *station)
+{
+	StationTable::StationID id = _stationTable.id(station);
+	if (id != StationTable::NoStation) {
+		_updateCache();
+		return id;
+	}
+
+	const std::string key = station_key(station);
+	SEISCOMP_DEBUG_S("GridSearch: setting up station " + key);
+	_configuredStations.insert(key);
+
+	Seiscomp::Core::Time start = Seiscomp::Core::Time::GMT();
+
+	// A station set up in an earlier run is taken from the cache
+	id = _cache->readStation(station, _stationTable);
+	if (id != StationTable::NoStation) {
+		_cachedStationCount++;
+		SEISCOMP_DEBUG("GridSearch: station %s read from grid cache, %d entries "
+		               "in %.1f ms", key.c_str(),
+		               int(_stationTable.end(id)-_stationTable.begin(id)),
+		               double(Seiscomp::Core::Time::GMT() - start)*1000);
+		return id;
+	}
+
+	// The travel time computation is not thread safe, so the station
+	// is set up sequentially. This happens only once per station.
+	id = _stationTable.addStation(station);
+	for (size_t i=0; i<_grid.size(); i++)
+		_grid[i]->setupStation(station, i, _stationTable);
+	_unsavedStationCount++;
+	_updateCache();
+
+	double elapsed = double(Seiscomp::Core::Time::GMT() - start);
+	SEISCOMP_DEBUG("GridSearch: station %s reaches %d of %d grid points, "
+	               "setup took %.1f ms, station table now %d entries in %.1f kB",
+	               key.c_str(), int(_stationTable.end(id)-_stationTable.begin(id)),
+	               int(_grid.size()), elapsed*1000, int(_stationTable.size()),
+	               _stationTable.memoryUsage()/1024.);
+
+	return id;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+// Fingerprint of the travel time table used to set up the stations,
+// computed from a few reference travel times
+static uint64_t travelTimeHash()
+{
+	uint64_t hash = GridCache::hash(nullptr, 0);
+
+	const double depths[] = { 0, 100, 600 };
+	const double deltas[] = { 1, 30, 100, 150 };
+	for (double dep : depths) {
+		for (double delta : deltas) {
+			TravelTime tt;
+			if ( ! travelTimeP(0, 0, dep, 0, delta, 0, delta, tt))
+				continue;
+			hash = GridCache::hash(&tt.time, sizeof(tt.time), hash);
+			hash = GridCache::hash(&tt.dtdd, sizeof(tt.dtdd), hash);
+			hash = GridCache::hash(tt.phase.data(), tt.phase.size(), hash);
+		}
+	}
+
+	return hash;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool GridSearch::_readGrid(const std::string &gridfile)
 {
-	std::ifstream ifile(gridfile.c_str());
+	std::ifstream gfile(gridfile.c_str(), std::ios::binary);
 
-	if ( ifile.good() ) {
+	if ( gfile.good() ) {
 		SEISCOMP_DEBUG_S("Reading grid file for nucleator: " + gridfile);
 	}
 	else {
@@ -777,7 +1029,40 @@ bool GridSearch::_readGrid(const std::string &gridfile)
 		return false;
 	}
 
+	// The content is needed as a whole to identify the grid in the cache
+	const std::string content((std::istreambuf_iterator<char>(gfile)),
+	                          std::istreambuf_iterator<char>());
+	_gridHash = GridCache::hash(content.data(), content.size());
+
 	_grid.clear();
+	_stationTable.clear();
+	_configuredStations.clear();
+	_cachedStationCount = 0;
+	_unsavedStationCount = 0;
+	_cache->close();
+
+	if ( ! _cacheFile.empty() && _cache->open(_cacheFile) ) {
+		// The stations of the cache are used as they are set up if
+		// grid and travel times did not change
+		_travelTimeHash = travelTimeHash();
+		const GridCache::Key &key = _cache->key();
+		bool gridValid = key.grid == _gridHash && _cache->readGrid(_grid);
+		if ( ! gridValid || key.travelTimes != _travelTimeHash) {
+			SEISCOMP_INFO_S("Grid cache " + _cacheFile + " is outdated and will be rewritten");
+			_cache->close();
+		}
+		else
+			SEISCOMP_INFO("Grid cache %s holds %d stations", _cacheFile.c_str(),
+			              int(_cache->stationCount()));
+
+		if (gridValid) {
+			SEISCOMP_DEBUG("read %d grid points from cache %s",
+			               int(_grid.size()), _cacheFile.c_str());
+			return true;
+		}
+	}
+
+	std::istringstream ifile(content);
 	double lat, lon, dep, rad, dmax; int nmin;
 	while ( ! ifile.eof() ) {
 		std::string line;
@@ -809,6 +1094,57 @@ bool GridSearch::_readGrid(const std::string &gridfile)
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool GridSearch::_writeCache()
+{
+	// nothing new since the cache was read or written
+	if ( _cacheFile.empty() || _grid.empty() || _unsavedStationCount == 0 )
+		return false;
+
+	_unsavedStationCount = 0;
+	_cacheWriteTime = Seiscomp::Core::Time::GMT();
+
+	size_t slash = _cacheFile.rfind('/');
+	if ( slash != std::string::npos )
+		Seiscomp::Util::createPath(_cacheFile.substr(0, slash));
+
+	if ( ! _travelTimeHash )
+		_travelTimeHash = travelTimeHash();
+
+	GridCache::Key key;
+	key.grid = _gridHash;
+	key.travelTimes = _travelTimeHash;
+
+	// Stations of the cache which did not pick yet are kept
+	if ( ! GridCache::write(_cacheFile, key, _grid, _stationTable, _cache.get()) )
+		return false;
+
+	SEISCOMP_INFO("Wrote %d stations with %d grid point entries to grid cache %s",
+	              int(_stationTable.stationCount()), int(_stationTable.size()),
+	              _cacheFile.c_str());
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void GridSearch::_updateCache()
+{
+	if (_unsavedStationCount == 0)
+		return;
+
+	Seiscomp::Core::TimeSpan interval(CacheWriteInterval);
+	if (Seiscomp::Core::Time::GMT() - _cacheWriteTime >= interval)
+		_writeCache();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void GridSearch::setup()
 {
@@ -17,12 +17,17 @@
 #ifndef _SEISCOMP_AUTOLOC_NUCLEATOR_
 #define _SEISCOMP_AUTOLOC_NUCLEATOR_
 
+#include <cstdint>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <set>
 #include <map>
+#include <deque>
+#include <memory>
+
+#include <seiscomp/private/workerpool.h>
 
 #include "datamodel.h"
 #include "locator.h"
@@ -66,10 +71,72 @@ DEFINE_SMARTPOINTER(GridPoint);
 typedef std::vector<GridPointPtr> Grid;
 
 
+
+// Phase of the first arrival from a grid point at a station
+enum class NucleationPhase : unsigned char { P, Pdiff, PKP, Other };
+
+
+
+// From a GridPoint point of view, a station has a distance, azimuth,
+// traveltime etc. Since there will be of the order 10^5 ... 10^6 of
+// such station/grid point pairs, they are stored in one flat table of
+// arrays per grid rather than in individual objects. Each station gets
+// a dense ID and its entries are stored contiguously, one entry per
+// grid point within nucleation range of the station.
+class StationTable
+{
+	public:
+		typedef size_t StationID;
+		static const StationID NoStation = static_cast<StationID>(-1);
+
+	public:
+		// Return the ID of a station or NoStation if not added yet
+		StationID id(const Station *station) const;
+
+		// Add a station and return its ID. Its entries must be
+		// appended before the next station is added.
+		StationID addStation(const Station *station);
+		void append(unsigned int gridpoint, float distance, float azimuth,
+		            float ttime, float hslow, NucleationPhase phase);
+
+		size_t stationCount() const { return _stations.size(); }
+		const Station *station(StationID id) const { return _stations[id]; }
+
+		// The half-open entry index range of a station
+		size_t begin(StationID id) const { return _offsets[id]; }
+		size_t end(StationID id) const {
+			return id+1 < _offsets.size() ? _offsets[id+1] : gridpoint.size();
+		}
+
+		size_t size() const { return gridpoint.size(); }
+		size_t memoryUsage() const;
+
+		void clear();
+
+	public:
+		// per entry data
+		std::vector<unsigned int>    gridpoint;
+		std::vector<float>           distance;
+		std::vector<float>           azimuth;
+		std::vector<float>           ttime;
+		std::vector<float>           hslow;
+		std::vector<NucleationPhase> phase;
+
+	private:
+		std::map<std::string, StationID> _ids;
+		std::vector<const Station*>      _stations;
+		std::vector<size_t>              _offsets;
+};
+
+
+class GridCache;
+
+
 class GridSearch : public Nucleator
 {
 	public:
 		GridSearch();
+		~GridSearch();
 		virtual bool init();
 
 	public:
@@ -90,6 +157,9 @@ class GridSearch : public Nucleator
 			double amin{5.0 * nmin};
 		
 			int verbosity{0};
+
+			// number of threads used to feed picks to the grid
+			size_t threads{1};
 		};
 
 	public:
@@ -100,6 +170,17 @@ class GridSearch : public Nucleator
 
 		bool setGridFile(const std::string &gridfile);
 
+		// Binary cache of grid and station table, see GridCache.
+		// Must be set before the grid file to take effect. An empty
+		// file name disables the cache.
+		void setCacheFile(const std::string &filename) { _cacheFile = filename; }
+
+		// Number of stations read from the cache since the grid file
+		// was set
+		size_t cachedStationCount() const { return _cachedStationCount; }
+
+		const StationTable &stationTable() const { return _stationTable; }
+
 		void setLocatorProfile(const std::string &profile);
 
 		void setSeiscompConfig(const Seiscomp::Config::Config*);
@@ -118,22 +199,49 @@ class GridSearch : public Nucleator
 		void shutdown()
 		{
 			_abort = true;
+			_workers.stop();
+			_writeCache();
+			_stationTable.clear();
 			_grid.clear();
 		}
 
 	protected:
 		virtual void setup();
 
-		// setup a single station - ideally "on the fly"
-		bool _setupStation(const Station *station);
+		// Set up a single station at all grid points within its range
+		// unless done already and return its ID in the station table
+		StationTable::StationID _setupStation(const Station *station);
 
 	private:
 		bool _readGrid(const std::string &gridfile);
 
+		// Write the station table to the cache if stations were set
+		// up since it was written last
+		bool _writeCache();
+		// Same but only once per CacheWriteInterval, except for the
+		// first station set up
+		void _updateCache();
+
 	private:
 		Grid    _grid;
 		Locator _relocator;
 
+		// distance, travel time etc. of the stations at the grid points
+		StationTable _stationTable;
+
+		// The cache read at start, used to set up stations known from
+		// earlier runs. Closed if it does not match grid and travel
+		// times.
+		std::unique_ptr<GridCache> _cache;
+		std::string _cacheFile;
+		uint64_t    _gridHash{0};
+		uint64_t    _travelTimeHash{0};
+		size_t      _cachedStationCount{0};
+		size_t      _unsavedStationCount{0};
+		Seiscomp::Core::Time _cacheWriteTime;
+
+		Seiscomp::Private::WorkerPool _workers;
+
 		bool _abort;
 
 		const Seiscomp::Config::Config *_scconfig{nullptr};
@@ -144,34 +252,6 @@ class GridSearch : public Nucleator
 
 
 
-// From a GridPoint point of view, a station has a
-// distance, azimuth, traveltime etc. These are stored
-// in StationWrapper, together with the corresponding
-// StationPtr.
-DEFINE_SMARTPOINTER(StationWrapper);
-
-class StationWrapper : public Seiscomp::Core::BaseObject {
-
-	public:
-		StationWrapper(const Station *station, const std::string &phase, float distance, float azimuth, float ttime, float hslow)
-			: Seiscomp::Core::BaseObject(), station(station), distance(distance), azimuth(azimuth), ttime(ttime), hslow(hslow), phase(phase)  {}
-
-		StationWrapper(const StationWrapper &other)
-			: Seiscomp::Core::BaseObject(), station(other.station), distance(other.distance), azimuth(other.azimuth), ttime(other.ttime), hslow(other.hslow), phase(other.phase) {}
-
-		// Since there will be of the order
-		// 10^5 ... 10^6 StationWrapper instances,
-		// we need to use floats
-		const Station *station;
-		float distance, azimuth; //, backazimuth;
-		float ttime, hslow; //, vslow;
-		// to further save space, make this a
-		// pointer to a static phase list entry:
-		std::string phase;
-};
-
-
-
 // A Pick projected in back time, corresponding
 // to the grid point location
 //DEFINE_SMARTPOINTER(ProjectedPick);
@@ -180,7 +260,7 @@ class ProjectedPick {
 
 	public:
 		ProjectedPick(const Time &t);
-		ProjectedPick(PickCPtr p, StationWrapperCPtr w);
+		ProjectedPick(PickCPtr p, const StationTable &table, size_t entry);
 		ProjectedPick(const ProjectedPick&);
 		~ProjectedPick();
 
@@ -196,7 +276,8 @@ class ProjectedPick {
 
 	// private:
 		PickCPtr p;
-		StationWrapperCPtr wrapper;
+		// copied from the station table entry
+		float distance, azimuth, hslow;
 	private:
 		Time _projectedTime;
 };
@@ -210,21 +291,23 @@ class GridPoint : public Seiscomp::Core::BaseObject
 		GridPoint(double latitude, double longitude, double depth);
 
 		~GridPoint() {
-			_wrappers.clear();
 			_picks.clear();
 		}
 
 	public:
-		// feed a new pick and perhaps get a new origin
-		const Origin* feed(const Pick*);
+		// feed a new pick and perhaps get a new origin. The entry
+		// refers to the station of the pick at this grid point.
+		const Origin* feed(const Pick*, const StationTable &table, size_t entry);
 
 		// remove all picks older than tmin
 		int cleanup(const Time& minTime);
 
 	public:
-		// void setStations(const StationMap *stations);
-
-		bool setupStation(const Station *station);
+		// Compute distance, azimuth etc. of the station and append
+		// them to the table as entry of this grid point. Returns false
+		// if the station is out of range.
+		bool setupStation(const Station *station, unsigned int index,
+		                  StationTable &table) const;
 
 	public:
 		Hypocenter hypocenter;
@@ -236,8 +319,9 @@ class GridPoint : public Seiscomp::Core::BaseObject
 		size_t _nmin;
 
 	private:
-		std::map<std::string, StationWrapperCPtr> _wrappers;
-		std::multiset<ProjectedPick> _picks;
+		// projected picks sorted by projected time, picks with equal
+		// time in order of insertion
+		std::deque<ProjectedPick> _picks;
 };
 
 
@@ -0,0 +1,379 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+
+
+#define SEISCOMP_COMPONENT Autoloc
+#include <seiscomp/logging/log.h>
+#include <seiscomp/datamodel/amplitude.h>
+#include <seiscomp/datamodel/eventparameters.h>
+#include <seiscomp/datamodel/origin.h>
+#include <seiscomp/datamodel/pick.h>
+#include <seiscomp/io/archive/xmlarchive.h>
+
+#include <algorithm>
+#include <sstream>
+#include <tuple>
+
+#include "objectreader.h"
+
+
+namespace Seiscomp {
+
+namespace Applications {
+
+namespace Autoloc {
+
+
+namespace {
+
+
+const size_t BlockSize = 1 << 20;
+
+
+// Returns the position after the end tag of the element with the given
+// name whose content starts at from. Nested elements of the same name,
+// e.g. the amplitude value of an amplitude, are skipped. Returns npos if
+// the end tag is not in the buffer yet.
+size_t findElementEnd(const std::string &buffer, const std::string &name,
+                      size_t from) {
+	const std::string endTag = "</" + name + ">";
+	size_t depth = 1;
+	size_t pos = from;
+
+	while ( true ) {
+		size_t tag = buffer.find('<', pos);
+		if ( tag == std::string::npos )
+			return std::string::npos;
+
+		if ( buffer.compare(tag, endTag.size(), endTag) == 0 ) {
+			pos = tag + endTag.size();
+			if ( --depth == 0 )
+				return pos;
+			continue;
+		}
+
+		size_t nameEnd = tag + 1 + name.size();
+		if ( buffer.compare(tag + 1, name.size(), name) == 0 ) {
+			if ( nameEnd >= buffer.size() )
+				return std::string::npos;
+
+			if ( buffer.find_first_of(" \t\r\n/>", nameEnd) == nameEnd ) {
+				size_t tagEnd = buffer.find('>', nameEnd);
+				if ( tagEnd == std::string::npos )
+					return std::string::npos;
+
+				if ( buffer[tagEnd-1] != '/' )
+					++depth;
+
+				pos = tagEnd + 1;
+				continue;
+			}
+		}
+
+		pos = tag + 1;
+	}
+}
+
+
+template <typename T>
+bool creationTime(const DataModel::PublicObject *object, Core::Time &time) {
+	const T *typed = T::ConstCast(object);
+	if ( !typed )
+		return false;
+
+	try {
+		time = typed->creationInfo().creationTime();
+	}
+	catch ( ... ) {
+		return false;
+	}
+
+	return true;
+}
+
+
+}
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool ObjectReader::Entry::operator<(const Entry &other) const {
+	return std::tie(time, type, publicID) < std::tie(other.time, other.type, other.publicID);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool ObjectReader::open(const std::string &filename) {
+	close();
+
+	_file.open(filename.c_str(), std::ios::in | std::ios::binary);
+	if ( !_file.is_open() ) {
+		SEISCOMP_ERROR("unable to open XML file: %s", filename.c_str());
+		return false;
+	}
+
+	// The objects are only scanned for their creation time, don't
+	// register them
+	bool registrationEnabled = DataModel::PublicObject::IsRegistrationEnabled();
+	DataModel::PublicObject::SetRegistrationEnabled(false);
+	bool success = scan();
+	DataModel::PublicObject::SetRegistrationEnabled(registrationEnabled);
+
+	if ( !success ) {
+		close();
+		return false;
+	}
+
+	std::sort(_entries.begin(), _entries.end());
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void ObjectReader::close() {
+	if ( _file.is_open() )
+		_file.close();
+	_file.clear();
+	_header.clear();
+	_entries.clear();
+	_next = 0;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool ObjectReader::scan() {
+	std::string buffer;
+	std::vector<char> block(BlockSize);
+	// file offset of the first character in the buffer
+	std::streamoff bufferOffset = 0;
+	size_t pos = 0;
+
+	// Drops the characters before pos and appends the next block
+	auto fill = [&]() {
+		buffer.erase(0, pos);
+		bufferOffset += pos;
+		pos = 0;
+
+		_file.read(block.data(), block.size());
+		std::streamsize n = _file.gcount();
+		if ( n <= 0 )
+			return false;
+
+		buffer.append(block.data(), n);
+		return true;
+	};
+
+	while ( true ) {
+		size_t start = buffer.find('<', pos);
+		if ( start == std::string::npos ) {
+			pos = buffer.size();
+			if ( !fill() )
+				break;
+			continue;
+		}
+
+		pos = start;
+
+		size_t nameEnd = buffer.find_first_of(" \t\r\n/>", start + 1);
+		size_t tagEnd = buffer.find('>', start);
+		if ( nameEnd == std::string::npos || tagEnd == std::string::npos ) {
+			if ( !fill() )
+				break;
+			continue;
+		}
+
+		std::string name = buffer.substr(start + 1, nameEnd - start - 1);
+
+		if ( name == "seiscomp" || name == "EventParameters" ) {
+			_header += buffer.substr(start, tagEnd - start + 1);
+			pos = tagEnd + 1;
+			continue;
+		}
+
+		Type type;
+		if ( name == "pick" )
+			type = PickType;
+		else if ( name == "amplitude" )
+			type = AmplitudeType;
+		else if ( name == "origin" )
+			type = OriginType;
+		else {
+			pos = start + 1;
+			continue;
+		}
+
+		size_t end;
+		if ( buffer[tagEnd-1] == '/' )
+			end = tagEnd + 1;
+		else {
+			end = findElementEnd(buffer, name, tagEnd + 1);
+			if ( end == std::string::npos ) {
+				if ( !fill() )
+					break;
+				continue;
+			}
+		}
+
+		addEntry(buffer.substr(start, end - start), type, bufferOffset + std::streamoff(start));
+		pos = end;
+	}
+
+	if ( _file.bad() ) {
+		SEISCOMP_ERROR("failed to read XML file");
+		return false;
+	}
+
+	if ( _header.empty() ) {
+		SEISCOMP_ERROR("No event parameters found");
+		return false;
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool ObjectReader::addEntry(const std::string &element, Type type,
+                            std::streamoff offset) {
+	DataModel::PublicObjectPtr object = parse(element, type);
+	if ( !object ) {
+		SEISCOMP_WARNING("Ignore invalid object at file offset %ld", long(offset));
+		return false;
+	}
+
+	Entry entry;
+	entry.type = type;
+	entry.publicID = object->publicID();
+	entry.offset = offset;
+	entry.length = element.size();
+
+	bool valid = false;
+	switch ( type ) {
+		case PickType:
+			valid = creationTime<DataModel::Pick>(object.get(), entry.time);
+			break;
+		case AmplitudeType:
+			valid = creationTime<DataModel::Amplitude>(object.get(), entry.time);
+			break;
+		case OriginType:
+			valid = creationTime<DataModel::Origin>(object.get(), entry.time);
+			break;
+	}
+
+	if ( !valid ) {
+		SEISCOMP_WARNING("Ignore %s %s: no creation time set",
+		                 object->className(), entry.publicID.c_str());
+		return false;
+	}
+
+	_entries.push_back(entry);
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DataModel::PublicObjectPtr ObjectReader::parse(const std::string &element,
+                                               Type type) const {
+	// Each element is read as event parameters of its own
+	std::stringbuf buf(_header + element + "</EventParameters></seiscomp>");
+
+	IO::XMLArchive ar;
+	if ( !ar.open(&buf) )
+		return nullptr;
+
+	DataModel::EventParametersPtr ep;
+	ar >> ep;
+	ar.close();
+
+	if ( !ep )
+		return nullptr;
+
+	switch ( type ) {
+		case PickType:
+			if ( ep->pickCount() > 0 ) {
+				DataModel::PickPtr pick = ep->pick(0);
+				ep->removePick(0);
+				return pick;
+			}
+			break;
+		case AmplitudeType:
+			if ( ep->amplitudeCount() > 0 ) {
+				DataModel::AmplitudePtr amplitude = ep->amplitude(0);
+				ep->removeAmplitude(0);
+				return amplitude;
+			}
+			break;
+		case OriginType:
+			if ( ep->originCount() > 0 ) {
+				DataModel::OriginPtr origin = ep->origin(0);
+				ep->removeOrigin(0);
+				return origin;
+			}
+			break;
+	}
+
+	return nullptr;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DataModel::PublicObjectPtr ObjectReader::next() {
+	while ( _next < _entries.size() ) {
+		const Entry &entry = _entries[_next++];
+
+		std::string element(entry.length, '\0');
+		_file.clear();
+		_file.seekg(entry.offset);
+		if ( !_file.read(&element[0], entry.length) ) {
+			SEISCOMP_ERROR("failed to read %s from XML file", entry.publicID.c_str());
+			return nullptr;
+		}
+
+		DataModel::PublicObjectPtr object = parse(element, entry.type);
+		if ( object )
+			return object;
+
+		SEISCOMP_WARNING("Ignore %s: failed to read object", entry.publicID.c_str());
+	}
+
+	return nullptr;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+}
+
+}
+
+}
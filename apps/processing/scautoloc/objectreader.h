@@ -0,0 +1,98 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+
+
+#ifndef SEISCOMP_APPLICATIONS_AUTOLOC_OBJECTREADER__
+#define SEISCOMP_APPLICATIONS_AUTOLOC_OBJECTREADER__
+
+#include <seiscomp/core/datetime.h>
+#include <seiscomp/datamodel/publicobject.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace Seiscomp {
+
+namespace Applications {
+
+namespace Autoloc {
+
+
+// Reads the picks, amplitudes and origins of an SCML file one by one
+// in order of their creation time.
+//
+// The file is scanned once for the pick, amplitude and origin elements
+// of the event parameters. Only the file position and the creation time
+// of each object are kept. An object is parsed from its position again
+// when it is due, so the event parameters are never held in memory as
+// a whole. As the file is read twice, it cannot be read from stdin.
+class ObjectReader {
+	public:
+		ObjectReader() = default;
+		ObjectReader(const ObjectReader&) = delete;
+		ObjectReader &operator=(const ObjectReader&) = delete;
+
+	public:
+		bool open(const std::string &filename);
+		void close();
+
+		// Number of objects with a creation time found in the file
+		size_t size() const { return _entries.size(); }
+
+		// Returns the next object in order of creation time. Picks come
+		// before amplitudes and amplitudes before origins with the same
+		// creation time. Returns nullptr if all objects have been read.
+		DataModel::PublicObjectPtr next();
+
+	private:
+		enum Type {
+			PickType,
+			AmplitudeType,
+			OriginType
+		};
+
+		struct Entry {
+			Core::Time     time;
+			Type           type;
+			std::string    publicID;
+			std::streamoff offset;
+			size_t         length;
+
+			bool operator<(const Entry &other) const;
+		};
+
+		bool scan();
+		bool addEntry(const std::string &element, Type type, std::streamoff offset);
+		DataModel::PublicObjectPtr parse(const std::string &element, Type type) const;
+
+	private:
+		std::ifstream      _file;
+		// The start tags of the document and the event parameters
+		// each element is wrapped in for parsing
+		std::string        _header;
+		std::vector<Entry> _entries;
+		size_t             _next{0};
+};
+
+
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_TEST_MODULE test_scautoloc_gridcache
+
+#include <seiscomp/unittest/unittests.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "nucleator.h"
+#include "gridcache.h"
+
+
+// Restarts of the nucleator with the grid cache. The stations are set up
+// lazily as in scautoloc, where a station is set up with its first pick.
+// A station set up in one run must be read from the cache in the next
+// run, even if the previous run was not shut down.
+//
+// The stations are set up with the travel time table used by scautoloc.
+
+
+using namespace std;
+using namespace Autoloc;
+
+
+namespace {
+
+
+const char *CacheFile = "gridcache-test.cache";
+
+
+// The nucleator as started by scautoloc, with access to the station set up
+class TestGridSearch : public GridSearch {
+	public:
+		TestGridSearch() {
+			setCacheFile(CacheFile);
+			BOOST_REQUIRE(setGridFile("../config/grid.conf"));
+		}
+
+		using GridSearch::_setupStation;
+};
+
+
+// The entries of a station in the station table
+struct Entries {
+	vector<unsigned int>    gridpoint;
+	vector<float>           distance, azimuth, ttime, hslow;
+	vector<NucleationPhase> phase;
+
+	bool operator==(const Entries &other) const {
+		return gridpoint == other.gridpoint && distance == other.distance &&
+		       azimuth == other.azimuth && ttime == other.ttime &&
+		       hslow == other.hslow && phase == other.phase;
+	}
+};
+
+
+Entries entries(const StationTable &table, StationTable::StationID id) {
+	Entries e;
+	for ( size_t i = table.begin(id); i < table.end(id); ++i ) {
+		e.gridpoint.push_back(table.gridpoint[i]);
+		e.distance.push_back(table.distance[i]);
+		e.azimuth.push_back(table.azimuth[i]);
+		e.ttime.push_back(table.ttime[i]);
+		e.hslow.push_back(table.hslow[i]);
+		e.phase.push_back(table.phase[i]);
+	}
+	return e;
+}
+
+
+// The stations as read again by each run
+vector<StationPtr> readStations() {
+	vector<StationPtr> stations;
+	StationMap *stationMap = Utils::readStationLocations("../config/station-locations.conf");
+	BOOST_REQUIRE(stationMap != nullptr);
+
+	for ( auto &item : *stationMap ) {
+		stations.push_back(const_cast<Station*>(item.second.get()));
+		if ( stations.size() == 5 ) break;
+	}
+
+	delete stationMap;
+	return stations;
+}
+
+
+StationPtr moved(const Station *station) {
+	StationPtr copy = new Station(station->code, station->net,
+	                              station->lat + 0.5, station->lon, station->alt);
+	copy->maxNucDist = station->maxNucDist;
+	copy->used = station->used;
+	return copy;
+}
+
+
+size_t cachedStations() {
+	GridCache cache;
+	return cache.open(CacheFile) ? cache.stationCount() : 0;
+}
+
+
+}
+
+
+BOOST_AUTO_TEST_SUITE(seiscomp_main_scautoloc_gridcache)
+
+
+BOOST_AUTO_TEST_CASE(restart) {
+	remove(CacheFile);
+
+	// First run without a cache
+	vector<Entries> expected;
+	{
+		vector<StationPtr> stations = readStations();
+		TestGridSearch nucleator;
+
+		for ( size_t i = 0; i < 4; ++i ) {
+			StationTable::StationID id = nucleator._setupStation(stations[i].get());
+			expected.push_back(entries(nucleator.stationTable(), id));
+			BOOST_REQUIRE(!expected.back().gridpoint.empty());
+
+			// The cache is written as soon as the first station is set
+			// up, a crash later on does not lose it
+			BOOST_CHECK_EQUAL(cachedStations(), 1);
+		}
+
+		BOOST_CHECK_EQUAL(nucleator.cachedStationCount(), 0);
+		nucleator.shutdown();
+		BOOST_CHECK_EQUAL(cachedStations(), 4);
+	}
+
+	// Second run, stations 2 and 3 do not pick but station 2 is moved
+	// and a new station 4 picks
+	{
+		vector<StationPtr> stations = readStations();
+		TestGridSearch nucleator;
+
+		for ( size_t i = 0; i < 2; ++i ) {
+			StationTable::StationID id = nucleator._setupStation(stations[i].get());
+			BOOST_CHECK(entries(nucleator.stationTable(), id) == expected[i]);
+		}
+		BOOST_CHECK_EQUAL(nucleator.cachedStationCount(), 2);
+
+		StationPtr station2 = moved(stations[2].get());
+		StationTable::StationID id = nucleator._setupStation(station2.get());
+		BOOST_CHECK(!(entries(nucleator.stationTable(), id) == expected[2]));
+		nucleator._setupStation(stations[4].get());
+		BOOST_CHECK_EQUAL(nucleator.cachedStationCount(), 2);
+
+		nucleator.shutdown();
+
+		// Station 3 of the first run is kept
+		BOOST_CHECK_EQUAL(cachedStations(), 5);
+	}
+
+	// Third run, everything is known
+	{
+		vector<StationPtr> stations = readStations();
+		TestGridSearch nucleator;
+
+		StationTable::StationID id = nucleator._setupStation(stations[3].get());
+		BOOST_CHECK(entries(nucleator.stationTable(), id) == expected[3]);
+
+		StationPtr station2 = moved(stations[2].get());
+		nucleator._setupStation(station2.get());
+		nucleator._setupStation(stations[4].get());
+		BOOST_CHECK_EQUAL(nucleator.cachedStationCount(), 3);
+
+		nucleator.shutdown();
+	}
+
+	remove(CacheFile);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,272 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_TEST_MODULE test_scautoloc_nucleator
+
+#include <seiscomp/unittest/unittests.h>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "nucleator.h"
+
+
+// Replay of a pick set through the grid points of the nucleator. Each pick
+// is fed into all grid points within range of its station, once with
+// GridPoint::feed() and once with the multiset based implementation with
+// the full pairwise cluster test it replaced. Both must create bit for bit
+// the same origins.
+//
+// data/picks.txt contains picks of four events and noise picks in the
+// format read by scautoloc --offline. The travel times are approximated by
+// a simple function of the distance, which serves both implementations.
+
+
+using namespace std;
+using namespace Autoloc;
+
+
+namespace {
+
+
+struct GridLine {
+	double lat, lon, dep, rad, dmax;
+	int nmin;
+};
+
+
+vector<GridLine> readGrid(const string &filename) {
+	vector<GridLine> grid;
+	ifstream ifs(filename.c_str());
+	string line;
+
+	while ( getline(ifs, line) ) {
+		if ( line.empty() || line[0] == '#' ) continue;
+
+		GridLine gl;
+		istringstream iss(line);
+		if ( iss >> gl.lat >> gl.lon >> gl.dep >> gl.rad >> gl.dmax >> gl.nmin )
+			grid.push_back(gl);
+	}
+
+	return grid;
+}
+
+
+PickVector readPicks(const string &filename) {
+	ifstream ifs(filename.c_str());
+	streambuf *cinbuf = cin.rdbuf(ifs.rdbuf());
+	PickVector picks = Utils::readPickFile();
+	cin.rdbuf(cinbuf);
+	return picks;
+}
+
+
+// The grid point implementation up to now, which keeps the projected
+// picks in a multiset and tests all pairs of picks within the time window
+// around a new pick
+Origin *referenceFeed(const GridPoint &gp, multiset<ProjectedPick> &picks,
+                      const Pick *pick, const StationTable &table, size_t entry) {
+	ProjectedPick pp(pick, table, entry);
+	picks.insert(pp);
+
+	vector<ProjectedPick> pps;
+	multiset<ProjectedPick>::iterator it,
+		lower = picks.lower_bound(pp.projectedTime() - gp._dt),
+		upper = picks.upper_bound(pp.projectedTime() + gp._dt);
+	for ( it = lower; it != upper; ++it )
+		pps.push_back(*it);
+	size_t npick = pps.size();
+
+	if ( npick < gp._nmin )
+		return nullptr;
+
+	double dt0 = 4;
+	vector<size_t> cnt(npick, 0), flg(npick, 0);
+	for ( size_t i = 0; i < npick; ++i ) {
+		ProjectedPick &ppi = pps[i];
+		double t_i = ppi.projectedTime();
+		double azi_i = ppi.azimuth;
+		double slo_i = ppi.hslow;
+
+		for ( size_t k = i; k < npick; ++k ) {
+			ProjectedPick &ppk = pps[k];
+			double t_k = ppk.projectedTime();
+			double azi_k = ppk.azimuth;
+			double slo_k = ppk.hslow;
+
+			double azi_diff = std::abs(fmod(((azi_k-azi_i)+180.), 360.)-180.);
+			double dtmax = gp._radius*(slo_i+slo_k) * azi_diff/90. + dt0;
+
+			if ( std::abs(t_i-t_k) < dtmax ) {
+				cnt[i]++;
+				cnt[k]++;
+
+				if ( ppi.p == pp.p || ppk.p == pp.p )
+					flg[k] = flg[i] = 1;
+			}
+		}
+	}
+
+	size_t sum = 0;
+	for ( size_t i = 0; i < npick; ++i )
+		sum += flg[i];
+	if ( sum < gp._nmin )
+		return nullptr;
+
+	vector<ProjectedPick> group;
+	size_t cntmax = 0;
+	Time otime;
+	for ( size_t i = 0; i < npick; ++i ) {
+		if ( !flg[i] ) continue;
+		group.push_back(pps[i]);
+		if ( cnt[i] > cntmax ) {
+			cntmax = cnt[i];
+			otime = pps[i].projectedTime();
+		}
+	}
+
+	Origin *origin = new Origin(gp.hypocenter.lat, gp.hypocenter.lon,
+	                            gp.hypocenter.dep, otime);
+
+	set<string> stations;
+	for ( size_t i = 0; i < group.size(); ++i ) {
+		const ProjectedPick &gpp = group[i];
+		PickCPtr p = gpp.p;
+		const string key = p->station()->net + "." + p->station()->code;
+		if ( stations.count(key) ) continue;
+		stations.insert(key);
+
+		Arrival arr(p.get());
+		arr.residual = gpp.projectedTime() - otime;
+		arr.distance = gpp.distance;
+		arr.azimuth  = gpp.azimuth;
+		arr.excluded = Arrival::NotExcluded;
+		arr.phase = (p->time - otime < 960.) ? "P" : "PKP";
+		origin->arrivals.push_back(arr);
+	}
+
+	if ( origin->arrivals.size() < gp._nmin ) {
+		delete origin;
+		return nullptr;
+	}
+
+	return origin;
+}
+
+
+int referenceCleanup(multiset<ProjectedPick> &picks, const Time &minTime) {
+	multiset<ProjectedPick>::iterator upper = picks.upper_bound(minTime);
+	int count = std::distance(picks.begin(), upper);
+	picks.erase(picks.begin(), upper);
+	return count;
+}
+
+
+}
+
+
+BOOST_AUTO_TEST_SUITE(seiscomp_main_scautoloc_nucleator)
+
+
+BOOST_AUTO_TEST_CASE(replay) {
+	vector<GridLine> gridLines = readGrid("../config/grid.conf");
+	StationMap *stations = Utils::readStationLocations("../config/station-locations.conf");
+	PickVector picks = readPicks("data/picks.txt");
+	BOOST_REQUIRE(!gridLines.empty());
+	BOOST_REQUIRE(stations != nullptr);
+	BOOST_REQUIRE(!picks.empty());
+
+	Grid grid;
+	for ( const GridLine &gl : gridLines ) {
+		GridPoint *gp = new GridPoint(gl.lat, gl.lon, gl.dep);
+		gp->_nmin = gl.nmin;
+		gp->_radius = gl.rad;
+		gp->maxStaDist = gl.dmax;
+		grid.push_back(gp);
+	}
+
+	StationTable table;
+	for ( auto &item : *stations ) {
+		const Station *station = item.second.get();
+		table.addStation(station);
+		for ( size_t i = 0; i < grid.size(); ++i ) {
+			const Hypocenter &hypo = grid[i]->hypocenter;
+			double delta, azi, baz;
+			delazi(&hypo, station, delta, azi, baz);
+			if ( delta > station->maxNucDist || delta > grid[i]->maxStaDist )
+				continue;
+			table.append(i, delta, azi,
+			             hypo.dep / 7. + 13.7 * delta - 0.045 * delta * delta,
+			             13.7 - 0.09 * delta, NucleationPhase::P);
+		}
+	}
+
+	vector<multiset<ProjectedPick> > referencePicks(grid.size());
+	size_t origins = 0;
+
+	for ( PickPtr &pick : picks ) {
+		StationMap::const_iterator it = stations->find(pick->net + "." + pick->sta);
+		BOOST_REQUIRE(it != stations->end());
+		pick->setStation(it->second.get());
+
+		// keep half an hour of picks to exercise the cleanup
+		Time minTime = pick->time - 1800;
+		int removed = 0, expectedRemoved = 0;
+		for ( size_t i = 0; i < grid.size(); ++i ) {
+			removed += grid[i]->cleanup(minTime);
+			expectedRemoved += referenceCleanup(referencePicks[i], minTime);
+		}
+		BOOST_CHECK_EQUAL(removed, expectedRemoved);
+
+		StationTable::StationID id = table.id(pick->station());
+		for ( size_t entry = table.begin(id); entry < table.end(id); ++entry ) {
+			size_t i = table.gridpoint[entry];
+			OriginCPtr origin = grid[i]->feed(pick.get(), table, entry);
+			OriginCPtr expected = referenceFeed(*grid[i], referencePicks[i],
+			                                    pick.get(), table, entry);
+
+			BOOST_REQUIRE_EQUAL(bool(origin), bool(expected));
+			if ( !origin ) continue;
+
+			++origins;
+			BOOST_CHECK_EQUAL(origin->time, expected->time);
+			BOOST_REQUIRE_EQUAL(origin->arrivals.size(), expected->arrivals.size());
+			for ( size_t k = 0; k < origin->arrivals.size(); ++k ) {
+				const Arrival &arr = origin->arrivals[k];
+				const Arrival &ref = expected->arrivals[k];
+				BOOST_CHECK(arr.pick == ref.pick);
+				BOOST_CHECK_EQUAL(arr.residual, ref.residual);
+				BOOST_CHECK_EQUAL(arr.distance, ref.distance);
+				BOOST_CHECK_EQUAL(arr.azimuth, ref.azimuth);
+				BOOST_CHECK_EQUAL(arr.phase, ref.phase);
+			}
+		}
+	}
+
+	// The pick set must actually trigger the cluster test
+	BOOST_CHECK(origins > 0);
+
+	delete stations;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
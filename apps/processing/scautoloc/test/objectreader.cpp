@@ -0,0 +1,128 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_TEST_MODULE test_scautoloc_objectreader
+
+#include <seiscomp/unittest/unittests.h>
+#include <seiscomp/datamodel/amplitude.h>
+#include <seiscomp/datamodel/pick.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "objectreader.h"
+
+
+// The objects of an SCML file as read by scautoloc --replay. Amplitudes
+// contain an amplitude element of their own which must not end the
+// amplitude object.
+
+
+using namespace std;
+using namespace Seiscomp;
+using namespace Seiscomp::Applications::Autoloc;
+
+
+namespace {
+
+
+struct Replay {
+	vector<string> publicIDs;
+	size_t         picks{0};
+	size_t         amplitudes{0};
+};
+
+
+Replay replay(const string &filename) {
+	Replay result;
+	ObjectReader reader;
+	BOOST_REQUIRE(reader.open(filename));
+
+	DataModel::PublicObjectPtr object;
+	while ( (object = reader.next()) ) {
+		result.publicIDs.push_back(object->publicID());
+
+		if ( DataModel::Pick::Cast(object) )
+			++result.picks;
+		else if ( DataModel::Amplitude *amplitude = DataModel::Amplitude::Cast(object) ) {
+			++result.amplitudes;
+			BOOST_CHECK(amplitude->amplitude().value() > 0);
+			BOOST_CHECK(!amplitude->pickID().empty());
+		}
+	}
+
+	return result;
+}
+
+
+}
+
+
+BOOST_AUTO_TEST_SUITE(seiscomp_main_scautoloc_objectreader)
+
+
+BOOST_AUTO_TEST_CASE(picksAndAmplitudes) {
+	Replay result = replay("data/replay.xml");
+
+	BOOST_CHECK_EQUAL(result.picks, 3);
+	BOOST_CHECK_EQUAL(result.amplitudes, 6);
+
+	// In order of creation time, picks before amplitudes of the same time
+	const vector<string> expected = {
+		"Pick/1", "Amplitude/1", "Amplitude/2", "Pick/2", "Amplitude/3",
+		"Pick/3", "Amplitude/5", "Amplitude/4", "Amplitude/6"
+	};
+	BOOST_CHECK_EQUAL_COLLECTIONS(result.publicIDs.begin(), result.publicIDs.end(),
+	                              expected.begin(), expected.end());
+}
+
+
+BOOST_AUTO_TEST_CASE(blockBoundaries) {
+	// The file is scanned in blocks of 1 MB. Enough amplitudes are
+	// written that some of them span two blocks.
+	const size_t count = 10000;
+	const string filename = "objectreader-blocks.xml";
+	{
+		ofstream ofs(filename.c_str());
+		ofs << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		       "<seiscomp xmlns=\"http://geofon.gfz-potsdam.de/ns/seiscomp3-schema/0.11\" version=\"0.11\">\n"
+		       "  <EventParameters>\n";
+		for ( size_t i = 0; i < count; ++i ) {
+			ofs << "    <amplitude publicID=\"Amplitude/" << i << "\">\n"
+			       "      <type>mb</type>\n"
+			       "      <amplitude>\n"
+			       "        <value>" << i + 1 << "</value>\n"
+			       "      </amplitude>\n"
+			       "      <pickID>Pick/" << i << "</pickID>\n"
+			       "      <creationInfo>\n"
+			       "        <creationTime>2020-01-01T00:00:" << (i % 60 < 10 ? "0" : "")
+			    << i % 60 << ".000000Z</creationTime>\n"
+			       "      </creationInfo>\n"
+			       "    </amplitude>\n";
+		}
+		ofs << "  </EventParameters>\n"
+		       "</seiscomp>\n";
+	}
+
+	Replay result = replay(filename);
+	remove(filename.c_str());
+
+	BOOST_CHECK_EQUAL(result.picks, 0);
+	BOOST_CHECK_EQUAL(result.amplitudes, count);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,229 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_TEST_MODULE test_scautoloc_stationtable
+
+#include <seiscomp/unittest/unittests.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "nucleator.h"
+
+
+// Benchmark of the station set up of the nucleator grid. The stations of
+// config/station-locations.conf are set up at all points of the default
+// grid config/grid.conf, once with the per grid point map of reference
+// counted StationWrapper objects used up to now and once with the flat
+// StationTable. The allocated memory and the elapsed time of both are
+// reported.
+//
+// The travel times are approximated by a simple function of the distance.
+// The travel time computation is the same for both layouts and would
+// otherwise dominate the time measured.
+
+
+namespace {
+
+
+// All allocations through the global operator new are accounted here. The
+// size of each block is stored in front of it such that operator delete
+// can account for it as well.
+std::atomic<size_t> allocatedBytes{0};
+const size_t headerSize = 16;
+
+
+}
+
+
+void *operator new(size_t size) {
+	void *p = std::malloc(size + headerSize);
+	if ( !p ) throw std::bad_alloc();
+	*static_cast<size_t*>(p) = size;
+	allocatedBytes += size;
+	return static_cast<char*>(p) + headerSize;
+}
+
+
+void operator delete(void *p) noexcept {
+	if ( !p ) return;
+	char *block = static_cast<char*>(p) - headerSize;
+	allocatedBytes -= *reinterpret_cast<size_t*>(block);
+	std::free(block);
+}
+
+
+void operator delete(void *p, size_t) noexcept {
+	operator delete(p);
+}
+
+
+using namespace std;
+using namespace Autoloc;
+
+
+namespace {
+
+
+// The station/grid point pair as stored before the StationTable
+DEFINE_SMARTPOINTER(StationWrapper);
+class StationWrapper : public Seiscomp::Core::BaseObject {
+	public:
+		StationWrapper(const Station *station, const std::string &phase,
+		               float distance, float azimuth, float ttime, float hslow)
+		: station(station), distance(distance), azimuth(azimuth)
+		, ttime(ttime), hslow(hslow), phase(phase) {}
+
+		const Station *station;
+		float distance, azimuth;
+		float ttime, hslow;
+		std::string phase;
+};
+
+typedef std::map<std::string, StationWrapperCPtr> StationWrapperMap;
+
+
+struct GridLine {
+	double lat, lon, dep, dmax;
+};
+
+
+vector<GridLine> readGrid(const string &filename) {
+	vector<GridLine> grid;
+	ifstream ifs(filename.c_str());
+	string line;
+
+	while ( getline(ifs, line) ) {
+		if ( line.empty() || line[0] == '#' ) continue;
+
+		GridLine gl;
+		double rad; int nmin;
+		istringstream iss(line);
+		if ( iss >> gl.lat >> gl.lon >> gl.dep >> rad >> gl.dmax >> nmin )
+			grid.push_back(gl);
+	}
+
+	return grid;
+}
+
+
+vector<StationPtr> readStations(const string &filename) {
+	vector<StationPtr> stations;
+	StationMap *stationMap = Utils::readStationLocations(filename);
+	if ( !stationMap ) return stations;
+
+	for ( auto &item : *stationMap )
+		stations.push_back(const_cast<Station*>(item.second.get()));
+
+	delete stationMap;
+	return stations;
+}
+
+
+bool travelTime(const GridLine &gp, const Station *station,
+                double &delta, double &azi, double &ttime, double &hslow) {
+	double baz;
+	delazi(gp.lat, gp.lon, station->lat, station->lon, delta, azi, baz);
+	if ( delta > station->maxNucDist || delta > gp.dmax )
+		return false;
+
+	ttime = gp.dep / 7. + 13.7 * delta - 0.045 * delta * delta;
+	hslow = 13.7 - 0.09 * delta;
+	return true;
+}
+
+
+double elapsedSince(const chrono::steady_clock::time_point &start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+}
+
+
+BOOST_AUTO_TEST_SUITE(seiscomp_main_scautoloc_stationtable)
+
+
+BOOST_AUTO_TEST_CASE(setupBenchmark) {
+	vector<GridLine> grid = readGrid("../config/grid.conf");
+	vector<StationPtr> stations = readStations("../config/station-locations.conf");
+	BOOST_REQUIRE(!grid.empty());
+	BOOST_REQUIRE(!stations.empty());
+
+	size_t legacyBytes, legacyEntries = 0;
+	double legacyTime;
+	{
+		size_t base = allocatedBytes;
+		auto start = chrono::steady_clock::now();
+
+		vector<StationWrapperMap> wrappers(grid.size());
+		for ( const StationPtr &station : stations ) {
+			const string key = station->net + "." + station->code;
+			for ( size_t i = 0; i < grid.size(); ++i ) {
+				double delta, azi, ttime, hslow;
+				if ( !travelTime(grid[i], station.get(), delta, azi, ttime, hslow) )
+					continue;
+				wrappers[i][key] = new StationWrapper(station.get(), "P", delta,
+				                                      azi, ttime, hslow);
+				++legacyEntries;
+			}
+		}
+
+		legacyTime = elapsedSince(start);
+		legacyBytes = allocatedBytes - base;
+	}
+
+	size_t tableBytes;
+	double tableTime;
+	StationTable table;
+	{
+		size_t base = allocatedBytes;
+		auto start = chrono::steady_clock::now();
+
+		for ( const StationPtr &station : stations ) {
+			table.addStation(station.get());
+			for ( size_t i = 0; i < grid.size(); ++i ) {
+				double delta, azi, ttime, hslow;
+				if ( !travelTime(grid[i], station.get(), delta, azi, ttime, hslow) )
+					continue;
+				table.append(i, delta, azi, ttime, hslow, NucleationPhase::P);
+			}
+		}
+
+		tableTime = elapsedSince(start);
+		tableBytes = allocatedBytes - base;
+	}
+
+	BOOST_CHECK_EQUAL(table.size(), legacyEntries);
+	BOOST_CHECK(tableBytes < legacyBytes);
+
+	cerr << "station setup of " << stations.size() << " stations at "
+	     << grid.size() << " grid points, " << legacyEntries << " entries" << endl
+	     << "  StationWrapper map: " << legacyBytes / 1024 << " kB, "
+	     << legacyTime * 1000 << " ms" << endl
+	     << "  StationTable:       " << tableBytes / 1024 << " kB, "
+	     << tableTime * 1000 << " ms" << endl;
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
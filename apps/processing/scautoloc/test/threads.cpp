@@ -0,0 +1,136 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_TEST_MODULE test_scautoloc_threads
+
+#include <seiscomp/unittest/unittests.h>
+#include <seiscomp/config/config.h>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "autoloc.h"
+
+
+// Replay of a pick set through Autoloc with one and with several threads.
+// The grid search and the relocations of the score enhancement run in
+// parallel with several threads. The reported origins must be the same,
+// including the depth of relocations which fall back to a fixed depth.
+//
+// data/picks.txt contains picks of four events and noise picks in the
+// format read by scautoloc --offline. The stations are located with
+// LOCSAT as in scautoloc.
+
+
+using namespace std;
+using namespace Autoloc;
+
+
+namespace {
+
+
+class TestAutoloc : public Autoloc3 {
+	public:
+		void finish() {
+			_flush();
+			shutdown();
+		}
+
+	public:
+		// One line per reported origin with all its arrivals
+		vector<string> reported;
+
+	protected:
+		bool _report(const Origin *origin) override {
+			ostringstream os;
+			os << setprecision(17) << printOneliner(origin) << " depth "
+			   << origin->hypocenter.dep << " rms " << origin->rms();
+			for ( const Arrival &arr : origin->arrivals ) {
+				os << " " << arr.pick->id << "/" << arr.phase << "/"
+				   << int(arr.excluded) << "/" << arr.residual;
+			}
+
+			reported.push_back(os.str());
+			return true;
+		}
+};
+
+
+PickVector readPicks(const string &filename) {
+	ifstream ifs(filename.c_str());
+	streambuf *cinbuf = cin.rdbuf(ifs.rdbuf());
+	PickVector picks = Utils::readPickFile();
+	cin.rdbuf(cinbuf);
+	return picks;
+}
+
+
+vector<string> replay(size_t threads) {
+	Seiscomp::Config::Config scconfig;
+
+	Autoloc3::Config config;
+	config.threads = threads;
+	config.offline = true;
+	config.playback = true;
+	config.test = true;
+	config.staConfFile = "";
+	config.scconfig = &scconfig;
+
+	TestAutoloc autoloc;
+	autoloc.setConfig(config);
+	BOOST_REQUIRE(autoloc.setGridFile("../config/grid.conf"));
+
+	StationMap *stations = Utils::readStationLocations("../config/station-locations.conf");
+	BOOST_REQUIRE(stations != nullptr);
+	for ( auto &item : *stations )
+		autoloc.setStation(const_cast<Station*>(item.second.get()));
+
+	BOOST_REQUIRE(autoloc.init());
+
+	PickVector picks = readPicks("data/picks.txt");
+	BOOST_REQUIRE(!picks.empty());
+	for ( const PickPtr &pick : picks ) {
+		autoloc.sync(pick->time);
+		autoloc.feed(pick.get());
+	}
+
+	autoloc.finish();
+	delete stations;
+
+	return autoloc.reported;
+}
+
+
+}
+
+
+BOOST_AUTO_TEST_SUITE(seiscomp_main_scautoloc_threads)
+
+
+BOOST_AUTO_TEST_CASE(sameOrigins) {
+	vector<string> serial = replay(1);
+	vector<string> parallel = replay(4);
+
+	BOOST_CHECK(!serial.empty());
+	BOOST_CHECK_EQUAL_COLLECTIONS(serial.begin(), serial.end(),
+	                              parallel.begin(), parallel.end());
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -118,6 +118,12 @@ void Picker::Config::init(const Client::Application *app) {
 
 	try { generateSimplifiedIDs = app->configGetBool("simplifiedIDs"); }
 	catch ( ... ) {}
+
+	try { threads = app->configGetInt("threads"); }
+	catch ( ... ) {}
+
+	try { batchDetectors = app->configGetBool("batchDetectors"); }
+	catch ( ... ) {}
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -131,6 +137,7 @@ void Picker::Config::init(const System::CommandLine &commandline) {
 	dumpRecords = commandline.hasOption("dump-records");
 	sendDetections = commandline.hasOption("send-detections") ? true : sendDetections;
 	extraPickComments = commandline.hasOption("extra-comments") ? true : extraPickComments;
+	batchDetectors = commandline.hasOption("batch-detectors") ? true : batchDetectors;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -192,6 +199,8 @@ void Picker::Config::dump() const {
 	printf("secondaryPickerType              %s\n",    secondaryPickerType.c_str());
 	printf("killPendingSPickers              %s\n",    killPendingSecondaryProcessors ? "true" : "false");
 	printf("sendDetections                   %s\n",    sendDetections ? "true" : "false");
+	printf("threads                          %d\n",    threads);
+	printf("batchDetectors                   %s\n",    batchDetectors ? "true" : "false");
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -164,6 +164,15 @@ class Config {
 
 		bool        generateSimplifiedIDs{false};
 
+		// The number of threads processing the streams. With more than
+		// one thread the stations are distributed across the threads.
+		int         threads{1};
+
+		// Filter the data of detectors with the same filter and sampling
+		// frequency in batches using SIMD instructions. Requires the
+		// streams to be processed by worker threads.
+		bool        batchDetectors{false};
+
 	public:
 		void dump() const;
 };
@@ -101,6 +101,19 @@ Detector::Detector(double on, double off, double initTime)
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+Detector::~Detector() {
+	// Processing the collected samples would call back into this
+	// detector which is partly destroyed already
+	if ( _lanes ) {
+		_lanes->detach(_laneSlot, false);
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void Detector::init() {
 	setDeadTime(10.);
@@ -160,8 +173,46 @@ void Detector::setSensitivityCorrection(bool enable) {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Detector::setLanes(DetectorLanes *lanes, const std::string &filter,
+                        double fsamp, std::string *error) {
+	DetectorLanes::Slot *slot = lanes->attach(filter, fsamp, std::bind(
+		&Detector::detect, this, std::placeholders::_1, std::placeholders::_2
+	), std::bind(&Detector::releaseLanes, this), error);
+	if ( !slot ) {
+		return false;
+	}
+
+	if ( _lanes ) {
+		_lanes->detach(_laneSlot);
+	}
+
+	_lanes = lanes;
+	_laneSlot = slot;
+	_laneFilter = filter;
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Detector::releaseLanes() {
+	_lanes = nullptr;
+	_laneSlot = nullptr;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void Detector::reset() {
+	if ( _laneSlot ) {
+		_laneSlot->reset();
+	}
+
 	Processing::SimpleDetector::reset();
 	_lastPick = Core::None;
 	_lastAmplitude = Core::None;
@@ -178,6 +229,12 @@ void Detector::fill(size_t n, double *samples) {
 	if ( _sensitivityCorrection )
 		_streamConfig[_usedComponent].applyGain(n, samples);
 
+	// The lanes filter the samples later
+	if ( _laneSlot ) {
+		_laneSlot->fill(n, samples);
+		return;
+	}
+
 	Processing::SimpleDetector::fill(n, samples);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -307,6 +364,37 @@ bool Detector::sendPick() {
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void Detector::process(const Record *record, const DoubleArray &filteredData) {
+	if ( !_laneSlot ) {
+		detect(record, filteredData);
+		return;
+	}
+
+	if ( record->samplingFrequency() != _laneSlot->samplingFrequency() ) {
+		// The filter of the new sampling frequency starts with the next
+		// record
+		SEISCOMP_WARNING("[%s] sampling frequency changed from %f to %f Hz, "
+		                 "restart filter", record->streamID().c_str(),
+		                 _laneSlot->samplingFrequency(),
+		                 record->samplingFrequency());
+		std::string error;
+		if ( !setLanes(_lanes, _laneFilter, record->samplingFrequency(), &error) ) {
+			SEISCOMP_ERROR("[%s] %s: %s", record->streamID().c_str(),
+			               _laneFilter.c_str(), error.c_str());
+			setStatus(ConfigurationError, 0);
+		}
+		return;
+	}
+
+	// The detection runs when the lanes have filtered the data
+	_laneSlot->process(record, filteredData.size());
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Detector::detect(const Record *record, const DoubleArray &filteredData) {
 	_amplProc.pickIndex = 0;
 
 	if ( _currentPickRecord ) {
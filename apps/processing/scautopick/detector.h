@@ -19,6 +19,8 @@
 #include <seiscomp/processing/detector.h>
 #include <seiscomp/processing/amplitudeprocessor.h>
 
+#include "detectorlanes.h"
+
 
 namespace Seiscomp {
 
@@ -33,6 +35,7 @@ class Detector : public Processing::SimpleDetector {
 	public:
 		Detector(double initTime = 0.0);
 		Detector(double on, double off, double initTime = 0.0);
+		~Detector();
 
 		void setAmplitudePublishFunction(const Processing::AmplitudeProcessor::PublishFunc& func);
 		void setPickID(const std::string&) const;
@@ -43,6 +46,11 @@ class Detector : public Processing::SimpleDetector {
 		void setDurations(double minDur, double maxDur);
 		void setSensitivityCorrection(bool enable);
 
+		//! Filters the data with the lanes instead of a filter of its own.
+		//! Returns false if the filter is not supported by the lanes.
+		bool setLanes(DetectorLanes *lanes, const std::string &filter,
+		              double fsamp, std::string *error = nullptr);
+
 		void reset();
 
 		double duration() const {
@@ -60,6 +68,7 @@ class Detector : public Processing::SimpleDetector {
 		bool emitPick(const Record* rec, const Core::Time& t);
 
 		void process(const Record *record, const DoubleArray &filteredData);
+		void detect(const Record *record, const DoubleArray &filteredData);
 
 		bool validateOn(const Record *record, size_t &i, const DoubleArray &filteredData);
 		bool validateOff(const Record *record, size_t i, const DoubleArray &filteredData);
@@ -73,6 +82,9 @@ class Detector : public Processing::SimpleDetector {
 	private:
 		void init();
 
+		// Called by the lanes if they are destroyed first
+		void releaseLanes();
+
 
 	private:
 		struct AmplitudeMaxProcessor {
@@ -115,6 +127,10 @@ class Detector : public Processing::SimpleDetector {
 		AmplitudeMaxProcessor _amplProc;
 
 		mutable std::string   _pickID;
+
+		DetectorLanes        *_lanes{nullptr};
+		DetectorLanes::Slot  *_laneSlot{nullptr};
+		std::string           _laneFilter;
 };
 
 
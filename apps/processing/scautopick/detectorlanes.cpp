@@ -0,0 +1,257 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT Autopick
+#include <seiscomp/logging/log.h>
+
+#include <algorithm>
+
+#include "detectorlanes.h"
+
+
+using namespace std;
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+
+
+class DetectorLanes::Group {
+	public:
+		LaneFilter    filter;
+		double        fsamp;
+		vector<Slot*> slots;
+};
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DetectorLanes::Slot::Slot(DetectorLanes *lanes, Group *group,
+                          const ProcessFunc &func, const ReleaseFunc &release)
+: _lanes(lanes)
+, _group(group)
+, _func(func)
+, _release(release) {
+	_group->filter.reset(_state);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void DetectorLanes::Slot::fill(size_t n, const double *samples) {
+	_samples.insert(_samples.end(), samples, samples + n);
+	_segments.push_back(Segment{nullptr, n});
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void DetectorLanes::Slot::process(const Record *rec, size_t n) {
+	// The detector processes the data it has filled last. Segments without
+	// record, e.g. interpolated gaps, only update the filter state.
+	if ( _segments.empty() || _segments.back().record || _segments.back().count != n ) {
+		SEISCOMP_WARNING("%s: no filtered data for record, skipped",
+		                 rec->streamID().c_str());
+		return;
+	}
+
+	_segments.back().record = rec;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void DetectorLanes::Slot::reset() {
+	// A reset while the group is processed affects the next samples only
+	if ( !_lanes->_flushing && !_samples.empty() ) {
+		_lanes->flush(_group);
+	}
+
+	_group->filter.reset(_state);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+double DetectorLanes::Slot::samplingFrequency() const {
+	return _group->fsamp;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DetectorLanes::DetectorLanes() {}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DetectorLanes::~DetectorLanes() {
+	// The detectors must not detach their slots later
+	for ( auto &item : _groups ) {
+		for ( Slot *slot : item.second->slots ) {
+			if ( slot->_release ) {
+				slot->_release();
+			}
+
+			delete slot;
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DetectorLanes::Slot *DetectorLanes::attach(const string &filter, double fsamp,
+                                           const ProcessFunc &func,
+                                           const ReleaseFunc &release,
+                                           string *error) {
+	unique_ptr<Group> &group = _groups[GroupKey(filter, fsamp)];
+	if ( !group ) {
+		unique_ptr<Group> newGroup(new Group);
+		newGroup->fsamp = fsamp;
+		if ( !newGroup->filter.setup(filter, fsamp, error) ) {
+			_groups.erase(GroupKey(filter, fsamp));
+			return nullptr;
+		}
+
+		group = std::move(newGroup);
+	}
+
+	Slot *slot = new Slot(this, group.get(), func, release);
+	group->slots.push_back(slot);
+	return slot;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void DetectorLanes::detach(Slot *slot, bool process) {
+	if ( !slot ) {
+		return;
+	}
+
+	Group *group = slot->_group;
+	if ( process && !_flushing && !slot->_samples.empty() ) {
+		flush(group);
+	}
+
+	group->slots.erase(remove(group->slots.begin(), group->slots.end(), slot),
+	                   group->slots.end());
+	delete slot;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void DetectorLanes::flush() {
+	for ( auto &item : _groups ) {
+		flush(item.second.get());
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void DetectorLanes::flush(Group *group) {
+	vector<Slot*> pending;
+	for ( Slot *slot : group->slots ) {
+		if ( !slot->_samples.empty() ) {
+			pending.push_back(slot);
+		}
+	}
+
+	if ( pending.empty() ) {
+		return;
+	}
+
+	// Streams with a similar number of samples share the lanes, which
+	// leaves less samples to be filtered separately
+	stable_sort(pending.begin(), pending.end(), [](const Slot *a, const Slot *b) {
+		return a->_samples.size() > b->_samples.size();
+	});
+
+	size_t i = 0;
+	for ( ; i + LaneWidth <= pending.size(); i += LaneWidth ) {
+		LaneState *states[LaneWidth];
+		double *data[LaneWidth];
+		size_t n[LaneWidth];
+
+		for ( int l = 0; l < LaneWidth; ++l ) {
+			Slot *slot = pending[i+l];
+			states[l] = &slot->_state;
+			data[l] = slot->_samples.data();
+			n[l] = slot->_samples.size();
+		}
+
+		group->filter.apply(states, data, n);
+	}
+
+	for ( ; i < pending.size(); ++i ) {
+		Slot *slot = pending[i];
+		group->filter.apply(slot->_state, slot->_samples.data(), slot->_samples.size());
+	}
+
+	// Detections emitted while processing must not modify the slots
+	_flushing = true;
+
+	for ( Slot *slot : pending ) {
+		size_t offset = 0;
+		for ( const Slot::Segment &segment : slot->_segments ) {
+			if ( segment.record ) {
+				DoubleArray filtered(static_cast<int>(segment.count),
+				                     slot->_samples.data() + offset);
+				slot->_func(segment.record.get(), filtered);
+			}
+
+			offset += segment.count;
+		}
+
+		slot->_samples.clear();
+		slot->_segments.clear();
+	}
+
+	_flushing = false;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+}
+}
+}
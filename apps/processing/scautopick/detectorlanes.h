@@ -0,0 +1,140 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#ifndef SEISCOMP_APPLICATIONS_PICKER_DETECTORLANES_H__
+#define SEISCOMP_APPLICATIONS_PICKER_DETECTORLANES_H__
+
+
+#include <seiscomp/core/record.h>
+#include <seiscomp/core/typedarray.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lanefilter.h"
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+
+
+/**
+ * @brief Filters the data of many detectors in batches.
+ *
+ * Detectors with the same filter and sampling frequency are attached to
+ * the same group. Their samples are collected until flush is called. Then
+ * the samples of each group are filtered LaneWidth streams at a time and
+ * the filtered data of each record are passed to the process function of
+ * its detector in the order they have been collected.
+ */
+class DetectorLanes {
+	public:
+		typedef std::function<void (const Record*, const DoubleArray&)> ProcessFunc;
+		//! Called if the lanes are destroyed while the slot is attached
+		typedef std::function<void ()> ReleaseFunc;
+
+		class Group;
+
+		//! The samples and the filter state of a single detector
+		class Slot {
+			public:
+				//! Collects samples which are going to be filtered
+				void fill(size_t n, const double *samples);
+
+				//! Passes the filtered samples of the last fill to the
+				//! process function of the detector
+				void process(const Record *rec, size_t n);
+
+				//! Filters the collected samples and resets the filter
+				void reset();
+
+				double samplingFrequency() const;
+
+
+			private:
+				Slot(DetectorLanes *lanes, Group *group, const ProcessFunc &func,
+				     const ReleaseFunc &release);
+
+
+			private:
+				struct Segment {
+					RecordCPtr record;
+					size_t     count;
+				};
+
+				DetectorLanes       *_lanes;
+				Group               *_group;
+				ProcessFunc          _func;
+				ReleaseFunc          _release;
+				LaneState            _state;
+				std::vector<double>  _samples;
+				std::vector<Segment> _segments;
+
+			friend class DetectorLanes;
+		};
+
+
+	public:
+		DetectorLanes();
+		~DetectorLanes();
+
+
+	public:
+		/**
+		 * @brief Attaches a detector.
+		 * @param filter The filter definition of the detector
+		 * @param fsamp The sampling frequency of the stream
+		 * @param func The function which processes the filtered data
+		 * @param release The function which is called if the lanes are
+		 *        destroyed before the slot has been detached
+		 * @param error Receives the reason if the filter is not supported
+		 * @return The slot of the detector or NULL if the filter is not
+		 *         supported
+		 */
+		Slot *attach(const std::string &filter, double fsamp,
+		             const ProcessFunc &func, const ReleaseFunc &release,
+		             std::string *error = nullptr);
+
+		//! Removes a slot. Its collected samples are processed before
+		//! unless process is false, e.g. if the detector is destroyed.
+		void detach(Slot *slot, bool process = true);
+
+		//! Filters and processes all collected samples
+		void flush();
+
+
+	private:
+		void flush(Group *group);
+
+
+	private:
+		typedef std::pair<std::string, double> GroupKey;
+		typedef std::map<GroupKey, std::unique_ptr<Group>> Groups;
+
+		Groups _groups;
+		bool   _flushing{false};
+};
+
+
+}
+}
+}
+
+
+#endif
@@ -0,0 +1,502 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+
+#include "lanefilter.h"
+
+
+using namespace std;
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+
+
+namespace {
+
+
+typedef double Lanes __attribute__((vector_size(LaneWidth * sizeof(double))));
+typedef long long LaneBits __attribute__((vector_size(LaneWidth * sizeof(double))));
+
+// The number of samples per lane which are transposed at once
+const size_t ChunkSize = 128;
+
+
+string trim(const string &str) {
+	size_t first = str.find_first_not_of(" \t");
+	if ( first == string::npos ) {
+		return string();
+	}
+
+	size_t last = str.find_last_not_of(" \t");
+	return str.substr(first, last - first + 1);
+}
+
+
+bool parseArguments(const string &str, vector<double> &args) {
+	size_t pos = 0;
+
+	while ( true ) {
+		size_t end = str.find(',', pos);
+		string arg = trim(str.substr(pos, end == string::npos ? string::npos : end - pos));
+		if ( arg.empty() ) {
+			return false;
+		}
+
+		char *tail;
+		double value = strtod(arg.c_str(), &tail);
+		if ( *tail != '\0' ) {
+			return false;
+		}
+
+		args.push_back(value);
+
+		if ( end == string::npos ) {
+			return true;
+		}
+
+		pos = end + 1;
+	}
+}
+
+
+size_t samples(double seconds, double fsamp) {
+	return max(size_t(1), static_cast<size_t>(round(seconds * fsamp)));
+}
+
+
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool LaneFilter::setup(const string &definition, double fsamp, string *error) {
+	_stages.clear();
+	_initLength = 0;
+
+	if ( fsamp <= 0 ) {
+		if ( error ) *error = "invalid sampling frequency";
+		return false;
+	}
+
+	size_t pos = 0;
+
+	while ( true ) {
+		size_t end = definition.find(">>", pos);
+		string token = trim(definition.substr(pos, end == string::npos ? string::npos : end - pos));
+
+		size_t open = token.find('(');
+		if ( open == string::npos || token[token.size()-1] != ')' ) {
+			if ( error ) *error = "unsupported filter: " + token;
+			return false;
+		}
+
+		string name = trim(token.substr(0, open));
+		vector<double> args;
+		if ( !parseArguments(token.substr(open + 1, token.size() - open - 2), args) ) {
+			if ( error ) *error = "invalid arguments: " + token;
+			return false;
+		}
+
+		if ( !addStage(name, args, fsamp, error) ) {
+			return false;
+		}
+
+		if ( end == string::npos ) {
+			break;
+		}
+
+		pos = end + 2;
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool LaneFilter::addStage(const string &name, const vector<double> &args,
+                          double fsamp, string *error) {
+	double nyquist = fsamp * 0.5;
+	Stage stage{};
+
+	if ( name == "RMHP" && args.size() == 1 && args[0] > 0 ) {
+		stage.type = Stage::RunningMeanHighPass;
+		stage.length[0] = samples(args[0], fsamp);
+		stage.weight[0] = 1.0 / stage.length[0];
+		_initLength = max(_initLength, stage.length[0]);
+		_stages.push_back(stage);
+		return true;
+	}
+
+	if ( name == "ITAPER" && args.size() == 1 && args[0] > 0 ) {
+		stage.type = Stage::InitialTaper;
+		stage.length[0] = samples(args[0], fsamp);
+		_initLength = max(_initLength, stage.length[0]);
+		_stages.push_back(stage);
+		return true;
+	}
+
+	if ( name == "STALTA" && args.size() == 2 && args[0] > 0 && args[1] > args[0] ) {
+		stage.type = Stage::StaLta;
+		stage.length[0] = samples(args[0], fsamp);
+		stage.length[1] = samples(args[1], fsamp);
+		stage.weight[0] = 1.0 / stage.length[0];
+		stage.weight[1] = 1.0 / stage.length[1];
+		_initLength = max(_initLength, stage.length[1]);
+		_stages.push_back(stage);
+		return true;
+	}
+
+	if ( (name == "BW" || name == "BW_HLP") && args.size() == 3 ) {
+		if ( args[1] <= 0 || args[2] <= args[1] || args[2] >= nyquist ) {
+			if ( error ) *error = "invalid corner frequencies for " + name;
+			return false;
+		}
+
+		if ( name == "BW" ) {
+			return addButterworthBandpass(static_cast<int>(args[0]), args[1],
+			                              args[2], fsamp, error);
+		}
+
+		return addButterworth(static_cast<int>(args[0]), args[1], true, fsamp, error)
+		    && addButterworth(static_cast<int>(args[0]), args[2], false, fsamp, error);
+	}
+
+	if ( (name == "BW_HP" || name == "BW_LP") && args.size() == 2 ) {
+		if ( args[1] <= 0 || args[1] >= nyquist ) {
+			if ( error ) *error = "invalid corner frequency for " + name;
+			return false;
+		}
+
+		return addButterworth(static_cast<int>(args[0]), args[1],
+		                      name == "BW_HP", fsamp, error);
+	}
+
+	if ( error ) *error = "unsupported filter: " + name;
+	return false;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool LaneFilter::addButterworth(int order, double fc, bool highPass,
+                                double fsamp, string *error) {
+	if ( order < 1 || order > 20 ) {
+		if ( error ) *error = "invalid Butterworth order";
+		return false;
+	}
+
+	// Prewarped analog corner frequency
+	double k = tan(M_PI * fc / fsamp);
+	double k2 = k * k;
+
+	for ( int i = 0; i < order / 2; ++i ) {
+		double q = 1.0 / (2.0 * sin((2 * i + 1) * M_PI / (2 * order)));
+		double norm = 1.0 / (1.0 + k / q + k2);
+
+		Stage stage{};
+		stage.type = Stage::SecondOrderSection;
+		if ( highPass ) {
+			stage.b0 = norm;
+			stage.b1 = -2.0 * norm;
+		}
+		else {
+			stage.b0 = k2 * norm;
+			stage.b1 = 2.0 * stage.b0;
+		}
+		stage.b2 = stage.b0;
+		stage.a1 = 2.0 * (k2 - 1.0) * norm;
+		stage.a2 = (1.0 - k / q + k2) * norm;
+		_stages.push_back(stage);
+	}
+
+	if ( order % 2 ) {
+		double norm = 1.0 / (1.0 + k);
+
+		Stage stage{};
+		stage.type = Stage::SecondOrderSection;
+		if ( highPass ) {
+			stage.b0 = norm;
+			stage.b1 = -norm;
+		}
+		else {
+			stage.b0 = k * norm;
+			stage.b1 = stage.b0;
+		}
+		stage.a1 = (k - 1.0) * norm;
+		_stages.push_back(stage);
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool LaneFilter::addButterworthBandpass(int order, double fmin, double fmax,
+                                        double fsamp, string *error) {
+	if ( order < 1 || order > 20 ) {
+		if ( error ) *error = "invalid Butterworth order";
+		return false;
+	}
+
+	// Prewarped analog corner frequencies, the lowpass prototype is
+	// transformed to a bandpass around w0 with bandwidth bw
+	double kmin = tan(M_PI * fmin / fsamp);
+	double kmax = tan(M_PI * fmax / fsamp);
+	double w0 = sqrt(kmin * kmax);
+	double bw = kmax - kmin;
+
+	// Adds the section of the analog poles s1 and conj(s1), which is
+	// scaled to unit gain at w0. The zeros are at 0 and at infinity.
+	auto addSection = [this, w0](double a, double c) {
+		double norm = 1.0 / (1.0 + a + c);
+
+		Stage stage{};
+		stage.type = Stage::SecondOrderSection;
+		stage.b0 = hypot(c - w0 * w0, a * w0) / w0 * norm;
+		stage.b2 = -stage.b0;
+		stage.a1 = 2.0 * (c - 1.0) * norm;
+		stage.a2 = (1.0 - a + c) * norm;
+		_stages.push_back(stage);
+	};
+
+	// Each complex pole pair of the prototype yields two sections
+	for ( int i = 0; i < order / 2; ++i ) {
+		double theta = (2 * i + 1) * M_PI / (2 * order);
+		complex<double> p(-sin(theta), cos(theta));
+		complex<double> ps = p * bw * 0.5;
+		complex<double> root = sqrt(ps * ps - w0 * w0);
+
+		for ( const complex<double> &s : { ps + root, ps - root } ) {
+			addSection(-2.0 * s.real(), std::norm(s));
+		}
+	}
+
+	// The real pole of an odd order yields s^2 + bw*s + w0^2
+	if ( order % 2 ) {
+		addSection(bw, w0 * w0);
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void LaneFilter::reset(LaneState &state) const {
+	state.values.assign(_stages.size() * 2, 0.0);
+	state.count = 0;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void LaneFilter::apply(LaneState &state, double *data, size_t n) const {
+	if ( state.values.size() != _stages.size() * 2 ) {
+		reset(state);
+	}
+
+	for ( size_t s = 0; s < _stages.size(); ++s ) {
+		const Stage &stage = _stages[s];
+		double &v0 = state.values[2*s];
+		double &v1 = state.values[2*s+1];
+		size_t k = state.count;
+
+		switch ( stage.type ) {
+			case Stage::RunningMeanHighPass:
+				// The mean of all samples until the window is filled
+				for ( size_t i = 0; i < n; ++i, ++k ) {
+					double w = k < stage.length[0] ? 1.0 / (k + 1) : stage.weight[0];
+					v0 += (data[i] - v0) * w;
+					data[i] -= v0;
+				}
+				break;
+
+			case Stage::InitialTaper:
+				for ( size_t i = 0; i < n && k < stage.length[0]; ++i, ++k ) {
+					data[i] *= 0.5 * (1.0 - cos(M_PI * k / stage.length[0]));
+				}
+				break;
+
+			case Stage::SecondOrderSection:
+				// Transposed direct form II
+				for ( size_t i = 0; i < n; ++i ) {
+					double x = data[i];
+					double y = stage.b0 * x + v0;
+					v0 = stage.b1 * x - stage.a1 * y + v1;
+					v1 = stage.b2 * x - stage.a2 * y;
+					data[i] = y;
+				}
+				break;
+
+			case Stage::StaLta:
+				for ( size_t i = 0; i < n; ++i, ++k ) {
+					double x = fabs(data[i]);
+					double ws = k < stage.length[0] ? 1.0 / (k + 1) : stage.weight[0];
+					double wl = k < stage.length[1] ? 1.0 / (k + 1) : stage.weight[1];
+					v0 += (x - v0) * ws;
+					v1 += (x - v1) * wl;
+					data[i] = v0 / v1;
+				}
+				break;
+		}
+	}
+
+	state.count += n;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void LaneFilter::apply(LaneState *const states[LaneWidth],
+                       double *const data[LaneWidth],
+                       const size_t n[LaneWidth]) const {
+	size_t common = n[0];
+	bool initialized = true;
+
+	for ( int l = 0; l < LaneWidth; ++l ) {
+		if ( states[l]->values.size() != _stages.size() * 2 ) {
+			reset(*states[l]);
+		}
+
+		common = min(common, n[l]);
+		if ( states[l]->count < _initLength ) {
+			initialized = false;
+		}
+	}
+
+	// The windows of a stream which has been reset recently are still
+	// growing, this is not worth to be vectorized
+	if ( !initialized ) {
+		common = 0;
+	}
+
+	if ( common > 0 ) {
+		applyLanes(states, data, common);
+	}
+
+	for ( int l = 0; l < LaneWidth; ++l ) {
+		if ( n[l] > common ) {
+			apply(*states[l], data[l] + common, n[l] - common);
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void LaneFilter::applyLanes(LaneState *const states[LaneWidth],
+                            double *const data[LaneWidth], size_t n) const {
+	Lanes buf[ChunkSize];
+
+	for ( size_t offset = 0; offset < n; offset += ChunkSize ) {
+		size_t m = min(ChunkSize, n - offset);
+
+		for ( size_t i = 0; i < m; ++i ) {
+			for ( int l = 0; l < LaneWidth; ++l ) {
+				buf[i][l] = data[l][offset+i];
+			}
+		}
+
+		for ( size_t s = 0; s < _stages.size(); ++s ) {
+			const Stage &stage = _stages[s];
+			Lanes v0, v1;
+
+			for ( int l = 0; l < LaneWidth; ++l ) {
+				v0[l] = states[l]->values[2*s];
+				v1[l] = states[l]->values[2*s+1];
+			}
+
+			// All windows are filled, see apply
+			switch ( stage.type ) {
+				case Stage::RunningMeanHighPass:
+					for ( size_t i = 0; i < m; ++i ) {
+						Lanes x = buf[i];
+						v0 += (x - v0) * stage.weight[0];
+						buf[i] = x - v0;
+					}
+					break;
+
+				case Stage::InitialTaper:
+					break;
+
+				case Stage::SecondOrderSection:
+					for ( size_t i = 0; i < m; ++i ) {
+						Lanes x = buf[i];
+						Lanes y = stage.b0 * x + v0;
+						v0 = stage.b1 * x - stage.a1 * y + v1;
+						v1 = stage.b2 * x - stage.a2 * y;
+						buf[i] = y;
+					}
+					break;
+
+				case Stage::StaLta:
+					for ( size_t i = 0; i < m; ++i ) {
+						Lanes x = (Lanes)((LaneBits)buf[i] & 0x7fffffffffffffffLL);
+						v0 += (x - v0) * stage.weight[0];
+						v1 += (x - v1) * stage.weight[1];
+						buf[i] = v0 / v1;
+					}
+					break;
+			}
+
+			for ( int l = 0; l < LaneWidth; ++l ) {
+				states[l]->values[2*s] = v0[l];
+				states[l]->values[2*s+1] = v1[l];
+			}
+		}
+
+		for ( size_t i = 0; i < m; ++i ) {
+			for ( int l = 0; l < LaneWidth; ++l ) {
+				data[l][offset+i] = buf[i][l];
+			}
+		}
+	}
+
+	for ( int l = 0; l < LaneWidth; ++l ) {
+		states[l]->count += n;
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+}
+}
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#ifndef SEISCOMP_APPLICATIONS_PICKER_LANEFILTER_H__
+#define SEISCOMP_APPLICATIONS_PICKER_LANEFILTER_H__
+
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+
+
+//! The number of streams filtered at once. A step spans several SIMD
+//! registers which hides the latency of the recursive filters.
+const int LaneWidth = 8;
+
+
+/**
+ * @brief The state of a lane filter for a single stream.
+ */
+struct LaneState {
+	//! Two values per filter stage
+	std::vector<double> values;
+	//! The number of samples filtered since the last reset
+	size_t              count{0};
+};
+
+
+/**
+ * @brief A detector filter chain which filters several streams at once.
+ *
+ * The filter supports the stages commonly used for detections:
+ * RMHP(window), ITAPER(length), BW(order,lo,hi), BW_HLP(order,lo,hi),
+ * BW_HP(order,fc), BW_LP(order,fc) and STALTA(sta,lta). All lengths are
+ * given in seconds, all frequencies in Hz. Butterworth filters are
+ * cascades of second order sections designed with the bilinear transform.
+ * BW is a bandpass of its own while BW_HLP combines a highpass and a
+ * lowpass, as in the filter library.
+ *
+ * Streams which share the filter and the sampling frequency keep their own
+ * LaneState. Once the initial windows of LaneWidth streams have passed,
+ * their samples are filtered together with SIMD instructions. Otherwise
+ * each stream is filtered separately with the same arithmetic.
+ */
+class LaneFilter {
+	public:
+		LaneFilter() = default;
+
+
+	public:
+		/**
+		 * @brief Sets up the filter chain.
+		 * @param definition The filter definition, e.g.
+		 *        RMHP(10)>>ITAPER(30)>>BW(4,0.7,2)>>STALTA(2,80)
+		 * @param fsamp The sampling frequency of the streams
+		 * @param error Receives the reason if the definition is not supported
+		 * @return False if the definition contains unsupported filters or
+		 *         invalid parameters
+		 */
+		bool setup(const std::string &definition, double fsamp,
+		           std::string *error = nullptr);
+
+		//! Resets the state of a stream
+		void reset(LaneState &state) const;
+
+		//! Filters the samples of a single stream in place
+		void apply(LaneState &state, double *data, size_t n) const;
+
+		/**
+		 * @brief Filters the samples of LaneWidth streams in place.
+		 *
+		 * The common number of samples is filtered at once if all streams
+		 * are initialized, the remaining samples of each stream are
+		 * filtered separately.
+		 */
+		void apply(LaneState *const states[LaneWidth],
+		           double *const data[LaneWidth],
+		           const size_t n[LaneWidth]) const;
+
+
+	private:
+		struct Stage {
+			enum Type {
+				RunningMeanHighPass,
+				InitialTaper,
+				SecondOrderSection,
+				StaLta
+			};
+
+			Type   type;
+			// The window lengths in samples
+			size_t length[2];
+			// The inverse window lengths
+			double weight[2];
+			// The coefficients of a second order section, a0 is 1
+			double b0, b1, b2, a1, a2;
+		};
+
+		typedef std::vector<Stage> Stages;
+
+
+	private:
+		bool addStage(const std::string &name, const std::vector<double> &args,
+		              double fsamp, std::string *error);
+		bool addButterworth(int order, double fc, bool highPass, double fsamp,
+		                    std::string *error);
+		bool addButterworthBandpass(int order, double fmin, double fmax,
+		                            double fsamp, std::string *error);
+
+		void applyLanes(LaneState *const states[LaneWidth],
+		                double *const data[LaneWidth], size_t n) const;
+
+
+	private:
+		Stages _stages;
+		// The number of samples until all windows are filled
+		size_t _initLength{0};
+};
+
+
+}
+}
+}
+
+
+#endif
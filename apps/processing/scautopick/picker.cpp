@@ -16,13 +16,12 @@
 #include <seiscomp/logging/log.h>
 
 #include <seiscomp/client/inventory.h>
+#include <seiscomp/client/queue.ipp>
 
 #include <seiscomp/processing/application.h>
 #include <seiscomp/processing/response.h>
 #include <seiscomp/processing/sensor.h>
 
-#include <seiscomp/io/archive/xmlarchive.h>
-
 #include <seiscomp/math/geo.h>
 #include <seiscomp/math/filter.h>
 
@@ -42,7 +41,6 @@
 #include <functional>
 
 #include "picker.h"
-#include "detector.h"
 
 
 using namespace std;
@@ -57,6 +55,14 @@ using namespace Seiscomp::Processing;
 namespace {
 
 
+// Maximum number of picks and amplitudes queued for the output thread
+const int OutputQueueSize = 4096;
+
+// Number of records read between two progress reports to the shards if the
+// output is sorted
+const size_t ProgressInterval = 1000;
+
+
 char statusFlag(const Seiscomp::DataModel::Pick *pick) {
 	try {
 		if ( pick->evaluationMode() == Seiscomp::DataModel::AUTOMATIC ) {
@@ -71,35 +77,13 @@ char statusFlag(const Seiscomp::DataModel::Pick *pick) {
 }
 
 
-bool contains(const Seiscomp::Core::TimeWindow &tw, const OPT(Seiscomp::Core::Time) &time) {
-	if ( !time ) {
-		return false;
-	}
-
-	if ( tw.startTime().valid() && tw.endTime().valid() ) {
-		return tw.contains(*time);
-	}
-
-	if ( tw.startTime().valid() ) {
-		return *time >= tw.startTime();
-	}
-
-	if ( tw.endTime().valid() ) {
-		return *time < tw.endTime();
+// The time by which the output is sorted
+Seiscomp::Core::Time referenceTime(const Seiscomp::DataModel::Amplitude *amp) {
+	try {
+		return amp->timeWindow().reference();
 	}
-
-	return true;
-}
-
-
-Seiscomp::DataModel::WaveformStreamID waveformStreamID(const Seiscomp::Record *rec) {
-	return Seiscomp::DataModel::WaveformStreamID(
-		rec->networkCode(), rec->stationCode(), rec->locationCode(), rec->channelCode(), "");
-}
-
-
-std::string dotted(const Seiscomp::DataModel::WaveformStreamID &wf) {
-	return wf.networkCode() + "." + wf.stationCode() + "." + wf.locationCode() + "." + wf.channelCode();
+	catch ( ... ) {}
+	return Seiscomp::Core::Time();
 }
 
 
@@ -167,6 +151,41 @@ ostream& operator<<(ostream& o, const Seiscomp::DataModel::Amplitude* amp) {
 namespace Seiscomp {
 namespace Applications {
 namespace Picker {
+
+
+// Processes all streams on the application thread. The processors are
+// registered with the application which feeds them with records.
+class App::LocalPipeline : public Pipeline {
+	public:
+		explicit LocalPipeline(App *app) : Pipeline(app) {}
+
+
+	protected:
+		void addProcessor(const std::string &networkCode,
+		                  const std::string &stationCode,
+		                  const std::string &locationCode,
+		                  const std::string &channelCode,
+		                  WaveformProcessor *proc) override {
+			_app->addProcessor(networkCode, stationCode, locationCode,
+			                   channelCode, proc);
+		}
+
+		void removeProcessor(WaveformProcessor *proc) override {
+			_app->removeProcessor(proc);
+		}
+
+		void publishPick(DataModel::Pick *pick, DataModel::Amplitude *amp) override {
+			_app->sendPick(pick, amp);
+		}
+
+		bool publishAmplitude(DataModel::Amplitude *amp, bool update) override {
+			return _app->sendAmplitude(amp, update);
+		}
+
+		void storeAmplitude(DataModel::Amplitude *amp) override {
+			_app->storeAmplitude(amp);
+		}
+};
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
 
@@ -251,10 +270,20 @@ void App::createCommandLineDescription() {
 	                        "If a picker is configured send detections as well.");
 	commandline().addOption("Settings", "extra-comments",
 	                        "Add extra comments to picks.\nSupported: SNR.");
+	commandline().addOption("Settings", "threads",
+	                        "The number of threads processing the streams.",
+	                        &_config.threads);
+	commandline().addOption("Settings", "batch-detectors",
+	                        "Filter the detector data of streams with the same "
+	                        "filter and sampling frequency in batches.");
 
 	commandline().addGroup("Output");
 	commandline().addOption("Output", "formatted,f",
 	                        "Use formatted XML output. Otherwise XML is unformatted.");
+	commandline().addOption("Output", "gzip",
+	                        "Compress the output of '--ep' with gzip.");
+	commandline().addOption("Output", "binary",
+	                        "Write the output of '--ep' as binary archives instead of XML.");
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -299,6 +328,11 @@ bool App::validateParameters() {
 		return false;
 	}
 
+	if ( _config.threads < 1 ) {
+		cerr << "The number of threads must be at least 1" << endl;
+		return false;
+	}
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -464,6 +498,14 @@ bool App::init() {
 		logAmplTypes += '\n';
 	}
 
+	// Pickers, feature extractors and amplitude processors may read other
+	// streams than the one of the detection, e.g. the vertical component
+	// after a detection on a horizontal component
+	_shardByStream = _config.pickerType.empty() &&
+	                 _config.secondaryPickerType.empty() &&
+	                 _config.featureExtractionType.empty() &&
+	                 (!_config.calculateAmplitudes || _config.amplitudeList.empty());
+
 	Core::Time now = Core::Time::UTC();
 	DataModel::Inventory *inv = Client::Inventory::Instance()->inventory();
 
@@ -614,6 +656,9 @@ void App::printUsage() const {
 	cout << "Non-real-time playback of miniSEED data in a file. Picks and "
 	        "amplitudes are printed to stdout as SCML" << endl
 	     << "  " << name() << " -d localhost --playback --ep -I data.mseed" << endl << endl;
+	cout << "Parallel playback with 8 threads. Picks and amplitudes are "
+	        "printed in time order followed by a throughput report" << endl
+	     << "  " << name() << " -d localhost --playback --ep --threads 8 -I data.mseed" << endl << endl;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -629,11 +674,46 @@ bool App::run() {
 		return true;
 	}
 
+	_formatted = commandline().hasOption("formatted");
+
 	if ( commandline().hasOption("ep") ) {
 		_ep = new DataModel::EventParameters;
+
+		// Picks and amplitudes are written as soon as they are final
+		// rather than collected until the end
+		_epWriter.setFormattedOutput(_formatted);
+		_epWriter.setCompression(commandline().hasOption("gzip"));
+		_epWriter.setBinary(commandline().hasOption("binary"));
+		if ( !_epWriter.create("-") )
+			return false;
 	}
 
-	_formatted = commandline().hasOption("formatted");
+	// Batch processing collects the records in the queue of a shard, hence
+	// it uses a shard even with a single thread
+	if ( _config.threads > 1 || _config.batchDetectors ) {
+		// Picks and amplitudes of all shards are sent by a single thread
+		_outputQueue.resize(OutputQueueSize);
+		_sender = thread(&App::sendOutput, this);
+
+		// The shards finish their picks and amplitudes at different times.
+		// The output is merged by time if it is written to a file.
+		_sortOutput = _ep && _config.threads > 1;
+		_shardTimes.assign(_config.threads, OPT(Core::Time)());
+
+		for ( int i = 0; i < _config.threads; ++i ) {
+			_shards.emplace_back(new Shard(this, i));
+			_shards.back()->start();
+		}
+
+		SEISCOMP_INFO("Distributing %s across %d threads",
+		              _shardByStream ? "streams" : "stations", _config.threads);
+		if ( _config.batchDetectors )
+			SEISCOMP_INFO("Filtering detector data in batches of %d streams", LaneWidth);
+	}
+	else
+		_pipeline.reset(new LocalPipeline(this));
+
+	_timer.restart();
 
 	return Processing::Application::run();
 }
@@ -644,17 +724,42 @@ bool App::run() {
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void App::done() {
+	// The queued records are processed before the output is closed
+	for ( auto &shard : _shards )
+		shard->stop();
+	_shards.clear();
+
+	if ( _sender.joinable() ) {
+		_outputQueue.push(OutputTask());
+		_sender.join();
+	}
+
+	if ( _pipeline )
+		_pipeline->flush();
+
 	if ( _ep ) {
-		IO::XMLArchive ar;
-		ar.create("-");
-		ar.setFormattedOutput(_formatted);
-		ar << _ep;
-		ar.close();
-		cerr << "Found "<< _ep->pickCount() << " picks and "
-		     << _ep->amplitudeCount() << " amplitudes" << endl;
+		if ( _sortOutput )
+			releaseOutput(true);
+
+		writeEventParameters();
+		_epWriter.close();
+		cerr << "Found "<< _pickCount << " picks and "
+		     << _amplitudeCount << " amplitudes" << endl;
 		_ep = NULL;
 	}
 
+	if ( _config.playback && _recordCount > 0 ) {
+		double seconds = (double)_timer.elapsed();
+		if ( seconds <= 0 ) seconds = 1E-6;
+
+		fprintf(stderr, "Processed %lu records with %lu samples in %.2f s: "
+		        "%.0f samples/s, %.2f picks/s (%lu picks, %d threads)\n",
+		        (unsigned long)_recordCount, (unsigned long)_sampleCount,
+		        seconds, _sampleCount / seconds, _emittedPickCount / seconds,
+		        (unsigned long)_emittedPickCount,
+		        _pipeline ? 1 : _config.threads);
+	}
+
 	Processing::Application::done();
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -698,285 +803,40 @@ void App::updateObject(const string& parentID, DataModel::Object* o) {
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-bool App::initComponent(Processing::WaveformProcessor *proc,
-                        Processing::WaveformProcessor::Component comp,
-                        const Core::Time &time,
-                        const std::string &streamID,
-                        const DataModel::WaveformStreamID &waveformID,
-                        bool metaDataRequired) {
-	auto it = _streams.find(streamID);
-	if ( it != _streams.end() && contains(it->second->epoch, time) ) {
-		proc->streamConfig(comp) = *it->second;
-		if ( proc->streamConfig(comp).gain == 0.0 && metaDataRequired ) {
-			SEISCOMP_ERROR("No gain for stream %s", streamID.c_str());
-			return false;
-		}
-	}
-	else {
-		// Load sensor, responses usw.
-		Processing::StreamPtr stream = new Processing::Stream;
-		_streams[streamID] = stream;
-
-		stream->init(waveformID.networkCode(), waveformID.stationCode(), waveformID.locationCode(), waveformID.channelCode(), time);
-		if ( (stream->gain == 0.0) && metaDataRequired ) {
-			SEISCOMP_ERROR("No gain for stream %s", streamID.c_str());
-			return false;
-		}
-
-		proc->streamConfig(comp) = *stream;
-	}
-
-	return true;
-}
-// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
-
-
-
-
-// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-bool App::initProcessor(Processing::WaveformProcessor *proc,
-                        Processing::WaveformProcessor::StreamComponent comp,
-                        const Core::Time &time,
-                        const std::string &streamID,
-                        const DataModel::WaveformStreamID &waveformID,
-                        bool metaDataRequired) {
-	const std::string dottedWaveformID = dotted(waveformID);
-	switch ( comp ) {
-		case Processing::WaveformProcessor::Vertical:
-			if ( !initComponent(proc,
-			                    Processing::WaveformProcessor::VerticalComponent,
-			                    time, streamID, waveformID, metaDataRequired) ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup vertical component");
-				return false;
-			}
-			break;
-
-		case Processing::WaveformProcessor::FirstHorizontal:
-			if ( !initComponent(proc,
-			                    Processing::WaveformProcessor::FirstHorizontalComponent,
-			                    time, streamID, waveformID, metaDataRequired) ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup first horizontal component");
-				return false;
-			}
-			break;
-
-		case Processing::WaveformProcessor::SecondHorizontal:
-			if ( !initComponent(proc, Processing::WaveformProcessor::SecondHorizontalComponent,
-			                    time, streamID, waveformID, metaDataRequired) ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup second horizontal component");
-				return false;
-			}
-			break;
-
-		case Processing::WaveformProcessor::Horizontal:
-		{
-			// Find the two horizontal components of given location code
-			DataModel::ThreeComponents chans;
-			DataModel::WaveformStreamID waveformID1, waveformID2;
-			string streamID1, streamID2;
-
-			DataModel::SensorLocation *loc =
-				Client::Inventory::Instance()->getSensorLocation(
-					waveformID.networkCode(), waveformID.stationCode(), waveformID.locationCode(), time);
-
-			if ( loc == NULL ) {
-				SEISCOMP_ERROR("%s.%s: location code '%s' not found",
-				               waveformID.networkCode().c_str(), waveformID.stationCode().c_str(),
-				               waveformID.locationCode().c_str());
-				return false;
-			}
-
-			// Extract the first two characters of the channel code
-			string c2 = waveformID.channelCode().substr(0, 2);
-
-			DataModel::getThreeComponents(chans, loc, c2.c_str(), time);
-			if ( chans.comps[DataModel::ThreeComponents::FirstHorizontal] != NULL ) {
-				string channelCode1 = chans.comps[DataModel::ThreeComponents::FirstHorizontal]->code();
-				waveformID1 = waveformID;
-				waveformID1.setChannelCode(channelCode1);
-				streamID1 = dotted(waveformID1);
-			}
-			else {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": 1st horizontal component not available");
-				return false;
-			}
-
-			if ( chans.comps[DataModel::ThreeComponents::SecondHorizontal] != NULL ) {
-				string channelCode2 = chans.comps[DataModel::ThreeComponents::SecondHorizontal]->code();
-				waveformID2 = waveformID;
-				waveformID2.setChannelCode(channelCode2);
-				streamID2 = dotted(waveformID2);
-			}
-			else {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": 2nd horizontal component not available");
-				return false;
-			}
-
-			if ( !initComponent(proc, Processing::WaveformProcessor::FirstHorizontalComponent,
-			                    time, streamID1, waveformID1, metaDataRequired) ||
-			     !initComponent(proc, Processing::WaveformProcessor::SecondHorizontalComponent,
-			                    time, streamID2, waveformID2, metaDataRequired) ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup horizontal components");
-				return false;
-			}
-			break;
-		}
-
-		case Processing::WaveformProcessor::Any:
-		{
-			// Find the all three components of given location code
-			DataModel::ThreeComponents chans;
-			DataModel::WaveformStreamID waveformID0, waveformID1, waveformID2;
-			string streamID0, streamID1, streamID2;
-
-			DataModel::SensorLocation *loc =
-				Client::Inventory::Instance()->getSensorLocation(
-					waveformID.networkCode(), waveformID.stationCode(), waveformID.locationCode(), time
-				);
-
-			if ( loc == NULL ) {
-				SEISCOMP_ERROR("%s.%s: location code '%s' not found",
-				               waveformID.networkCode().c_str(), waveformID.stationCode().c_str(),
-				               waveformID.locationCode().c_str());
-				return false;
-			}
-
-			// Extract the first two characters of the channel code
-			string c2 = waveformID.channelCode().substr(0, 2);
-			DataModel::getThreeComponents(chans, loc, c2.c_str(), time);
-			if ( chans.comps[DataModel::ThreeComponents::Vertical] != NULL ) {
-				string channelCode0 = chans.comps[DataModel::ThreeComponents::Vertical]->code();
-				waveformID0 = waveformID;
-				waveformID0.setChannelCode(channelCode0);
-				streamID0 = dotted(waveformID0);
-			}
-			else if ( metaDataRequired ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": vertical component not available");
-				return false;
-			}
-
-			if ( chans.comps[DataModel::ThreeComponents::FirstHorizontal] != NULL ) {
-				string channelCode1 = chans.comps[DataModel::ThreeComponents::FirstHorizontal]->code();
-				waveformID1 = waveformID;
-				waveformID1.setChannelCode(channelCode1);
-				streamID1 = dotted(waveformID1);
-			}
-			else if ( metaDataRequired ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": 1st horizontal component not available");
-				return false;
-			}
+void App::handleRecord(Record *rec) {
+	++_recordCount;
+	if ( rec->sampleCount() > 0 )
+		_sampleCount += rec->sampleCount();
 
-			if ( chans.comps[DataModel::ThreeComponents::SecondHorizontal] != NULL ) {
-				string channelCode2 = chans.comps[DataModel::ThreeComponents::SecondHorizontal]->code();
-				waveformID2 = waveformID;
-				waveformID2.setChannelCode(channelCode2);
-				streamID2 = dotted(waveformID2);
-			}
-			else if ( metaDataRequired ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": 2nd horizontal component not available");
-				return false;
-			}
-
-			if ( ! initComponent(proc, Processing::WaveformProcessor::VerticalComponent,
-			                     time, streamID0, waveformID0, metaDataRequired) ||
-			     ! initComponent(proc, Processing::WaveformProcessor::FirstHorizontalComponent,
-			                     time, streamID1, waveformID1, metaDataRequired) ||
-			     ! initComponent(proc, Processing::WaveformProcessor::SecondHorizontalComponent,
-			                     time, streamID2, waveformID2, metaDataRequired) ) {
-				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup components");
-				return false;
-			}
-			break;
-		}
-
-		default:
-			break;
+	if ( _shards.empty() ) {
+		Processing::Application::handleRecord(rec);
+		return;
 	}
 
-	const StreamConfig *sc = _stationConfig.get(&configuration(), configModuleName(),
-	                                            waveformID.networkCode(), waveformID.stationCode());
-	return proc->setup(Settings(configModuleName(), waveformID.networkCode(), waveformID.stationCode(),
-	                            waveformID.locationCode(), waveformID.channelCode(), &configuration(),
-	                            sc?sc->parameters.get():NULL));
-}
-// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
-
-
-
+	size_t hash;
+	if ( _shardByStream )
+		hash = std::hash<std::string>()(rec->streamID());
+	else
+		// All streams of a station are processed by the same shard since
+		// processors may use several components
+		hash = std::hash<std::string>()(rec->networkCode() + "." + rec->stationCode());
 
-// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-bool App::initDetector(const string &streamID,
-                       const DataModel::WaveformStreamID &waveformID,
-                       const Record *rec) {
-	double trigOn = _config.defaultTriggerOnThreshold;
-	double trigOff = _config.defaultTriggerOffThreshold;
-	double tcorr = _config.defaultTimeCorrection;
-	string filter = _config.defaultFilter;
-	bool sensitivityCorrection = false;
-
-	const StreamConfig *sc = _stationConfig.get(&configuration(), configModuleName(),
-	                                            waveformID.networkCode(), waveformID.stationCode());
-	if ( sc != NULL ) {
-		if ( !sc->enabled ) {
-			SEISCOMP_INFO("Detector on station %s.%s disabled by config",
-			              waveformID.networkCode().c_str(), waveformID.stationCode().c_str());
-			return true;
-		}
+	_shards[hash % _shards.size()]->feed(rec);
 
-		if ( sc->triggerOn ) trigOn = *sc->triggerOn;
-		if ( sc->triggerOff ) trigOff = *sc->triggerOff;
-		if ( !sc->filter.empty() ) filter = sc->filter;
-		if ( sc->timeCorrection ) tcorr = *sc->timeCorrection;
-		sensitivityCorrection = sc->sensitivityCorrection;
-	}
+	if ( !_sortOutput )
+		return;
 
-	DetectorPtr detector = new Detector(trigOn, trigOff, _config.initTime);
+	if ( !_readTime || rec->endTime() > *_readTime )
+		_readTime = rec->endTime();
 
-	Processing::WaveformProcessor::Filter *detecFilter;
-	string filterError;
-	detecFilter = Processing::WaveformProcessor::Filter::Create(filter, &filterError);
-	if ( !detecFilter ) {
-		SEISCOMP_WARNING("%s: compiling filter failed: %s: %s", streamID.c_str(),
-		                 filter.c_str(), filterError.c_str());
-		return false;
+	// All shards, also those without streams, learn regularly up to which
+	// time the data have been read. They report it to the output thread
+	// once they processed the records queued before.
+	if ( ++_unreportedRecords >= ProgressInterval ) {
+		for ( auto &shard : _shards )
+			shard->feedProgress(*_readTime);
+		_unreportedRecords = 0;
 	}
-
-	detector->setDeadTime(_config.triggerDeadTime);
-	detector->setAmplitudeTimeWindow(_config.amplitudeMaxTimeWindow);
-	//picker->setAmplitudeTimeWindow(0.0);
-	detector->setMinAmplitudeOffset(_config.amplitudeMinOffset);
-	detector->setDurations(_config.minDuration, _config.maxDuration);
-	detector->setFilter(detecFilter);
-	detector->setOffset(tcorr);
-	detector->setGapTolerance(_config.maxGapLength);
-	detector->setGapInterpolationEnabled(_config.interpolateGaps);
-	detector->setSensitivityCorrection(sensitivityCorrection);
-	detector->setPublishFunction(bind(
-		&App::emitDetection, this,
-		placeholders::_1,
-		placeholders::_2,
-		placeholders::_3
-	));
-
-	if ( _config.calculateAmplitudes )
-		detector->setAmplitudePublishFunction(bind(
-			&App::emitAmplitude, this,
-			placeholders::_1, placeholders::_2
-		));
-
-	if ( !initProcessor(detector.get(), detector->usedComponent(),
-	                    rec->startTime(), streamID, waveformID, sensitivityCorrection) )
-		return false;
-
-	SEISCOMP_DEBUG("%s: created detector with filter %s",
-	               streamID.c_str(), filter.c_str());
-
-	addProcessor(waveformID, detector.get());
-	detector->feed(rec);
-
-//	SEISCOMP_DEBUG("Number of processors: %lu", (unsigned long)processorCount());
-
-	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -985,77 +845,8 @@ bool App::initDetector(const string &streamID,
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void App::handleNewStream(const Record *rec) {
-	if ( _config.useAllStreams || _streamIDs.find(rec->streamID()) != _streamIDs.end() ) {
-		if ( !initDetector(rec->streamID(), waveformStreamID(rec), rec) ) {
-			SEISCOMP_ERROR("%s: initialization failed: abort operation",
-			               rec->streamID().c_str());
-			exit(1);
-		}
-	}
-}
-// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
-
-
-
-
-// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-template <typename T>
-void App::pushProcessor(const std::string &networkCode,
-                        const std::string &stationCode,
-                        const std::string &locationCode,
-                        T *proc) {
-	switch ( proc->usedComponent() ) {
-		case Processing::WaveformProcessor::Vertical:
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::VerticalComponent).code(),
-			             proc);
-			break;
-		case Processing::WaveformProcessor::FirstHorizontal:
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::FirstHorizontalComponent).code(),
-			             proc);
-			break;
-		case Processing::WaveformProcessor::SecondHorizontal:
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::SecondHorizontalComponent).code(),
-			             proc);
-			break;
-		case Processing::WaveformProcessor::Horizontal:
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::FirstHorizontalComponent).code(),
-			             proc);
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::SecondHorizontalComponent).code(),
-			             proc);
-			break;
-		case Processing::WaveformProcessor::Any:
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::VerticalComponent).code(),
-			             proc);
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::FirstHorizontalComponent).code(),
-			             proc);
-			addProcessor(networkCode,
-			             stationCode,
-			             locationCode,
-			             proc->streamConfig(Processing::WaveformProcessor::SecondHorizontalComponent).code(),
-			             proc);
-			break;
-	}
+	if ( _pipeline )
+		_pipeline->handleNewStream(rec);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1064,38 +855,8 @@ void App::pushProcessor(const std::string &networkCode,
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void App::processorFinished(const Record *rec, WaveformProcessor *wp) {
-	std::stringstream ss;
-
-	if ( wp->status() == Processing::WaveformProcessor::LowSNR )
-		ss << "SNR " << wp->statusValue() << " too low";
-	else if ( wp->status() > Processing::WaveformProcessor::Terminated )
-		ss << "ERROR (" << wp->status().toString() << "," << wp->statusValue() << ")";
-	else
-		ss << "OK";
-
-	SEISCOMP_DEBUG("%s:%s: %s", rec != NULL?rec->streamID().c_str():"-",
-	                           wp->className(),
-	                           ss.str().c_str());
-
-	// If its a secondary processor remove it from the tracked item list
-	ProcReverseMap::iterator pit = _procLookup.find(wp);
-	if ( pit == _procLookup.end() ) return;
-
-	ProcMap::iterator mit = _runningStreamProcs.find(pit->second);
-
-	_procLookup.erase(pit);
-
-	if ( mit == _runningStreamProcs.end() ) return;
-
-	ProcList &list = mit->second;
-	for ( ProcList::iterator it = list.begin(); it != list.end(); ) {
-		if ( it->proc == wp ) {
-			SEISCOMP_DEBUG("Removed finished processor from stream procs");
-			it = list.erase(it);
-		}
-		else
-			++it;
-	}
+	if ( _pipeline )
+		_pipeline->processorFinished(rec, wp);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1103,141 +864,62 @@ void App::processorFinished(const Record *rec, WaveformProcessor *wp) {
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-bool App::addFeatureExtractor(Seiscomp::DataModel::Pick *pick,
-                              DataModel::Amplitude *amp,
-                              const Record *rec, bool isPrimary) {
-	// Add secondary picker
-	FXPtr proc = FXFactory::Create(_config.featureExtractionType.c_str());
-	if ( !proc ) {
-		SEISCOMP_WARNING("Could not create fx: %s", _config.featureExtractionType.c_str());
-		this->exit(1);
-		return false;
+void App::sendPick(Seiscomp::DataModel::Pick *pick, DataModel::Amplitude *amp) {
+#ifdef LOG_PICKS
+	if ( !isMessagingEnabled() && !_ep ) {
+		//cout << pick.get();
+		printf("%s %-2s %-6s %-3s %-2s %6.1f %10.3f %4.1f %c %s\n",
+		       pick->time().value().toString("%Y-%m-%d %H:%M:%S.%1f").c_str(),
+		       pick->waveformID().networkCode().c_str(),
+		       pick->waveformID().stationCode().c_str(),
+		       pick->waveformID().channelCode().c_str(),
+		       pick->waveformID().locationCode().empty()?"__":pick->waveformID().locationCode().c_str(),
+		       -1.0, -1.0, -1.0, statusFlag(pick),
+		       pick->publicID().c_str());
 	}
+#endif
 
-	proc->setTrigger(pick->time().value());
-	proc->setEnvironment(
-		Client::Inventory::Instance()->getSensorLocation(
-			pick->waveformID().networkCode(),
-			pick->waveformID().stationCode(),
-			pick->waveformID().locationCode(),
-			pick->time().value()
-		),
-		pick
-	);
-	proc->setPublishFunction(std::bind(
-		&App::emitFXPick, this,
-		Seiscomp::DataModel::PickPtr(pick),
-		Seiscomp::DataModel::AmplitudePtr(amp),
-		isPrimary,
-		placeholders::_1, placeholders::_2
-	));
-
-	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
-	const std::string &n = rec->networkCode();
-	const std::string &s = rec->stationCode();
-	const std::string &l = rec->locationCode();
-	std::string c = rec->channelCode();
-
-	if ( !initProcessor(proc.get(), proc->usedComponent(), pick->time().value(), rec->streamID(), waveformID, true) )
-		return false;
-
-	SEISCOMP_DEBUG("%s: created fx %s (rec ref: %d)",
-	               rec->streamID().c_str(), _config.featureExtractionType.c_str(),
-	               rec->referenceCount());
-
-	pushProcessor(n, s, l, proc.get());
-
-	return true;
-}
-// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
-
-
-
+	SEISCOMP_DEBUG("%s.%s.%s.%s: emit detection %s",
+	               pick->waveformID().networkCode().c_str(),
+	               pick->waveformID().stationCode().c_str(),
+	               pick->waveformID().locationCode().c_str(),
+	               pick->waveformID().channelCode().c_str(),
+	               pick->publicID().c_str());
+	Core::Time now = Core::Time::UTC();
 
-// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::addSecondaryPicker(const Core::Time &onset, const Record *rec, const std::string &pickID) {
-	// Add secondary picker
-	SecondaryPickerPtr proc = SecondaryPickerFactory::Create(_config.secondaryPickerType.c_str());
-	if ( proc == NULL ) {
-		SEISCOMP_WARNING("Could not create secondary picker: %s", _config.secondaryPickerType.c_str());
-		this->exit(1);
-		return;
-	}
+	logObject(_logPicks, now);
+	if ( amp )
+		logObject(_logAmps, now);
 
-	SecondaryPicker::Trigger trigger;
-	trigger.onset = onset;
-	proc->setTrigger(trigger);
-	proc->setPublishFunction(bind(&App::emitSPick, this, placeholders::_1, placeholders::_2));
-	proc->setReferencingPickID(pickID);
+	++_emittedPickCount;
 
-	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
-	const std::string &n = rec->networkCode();
-	const std::string &s = rec->stationCode();
-	const std::string &l = rec->locationCode();
-	std::string c = rec->channelCode();
+	if ( connection() && !_config.test ) {
+		DataModel::NotifierPtr n = new DataModel::Notifier("EventParameters", DataModel::OP_ADD, pick);
+		DataModel::NotifierMessagePtr m = new DataModel::NotifierMessage;
+		m->attach(n.get());
 
-	if ( !initProcessor(proc.get(), proc->usedComponent(), onset, rec->streamID(), waveformID, true) )
-		return;
+		for ( size_t i = 0; i < pick->commentCount(); ++i ) {
+			n = new DataModel::Notifier(pick->publicID(), DataModel::OP_ADD, pick->comment(i));
+			m->attach(n.get());
+		}
 
-	SEISCOMP_DEBUG("%s: created secondary picker %s (rec ref: %d)",
-	               rec->streamID().c_str(), _config.secondaryPickerType.c_str(),
-	               rec->referenceCount());
-
-	pushProcessor(n, s, l, proc.get());
-
-	ProcList &list = _runningStreamProcs[rec->streamID()];
-	if ( _config.killPendingSecondaryProcessors ) {
-		SEISCOMP_DEBUG("check for expired procs (got %d in list)", (int)list.size());
-
-		// Check for secondary procs that are still running but where the
-		// end time is before onset and remove them
-		// ...
-		for ( ProcList::iterator it = list.begin(); it != list.end(); ) {
-			if ( it->dataEndTime <= onset ) {
-				SEISCOMP_DEBUG("Remove expired proc 0x%lx", (long int)it->proc);
-				if ( /*it->proc != NULL*/true ) {
-					SEISCOMP_INFO("Remove expired running processor %s on %s",
-					              it->proc->className(), rec->streamID().c_str());
-
-					if ( it->proc->status() == Processing::WaveformProcessor::LowSNR )
-						SEISCOMP_DEBUG("  -> status: SNR(%f) too low", it->proc->statusValue());
-					else if ( it->proc->status() > Processing::WaveformProcessor::Terminated )
-						SEISCOMP_DEBUG("  -> status: ERROR (%s, %f)",
-						               it->proc->status().toString(), it->proc->statusValue());
-					else
-						SEISCOMP_DEBUG("  -> status: OK");
-
-					// Remove processor from application
-					removeProcessor(it->proc);
-
-					// Remove its reverse lookup
-					ProcReverseMap::iterator pit = _procLookup.find(it->proc);
-					if ( pit != _procLookup.end() ) _procLookup.erase(pit);
-				}
+		connection()->send(m.get());
 
-				// Remove it from the run list
-				it = list.erase(it);
-			}
-			else
-				++it;
+		// Send amplitude
+		if ( amp ) {
+			n = new DataModel::Notifier("EventParameters", DataModel::OP_ADD, amp);
+			m = new DataModel::NotifierMessage;
+			m->attach(n.get());
+			connection()->send(_config.amplitudeGroup, m.get());
 		}
 	}
 
-	// addProcessor can feed the requested time window with cached records
-	// so the proc might be finished already. This needs a test otherwise
-	// the registered pointer is invalid later when checking for expired
-	// procs.
-	if ( !proc->isFinished() ) {
-		// Register the secondary procs running on the verticals
-		list.push_back(ProcEntry(proc->safetyTimeWindow().endTime(), proc.get()));
-		_procLookup[proc.get()] = rec->streamID();
-		SEISCOMP_DEBUG("%s: registered proc 0x%lx",
-		               rec->streamID().data(), (long int)proc.get());
+	if ( _ep ) {
+		storeObject(pick, pick->time().value());
+		if ( amp )
+			storeObject(amp, referenceTime(amp));
+		writeEventParameters();
 	}
-	else
-		SEISCOMP_DEBUG("%s: proc finished already", rec->streamID().data());
-
-//	SEISCOMP_DEBUG("Number of processors: %lu", (unsigned long)processorCount());
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1245,44 +927,17 @@ void App::addSecondaryPicker(const Core::Time &onset, const Record *rec, const s
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::addAmplitudeProcessor(AmplitudeProcessorPtr proc,
-                                const Record *rec,
-                                const Seiscomp::DataModel::Pick *pick) {
-	proc->setPublishFunction(bind(&App::emitAmplitude, this, placeholders::_1, placeholders::_2));
-	proc->setReferencingPickID(pick->publicID());
-
-	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
-	const std::string &n = rec->networkCode();
-	const std::string &s = rec->stationCode();
-	const std::string &l = rec->locationCode();
-	std::string c = rec->channelCode();
-
-	if ( !initProcessor(proc.get(), proc->usedComponent(), proc->trigger(), rec->streamID(), waveformID, true) )
-		return;
-
-	proc->setEnvironment(
-		nullptr, // No hypocenter information
-		Client::Inventory::Instance()->getSensorLocation(
-			n, s, l, proc->trigger()
-		),
-		pick
-	);
+bool App::sendAmplitude(DataModel::Amplitude *amp, bool update) {
+	logObject(_logAmps, Core::Time::UTC());
 
-	if ( proc->isFinished() ) {
-		// If the processor has finished already e.g. due to missing
-		// hypocenter information, do not add it and return.
-		processorFinished(rec, proc.get());
-		return;
+	if ( connection() && !_config.test ) {
+		DataModel::NotifierPtr n = new DataModel::Notifier("EventParameters", update?DataModel::OP_UPDATE:DataModel::OP_ADD, amp);
+		DataModel::NotifierMessagePtr m = new DataModel::NotifierMessage;
+		m->attach(n.get());
+		return connection()->send(_config.amplitudeGroup, m.get());
 	}
 
-	if ( _config.amplitudeUpdateList.find(proc->type()) != _config.amplitudeUpdateList.end() )
-		proc->setUpdateEnabled(true);
-	else
-		proc->setUpdateEnabled(false);
-
-	pushProcessor(n, s, l, proc.get());
-
-//	SEISCOMP_DEBUG("Number of processors: %lu", (unsigned long)processorCount());
+	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1290,27 +945,12 @@ void App::addAmplitudeProcessor(AmplitudeProcessorPtr proc,
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::emitTrigger(const Processing::Detector *pickProc,
-                      const Record *rec, const Core::Time &time) {
-	PickerPtr proc = PickerFactory::Create(_config.pickerType.c_str());
-	if ( !proc ) {
-		SEISCOMP_ERROR("Unable to create '%s' picker, no picking possible", _config.pickerType.c_str());
-		return;
-	}
-
-	proc->setTrigger(time);
-	proc->setPublishFunction(bind(&App::emitPPick, this, placeholders::_1, placeholders::_2, static_cast<const Detector*>(pickProc)->duration()));
-
-	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
-
-	if ( !initProcessor(proc.get(), proc->usedComponent(), time, rec->streamID(), waveformID, false) )
+void App::storeAmplitude(DataModel::Amplitude *amp) {
+	if ( !_ep )
 		return;
 
-	SEISCOMP_DEBUG("%s: created picker %s",
-	               rec->streamID().c_str(), _config.pickerType.c_str());
-
-	pushProcessor(waveformID.networkCode(), waveformID.stationCode(),
-	              waveformID.locationCode(), proc.get());
+	storeObject(amp, referenceTime(amp));
+	writeEventParameters();
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1318,155 +958,24 @@ void App::emitTrigger(const Processing::Detector *pickProc,
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::emitPPick(const Processing::Picker *proc,
-                    const Processing::Picker::Result &res,
-                    double duration)
-{
-	PickMap::iterator it = _lastPicks.find(res.record->streamID());
-	if ( it != _lastPicks.end() ) {
-		if ( it->second->time().value() == res.time ) {
-			SEISCOMP_WARNING("Duplicate pick on %s at %s: ignoring",
-			                 res.record->streamID().c_str(),
-			                 res.time.iso().c_str());
-			return;
-		}
-	}
-
-	DataModel::PickPtr pick;
-	if ( _config.generateSimplifiedIDs ) {
-		std::string pickID = res.time.toString("%Y%m%d.%H%M%S.%f-") + _config.pickerType +
-		                     "-" + res.record->streamID();
-		pick = DataModel::Pick::Create(pickID);
-
-		if ( !pick ) {
-			SEISCOMP_WARNING("Duplicate pick %s ignored", pickID.c_str());
-			return;
-		}
-	}
-	else {
-		pick = DataModel::Pick::Create();
-
-		if ( !pick ) {
-			SEISCOMP_WARNING("Duplicate pick ignored");
-			return;
-		}
-	}
+void App::sendOutput() {
+	// Objects are passed from the shards without registration
+	DataModel::PublicObject::SetRegistrationEnabled(false);
 
-	Core::Time now = Core::Time::UTC();
-	DataModel::CreationInfo ci;
-	ci.setCreationTime(now);
-	ci.setAgencyID(agencyID());
-	ci.setAuthor(author());
-	pick->setCreationInfo(ci);
-
-	if ( res.polarity ) {
-		switch ( *res.polarity ) {
-			case Processing::Picker::POSITIVE:
-				pick->setPolarity(DataModel::PickPolarity(DataModel::POSITIVE));
-				break;
-			case Processing::Picker::NEGATIVE:
-				pick->setPolarity(DataModel::PickPolarity(DataModel::NEGATIVE));
-				break;
-			case Processing::Picker::UNDECIDABLE:
-				pick->setPolarity(DataModel::PickPolarity(DataModel::UNDECIDABLE));
-				break;
-			default:
-				break;
+	while ( true ) {
+		OutputTask task;
+		try {
+			task = _outputQueue.pop();
 		}
-	}
-
-	DataModel::TimeQuantity pickTime(res.time);
-	if ( res.timeLowerUncertainty >= 0 && res.timeUpperUncertainty >= 0 &&
-	     res.timeLowerUncertainty == res.timeUpperUncertainty )
-		pickTime.setUncertainty(res.timeUpperUncertainty);
-	else {
-		if ( res.timeLowerUncertainty >= 0 )
-			pickTime.setLowerUncertainty(res.timeLowerUncertainty);
-		if ( res.timeUpperUncertainty >= 0 )
-			pickTime.setUpperUncertainty(res.timeUpperUncertainty);
-	}
-
-	pick->setTime(pickTime);
-	pick->setMethodID(proc->methodID());
-	pick->setFilterID(proc->filterID());
-
-	pick->setEvaluationMode(DataModel::EvaluationMode(DataModel::AUTOMATIC));
-
-	pick->setPhaseHint(DataModel::Phase(_config.phaseHint));
-	pick->setWaveformID(waveformStreamID(res.record));
-
-	if ( _config.extraPickComments && res.snr >= 0 ) {
-		DataModel::CommentPtr comment;
-
-		if ( duration >= 0 ) {
-			comment = new DataModel::Comment;
-			comment->setId("duration");
-			comment->setText(Core::toString(duration));
-			pick->add(comment.get());
+		catch ( Client::QueueClosedException & ) {
+			break;
 		}
 
-		comment = new DataModel::Comment;
-		comment->setId("SNR");
-		comment->setText(Core::toString(res.snr));
-		pick->add(comment.get());
-	}
-
-	if ( !_config.commentID.empty() && !_config.commentText.empty() ) {
-		DataModel::CommentPtr comment;
-		comment = new DataModel::Comment;
-		comment->setId(_config.commentID);
-		comment->setText(_config.commentText);
-		pick->add(comment.get());
-	}
-
-	proc->finalizePick(pick.get());
-
-	string phaseHintCode;
-	try {
-		phaseHintCode = pick->phaseHint().code();
-	}
-	catch ( ... ) {}
-
-	bool isPrimary = Util::getShortPhaseName(phaseHintCode) == Util::getShortPhaseName(_config.phaseHint);
-
-	SEISCOMP_DEBUG("Created %s'%s' pick %s", isPrimary ? "primary ":"", phaseHintCode, pick->publicID());
-
-	_lastPicks[res.record->streamID()] = pick;
-
-	DataModel::TimeWindow tw;
-	tw.setReference(res.time);
-	tw.setBegin(res.timeWindowBegin);
-	tw.setEnd(res.timeWindowEnd);
-
-	DataModel::AmplitudePtr amp;
-	if ( _config.generateSimplifiedIDs ) {
-		amp = DataModel::Amplitude::Create(pick->publicID() + ".snr");
-	}
-	else {
-		amp = DataModel::Amplitude::Create();
-	}
-
-	if ( amp ) {
-		amp->setCreationInfo(ci);
-
-		amp->setPickID(pick->publicID());
-		amp->setType("snr");
-
-		amp->setWaveformID(pick->waveformID());
-		amp->setTimeWindow(tw);
-
-		amp->setSnr(res.snr);
-		amp->setAmplitude(DataModel::RealQuantity(res.snr));
-
-		SEISCOMP_DEBUG("Created %s amplitude %s", amp->type(), amp->publicID());
-		SEISCOMP_DEBUG("  pickID   %s", amp->pickID());
-	}
+		// An empty task signals the end of the queue
+		if ( !task )
+			break;
 
-	if ( _config.featureExtractionType.empty() || !isPrimary
-	  || !addFeatureExtractor(pick.get(), amp.get(), res.record, isPrimary) ) {
-		sendPick(pick.get(), amp.get(), res.record, isPrimary);
-		SEISCOMP_DEBUG("%s: emit %s pick %s", res.record->streamID(),
-		               phaseHintCode, pick->publicID());
+		task();
 	}
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -1475,75 +984,11 @@ void App::emitPPick(const Processing::Picker *proc,
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::emitSPick(const Processing::SecondaryPicker *proc,
-                    const Processing::SecondaryPicker::Result &res) {
-	DataModel::PickPtr pick;
-
-	if ( _config.generateSimplifiedIDs ) {
-		std::string pickID = res.time.toString("%Y%m%d.%H%M%S.%f-") + _config.secondaryPickerType +
-		                     "-" + res.record->streamID();
-		pick = DataModel::Pick::Create(pickID);
-
-		if ( !pick ) {
-			SEISCOMP_WARNING("Duplicate pick %s ignored", pickID.c_str());
-			return;
-		}
-	}
-	else {
-		pick = DataModel::Pick::Create();
-
-		if ( !pick ) {
-			SEISCOMP_WARNING("Duplicate pick ignored");
-			return;
-		}
-	}
-
-	Core::Time now = Core::Time::UTC();
-	DataModel::CreationInfo ci;
-	ci.setCreationTime(now);
-	ci.setAgencyID(agencyID());
-	ci.setAuthor(author());
-	pick->setCreationInfo(ci);
-
-	DataModel::TimeQuantity pickTime(res.time);
-	if ( res.timeLowerUncertainty >= 0 && res.timeUpperUncertainty >= 0 &&
-	     res.timeLowerUncertainty == res.timeUpperUncertainty )
-		pickTime.setUncertainty(res.timeUpperUncertainty);
-	else {
-		if ( res.timeLowerUncertainty >= 0 )
-			pickTime.setLowerUncertainty(res.timeLowerUncertainty);
-		if ( res.timeUpperUncertainty >= 0 )
-			pickTime.setUpperUncertainty(res.timeUpperUncertainty);
-	}
-
-	pick->setTime(pickTime);
-	pick->setMethodID(proc->methodID());
-	pick->setFilterID(proc->filterID());
-	pick->setEvaluationMode(DataModel::EvaluationMode(DataModel::AUTOMATIC));
-	pick->setPhaseHint(DataModel::Phase(res.phaseCode));
-	pick->setWaveformID(waveformStreamID(res.record));
-
-	DataModel::CommentPtr comment;
-	if ( !proc->referencingPickID().empty() ) {
-		comment = new DataModel::Comment;
-		comment->setId("RefPickID");
-		comment->setText(proc->referencingPickID());
-		pick->add(comment.get());
-	}
-
-	if ( _config.extraPickComments && res.snr >= 0 ) {
-		DataModel::CommentPtr comment;
-		comment = new DataModel::Comment;
-		comment->setId("SNR");
-		comment->setText(Core::toString(res.snr));
-		pick->add(comment.get());
-	}
-
-	if ( _config.featureExtractionType.empty()
-	  || !addFeatureExtractor(pick.get(), NULL, res.record, false) ) {
-		sendPick(pick.get(), NULL, res.record, false);
-		SEISCOMP_DEBUG("%s: emit S pick %s", res.record->streamID().c_str(), pick->publicID().c_str());
-	}
+void App::storeObject(DataModel::PublicObject *obj, const Core::Time &time) {
+	if ( _sortOutput )
+		_outputBuffer.insert(OutputBuffer::value_type(time, obj));
+	else
+		addToEventParameters(obj);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1551,74 +996,16 @@ void App::emitSPick(const Processing::SecondaryPicker *proc,
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::emitDetection(const Processing::Detector *proc, const Record *rec, const Core::Time& time) {
-	if ( !_config.pickerType.empty() ) {
-		emitTrigger(proc, rec, time);
-
-		if ( !_config.sendDetections ) return;
-	}
-
-	bool isDetection = !_config.pickerType.empty() && _config.sendDetections;
-	Core::Time now = Core::Time::UTC();
-	DataModel::PickPtr pick;
-	if ( _config.generateSimplifiedIDs ) {
-		pick = DataModel::Pick::Create(time.toString("%Y%m%d.%H%M%S.%f-") + rec->streamID());
-	}
-	else {
-		pick = DataModel::Pick::Create();
-	}
-
-	DataModel::CreationInfo ci;
-	ci.setCreationTime(now);
-	ci.setAgencyID(agencyID());
-	ci.setAuthor(author());
-	pick->setCreationInfo(ci);
-	pick->setTime(time);
-	pick->setMethodID(proc->methodID());
-	if ( !_config.commentID.empty() && !_config.commentText.empty() ) {
-		DataModel::CommentPtr comment;
-		comment = new DataModel::Comment;
-		comment->setId(_config.commentID);
-		comment->setText(_config.commentText);
-		pick->add(comment.get());
-	}
-
-	// Set filterID
-	string filter = _config.defaultFilter;
-
-	const StreamConfig *sc = _stationConfig.get(&configuration(), configModuleName(),
-	                                            rec->networkCode(), rec->stationCode());
-	if ( sc )
-		if ( !sc->filter.empty() ) filter = sc->filter;
-
-	pick->setFilterID(filter);
-
-	pick->setEvaluationMode(DataModel::EvaluationMode(DataModel::AUTOMATIC));
-	if ( isDetection ) {
-		// set the status to rejected if sendDections has been activated and the
-		// repicker is active
-		pick->setEvaluationStatus(DataModel::EvaluationStatus(DataModel::REJECTED));
-	}
-	pick->setPhaseHint(DataModel::Phase(_config.phaseHint));
-	pick->setWaveformID(waveformStreamID(rec));
-
-	if ( _config.extraPickComments ) {
-		if ( static_cast<const Detector*>(proc)->duration() >= 0 ) {
-			auto comment = new DataModel::Comment;
-			comment->setId("duration");
-			comment->setText(Core::toString(static_cast<const Detector*>(proc)->duration()));
-			pick->add(comment);
-		}
+void App::addToEventParameters(DataModel::PublicObject *obj) {
+	DataModel::Pick *pick = DataModel::Pick::Cast(obj);
+	if ( pick ) {
+		_ep->add(pick);
+		return;
 	}
 
-	SEISCOMP_DEBUG("Created detection %s", pick->publicID().c_str());
-
-	static_cast<const Detector*>(proc)->setPickID(pick->publicID());
-
-	if ( _config.featureExtractionType.empty()
-	  || !addFeatureExtractor(pick.get(), 0, rec, true) ) {
-		sendPick(pick.get(), nullptr, rec, !isDetection);
-	}
+	DataModel::Amplitude *amp = DataModel::Amplitude::Cast(obj);
+	if ( amp )
+		_ep->add(amp);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1626,13 +1013,12 @@ void App::emitDetection(const Processing::Detector *proc, const Record *rec, con
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::emitFXPick(Seiscomp::DataModel::PickPtr pick,
-                     DataModel::AmplitudePtr amp,
-                     bool isPrimary,
-                     const Processing::FX *proc,
-	                 const Processing::FX::Result &res) {
-	proc->finalizePick(pick.get());
-	sendPick(pick.get(), amp.get(), res.record, isPrimary);
+void App::updateShardTime(int shard, const Core::Time &time) {
+	if ( shard < 0 || shard >= (int)_shardTimes.size() )
+		return;
+
+	_shardTimes[shard] = time;
+	releaseOutput(false);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1640,77 +1026,38 @@ void App::emitFXPick(Seiscomp::DataModel::PickPtr pick,
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::sendPick(Seiscomp::DataModel::Pick *pick, DataModel::Amplitude *amp,
-                   const Record *rec, bool isPrimary) {
-#ifdef LOG_PICKS
-	if ( !isMessagingEnabled() && !_ep ) {
-		//cout << pick.get();
-		printf("%s %-2s %-6s %-3s %-2s %6.1f %10.3f %4.1f %c %s\n",
-		       pick->time().value().toString("%Y-%m-%d %H:%M:%S.%1f").c_str(),
-		       pick->waveformID().networkCode().c_str(),
-		       pick->waveformID().stationCode().c_str(),
-		       pick->waveformID().channelCode().c_str(),
-		       pick->waveformID().locationCode().empty()?"__":pick->waveformID().locationCode().c_str(),
-		       -1.0, -1.0, -1.0, statusFlag(pick),
-		       pick->publicID().c_str());
-	}
-#endif
-
-	SEISCOMP_DEBUG("%s.%s.%s.%s: emit detection %s",
-	               pick->waveformID().networkCode().c_str(),
-	               pick->waveformID().stationCode().c_str(),
-	               pick->waveformID().locationCode().c_str(),
-	               pick->waveformID().channelCode().c_str(),
-	               pick->publicID().c_str());
-	Core::Time now = Core::Time::UTC();
-
-	logObject(_logPicks, now);
-	if ( amp )
-		logObject(_logAmps, now);
-
-	if ( connection() && !_config.test ) {
-		DataModel::NotifierPtr n = new DataModel::Notifier("EventParameters", DataModel::OP_ADD, pick);
-		DataModel::NotifierMessagePtr m = new DataModel::NotifierMessage;
-		m->attach(n.get());
-
-		for ( size_t i = 0; i < pick->commentCount(); ++i ) {
-			n = new DataModel::Notifier(pick->publicID(), DataModel::OP_ADD, pick->comment(i));
-			m->attach(n.get());
+void App::releaseOutput(bool all) {
+	OutputBuffer::iterator end = _outputBuffer.end();
+
+	if ( !all ) {
+		// Each shard reports the read time it received last once it
+		// processed the records read before. Until all shards have
+		// reported, the output is held back.
+		OPT(Core::Time) horizon;
+		for ( const OPT(Core::Time) &time : _shardTimes ) {
+			if ( !time )
+				return;
+
+			if ( !horizon || *time < *horizon )
+				horizon = time;
 		}
 
-		connection()->send(m.get());
-
-		// Send amplitude
-		if ( amp ) {
-			n = new DataModel::Notifier("EventParameters", DataModel::OP_ADD, amp);
-			m = new DataModel::NotifierMessage;
-			m->attach(n.get());
-			connection()->send(_config.amplitudeGroup, m.get());
-		}
-	}
+		if ( !horizon )
+			return;
 
-	if ( _ep ) {
-		_ep->add(pick);
-		if ( amp )
-			_ep->add(amp);
+		// Picks and amplitudes refer to data of the past which is kept in
+		// the ring buffer. Objects arriving later are written nevertheless.
+		end = _outputBuffer.lower_bound(*horizon - Core::TimeSpan(_config.ringBufferSize));
 	}
 
-	if ( isPrimary ) {
-		if ( !_config.secondaryPickerType.empty() ) {
-			addSecondaryPicker(pick->time().value(), rec, pick->publicID());
-		}
+	if ( end == _outputBuffer.begin() )
+		return;
 
-		if ( _config.calculateAmplitudes ) {
-			for ( StringSet::iterator it = _config.amplitudeList.begin();
-			      it != _config.amplitudeList.end(); ++it ) {
-				AmplitudeProcessorPtr proc = AmplitudeProcessorFactory::Create(it->c_str());
-				if ( !proc ) continue;
+	for ( OutputBuffer::iterator it = _outputBuffer.begin(); it != end; ++it )
+		addToEventParameters(it->second.get());
 
-				proc->setTrigger(pick->time().value());
-				addAmplitudeProcessor(proc.get(), rec, pick);
-			}
-		}
-	}
+	_outputBuffer.erase(_outputBuffer.begin(), end);
+	writeEventParameters();
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -1718,105 +1065,23 @@ void App::sendPick(Seiscomp::DataModel::Pick *pick, DataModel::Amplitude *amp,
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void App::emitAmplitude(const AmplitudeProcessor *ampProc,
-                        const AmplitudeProcessor::Result &res) {
-
-	if ( _config.dumpRecords && _config.offline )
-		ampProc->writeData();
-
-	bool update = true;
-	DataModel::TimeWindow tw;
-	tw.setReference(res.time.reference);
-	tw.setBegin(res.time.begin);
-	tw.setEnd(res.time.end);
-
-	DataModel::AmplitudePtr amp = (DataModel::Amplitude*)ampProc->userData();
-	Core::Time now = Core::Time::UTC();
-
-	if ( !amp ) {
-		if ( _config.generateSimplifiedIDs ) {
-			amp = DataModel::Amplitude::Create(ampProc->referencingPickID() + "." + ampProc->type());
-		}
-		else {
-			amp = DataModel::Amplitude::Create();
-		}
-
-		if ( !amp ) {
-			SEISCOMP_WARNING("Internal error: duplicate amplitudeID?");
-			return;
-		}
-
-		DataModel::CreationInfo ci;
-		ci.setCreationTime(now);
-		ci.setAgencyID(agencyID());
-		ci.setAuthor(author());
-		amp->setCreationInfo(ci);
-
-		amp->setPickID(ampProc->referencingPickID());
-		amp->setType(ampProc->type());
-		amp->setWaveformID(waveformStreamID(res.record));
-		ampProc->setUserData(amp.get());
-
-		SEISCOMP_DEBUG("Created %s amplitude %s", amp->type().c_str(), amp->publicID().c_str());
-		SEISCOMP_DEBUG("  pickID   %s", amp->pickID().c_str());
-
-		update = false;
-	}
-	else {
-		try {
-			amp->creationInfo().setModificationTime(now);
-		}
-		catch ( Core::ValueException &e ) {
-			DataModel::CreationInfo ci;
-			ci.setModificationTime(now);
-			amp->setCreationInfo(ci);
-		}
-	}
-
-	amp->setUnit(ampProc->unit());
-	amp->setTimeWindow(tw);
-	if ( res.period > 0 ) amp->setPeriod(DataModel::RealQuantity(res.period));
-	if ( res.snr >= 0 ) amp->setSnr(res.snr);
-	amp->setAmplitude(
-		DataModel::RealQuantity(
-			res.amplitude.value, Core::None,
-			res.amplitude.lowerUncertainty, res.amplitude.upperUncertainty,
-			Core::None
-		)
-	);
+void App::writeEventParameters() {
+	if ( _ep->pickCount() == 0 && _ep->amplitudeCount() == 0 )
+		return;
 
-	ampProc->finalizeAmplitude(amp.get());
+	_pickCount += _ep->pickCount();
+	_amplitudeCount += _ep->amplitudeCount();
 
-#ifdef LOG_PICKS
-	if ( !isMessagingEnabled() && !_ep ) {
-		//cout << amp.get();
-		if ( amp->type() == "snr" || amp->type() == "mb" ) {
-			printf("%s %-2s %-6s %-3s %-2s %6.1f %10.3f %4.1f %c %s\n",
-			       ampProc->trigger().toString("%Y-%m-%d %H:%M:%S.%1f").c_str(),
-			       res.record->networkCode().c_str(), res.record->stationCode().c_str(),
-			       res.record->channelCode().c_str(),
-			       res.record->locationCode().empty()?"__":res.record->locationCode().c_str(),
-			       amp->type() == "snr"?res.amplitude.value:-1.0, amp->type() == "mb"?res.amplitude.value:-1.0,
-			       amp->type() == "mb"?res.period:-1.0, 'A',
-			       amp->pickID().c_str());
-		}
+	if ( !_epWriter.writeChildren(_ep.get()) ) {
+		SEISCOMP_ERROR("Failed to write event parameters");
+		this->exit(1);
 	}
-#endif
 
-	SEISCOMP_DEBUG("Emit amplitude %s, proc = 0x%lx, %s", amp->publicID().c_str(), (long int)ampProc, ampProc->type().c_str());
-	logObject(_logAmps, now);
-
-	if ( connection() && !_config.test ) {
-		DataModel::NotifierPtr n = new DataModel::Notifier("EventParameters", update?DataModel::OP_UPDATE:DataModel::OP_ADD, amp.get());
-		DataModel::NotifierMessagePtr m = new DataModel::NotifierMessage;
-		m->attach(n.get());
-		if ( !connection()->send(_config.amplitudeGroup, m.get()) && !update ) {
-			ampProc->setUserData(NULL);
-		}
-	}
+	while ( _ep->pickCount() > 0 )
+		_ep->removePick(_ep->pickCount() - 1);
 
-	if ( _ep )
-		_ep->add(amp.get());
+	while ( _ep->amplitudeCount() > 0 )
+		_ep->removeAmplitude(_ep->amplitudeCount() - 1);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -16,20 +16,25 @@
 #define SEISCOMP_APPLICATIONS_PICKER
 
 
+#include <seiscomp/client/queue.h>
+#include <seiscomp/core/optional.h>
 #include <seiscomp/processing/application.h>
-#include <seiscomp/processing/detector.h>
-#include <seiscomp/processing/picker.h>
-#include <seiscomp/processing/secondarypicker.h>
-#include <seiscomp/processing/fx.h>
-#include <seiscomp/processing/amplitudeprocessor.h>
 
 #include <seiscomp/datamodel/eventparameters.h>
 #include <seiscomp/datamodel/pick.h>
 #include <seiscomp/datamodel/stationmagnitude.h>
+#include <seiscomp/utils/timer.h>
+#include <seiscomp/private/streamwriter.h>
 
-#include <list>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include "config.h"
+#include "pipeline.h"
+#include "shard.h"
 #include "stationconfig.h"
 
 
@@ -57,111 +62,89 @@ class App : public Processing::Application {
 		void removeObject(const std::string& parentID, DataModel::Object* o) override;
 		void updateObject(const std::string& parentID, DataModel::Object* o) override;
 
+		void handleRecord(Record *rec) override;
 		void handleNewStream(const Record *rec) override;
+		void processorFinished(const Record *rec, Processing::WaveformProcessor *wp) override;
 
 		void printUsage() const override;
 
 
 	private:
-		// Initializes a single component of a processor.
-		bool initComponent(Processing::WaveformProcessor *proc,
-		                   Processing::WaveformProcessor::Component comp,
-		                   const Core::Time &time,
-		                   const std::string &streamID,
-		                   const DataModel::WaveformStreamID &waveformID,
-		                   bool metaDataRequired);
-
-		// Initializes a processor which can use multiple components. This
-		// method calls initComponent for each requested component.
-		bool initProcessor(Processing::WaveformProcessor *proc,
-		                   Processing::WaveformProcessor::StreamComponent comp,
-		                   const Core::Time &time,
-		                   const std::string &streamID,
-		                   const DataModel::WaveformStreamID &waveformID,
-		                   bool metaDataRequired);
-
-		bool initDetector(const std::string &streamID,
-		                   const DataModel::WaveformStreamID &waveformID,
-		                   const Record *rec);
-
-		bool addFeatureExtractor(Seiscomp::DataModel::Pick *pick,
-		                         DataModel::Amplitude *amp,
-		                         const Record *rec, bool isPrimary);
-		void addSecondaryPicker(const Core::Time &onset, const Record *rec,
-		                        const std::string& pickID);
-		void addAmplitudeProcessor(Processing::AmplitudeProcessorPtr proc,
-		                           const Record *rec,
-		                           const Seiscomp::DataModel::Pick *pick);
-
-		template <typename T>
-		void pushProcessor(const std::string &networkCode,
-		                   const std::string &stationCode,
-		                   const std::string &locationCode,
-		                   T *proc);
-
-		void processorFinished(const Record *rec, Processing::WaveformProcessor *wp);
-
-		void emitTrigger(const Processing::Detector *pickProc,
-		                 const Record *rec, const Core::Time& time);
-
-		void emitDetection(const Processing::Detector *pickProc,
-		                   const Record *rec, const Core::Time& time);
-
-		void emitPPick(const Processing::Picker *,
-		               const Processing::Picker::Result &,
-		               double duration);
-
-		void emitSPick(const Processing::SecondaryPicker *,
-		               const Processing::SecondaryPicker::Result &);
-
-		void emitFXPick(Seiscomp::DataModel::PickPtr pick,
-		                Seiscomp::DataModel::AmplitudePtr amp,
-		                bool isPrimary,
-		                const Processing::FX*,
-		                const Processing::FX::Result &);
-
-		void emitAmplitude(const Processing::AmplitudeProcessor *ampProc,
-		                   const Processing::AmplitudeProcessor::Result &res);
-
-		void sendPick(Seiscomp::DataModel::Pick *pick,
-		              Seiscomp::DataModel::Amplitude *amp,
-		              const Record *rec, bool isPrimary);
+		// Sends a pick and its optional SNR amplitude and adds both to the
+		// event parameters.
+		void sendPick(DataModel::Pick *pick, DataModel::Amplitude *amp);
+		// Sends a new or updated amplitude.
+		bool sendAmplitude(DataModel::Amplitude *amp, bool update);
+		// Adds a final amplitude to the event parameters.
+		void storeAmplitude(DataModel::Amplitude *amp);
+
+		// Runs the tasks queued by the shards, called by the output thread.
+		void sendOutput();
+
+		// Adds a pick or an amplitude to the event parameters. With sorted
+		// output the object is held back until all shards have processed
+		// the data up to its time.
+		void storeObject(DataModel::PublicObject *obj, const Core::Time &time);
+		void addToEventParameters(DataModel::PublicObject *obj);
+
+		// Records the time of the data read before the records processed
+		// by a shard and writes the held back objects which cannot be
+		// preceded anymore.
+		void updateShardTime(int shard, const Core::Time &time);
+		void releaseOutput(bool all);
+
+		// Writes the picks and amplitudes collected for the '--ep' output
+		// and removes them from the event parameters.
+		void writeEventParameters();
 
 
 	private:
-		typedef std::map<std::string, Processing::StreamPtr> StreamMap;
-		typedef std::map<std::string, DataModel::PickPtr> PickMap;
+		class LocalPipeline;
 
-		typedef Processing::WaveformProcessor TWProc;
-
-		struct ProcEntry {
-			ProcEntry(const Core::Time &t, TWProc *p)
-			: dataEndTime(t), proc(p) {}
-
-			Core::Time  dataEndTime;
-			TWProc     *proc;
-		};
-
-		typedef std::list<ProcEntry>  ProcList;
-		typedef std::map<std::string, ProcList> ProcMap;
-		typedef std::map<TWProc*, std::string> ProcReverseMap;
 		typedef DataModel::EventParametersPtr EP;
+		typedef std::function<void()> OutputTask;
+		typedef std::multimap<Core::Time, DataModel::PublicObjectPtr> OutputBuffer;
 
-		StreamMap      _streams;
 		Config         _config;
-		PickMap        _lastPicks;
-
-		ProcMap        _runningStreamProcs;
-		ProcReverseMap _procLookup;
 
 		StringSet      _streamIDs;
 
 		StationConfig  _stationConfig;
 		EP             _ep;
 		bool           _formatted{false};
+		Private::StreamWriter _epWriter;
+		size_t         _pickCount{0};
+		size_t         _amplitudeCount{0};
+
+		// Statistics of the throughput report
+		Util::StopWatch _timer;
+		size_t          _recordCount{0};
+		size_t          _sampleCount{0};
+		size_t          _emittedPickCount{0};
 
 		ObjectLog     *_logPicks;
 		ObjectLog     *_logAmps;
+
+		// The pipeline of the application thread if no shards are used
+		std::unique_ptr<Pipeline>           _pipeline;
+		std::vector<std::unique_ptr<Shard>> _shards;
+		Client::ThreadedQueue<OutputTask>   _outputQueue;
+		std::thread                         _sender;
+		// Streams rather than stations are distributed if all processors
+		// read the stream of the detection only
+		bool                                _shardByStream{false};
+		// Picks and amplitudes of the '--ep' output are written in time
+		// order
+		bool                                _sortOutput{false};
+		OutputBuffer                        _outputBuffer;
+		std::vector<OPT(Core::Time)>        _shardTimes;
+		// The latest end time of the records read and the number of records
+		// read since it was passed to the shards
+		OPT(Core::Time)                     _readTime;
+		size_t                              _unreportedRecords{0};
+
+	friend class Pipeline;
+	friend class Shard;
 };
 
 
@@ -0,0 +1,1266 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT Autopick
+#include <seiscomp/logging/log.h>
+
+#include <seiscomp/client/inventory.h>
+
+#include <seiscomp/datamodel/pick.h>
+#include <seiscomp/datamodel/amplitude.h>
+#include <seiscomp/datamodel/sensorlocation.h>
+#include <seiscomp/datamodel/stream.h>
+#include <seiscomp/datamodel/utils.h>
+
+#include <seiscomp/utils/misc.h>
+
+#include <functional>
+#include <mutex>
+#include <sstream>
+
+#include "pipeline.h"
+#include "picker.h"
+#include "detector.h"
+
+
+using namespace std;
+using namespace Seiscomp::Client;
+using namespace Seiscomp::Processing;
+
+
+#define LOG_PICKS
+
+
+namespace {
+
+
+// Object IDs are generated from shared state while the pipelines of
+// several threads create objects concurrently
+std::mutex objectCreationMutex;
+
+
+Seiscomp::DataModel::PickPtr createPick(const std::string &publicID = std::string()) {
+	std::lock_guard<std::mutex> lock(objectCreationMutex);
+	if ( publicID.empty() ) {
+		return Seiscomp::DataModel::Pick::Create();
+	}
+
+	return Seiscomp::DataModel::Pick::Create(publicID);
+}
+
+
+Seiscomp::DataModel::AmplitudePtr createAmplitude(const std::string &publicID = std::string()) {
+	std::lock_guard<std::mutex> lock(objectCreationMutex);
+	if ( publicID.empty() ) {
+		return Seiscomp::DataModel::Amplitude::Create();
+	}
+
+	return Seiscomp::DataModel::Amplitude::Create(publicID);
+}
+
+
+bool contains(const Seiscomp::Core::TimeWindow &tw, const OPT(Seiscomp::Core::Time) &time) {
+	if ( !time ) {
+		return false;
+	}
+
+	if ( tw.startTime().valid() && tw.endTime().valid() ) {
+		return tw.contains(*time);
+	}
+
+	if ( tw.startTime().valid() ) {
+		return *time >= tw.startTime();
+	}
+
+	if ( tw.endTime().valid() ) {
+		return *time < tw.endTime();
+	}
+
+	return true;
+}
+
+
+Seiscomp::DataModel::WaveformStreamID waveformStreamID(const Seiscomp::Record *rec) {
+	return Seiscomp::DataModel::WaveformStreamID(
+		rec->networkCode(), rec->stationCode(), rec->locationCode(), rec->channelCode(), "");
+}
+
+
+std::string dotted(const Seiscomp::DataModel::WaveformStreamID &wf) {
+	return wf.networkCode() + "." + wf.stationCode() + "." + wf.locationCode() + "." + wf.channelCode();
+}
+
+
+}
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+Pipeline::Pipeline(App *app)
+: _app(app)
+, _config(app->_config)
+, _stationConfig(app->_stationConfig) {}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+Pipeline::~Pipeline() {}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Pipeline::initComponent(Processing::WaveformProcessor *proc,
+                             Processing::WaveformProcessor::Component comp,
+                             const Core::Time &time,
+                             const std::string &streamID,
+                             const DataModel::WaveformStreamID &waveformID,
+                             bool metaDataRequired) {
+	auto it = _streams.find(streamID);
+	if ( it != _streams.end() && contains(it->second->epoch, time) ) {
+		proc->streamConfig(comp) = *it->second;
+		if ( proc->streamConfig(comp).gain == 0.0 && metaDataRequired ) {
+			SEISCOMP_ERROR("No gain for stream %s", streamID.c_str());
+			return false;
+		}
+	}
+	else {
+		// Load sensor, responses usw.
+		Processing::StreamPtr stream = new Processing::Stream;
+		_streams[streamID] = stream;
+
+		stream->init(waveformID.networkCode(), waveformID.stationCode(), waveformID.locationCode(), waveformID.channelCode(), time);
+		if ( (stream->gain == 0.0) && metaDataRequired ) {
+			SEISCOMP_ERROR("No gain for stream %s", streamID.c_str());
+			return false;
+		}
+
+		proc->streamConfig(comp) = *stream;
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Pipeline::initProcessor(Processing::WaveformProcessor *proc,
+                             Processing::WaveformProcessor::StreamComponent comp,
+                             const Core::Time &time,
+                             const std::string &streamID,
+                             const DataModel::WaveformStreamID &waveformID,
+                             bool metaDataRequired) {
+	const std::string dottedWaveformID = dotted(waveformID);
+	switch ( comp ) {
+		case Processing::WaveformProcessor::Vertical:
+			if ( !initComponent(proc,
+			                    Processing::WaveformProcessor::VerticalComponent,
+			                    time, streamID, waveformID, metaDataRequired) ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup vertical component");
+				return false;
+			}
+			break;
+
+		case Processing::WaveformProcessor::FirstHorizontal:
+			if ( !initComponent(proc,
+			                    Processing::WaveformProcessor::FirstHorizontalComponent,
+			                    time, streamID, waveformID, metaDataRequired) ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup first horizontal component");
+				return false;
+			}
+			break;
+
+		case Processing::WaveformProcessor::SecondHorizontal:
+			if ( !initComponent(proc, Processing::WaveformProcessor::SecondHorizontalComponent,
+			                    time, streamID, waveformID, metaDataRequired) ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup second horizontal component");
+				return false;
+			}
+			break;
+
+		case Processing::WaveformProcessor::Horizontal:
+		{
+			// Find the two horizontal components of given location code
+			DataModel::ThreeComponents chans;
+			DataModel::WaveformStreamID waveformID1, waveformID2;
+			string streamID1, streamID2;
+
+			DataModel::SensorLocation *loc =
+				Client::Inventory::Instance()->getSensorLocation(
+					waveformID.networkCode(), waveformID.stationCode(), waveformID.locationCode(), time);
+
+			if ( loc == NULL ) {
+				SEISCOMP_ERROR("%s.%s: location code '%s' not found",
+				               waveformID.networkCode().c_str(), waveformID.stationCode().c_str(),
+				               waveformID.locationCode().c_str());
+				return false;
+			}
+
+			// Extract the first two characters of the channel code
+			string c2 = waveformID.channelCode().substr(0, 2);
+
+			DataModel::getThreeComponents(chans, loc, c2.c_str(), time);
+			if ( chans.comps[DataModel::ThreeComponents::FirstHorizontal] != NULL ) {
+				string channelCode1 = chans.comps[DataModel::ThreeComponents::FirstHorizontal]->code();
+				waveformID1 = waveformID;
+				waveformID1.setChannelCode(channelCode1);
+				streamID1 = dotted(waveformID1);
+			}
+			else {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": 1st horizontal component not available");
+				return false;
+			}
+
+			if ( chans.comps[DataModel::ThreeComponents::SecondHorizontal] != NULL ) {
+				string channelCode2 = chans.comps[DataModel::ThreeComponents::SecondHorizontal]->code();
+				waveformID2 = waveformID;
+				waveformID2.setChannelCode(channelCode2);
+				streamID2 = dotted(waveformID2);
+			}
+			else {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": 2nd horizontal component not available");
+				return false;
+			}
+
+			if ( !initComponent(proc, Processing::WaveformProcessor::FirstHorizontalComponent,
+			                    time, streamID1, waveformID1, metaDataRequired) ||
+			     !initComponent(proc, Processing::WaveformProcessor::SecondHorizontalComponent,
+			                    time, streamID2, waveformID2, metaDataRequired) ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup horizontal components");
+				return false;
+			}
+			break;
+		}
+
+		case Processing::WaveformProcessor::Any:
+		{
+			// Find the all three components of given location code
+			DataModel::ThreeComponents chans;
+			DataModel::WaveformStreamID waveformID0, waveformID1, waveformID2;
+			string streamID0, streamID1, streamID2;
+
+			DataModel::SensorLocation *loc =
+				Client::Inventory::Instance()->getSensorLocation(
+					waveformID.networkCode(), waveformID.stationCode(), waveformID.locationCode(), time
+				);
+
+			if ( loc == NULL ) {
+				SEISCOMP_ERROR("%s.%s: location code '%s' not found",
+				               waveformID.networkCode().c_str(), waveformID.stationCode().c_str(),
+				               waveformID.locationCode().c_str());
+				return false;
+			}
+
+			// Extract the first two characters of the channel code
+			string c2 = waveformID.channelCode().substr(0, 2);
+			DataModel::getThreeComponents(chans, loc, c2.c_str(), time);
+			if ( chans.comps[DataModel::ThreeComponents::Vertical] != NULL ) {
+				string channelCode0 = chans.comps[DataModel::ThreeComponents::Vertical]->code();
+				waveformID0 = waveformID;
+				waveformID0.setChannelCode(channelCode0);
+				streamID0 = dotted(waveformID0);
+			}
+			else if ( metaDataRequired ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": vertical component not available");
+				return false;
+			}
+
+			if ( chans.comps[DataModel::ThreeComponents::FirstHorizontal] != NULL ) {
+				string channelCode1 = chans.comps[DataModel::ThreeComponents::FirstHorizontal]->code();
+				waveformID1 = waveformID;
+				waveformID1.setChannelCode(channelCode1);
+				streamID1 = dotted(waveformID1);
+			}
+			else if ( metaDataRequired ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": 1st horizontal component not available");
+				return false;
+			}
+
+			if ( chans.comps[DataModel::ThreeComponents::SecondHorizontal] != NULL ) {
+				string channelCode2 = chans.comps[DataModel::ThreeComponents::SecondHorizontal]->code();
+				waveformID2 = waveformID;
+				waveformID2.setChannelCode(channelCode2);
+				streamID2 = dotted(waveformID2);
+			}
+			else if ( metaDataRequired ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": 2nd horizontal component not available");
+				return false;
+			}
+
+			if ( ! initComponent(proc, Processing::WaveformProcessor::VerticalComponent,
+			                     time, streamID0, waveformID0, metaDataRequired) ||
+			     ! initComponent(proc, Processing::WaveformProcessor::FirstHorizontalComponent,
+			                     time, streamID1, waveformID1, metaDataRequired) ||
+			     ! initComponent(proc, Processing::WaveformProcessor::SecondHorizontalComponent,
+			                     time, streamID2, waveformID2, metaDataRequired) ) {
+				SEISCOMP_ERROR_S(dottedWaveformID + ": failed to setup components");
+				return false;
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	const StreamConfig *sc = _stationConfig.get(&_app->configuration(), _app->configModuleName(),
+	                                            waveformID.networkCode(), waveformID.stationCode());
+	return proc->setup(Settings(_app->configModuleName(), waveformID.networkCode(), waveformID.stationCode(),
+	                            waveformID.locationCode(), waveformID.channelCode(), &_app->configuration(),
+	                            sc?sc->parameters.get():NULL));
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Pipeline::initDetector(const string &streamID,
+                            const DataModel::WaveformStreamID &waveformID,
+                            const Record *rec) {
+	double trigOn = _config.defaultTriggerOnThreshold;
+	double trigOff = _config.defaultTriggerOffThreshold;
+	double tcorr = _config.defaultTimeCorrection;
+	string filter = _config.defaultFilter;
+	bool sensitivityCorrection = false;
+
+	const StreamConfig *sc = _stationConfig.get(&_app->configuration(), _app->configModuleName(),
+	                                            waveformID.networkCode(), waveformID.stationCode());
+	if ( sc != NULL ) {
+		if ( !sc->enabled ) {
+			SEISCOMP_INFO("Detector on station %s.%s disabled by config",
+			              waveformID.networkCode().c_str(), waveformID.stationCode().c_str());
+			return true;
+		}
+
+		if ( sc->triggerOn ) trigOn = *sc->triggerOn;
+		if ( sc->triggerOff ) trigOff = *sc->triggerOff;
+		if ( !sc->filter.empty() ) filter = sc->filter;
+		if ( sc->timeCorrection ) tcorr = *sc->timeCorrection;
+		sensitivityCorrection = sc->sensitivityCorrection;
+	}
+
+	DetectorPtr detector = new Detector(trigOn, trigOff, _config.initTime);
+
+	string filterError;
+	if ( !_lanes || !detector->setLanes(_lanes.get(), filter, rec->samplingFrequency(), &filterError) ) {
+		if ( _lanes ) {
+			SEISCOMP_DEBUG("%s: filter %s not supported by batch processing: %s",
+			               streamID.c_str(), filter.c_str(), filterError.c_str());
+		}
+
+		Processing::WaveformProcessor::Filter *detecFilter;
+		detecFilter = Processing::WaveformProcessor::Filter::Create(filter, &filterError);
+		if ( !detecFilter ) {
+			SEISCOMP_WARNING("%s: compiling filter failed: %s: %s", streamID.c_str(),
+			                 filter.c_str(), filterError.c_str());
+			return false;
+		}
+
+		detector->setFilter(detecFilter);
+	}
+
+	detector->setDeadTime(_config.triggerDeadTime);
+	detector->setAmplitudeTimeWindow(_config.amplitudeMaxTimeWindow);
+	//picker->setAmplitudeTimeWindow(0.0);
+	detector->setMinAmplitudeOffset(_config.amplitudeMinOffset);
+	detector->setDurations(_config.minDuration, _config.maxDuration);
+	detector->setOffset(tcorr);
+	detector->setGapTolerance(_config.maxGapLength);
+	detector->setGapInterpolationEnabled(_config.interpolateGaps);
+	detector->setSensitivityCorrection(sensitivityCorrection);
+	detector->setPublishFunction(bind(
+		&Pipeline::emitDetection, this,
+		placeholders::_1,
+		placeholders::_2,
+		placeholders::_3
+	));
+
+	if ( _config.calculateAmplitudes )
+		detector->setAmplitudePublishFunction(bind(
+			&Pipeline::emitAmplitude, this,
+			placeholders::_1, placeholders::_2
+		));
+
+	if ( !initProcessor(detector.get(), detector->usedComponent(),
+	                    rec->startTime(), streamID, waveformID, sensitivityCorrection) )
+		return false;
+
+	SEISCOMP_DEBUG("%s: created detector with filter %s",
+	               streamID.c_str(), filter.c_str());
+
+	addProcessor(waveformID.networkCode(), waveformID.stationCode(),
+	             waveformID.locationCode(), waveformID.channelCode(),
+	             detector.get());
+	detector->feed(rec);
+
+//	SEISCOMP_DEBUG("Number of processors: %lu", (unsigned long)processorCount());
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::handleNewStream(const Record *rec) {
+	if ( _config.useAllStreams || _app->_streamIDs.find(rec->streamID()) != _app->_streamIDs.end() ) {
+		if ( !initDetector(rec->streamID(), waveformStreamID(rec), rec) ) {
+			SEISCOMP_ERROR("%s: initialization failed: abort operation",
+			               rec->streamID().c_str());
+			_app->exit(1);
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+template <typename T>
+void Pipeline::pushProcessor(const std::string &networkCode,
+                             const std::string &stationCode,
+                             const std::string &locationCode,
+                             T *proc) {
+	switch ( proc->usedComponent() ) {
+		case Processing::WaveformProcessor::Vertical:
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::VerticalComponent).code(),
+			             proc);
+			break;
+		case Processing::WaveformProcessor::FirstHorizontal:
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::FirstHorizontalComponent).code(),
+			             proc);
+			break;
+		case Processing::WaveformProcessor::SecondHorizontal:
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::SecondHorizontalComponent).code(),
+			             proc);
+			break;
+		case Processing::WaveformProcessor::Horizontal:
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::FirstHorizontalComponent).code(),
+			             proc);
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::SecondHorizontalComponent).code(),
+			             proc);
+			break;
+		case Processing::WaveformProcessor::Any:
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::VerticalComponent).code(),
+			             proc);
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::FirstHorizontalComponent).code(),
+			             proc);
+			addProcessor(networkCode,
+			             stationCode,
+			             locationCode,
+			             proc->streamConfig(Processing::WaveformProcessor::SecondHorizontalComponent).code(),
+			             proc);
+			break;
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::processorFinished(const Record *rec, WaveformProcessor *wp) {
+	std::stringstream ss;
+
+	if ( wp->status() == Processing::WaveformProcessor::LowSNR )
+		ss << "SNR " << wp->statusValue() << " too low";
+	else if ( wp->status() > Processing::WaveformProcessor::Terminated )
+		ss << "ERROR (" << wp->status().toString() << "," << wp->statusValue() << ")";
+	else
+		ss << "OK";
+
+	SEISCOMP_DEBUG("%s:%s: %s", rec != NULL?rec->streamID().c_str():"-",
+	                           wp->className(),
+	                           ss.str().c_str());
+
+	releasePendingAmplitude(wp);
+
+	// If its a secondary processor remove it from the tracked item list
+	ProcReverseMap::iterator pit = _procLookup.find(wp);
+	if ( pit == _procLookup.end() ) return;
+
+	ProcMap::iterator mit = _runningStreamProcs.find(pit->second);
+
+	_procLookup.erase(pit);
+
+	if ( mit == _runningStreamProcs.end() ) return;
+
+	ProcList &list = mit->second;
+	for ( ProcList::iterator it = list.begin(); it != list.end(); ) {
+		if ( it->proc == wp ) {
+			SEISCOMP_DEBUG("Removed finished processor from stream procs");
+			it = list.erase(it);
+		}
+		else
+			++it;
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::releasePendingAmplitude(const TWProc *wp) {
+	// An amplitude which could have been updated is final now
+	for ( PendingAmplitudes::iterator it = _pendingAmplitudes.begin();
+	      it != _pendingAmplitudes.end(); ++it ) {
+		if ( it->first == wp ) {
+			storeAmplitude(it->second.get());
+			_pendingAmplitudes.erase(it);
+			break;
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::flush() {
+	for ( PendingAmplitudes::iterator it = _pendingAmplitudes.begin();
+	      it != _pendingAmplitudes.end(); ++it )
+		storeAmplitude(it->second.get());
+	_pendingAmplitudes.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Pipeline::addFeatureExtractor(Seiscomp::DataModel::Pick *pick,
+                                   DataModel::Amplitude *amp,
+                                   const Record *rec, bool isPrimary) {
+	// Add secondary picker
+	FXPtr proc = FXFactory::Create(_config.featureExtractionType.c_str());
+	if ( !proc ) {
+		SEISCOMP_WARNING("Could not create fx: %s", _config.featureExtractionType.c_str());
+		_app->exit(1);
+		return false;
+	}
+
+	proc->setTrigger(pick->time().value());
+	proc->setEnvironment(
+		Client::Inventory::Instance()->getSensorLocation(
+			pick->waveformID().networkCode(),
+			pick->waveformID().stationCode(),
+			pick->waveformID().locationCode(),
+			pick->time().value()
+		),
+		pick
+	);
+	proc->setPublishFunction(std::bind(
+		&Pipeline::emitFXPick, this,
+		Seiscomp::DataModel::PickPtr(pick),
+		Seiscomp::DataModel::AmplitudePtr(amp),
+		isPrimary,
+		placeholders::_1, placeholders::_2
+	));
+
+	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
+	const std::string &n = rec->networkCode();
+	const std::string &s = rec->stationCode();
+	const std::string &l = rec->locationCode();
+	std::string c = rec->channelCode();
+
+	if ( !initProcessor(proc.get(), proc->usedComponent(), pick->time().value(), rec->streamID(), waveformID, true) )
+		return false;
+
+	SEISCOMP_DEBUG("%s: created fx %s (rec ref: %d)",
+	               rec->streamID().c_str(), _config.featureExtractionType.c_str(),
+	               rec->referenceCount());
+
+	pushProcessor(n, s, l, proc.get());
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::addSecondaryPicker(const Core::Time &onset, const Record *rec, const std::string &pickID) {
+	// Add secondary picker
+	SecondaryPickerPtr proc = SecondaryPickerFactory::Create(_config.secondaryPickerType.c_str());
+	if ( proc == NULL ) {
+		SEISCOMP_WARNING("Could not create secondary picker: %s", _config.secondaryPickerType.c_str());
+		_app->exit(1);
+		return;
+	}
+
+	SecondaryPicker::Trigger trigger;
+	trigger.onset = onset;
+	proc->setTrigger(trigger);
+	proc->setPublishFunction(bind(&Pipeline::emitSPick, this, placeholders::_1, placeholders::_2));
+	proc->setReferencingPickID(pickID);
+
+	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
+	const std::string &n = rec->networkCode();
+	const std::string &s = rec->stationCode();
+	const std::string &l = rec->locationCode();
+	std::string c = rec->channelCode();
+
+	if ( !initProcessor(proc.get(), proc->usedComponent(), onset, rec->streamID(), waveformID, true) )
+		return;
+
+	SEISCOMP_DEBUG("%s: created secondary picker %s (rec ref: %d)",
+	               rec->streamID().c_str(), _config.secondaryPickerType.c_str(),
+	               rec->referenceCount());
+
+	pushProcessor(n, s, l, proc.get());
+
+	ProcList &list = _runningStreamProcs[rec->streamID()];
+	if ( _config.killPendingSecondaryProcessors ) {
+		SEISCOMP_DEBUG("check for expired procs (got %d in list)", (int)list.size());
+
+		// Check for secondary procs that are still running but where the
+		// end time is before onset and remove them
+		// ...
+		for ( ProcList::iterator it = list.begin(); it != list.end(); ) {
+			if ( it->dataEndTime <= onset ) {
+				SEISCOMP_DEBUG("Remove expired proc 0x%lx", (long int)it->proc);
+				if ( /*it->proc != NULL*/true ) {
+					SEISCOMP_INFO("Remove expired running processor %s on %s",
+					              it->proc->className(), rec->streamID().c_str());
+
+					if ( it->proc->status() == Processing::WaveformProcessor::LowSNR )
+						SEISCOMP_DEBUG("  -> status: SNR(%f) too low", it->proc->statusValue());
+					else if ( it->proc->status() > Processing::WaveformProcessor::Terminated )
+						SEISCOMP_DEBUG("  -> status: ERROR (%s, %f)",
+						               it->proc->status().toString(), it->proc->statusValue());
+					else
+						SEISCOMP_DEBUG("  -> status: OK");
+
+					// Remove processor from application
+					releasePendingAmplitude(it->proc);
+					removeProcessor(it->proc);
+
+					// Remove its reverse lookup
+					ProcReverseMap::iterator pit = _procLookup.find(it->proc);
+					if ( pit != _procLookup.end() ) _procLookup.erase(pit);
+				}
+
+				// Remove it from the run list
+				it = list.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	// addProcessor can feed the requested time window with cached records
+	// so the proc might be finished already. This needs a test otherwise
+	// the registered pointer is invalid later when checking for expired
+	// procs.
+	if ( !proc->isFinished() ) {
+		// Register the secondary procs running on the verticals
+		list.push_back(ProcEntry(proc->safetyTimeWindow().endTime(), proc.get()));
+		_procLookup[proc.get()] = rec->streamID();
+		SEISCOMP_DEBUG("%s: registered proc 0x%lx",
+		               rec->streamID().data(), (long int)proc.get());
+	}
+	else
+		SEISCOMP_DEBUG("%s: proc finished already", rec->streamID().data());
+
+//	SEISCOMP_DEBUG("Number of processors: %lu", (unsigned long)processorCount());
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::addAmplitudeProcessor(AmplitudeProcessorPtr proc,
+                                     const Record *rec,
+                                     const Seiscomp::DataModel::Pick *pick) {
+	proc->setPublishFunction(bind(&Pipeline::emitAmplitude, this, placeholders::_1, placeholders::_2));
+	proc->setReferencingPickID(pick->publicID());
+
+	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
+	const std::string &n = rec->networkCode();
+	const std::string &s = rec->stationCode();
+	const std::string &l = rec->locationCode();
+	std::string c = rec->channelCode();
+
+	if ( !initProcessor(proc.get(), proc->usedComponent(), proc->trigger(), rec->streamID(), waveformID, true) )
+		return;
+
+	proc->setEnvironment(
+		nullptr, // No hypocenter information
+		Client::Inventory::Instance()->getSensorLocation(
+			n, s, l, proc->trigger()
+		),
+		pick
+	);
+
+	if ( proc->isFinished() ) {
+		// If the processor has finished already e.g. due to missing
+		// hypocenter information, do not add it and return.
+		processorFinished(rec, proc.get());
+		return;
+	}
+
+	if ( _config.amplitudeUpdateList.find(proc->type()) != _config.amplitudeUpdateList.end() )
+		proc->setUpdateEnabled(true);
+	else
+		proc->setUpdateEnabled(false);
+
+	pushProcessor(n, s, l, proc.get());
+
+//	SEISCOMP_DEBUG("Number of processors: %lu", (unsigned long)processorCount());
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::emitTrigger(const Processing::Detector *pickProc,
+                           const Record *rec, const Core::Time &time) {
+	PickerPtr proc = PickerFactory::Create(_config.pickerType.c_str());
+	if ( !proc ) {
+		SEISCOMP_ERROR("Unable to create '%s' picker, no picking possible", _config.pickerType.c_str());
+		return;
+	}
+
+	proc->setTrigger(time);
+	proc->setPublishFunction(bind(&Pipeline::emitPPick, this, placeholders::_1, placeholders::_2, static_cast<const Detector*>(pickProc)->duration()));
+
+	const DataModel::WaveformStreamID waveformID(waveformStreamID(rec));
+
+	if ( !initProcessor(proc.get(), proc->usedComponent(), time, rec->streamID(), waveformID, false) )
+		return;
+
+	SEISCOMP_DEBUG("%s: created picker %s",
+	               rec->streamID().c_str(), _config.pickerType.c_str());
+
+	pushProcessor(waveformID.networkCode(), waveformID.stationCode(),
+	              waveformID.locationCode(), proc.get());
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::emitPPick(const Processing::Picker *proc,
+                         const Processing::Picker::Result &res,
+                         double duration)
+{
+	PickMap::iterator it = _lastPicks.find(res.record->streamID());
+	if ( it != _lastPicks.end() ) {
+		if ( it->second->time().value() == res.time ) {
+			SEISCOMP_WARNING("Duplicate pick on %s at %s: ignoring",
+			                 res.record->streamID().c_str(),
+			                 res.time.iso().c_str());
+			return;
+		}
+	}
+
+	DataModel::PickPtr pick;
+	if ( _config.generateSimplifiedIDs ) {
+		std::string pickID = res.time.toString("%Y%m%d.%H%M%S.%f-") + _config.pickerType +
+		                     "-" + res.record->streamID();
+		pick = createPick(pickID);
+
+		if ( !pick ) {
+			SEISCOMP_WARNING("Duplicate pick %s ignored", pickID.c_str());
+			return;
+		}
+	}
+	else {
+		pick = createPick();
+
+		if ( !pick ) {
+			SEISCOMP_WARNING("Duplicate pick ignored");
+			return;
+		}
+	}
+
+	Core::Time now = Core::Time::UTC();
+	DataModel::CreationInfo ci;
+	ci.setCreationTime(now);
+	ci.setAgencyID(_app->agencyID());
+	ci.setAuthor(_app->author());
+	pick->setCreationInfo(ci);
+
+	if ( res.polarity ) {
+		switch ( *res.polarity ) {
+			case Processing::Picker::POSITIVE:
+				pick->setPolarity(DataModel::PickPolarity(DataModel::POSITIVE));
+				break;
+			case Processing::Picker::NEGATIVE:
+				pick->setPolarity(DataModel::PickPolarity(DataModel::NEGATIVE));
+				break;
+			case Processing::Picker::UNDECIDABLE:
+				pick->setPolarity(DataModel::PickPolarity(DataModel::UNDECIDABLE));
+				break;
+			default:
+				break;
+		}
+	}
+
+	DataModel::TimeQuantity pickTime(res.time);
+	if ( res.timeLowerUncertainty >= 0 && res.timeUpperUncertainty >= 0 &&
+	     res.timeLowerUncertainty == res.timeUpperUncertainty )
+		pickTime.setUncertainty(res.timeUpperUncertainty);
+	else {
+		if ( res.timeLowerUncertainty >= 0 )
+			pickTime.setLowerUncertainty(res.timeLowerUncertainty);
+		if ( res.timeUpperUncertainty >= 0 )
+			pickTime.setUpperUncertainty(res.timeUpperUncertainty);
+	}
+
+	pick->setTime(pickTime);
+	pick->setMethodID(proc->methodID());
+	pick->setFilterID(proc->filterID());
+
+	pick->setEvaluationMode(DataModel::EvaluationMode(DataModel::AUTOMATIC));
+
+	pick->setPhaseHint(DataModel::Phase(_config.phaseHint));
+	pick->setWaveformID(waveformStreamID(res.record));
+
+	if ( _config.extraPickComments && res.snr >= 0 ) {
+		DataModel::CommentPtr comment;
+
+		if ( duration >= 0 ) {
+			comment = new DataModel::Comment;
+			comment->setId("duration");
+			comment->setText(Core::toString(duration));
+			pick->add(comment.get());
+		}
+
+		comment = new DataModel::Comment;
+		comment->setId("SNR");
+		comment->setText(Core::toString(res.snr));
+		pick->add(comment.get());
+	}
+
+	if ( !_config.commentID.empty() && !_config.commentText.empty() ) {
+		DataModel::CommentPtr comment;
+		comment = new DataModel::Comment;
+		comment->setId(_config.commentID);
+		comment->setText(_config.commentText);
+		pick->add(comment.get());
+	}
+
+	proc->finalizePick(pick.get());
+
+	string phaseHintCode;
+	try {
+		phaseHintCode = pick->phaseHint().code();
+	}
+	catch ( ... ) {}
+
+	bool isPrimary = Util::getShortPhaseName(phaseHintCode) == Util::getShortPhaseName(_config.phaseHint);
+
+	SEISCOMP_DEBUG("Created %s'%s' pick %s", isPrimary ? "primary ":"", phaseHintCode, pick->publicID());
+
+	_lastPicks[res.record->streamID()] = pick;
+
+	DataModel::TimeWindow tw;
+	tw.setReference(res.time);
+	tw.setBegin(res.timeWindowBegin);
+	tw.setEnd(res.timeWindowEnd);
+
+	DataModel::AmplitudePtr amp;
+	if ( _config.generateSimplifiedIDs ) {
+		amp = createAmplitude(pick->publicID() + ".snr");
+	}
+	else {
+		amp = createAmplitude();
+	}
+
+	if ( amp ) {
+		amp->setCreationInfo(ci);
+
+		amp->setPickID(pick->publicID());
+		amp->setType("snr");
+
+		amp->setWaveformID(pick->waveformID());
+		amp->setTimeWindow(tw);
+
+		amp->setSnr(res.snr);
+		amp->setAmplitude(DataModel::RealQuantity(res.snr));
+
+		SEISCOMP_DEBUG("Created %s amplitude %s", amp->type(), amp->publicID());
+		SEISCOMP_DEBUG("  pickID   %s", amp->pickID());
+	}
+
+	if ( _config.featureExtractionType.empty() || !isPrimary
+	  || !addFeatureExtractor(pick.get(), amp.get(), res.record, isPrimary) ) {
+		sendPick(pick.get(), amp.get(), res.record, isPrimary);
+		SEISCOMP_DEBUG("%s: emit %s pick %s", res.record->streamID(),
+		               phaseHintCode, pick->publicID());
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::emitSPick(const Processing::SecondaryPicker *proc,
+                         const Processing::SecondaryPicker::Result &res) {
+	DataModel::PickPtr pick;
+
+	if ( _config.generateSimplifiedIDs ) {
+		std::string pickID = res.time.toString("%Y%m%d.%H%M%S.%f-") + _config.secondaryPickerType +
+		                     "-" + res.record->streamID();
+		pick = createPick(pickID);
+
+		if ( !pick ) {
+			SEISCOMP_WARNING("Duplicate pick %s ignored", pickID.c_str());
+			return;
+		}
+	}
+	else {
+		pick = createPick();
+
+		if ( !pick ) {
+			SEISCOMP_WARNING("Duplicate pick ignored");
+			return;
+		}
+	}
+
+	Core::Time now = Core::Time::UTC();
+	DataModel::CreationInfo ci;
+	ci.setCreationTime(now);
+	ci.setAgencyID(_app->agencyID());
+	ci.setAuthor(_app->author());
+	pick->setCreationInfo(ci);
+
+	DataModel::TimeQuantity pickTime(res.time);
+	if ( res.timeLowerUncertainty >= 0 && res.timeUpperUncertainty >= 0 &&
+	     res.timeLowerUncertainty == res.timeUpperUncertainty )
+		pickTime.setUncertainty(res.timeUpperUncertainty);
+	else {
+		if ( res.timeLowerUncertainty >= 0 )
+			pickTime.setLowerUncertainty(res.timeLowerUncertainty);
+		if ( res.timeUpperUncertainty >= 0 )
+			pickTime.setUpperUncertainty(res.timeUpperUncertainty);
+	}
+
+	pick->setTime(pickTime);
+	pick->setMethodID(proc->methodID());
+	pick->setFilterID(proc->filterID());
+	pick->setEvaluationMode(DataModel::EvaluationMode(DataModel::AUTOMATIC));
+	pick->setPhaseHint(DataModel::Phase(res.phaseCode));
+	pick->setWaveformID(waveformStreamID(res.record));
+
+	DataModel::CommentPtr comment;
+	if ( !proc->referencingPickID().empty() ) {
+		comment = new DataModel::Comment;
+		comment->setId("RefPickID");
+		comment->setText(proc->referencingPickID());
+		pick->add(comment.get());
+	}
+
+	if ( _config.extraPickComments && res.snr >= 0 ) {
+		DataModel::CommentPtr comment;
+		comment = new DataModel::Comment;
+		comment->setId("SNR");
+		comment->setText(Core::toString(res.snr));
+		pick->add(comment.get());
+	}
+
+	if ( _config.featureExtractionType.empty()
+	  || !addFeatureExtractor(pick.get(), NULL, res.record, false) ) {
+		sendPick(pick.get(), NULL, res.record, false);
+		SEISCOMP_DEBUG("%s: emit S pick %s", res.record->streamID().c_str(), pick->publicID().c_str());
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::emitDetection(const Processing::Detector *proc, const Record *rec, const Core::Time& time) {
+	if ( !_config.pickerType.empty() ) {
+		emitTrigger(proc, rec, time);
+
+		if ( !_config.sendDetections ) return;
+	}
+
+	bool isDetection = !_config.pickerType.empty() && _config.sendDetections;
+	Core::Time now = Core::Time::UTC();
+	DataModel::PickPtr pick;
+	if ( _config.generateSimplifiedIDs ) {
+		pick = createPick(time.toString("%Y%m%d.%H%M%S.%f-") + rec->streamID());
+	}
+	else {
+		pick = createPick();
+	}
+
+	DataModel::CreationInfo ci;
+	ci.setCreationTime(now);
+	ci.setAgencyID(_app->agencyID());
+	ci.setAuthor(_app->author());
+	pick->setCreationInfo(ci);
+	pick->setTime(time);
+	pick->setMethodID(proc->methodID());
+	if ( !_config.commentID.empty() && !_config.commentText.empty() ) {
+		DataModel::CommentPtr comment;
+		comment = new DataModel::Comment;
+		comment->setId(_config.commentID);
+		comment->setText(_config.commentText);
+		pick->add(comment.get());
+	}
+
+	// Set filterID
+	string filter = _config.defaultFilter;
+
+	const StreamConfig *sc = _stationConfig.get(&_app->configuration(), _app->configModuleName(),
+	                                            rec->networkCode(), rec->stationCode());
+	if ( sc )
+		if ( !sc->filter.empty() ) filter = sc->filter;
+
+	pick->setFilterID(filter);
+
+	pick->setEvaluationMode(DataModel::EvaluationMode(DataModel::AUTOMATIC));
+	if ( isDetection ) {
+		// set the status to rejected if sendDections has been activated and the
+		// repicker is active
+		pick->setEvaluationStatus(DataModel::EvaluationStatus(DataModel::REJECTED));
+	}
+	pick->setPhaseHint(DataModel::Phase(_config.phaseHint));
+	pick->setWaveformID(waveformStreamID(rec));
+
+	if ( _config.extraPickComments ) {
+		if ( static_cast<const Detector*>(proc)->duration() >= 0 ) {
+			auto comment = new DataModel::Comment;
+			comment->setId("duration");
+			comment->setText(Core::toString(static_cast<const Detector*>(proc)->duration()));
+			pick->add(comment);
+		}
+	}
+
+	SEISCOMP_DEBUG("Created detection %s", pick->publicID().c_str());
+
+	static_cast<const Detector*>(proc)->setPickID(pick->publicID());
+
+	if ( _config.featureExtractionType.empty()
+	  || !addFeatureExtractor(pick.get(), 0, rec, true) ) {
+		sendPick(pick.get(), nullptr, rec, !isDetection);
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::emitFXPick(Seiscomp::DataModel::PickPtr pick,
+                          DataModel::AmplitudePtr amp,
+                          bool isPrimary,
+                          const Processing::FX *proc,
+	                 const Processing::FX::Result &res) {
+	proc->finalizePick(pick.get());
+	sendPick(pick.get(), amp.get(), res.record, isPrimary);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::sendPick(Seiscomp::DataModel::Pick *pick, DataModel::Amplitude *amp,
+                        const Record *rec, bool isPrimary) {
+	publishPick(pick, amp);
+
+	if ( isPrimary ) {
+		if ( !_config.secondaryPickerType.empty() ) {
+			addSecondaryPicker(pick->time().value(), rec, pick->publicID());
+		}
+
+		if ( _config.calculateAmplitudes ) {
+			for ( StringSet::iterator it = _config.amplitudeList.begin();
+			      it != _config.amplitudeList.end(); ++it ) {
+				AmplitudeProcessorPtr proc = AmplitudeProcessorFactory::Create(it->c_str());
+				if ( !proc ) continue;
+
+				proc->setTrigger(pick->time().value());
+				addAmplitudeProcessor(proc.get(), rec, pick);
+			}
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Pipeline::emitAmplitude(const AmplitudeProcessor *ampProc,
+                             const AmplitudeProcessor::Result &res) {
+
+	if ( _config.dumpRecords && _config.offline )
+		ampProc->writeData();
+
+	bool update = true;
+	DataModel::TimeWindow tw;
+	tw.setReference(res.time.reference);
+	tw.setBegin(res.time.begin);
+	tw.setEnd(res.time.end);
+
+	DataModel::AmplitudePtr amp = (DataModel::Amplitude*)ampProc->userData();
+	Core::Time now = Core::Time::UTC();
+
+	if ( !amp ) {
+		if ( _config.generateSimplifiedIDs ) {
+			amp = createAmplitude(ampProc->referencingPickID() + "." + ampProc->type());
+		}
+		else {
+			amp = createAmplitude();
+		}
+
+		if ( !amp ) {
+			SEISCOMP_WARNING("Internal error: duplicate amplitudeID?");
+			return;
+		}
+
+		DataModel::CreationInfo ci;
+		ci.setCreationTime(now);
+		ci.setAgencyID(_app->agencyID());
+		ci.setAuthor(_app->author());
+		amp->setCreationInfo(ci);
+
+		amp->setPickID(ampProc->referencingPickID());
+		amp->setType(ampProc->type());
+		amp->setWaveformID(waveformStreamID(res.record));
+		ampProc->setUserData(amp.get());
+
+		SEISCOMP_DEBUG("Created %s amplitude %s", amp->type().c_str(), amp->publicID().c_str());
+		SEISCOMP_DEBUG("  pickID   %s", amp->pickID().c_str());
+
+		update = false;
+	}
+	else {
+		try {
+			amp->creationInfo().setModificationTime(now);
+		}
+		catch ( Core::ValueException &e ) {
+			DataModel::CreationInfo ci;
+			ci.setModificationTime(now);
+			amp->setCreationInfo(ci);
+		}
+	}
+
+	amp->setUnit(ampProc->unit());
+	amp->setTimeWindow(tw);
+	if ( res.period > 0 ) amp->setPeriod(DataModel::RealQuantity(res.period));
+	if ( res.snr >= 0 ) amp->setSnr(res.snr);
+	amp->setAmplitude(
+		DataModel::RealQuantity(
+			res.amplitude.value, Core::None,
+			res.amplitude.lowerUncertainty, res.amplitude.upperUncertainty,
+			Core::None
+		)
+	);
+
+	ampProc->finalizeAmplitude(amp.get());
+
+#ifdef LOG_PICKS
+	if ( !_app->isMessagingEnabled() && !_app->_ep ) {
+		//cout << amp.get();
+		if ( amp->type() == "snr" || amp->type() == "mb" ) {
+			printf("%s %-2s %-6s %-3s %-2s %6.1f %10.3f %4.1f %c %s\n",
+			       ampProc->trigger().toString("%Y-%m-%d %H:%M:%S.%1f").c_str(),
+			       res.record->networkCode().c_str(), res.record->stationCode().c_str(),
+			       res.record->channelCode().c_str(),
+			       res.record->locationCode().empty()?"__":res.record->locationCode().c_str(),
+			       amp->type() == "snr"?res.amplitude.value:-1.0, amp->type() == "mb"?res.amplitude.value:-1.0,
+			       amp->type() == "mb"?res.period:-1.0, 'A',
+			       amp->pickID().c_str());
+		}
+	}
+#endif
+
+	SEISCOMP_DEBUG("Emit amplitude %s, proc = 0x%lx, %s", amp->publicID().c_str(), (long int)ampProc, ampProc->type().c_str());
+
+	if ( !publishAmplitude(amp.get(), update) && !update ) {
+		ampProc->setUserData(NULL);
+	}
+
+	if ( _app->_ep ) {
+		if ( _config.amplitudeUpdateList.find(ampProc->type()) != _config.amplitudeUpdateList.end() ) {
+			// The amplitude might be updated, keep it until the processor
+			// has finished
+			PendingAmplitudes::iterator it = _pendingAmplitudes.begin();
+			for ( ; it != _pendingAmplitudes.end(); ++it ) {
+				if ( it->first == ampProc ) break;
+			}
+
+			if ( it == _pendingAmplitudes.end() )
+				_pendingAmplitudes.push_back(PendingAmplitude(ampProc, amp));
+			else if ( it->second != amp ) {
+				// The processor created a new amplitude because sending
+				// the pending one failed
+				storeAmplitude(it->second.get());
+				it->second = amp;
+			}
+		}
+		else
+			storeAmplitude(amp.get());
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+}
+}
+}
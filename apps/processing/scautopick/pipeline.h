@@ -0,0 +1,214 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#ifndef SEISCOMP_APPLICATIONS_PICKER_PIPELINE_H__
+#define SEISCOMP_APPLICATIONS_PICKER_PIPELINE_H__
+
+
+#include <seiscomp/processing/stream.h>
+#include <seiscomp/processing/detector.h>
+#include <seiscomp/processing/picker.h>
+#include <seiscomp/processing/secondarypicker.h>
+#include <seiscomp/processing/fx.h>
+#include <seiscomp/processing/amplitudeprocessor.h>
+
+#include <seiscomp/datamodel/pick.h>
+#include <seiscomp/datamodel/amplitude.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "config.h"
+#include "detectorlanes.h"
+#include "stationconfig.h"
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+
+
+class App;
+
+
+/**
+ * @brief Picking on a set of streams.
+ *
+ * The pipeline creates the detectors of its streams and the pickers,
+ * secondary pickers, feature extractors and amplitude processors started
+ * by detections and picks. It owns the per-stream state: the stream
+ * configurations, the last pick and the running secondary processors of
+ * each stream.
+ *
+ * The registration of processors for the records of a stream and the
+ * output of picks and amplitudes are up to the implementation. All methods
+ * of a pipeline must be called by the same thread.
+ */
+class Pipeline {
+	public:
+		explicit Pipeline(App *app);
+		virtual ~Pipeline();
+
+
+	public:
+		//! Creates the detector of a stream when its first record arrives
+		void handleNewStream(const Record *rec);
+
+		//! Must be called when a processor has finished and before it is
+		//! removed
+		void processorFinished(const Record *rec, Processing::WaveformProcessor *wp);
+
+		//! Stores the amplitudes which have been kept for updates. Called
+		//! when processing ends.
+		void flush();
+
+
+	protected:
+		virtual void addProcessor(const std::string &networkCode,
+		                          const std::string &stationCode,
+		                          const std::string &locationCode,
+		                          const std::string &channelCode,
+		                          Processing::WaveformProcessor *proc) = 0;
+		//! Removes a processor. A processor which has not finished must
+		//! be passed to releasePendingAmplitude before.
+		virtual void removeProcessor(Processing::WaveformProcessor *proc) = 0;
+
+		//! Stores the amplitude kept for updates by a processor which
+		//! finishes or is removed
+		void releasePendingAmplitude(const Processing::WaveformProcessor *wp);
+
+		//! Sends a pick with its optional SNR amplitude and adds both to the
+		//! event parameters
+		virtual void publishPick(DataModel::Pick *pick, DataModel::Amplitude *amp) = 0;
+
+		//! Sends a new or updated amplitude. Returns false if sending failed.
+		virtual bool publishAmplitude(DataModel::Amplitude *amp, bool update) = 0;
+
+		//! Adds a final amplitude to the event parameters
+		virtual void storeAmplitude(DataModel::Amplitude *amp) = 0;
+
+
+	private:
+		// Initializes a single component of a processor.
+		bool initComponent(Processing::WaveformProcessor *proc,
+		                   Processing::WaveformProcessor::Component comp,
+		                   const Core::Time &time,
+		                   const std::string &streamID,
+		                   const DataModel::WaveformStreamID &waveformID,
+		                   bool metaDataRequired);
+
+		// Initializes a processor which can use multiple components. This
+		// method calls initComponent for each requested component.
+		bool initProcessor(Processing::WaveformProcessor *proc,
+		                   Processing::WaveformProcessor::StreamComponent comp,
+		                   const Core::Time &time,
+		                   const std::string &streamID,
+		                   const DataModel::WaveformStreamID &waveformID,
+		                   bool metaDataRequired);
+
+		bool initDetector(const std::string &streamID,
+		                  const DataModel::WaveformStreamID &waveformID,
+		                  const Record *rec);
+
+		bool addFeatureExtractor(Seiscomp::DataModel::Pick *pick,
+		                         DataModel::Amplitude *amp,
+		                         const Record *rec, bool isPrimary);
+		void addSecondaryPicker(const Core::Time &onset, const Record *rec,
+		                        const std::string& pickID);
+		void addAmplitudeProcessor(Processing::AmplitudeProcessorPtr proc,
+		                           const Record *rec,
+		                           const Seiscomp::DataModel::Pick *pick);
+
+		template <typename T>
+		void pushProcessor(const std::string &networkCode,
+		                   const std::string &stationCode,
+		                   const std::string &locationCode,
+		                   T *proc);
+
+		void emitTrigger(const Processing::Detector *pickProc,
+		                 const Record *rec, const Core::Time& time);
+
+		void emitDetection(const Processing::Detector *pickProc,
+		                   const Record *rec, const Core::Time& time);
+
+		void emitPPick(const Processing::Picker *,
+		               const Processing::Picker::Result &,
+		               double duration);
+
+		void emitSPick(const Processing::SecondaryPicker *,
+		               const Processing::SecondaryPicker::Result &);
+
+		void emitFXPick(Seiscomp::DataModel::PickPtr pick,
+		                Seiscomp::DataModel::AmplitudePtr amp,
+		                bool isPrimary,
+		                const Processing::FX*,
+		                const Processing::FX::Result &);
+
+		void emitAmplitude(const Processing::AmplitudeProcessor *ampProc,
+		                   const Processing::AmplitudeProcessor::Result &res);
+
+		void sendPick(Seiscomp::DataModel::Pick *pick,
+		              Seiscomp::DataModel::Amplitude *amp,
+		              const Record *rec, bool isPrimary);
+
+
+	protected:
+		App                *_app;
+		const Config       &_config;
+		StationConfig      &_stationConfig;
+
+		// Filters the detector data in batches if set, see
+		// Config::batchDetectors
+		std::unique_ptr<DetectorLanes> _lanes;
+
+
+	private:
+		typedef std::map<std::string, Processing::StreamPtr> StreamMap;
+		typedef std::map<std::string, DataModel::PickPtr> PickMap;
+
+		typedef Processing::WaveformProcessor TWProc;
+
+		struct ProcEntry {
+			ProcEntry(const Core::Time &t, TWProc *p)
+			: dataEndTime(t), proc(p) {}
+
+			Core::Time  dataEndTime;
+			TWProc     *proc;
+		};
+
+		typedef std::list<ProcEntry>  ProcList;
+		typedef std::map<std::string, ProcList> ProcMap;
+		typedef std::map<TWProc*, std::string> ProcReverseMap;
+		typedef std::pair<const TWProc*, DataModel::AmplitudePtr> PendingAmplitude;
+		typedef std::list<PendingAmplitude> PendingAmplitudes;
+
+		StreamMap          _streams;
+		PickMap            _lastPicks;
+
+		ProcMap            _runningStreamProcs;
+		ProcReverseMap     _procLookup;
+
+		// Amplitudes which can be updated until their processor finishes
+		PendingAmplitudes  _pendingAmplitudes;
+};
+
+
+}
+}
+}
+
+
+#endif
@@ -0,0 +1,428 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT Autopick
+#include <seiscomp/logging/log.h>
+
+#include <seiscomp/client/queue.ipp>
+#include <seiscomp/processing/timewindowprocessor.h>
+
+#include "shard.h"
+#include "picker.h"
+
+
+using namespace std;
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+
+
+namespace {
+
+
+// Maximum number of records queued per shard
+const int RecordQueueSize = 1024;
+
+// Maximum number of records processed before the detector data are filtered
+const size_t LaneBatchSize = 256;
+
+
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+Shard::Shard(App *app, int id)
+: Pipeline(app)
+, _id(id)
+, _queue(RecordQueueSize) {
+	_buffer.setTimeSpan(_config.ringBufferSize);
+
+	if ( _config.batchDetectors ) {
+		_lanes.reset(new DetectorLanes);
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+Shard::~Shard() {
+	stop();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::start() {
+	_thread = thread(&Shard::run, this);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::feed(Record *rec) {
+	Item item;
+	item.record = rec;
+	_queue.push(item);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::feedProgress(const Core::Time &time) {
+	Item item;
+	item.progress = time;
+	_queue.push(item);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::stop() {
+	if ( !_thread.joinable() ) {
+		return;
+	}
+
+	// An empty item signals the end of the queue
+	_queue.push(Item());
+	_thread.join();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::run() {
+	// The global object registry is not thread safe. Objects are created
+	// without registration, unique IDs are generated nevertheless.
+	DataModel::PublicObject::SetRegistrationEnabled(false);
+
+	SEISCOMP_DEBUG("[shard %d] started", _id);
+
+	size_t batchSize = 0;
+	// The read time received last which has not been reported since
+	// detector data are pending
+	OPT(Core::Time) progress;
+
+	while ( true ) {
+		Item item;
+		try {
+			item = _queue.pop();
+		}
+		catch ( Client::QueueClosedException & ) {
+			break;
+		}
+
+		if ( item.record ) {
+			process(item.record.get());
+			if ( _lanes ) {
+				++batchSize;
+			}
+		}
+		else if ( item.progress ) {
+			progress = item.progress;
+		}
+		else {
+			break;
+		}
+
+		// The detector data are filtered when all queued records have been
+		// collected, hence the detections are not delayed while the shard
+		// keeps up with the data
+		if ( batchSize > 0 && (batchSize >= LaneBatchSize || !_queue.canPop()) ) {
+			flushLanes();
+			batchSize = 0;
+		}
+
+		// All objects of the records read up to this time have been passed
+		// to the output thread unless detector data are pending
+		if ( progress && batchSize == 0 ) {
+			reportProgress(*progress);
+			progress = Core::None;
+		}
+	}
+
+	if ( _lanes ) {
+		flushLanes();
+	}
+
+	flush();
+
+	// The callbacks of the processors refer to this shard
+	_pending.clear();
+	_processors.clear();
+	_buffer.clear();
+
+	SEISCOMP_DEBUG("[shard %d] finished after %lu records",
+	               _id, static_cast<unsigned long>(_recordCount));
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::process(const Record *rec) {
+	++_recordCount;
+
+	// Records are decoded by the shard thread
+	if ( !rec->data() ) {
+		return;
+	}
+
+	if ( !_buffer.feed(rec) ) {
+		return;
+	}
+
+	// Processors created while feeding, e.g. the detector of a new stream
+	// or a picker started by a detection, are registered afterwards and
+	// fed from the buffer
+	_registrationBlocked = true;
+
+	if ( _buffer.addedNewStream() ) {
+		handleNewStream(rec);
+	}
+
+	auto range = _processors.equal_range(rec->streamID());
+	for ( auto it = range.first; it != range.second; ++it ) {
+		Processing::WaveformProcessor *proc = it->second.get();
+		if ( proc->isFinished() ) {
+			// Waits for removal
+			continue;
+		}
+
+		proc->feed(rec);
+
+		if ( proc->isFinished() ) {
+			processorFinished(rec, proc);
+			removeProcessor(proc);
+		}
+	}
+
+	_registrationBlocked = false;
+
+	registerPending();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::flushLanes() {
+	// Processors created by detections are registered afterwards
+	_registrationBlocked = true;
+	_lanes->flush();
+	_registrationBlocked = false;
+
+	registerPending();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::reportProgress(const Core::Time &time) {
+	App *app = _app;
+	int id = _id;
+
+	app->_outputQueue.push([app, id, time]() {
+		app->updateShardTime(id, time);
+	});
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::registerPending() {
+	_registrationBlocked = true;
+
+	// Feeding buffered records to a new processor can register further
+	// processors which are appended to the list
+	while ( !_pending.empty() ) {
+		Registration reg = _pending.front();
+		_pending.pop_front();
+
+		if ( !reg.add ) {
+			for ( auto it = _processors.begin(); it != _processors.end(); ) {
+				if ( it->second == reg.proc ) {
+					it = _processors.erase(it);
+				}
+				else {
+					++it;
+				}
+			}
+
+			continue;
+		}
+
+		_processors.insert(ProcessorMap::value_type(
+			reg.networkCode + "." + reg.stationCode + "." +
+			reg.locationCode + "." + reg.channelCode,
+			reg.proc
+		));
+
+		feedBuffered(reg);
+	}
+
+	_registrationBlocked = false;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::feedBuffered(const Registration &reg) {
+	// Only time window processors request data of the past
+	Processing::TimeWindowProcessor *proc =
+		dynamic_cast<Processing::TimeWindowProcessor*>(reg.proc.get());
+	if ( !proc || proc->isFinished() ) {
+		return;
+	}
+
+	RecordSequence *seq = _buffer.sequence(
+		Processing::StreamBuffer::WaveformID(reg.networkCode, reg.stationCode,
+		                                     reg.locationCode, reg.channelCode)
+	);
+	if ( !seq ) {
+		return;
+	}
+
+	Core::TimeWindow tw = proc->safetyTimeWindow();
+	const Record *lastRec = nullptr;
+
+	for ( RecordSequence::iterator it = seq->begin(); it != seq->end(); ++it ) {
+		const Record *rec = it->get();
+		if ( tw.startTime().valid() && rec->endTime() <= tw.startTime() ) {
+			continue;
+		}
+
+		proc->feed(rec);
+		lastRec = rec;
+
+		if ( proc->isFinished() ) {
+			processorFinished(lastRec, proc);
+			removeProcessor(proc);
+			break;
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::addProcessor(const std::string &networkCode,
+                         const std::string &stationCode,
+                         const std::string &locationCode,
+                         const std::string &channelCode,
+                         Processing::WaveformProcessor *proc) {
+	_pending.push_back(Registration{true, networkCode, stationCode,
+	                                locationCode, channelCode, proc});
+
+	if ( !_registrationBlocked ) {
+		registerPending();
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::removeProcessor(Processing::WaveformProcessor *proc) {
+	_pending.push_back(Registration{false, "", "", "", "", proc});
+
+	if ( !_registrationBlocked ) {
+		registerPending();
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::publishPick(DataModel::Pick *pick, DataModel::Amplitude *amp) {
+	App *app = _app;
+	DataModel::PickPtr p(pick);
+	DataModel::AmplitudePtr a(amp);
+
+	app->_outputQueue.push([app, p, a]() {
+		app->sendPick(p.get(), a.get());
+	});
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Shard::publishAmplitude(DataModel::Amplitude *amp, bool update) {
+	// The processor may update the amplitude while it is being sent,
+	// hence a copy is sent
+	DataModel::AmplitudePtr a = DataModel::Amplitude::Create(amp->publicID());
+	*a = *amp;
+
+	App *app = _app;
+	app->_outputQueue.push([app, a, update]() {
+		app->sendAmplitude(a.get(), update);
+	});
+
+	// Failures are reported by the output thread
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Shard::storeAmplitude(DataModel::Amplitude *amp) {
+	App *app = _app;
+	DataModel::AmplitudePtr a(amp);
+
+	app->_outputQueue.push([app, a]() {
+		app->storeAmplitude(a.get());
+	});
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+}
+}
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#ifndef SEISCOMP_APPLICATIONS_PICKER_SHARD_H__
+#define SEISCOMP_APPLICATIONS_PICKER_SHARD_H__
+
+
+#include <seiscomp/client/queue.h>
+#include <seiscomp/processing/streambuffer.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "pipeline.h"
+
+
+namespace Seiscomp {
+namespace Applications {
+namespace Picker {
+
+
+/**
+ * @brief A pipeline running in its own thread.
+ *
+ * The application distributes the streams by station, or by stream if the
+ * processors do not read other components, across the shards.
+ * A shard decodes the queued records of its streams, buffers them and
+ * feeds them to its processors. Unlike the single threaded pipeline it
+ * does not use the processor registration of the application. Picks and
+ * amplitudes are passed to the output thread of the application in the
+ * order they are emitted. If the output is sorted, the application queues
+ * the time of the data read so far regularly and the shard reports it once
+ * the records queued before have been processed.
+ */
+class Shard : public Pipeline {
+	public:
+		Shard(App *app, int id);
+		~Shard() override;
+
+
+	public:
+		void start();
+
+		//! Queues a record for processing, blocks while the queue is full
+		void feed(Record *rec);
+
+		//! Queues the time of the data read so far, which is reported to
+		//! the output thread after the records queued before
+		void feedProgress(const Core::Time &time);
+
+		//! Processes the queued records and stops the thread
+		void stop();
+
+
+	protected:
+		void addProcessor(const std::string &networkCode,
+		                  const std::string &stationCode,
+		                  const std::string &locationCode,
+		                  const std::string &channelCode,
+		                  Processing::WaveformProcessor *proc) override;
+		void removeProcessor(Processing::WaveformProcessor *proc) override;
+
+		void publishPick(DataModel::Pick *pick, DataModel::Amplitude *amp) override;
+		bool publishAmplitude(DataModel::Amplitude *amp, bool update) override;
+		void storeAmplitude(DataModel::Amplitude *amp) override;
+
+
+	private:
+		typedef std::multimap<std::string, Processing::WaveformProcessorPtr> ProcessorMap;
+
+		// A processor to add for a stream or to remove from all streams
+		struct Registration {
+			bool                             add;
+			std::string                      networkCode;
+			std::string                      stationCode;
+			std::string                      locationCode;
+			std::string                      channelCode;
+			Processing::WaveformProcessorPtr proc;
+		};
+
+		typedef std::list<Registration> Registrations;
+
+
+	private:
+		void run();
+		void process(const Record *rec);
+
+		// Filters the collected detector data and runs the detections
+		void flushLanes();
+
+		// Passes the read time of the processed data to the output thread
+		// which merges the output of all shards by time
+		void reportProgress(const Core::Time &time);
+
+		// Applies the registrations which have been deferred while records
+		// were fed
+		void registerPending();
+
+		// Feeds the buffered records of a stream to a newly registered
+		// time window processor
+		void feedBuffered(const Registration &reg);
+
+
+	private:
+		// A record to process or, without record, the time of the data
+		// read so far. An empty item ends the queue.
+		struct Item {
+			RecordPtr       record;
+			OPT(Core::Time) progress;
+		};
+
+		int                                 _id;
+		Client::ThreadedQueue<Item>         _queue;
+		std::thread                         _thread;
+
+		Processing::StreamBuffer            _buffer;
+		ProcessorMap                        _processors;
+		Registrations                       _pending;
+		bool                                _registrationBlocked{false};
+		size_t                              _recordCount{0};
+};
+
+
+}
+}
+}
+
+
+#endif
@@ -0,0 +1,184 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#include <seiscomp/math/filter.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "lanefilter.h"
+
+
+// Benchmark of the detector filtering. A set of streams is filtered
+// record by record with a detector filter three times: with one library
+// filter per stream as done by the detectors without lanes, with the
+// scalar path of the LaneFilter and with the lanes. The time per sample
+// of each is reported.
+//
+// Usage: scautopick_lanebench [filter [streams [records]]]
+
+
+using namespace std;
+using namespace Seiscomp;
+using namespace Seiscomp::Applications::Picker;
+
+
+namespace {
+
+
+const double SamplingFrequency = 100.0;
+const size_t RecordLength = 400;
+
+
+typedef vector<vector<double>> Streams;
+
+
+Streams createStreams(size_t streamCount, size_t recordCount) {
+	mt19937 generator(1);
+	normal_distribution<double> noise(0, 1000);
+	Streams streams(streamCount);
+
+	for ( vector<double> &stream : streams ) {
+		for ( size_t i = 0; i < recordCount * RecordLength; ++i ) {
+			stream.push_back(noise(generator));
+		}
+	}
+
+	return streams;
+}
+
+
+double elapsedSince(const chrono::steady_clock::time_point &start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+double filterLibrary(const string &definition, Streams &streams, size_t recordCount) {
+	typedef Math::Filtering::InPlaceFilter<double> LibraryFilter;
+	vector<unique_ptr<LibraryFilter>> filters;
+	for ( size_t s = 0; s < streams.size(); ++s ) {
+		filters.emplace_back(LibraryFilter::Create(definition));
+		if ( !filters.back() ) {
+			return -1;
+		}
+
+		filters.back()->setSamplingFrequency(SamplingFrequency);
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	for ( size_t r = 0; r < recordCount; ++r ) {
+		for ( size_t s = 0; s < streams.size(); ++s ) {
+			filters[s]->apply(static_cast<int>(RecordLength),
+			                  streams[s].data() + r * RecordLength);
+		}
+	}
+
+	return elapsedSince(start);
+}
+
+
+double filterScalar(const LaneFilter &filter, Streams &streams, size_t recordCount) {
+	vector<LaneState> states(streams.size());
+	for ( LaneState &state : states ) {
+		filter.reset(state);
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	for ( size_t r = 0; r < recordCount; ++r ) {
+		for ( size_t s = 0; s < streams.size(); ++s ) {
+			filter.apply(states[s], streams[s].data() + r * RecordLength, RecordLength);
+		}
+	}
+
+	return elapsedSince(start);
+}
+
+
+double filterLanes(const LaneFilter &filter, Streams &streams, size_t recordCount) {
+	vector<LaneState> states(streams.size());
+	for ( LaneState &state : states ) {
+		filter.reset(state);
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	for ( size_t r = 0; r < recordCount; ++r ) {
+		size_t s = 0;
+		for ( ; s + LaneWidth <= streams.size(); s += LaneWidth ) {
+			LaneState *laneStates[LaneWidth];
+			double *data[LaneWidth];
+			size_t n[LaneWidth];
+
+			for ( int l = 0; l < LaneWidth; ++l ) {
+				laneStates[l] = &states[s+l];
+				data[l] = streams[s+l].data() + r * RecordLength;
+				n[l] = RecordLength;
+			}
+
+			filter.apply(laneStates, data, n);
+		}
+
+		for ( ; s < streams.size(); ++s ) {
+			filter.apply(states[s], streams[s].data() + r * RecordLength, RecordLength);
+		}
+	}
+
+	return elapsedSince(start);
+}
+
+
+}
+
+
+int main(int argc, char **argv) {
+	string definition = "RMHP(10)>>ITAPER(30)>>BW(4,0.7,2)>>STALTA(2,80)";
+	size_t streamCount = 400;
+	size_t recordCount = 100;
+
+	if ( argc > 1 ) definition = argv[1];
+	if ( argc > 2 ) streamCount = static_cast<size_t>(atoi(argv[2]));
+	if ( argc > 3 ) recordCount = static_cast<size_t>(atoi(argv[3]));
+
+	LaneFilter filter;
+	string error;
+	if ( !filter.setup(definition, SamplingFrequency, &error) ) {
+		cerr << definition << ": " << error << endl;
+		return 1;
+	}
+
+	Streams library = createStreams(streamCount, recordCount);
+	Streams scalar = library;
+	Streams lanes = library;
+	double samples = static_cast<double>(streamCount * recordCount * RecordLength);
+
+	double libraryTime = filterLibrary(definition, library, recordCount);
+	double scalarTime = filterScalar(filter, scalar, recordCount);
+	double lanesTime = filterLanes(filter, lanes, recordCount);
+
+	cout << streamCount << " streams at " << SamplingFrequency << " Hz, "
+	     << static_cast<size_t>(samples) << " samples, " << definition << endl;
+	if ( libraryTime >= 0 ) {
+		cout << "  library filter: " << libraryTime * 1E9 / samples << " ns/sample" << endl;
+	}
+	cout << "  scalar:         " << scalarTime * 1E9 / samples << " ns/sample" << endl
+	     << "  lanes:          " << lanesTime * 1E9 / samples << " ns/sample" << endl;
+
+	return 0;
+}
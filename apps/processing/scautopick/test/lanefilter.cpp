@@ -0,0 +1,429 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_TEST_MODULE test_scautopick_lanefilter
+
+#include <seiscomp/unittest/unittests.h>
+#include <seiscomp/core/genericrecord.h>
+#include <seiscomp/core/strings.h>
+#include <seiscomp/math/filter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "lanefilter.h"
+#include "detectorlanes.h"
+#include "detector.h"
+
+
+// The detector filtering with the lanes compared to the library filters.
+//
+// Each supported filter chain is applied to a set of streams with the
+// library filter, the scalar path of the LaneFilter and the lanes. The
+// lanes must produce bit for bit the output of the scalar path, and both
+// must follow the library within a relative tolerance. The streams have
+// different record lengths and some of them are reset while the others
+// continue, which exercises the scalar fallback of the lanes.
+//
+// The detectors must pick the same onsets with the lanes as with the
+// library filters. Filters which the lanes do not support are applied
+// with the library filter as done by the pipeline.
+//
+// The timing of the filters is measured by scautopick_lanebench.
+
+
+using namespace std;
+using namespace Seiscomp;
+using namespace Seiscomp::Applications::Picker;
+
+
+namespace {
+
+
+const char *DefaultFilter = "RMHP(10)>>ITAPER(30)>>BW(4,0.7,2)>>STALTA(2,80)";
+const double SamplingFrequency = 100.0;
+
+// The maximum deviation from the library relative to the maximum
+// amplitude of the library output
+const double Tolerance = 1E-6;
+
+const size_t StreamCount = 24;
+const size_t RecordCount = 40;
+// Streams are reset at this record, a third of them
+const size_t ResetRecord = 20;
+
+
+struct Stream {
+	// The samples of all records, filtered in place
+	vector<double> data;
+	vector<size_t> recordLengths;
+	bool           reset;
+};
+
+
+size_t recordLength(size_t stream, size_t record) {
+	return 400 - 16 * ((stream + record) % 4);
+}
+
+
+vector<Stream> createStreams() {
+	mt19937 generator(1);
+	normal_distribution<double> noise(5000, 1000);
+	vector<Stream> streams(StreamCount);
+
+	for ( size_t s = 0; s < StreamCount; ++s ) {
+		Stream &stream = streams[s];
+		stream.reset = s % 3 == 0;
+		for ( size_t r = 0; r < RecordCount; ++r ) {
+			size_t n = recordLength(s, r);
+			stream.recordLengths.push_back(n);
+			for ( size_t i = 0; i < n; ++i ) {
+				stream.data.push_back(noise(generator));
+			}
+		}
+	}
+
+	return streams;
+}
+
+
+void filterLibrary(const string &definition, vector<Stream> &streams) {
+	typedef Math::Filtering::InPlaceFilter<double> LibraryFilter;
+	vector<unique_ptr<LibraryFilter>> filters;
+	for ( size_t s = 0; s < streams.size(); ++s ) {
+		filters.emplace_back(LibraryFilter::Create(definition));
+		BOOST_REQUIRE_MESSAGE(filters.back(), definition);
+		filters.back()->setSamplingFrequency(SamplingFrequency);
+	}
+
+	vector<size_t> offsets(streams.size(), 0);
+	for ( size_t r = 0; r < RecordCount; ++r ) {
+		for ( size_t s = 0; s < streams.size(); ++s ) {
+			Stream &stream = streams[s];
+			if ( r == ResetRecord && stream.reset ) {
+				filters[s].reset(filters[s]->clone());
+				filters[s]->setSamplingFrequency(SamplingFrequency);
+			}
+
+			size_t n = stream.recordLengths[r];
+			filters[s]->apply(static_cast<int>(n), stream.data.data() + offsets[s]);
+			offsets[s] += n;
+		}
+	}
+}
+
+
+void filterScalar(const LaneFilter &filter, vector<Stream> &streams) {
+	vector<LaneState> states(streams.size());
+	for ( LaneState &state : states ) {
+		filter.reset(state);
+	}
+
+	vector<size_t> offsets(streams.size(), 0);
+	for ( size_t r = 0; r < RecordCount; ++r ) {
+		for ( size_t s = 0; s < streams.size(); ++s ) {
+			Stream &stream = streams[s];
+			if ( r == ResetRecord && stream.reset ) {
+				filter.reset(states[s]);
+			}
+
+			size_t n = stream.recordLengths[r];
+			filter.apply(states[s], stream.data.data() + offsets[s], n);
+			offsets[s] += n;
+		}
+	}
+}
+
+
+void filterLanes(const LaneFilter &filter, vector<Stream> &streams) {
+	vector<LaneState> states(streams.size());
+	for ( LaneState &state : states ) {
+		filter.reset(state);
+	}
+
+	vector<size_t> offsets(streams.size(), 0);
+	for ( size_t r = 0; r < RecordCount; ++r ) {
+		for ( size_t s = 0; s + LaneWidth <= streams.size(); s += LaneWidth ) {
+			LaneState *laneStates[LaneWidth];
+			double *data[LaneWidth];
+			size_t n[LaneWidth];
+
+			for ( int l = 0; l < LaneWidth; ++l ) {
+				Stream &stream = streams[s+l];
+				if ( r == ResetRecord && stream.reset ) {
+					filter.reset(states[s+l]);
+				}
+
+				laneStates[l] = &states[s+l];
+				data[l] = stream.data.data() + offsets[s+l];
+				n[l] = stream.recordLengths[r];
+				offsets[s+l] += n[l];
+			}
+
+			filter.apply(laneStates, data, n);
+		}
+	}
+}
+
+
+// The maximum deviation of a stream from the library output relative to
+// the maximum amplitude of the library output
+double deviation(const Stream &library, const Stream &stream) {
+	double maxAmplitude = 0;
+	double maxDeviation = 0;
+	for ( size_t i = 0; i < library.data.size(); ++i ) {
+		maxAmplitude = max(maxAmplitude, fabs(library.data[i]));
+		maxDeviation = max(maxDeviation, fabs(library.data[i] - stream.data[i]));
+	}
+
+	return maxAmplitude > 0 ? maxDeviation / maxAmplitude : maxDeviation;
+}
+
+
+// The picks of the detectors on a fixture of streams with one onset each
+const size_t PickStreamCount = 2 * LaneWidth;
+const size_t PickRecordCount = 100;
+const double TriggerOn = 3;
+const double TriggerOff = 1.5;
+const double InitTime = 60;
+const Core::Time ReferenceTime(1577836800, 0);
+
+
+double onsetTime(size_t stream) {
+	return 150 + 10.0 * stream;
+}
+
+
+struct Pick {
+	size_t stream;
+	// The pick time relative to the reference time
+	double time;
+
+	bool operator<(const Pick &other) const {
+		return stream < other.stream || (stream == other.stream && time < other.time);
+	}
+};
+
+typedef vector<Pick> Picks;
+
+
+vector<GenericRecordPtr> createRecords(size_t stream) {
+	mt19937 generator(static_cast<unsigned int>(stream + 1));
+	normal_distribution<double> noise(1000, 100);
+	size_t onset = static_cast<size_t>(onsetTime(stream) * SamplingFrequency);
+	vector<GenericRecordPtr> records;
+
+	size_t offset = 0;
+	for ( size_t r = 0; r < PickRecordCount; ++r ) {
+		size_t n = recordLength(stream, r);
+		vector<double> samples(n);
+		for ( size_t i = 0; i < n; ++i, ++offset ) {
+			samples[i] = noise(generator);
+			if ( offset >= onset ) {
+				double t = (offset - onset) / SamplingFrequency;
+				samples[i] += 20000 * exp(-t / 20) * sin(2 * M_PI * 1.2 * t);
+			}
+		}
+
+		Core::Time start = ReferenceTime + Core::TimeSpan((offset - n) / SamplingFrequency);
+		GenericRecordPtr rec = new GenericRecord("XX", "S" + Core::toString(stream),
+		                                         "", "HHZ", start, SamplingFrequency);
+		rec->setData(new DoubleArray(static_cast<int>(n), samples.data()));
+		rec->dataUpdated();
+		records.push_back(rec);
+	}
+
+	return records;
+}
+
+
+// Runs a detector per stream as set up by the pipeline, with the lanes
+// if batch is set. Returns the picks sorted by stream and time.
+Picks detect(const string &definition, bool batch, size_t *attached = nullptr) {
+	DetectorLanes lanes;
+	vector<DetectorPtr> detectors;
+	vector<vector<GenericRecordPtr>> records;
+	Picks picks;
+
+	if ( attached ) *attached = 0;
+
+	for ( size_t s = 0; s < PickStreamCount; ++s ) {
+		DetectorPtr detector = new Detector(TriggerOn, TriggerOff, InitTime);
+
+		string error;
+		if ( !batch || !detector->setLanes(&lanes, definition, SamplingFrequency, &error) ) {
+			Processing::WaveformProcessor::Filter *filter;
+			filter = Processing::WaveformProcessor::Filter::Create(definition, &error);
+			BOOST_REQUIRE_MESSAGE(filter, definition << ": " << error);
+			detector->setFilter(filter);
+		}
+		else if ( attached ) {
+			++*attached;
+		}
+
+		detector->setPublishFunction([&picks, s](const Processing::Detector *,
+		                                         const Record *,
+		                                         const Core::Time &time) {
+			picks.push_back(Pick{s, static_cast<double>(time - ReferenceTime)});
+		});
+
+		detectors.push_back(detector);
+		records.push_back(createRecords(s));
+	}
+
+	// The shards flush the lanes after a batch of records
+	for ( size_t r = 0; r < PickRecordCount; ++r ) {
+		for ( size_t s = 0; s < PickStreamCount; ++s ) {
+			detectors[s]->feed(records[s][r].get());
+		}
+
+		lanes.flush();
+	}
+
+	detectors.clear();
+	sort(picks.begin(), picks.end());
+	return picks;
+}
+
+
+void checkOnsets(const Picks &picks) {
+	for ( size_t s = 0; s < PickStreamCount; ++s ) {
+		bool found = false;
+		for ( const Pick &pick : picks ) {
+			if ( pick.stream == s && pick.time >= onsetTime(s) && pick.time < onsetTime(s) + 5 ) {
+				found = true;
+			}
+		}
+
+		BOOST_CHECK_MESSAGE(found, "no pick at onset of stream " << s);
+	}
+}
+
+
+void checkSamePicks(const Picks &library, const Picks &lanes) {
+	BOOST_REQUIRE_EQUAL(library.size(), lanes.size());
+	for ( size_t i = 0; i < library.size(); ++i ) {
+		BOOST_CHECK_EQUAL(library[i].stream, lanes[i].stream);
+		// The same sample
+		BOOST_CHECK_SMALL(library[i].time - lanes[i].time, 0.5 / SamplingFrequency);
+	}
+}
+
+
+}
+
+
+BOOST_AUTO_TEST_SUITE(seiscomp_main_scautopick_lanefilter)
+
+
+BOOST_AUTO_TEST_CASE(libraryOutput) {
+	BOOST_REQUIRE(StreamCount % LaneWidth == 0);
+
+	const vector<string> chains = {
+		"RMHP(10)",
+		"RMHP(10)>>ITAPER(30)",
+		"BW_HP(3,0.7)",
+		"BW_LP(4,2)",
+		"BW_HLP(3,0.7,2)",
+		"BW(3,0.7,2)",
+		"BW(4,0.7,2)",
+		"STALTA(2,80)",
+		DefaultFilter
+	};
+
+	const vector<Stream> input = createStreams();
+
+	for ( const string &chain : chains ) {
+		LaneFilter filter;
+		string error;
+		BOOST_REQUIRE_MESSAGE(filter.setup(chain, SamplingFrequency, &error),
+		                      chain << ": " << error);
+
+		vector<Stream> library = input;
+		vector<Stream> scalar = input;
+		vector<Stream> lanes = input;
+
+		filterLibrary(chain, library);
+		filterScalar(filter, scalar);
+		filterLanes(filter, lanes);
+
+		size_t differingStreams = 0;
+		double maxDeviation = 0;
+		for ( size_t s = 0; s < StreamCount; ++s ) {
+			if ( memcmp(scalar[s].data.data(), lanes[s].data.data(),
+			            scalar[s].data.size() * sizeof(double)) ) {
+				++differingStreams;
+			}
+
+			maxDeviation = max(maxDeviation, deviation(library[s], scalar[s]));
+		}
+
+		BOOST_CHECK_MESSAGE(differingStreams == 0,
+		                    chain << ": " << differingStreams << " streams differ from the scalar path");
+		BOOST_CHECK_MESSAGE(maxDeviation < Tolerance,
+		                    chain << ": deviation from library " << maxDeviation);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(samePicks) {
+	size_t attached;
+	Picks library = detect(DefaultFilter, false);
+	Picks lanes = detect(DefaultFilter, true, &attached);
+
+	BOOST_CHECK_EQUAL(attached, PickStreamCount);
+	checkOnsets(library);
+	checkSamePicks(library, lanes);
+}
+
+
+BOOST_AUTO_TEST_CASE(unsupportedFilters) {
+	const vector<string> unsupported = {
+		"RMHP(10)>>ITAPER(30)>>BW(4,0.7,2)>>AVG(0.05)>>STALTA(2,80)",
+		"STALTA2(2,80,3,1.5)",
+		"RMHP>>STALTA(2,80)",
+		"RMHP(10)>>>ITAPER(30)",
+		"BW(4,2,0.7)",
+		"BW_HP(4,60)",
+		"STALTA(80,2)"
+	};
+
+	for ( const string &definition : unsupported ) {
+		LaneFilter filter;
+		string error;
+		BOOST_CHECK_MESSAGE(!filter.setup(definition, SamplingFrequency, &error), definition);
+		BOOST_CHECK_MESSAGE(!error.empty(), definition);
+
+		DetectorLanes lanes;
+		BOOST_CHECK(!lanes.attach(definition, SamplingFrequency,
+		                          DetectorLanes::ProcessFunc(),
+		                          DetectorLanes::ReleaseFunc()));
+	}
+
+	// The detectors fall back to the library filter
+	size_t attached;
+	Picks library = detect(unsupported[0], false);
+	Picks lanes = detect(unsupported[0], true, &attached);
+
+	BOOST_CHECK_EQUAL(attached, 0);
+	checkOnsets(library);
+	checkSamePicks(library, lanes);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,633 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT SCEVENT
+#include <seiscomp/logging/log.h>
+
+#include "eventindex.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+using namespace std;
+using namespace Seiscomp;
+using namespace Seiscomp::DataModel;
+using namespace Seiscomp::Client;
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+namespace {
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void eraseValue(vector<EventInformation*> &v, EventInformation *info) {
+	v.erase(std::remove(v.begin(), v.end(), info), v.end());
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+}
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventIndex::EventIndex(EventInformation::Cache *cache, const Config *cfg)
+: _cache(cache), _config(cfg) {}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventIndex::~EventIndex() {
+	clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::add(EventInformation *info) {
+	Entry &entry = _entries[info];
+	if ( !entry.info ) {
+		entry.info = info;
+		info->index = this;
+	}
+
+	invalidate(info);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::remove(EventInformation *info) {
+	auto it = _entries.find(info);
+	if ( it == _entries.end() ) {
+		return;
+	}
+
+	unindex(it->second);
+	if ( it->second.pending ) {
+		eraseValue(_pending, info);
+	}
+
+	info->index = nullptr;
+	_entries.erase(it);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::invalidate(EventInformation *info) {
+	if ( auto it = _entries.find(info); it != _entries.end() && !it->second.pending ) {
+		it->second.pending = true;
+		_pending.push_back(info);
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::invalidateOrigin(const string &originID) {
+	if ( auto it = _origins.find(originID); it != _origins.end() ) {
+		for ( EventInformation *info : it->second ) {
+			invalidate(info);
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::update() {
+	for ( EventInformation *info : _pending ) {
+		Entry &entry = _entries[info];
+		entry.pending = false;
+		unindex(entry);
+		index(entry);
+	}
+
+	_pending.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::clear() {
+	for ( auto &[info, entry] : _entries ) {
+		info->index = nullptr;
+	}
+
+	_entries.clear();
+	_pending.clear();
+	_origins.clear();
+	_focalMechanisms.clear();
+	_picks.clear();
+	_pickTimes.clear();
+	_stationKeys.clear();
+	_freeStationKeys.clear();
+	_cells.clear();
+	_unknownPicks.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventInformation *EventIndex::findByOrigin(const string &originID) const {
+	return find(_origins, originID, true);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventInformation *EventIndex::findByFocalMechanism(const string &fmID) const {
+	return find(_focalMechanisms, fmID, false);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventIndex::Candidates
+EventIndex::candidates(Origin *origin,
+                       const EventInformation::PickCache *pickCache) const {
+	vector<EventInformation*> events;
+	PickMatches matches;
+
+	if ( _config->eventAssociation.minMatchingPicks == 0 ) {
+		// Every event matches by picks
+		for ( auto &[info, entry] : _entries ) {
+			if ( entry.matchable ) {
+				events.push_back(info);
+			}
+		}
+	}
+	else {
+		// Time and location
+		try {
+			const double maxDist = _config->eventAssociation.maxDist;
+			const double lat = origin->latitude().value();
+			Cell from = cell(origin->time().value().epoch(), std::max(lat - maxDist, -90.0));
+			Cell to = cell(origin->time().value().epoch(), std::min(lat + maxDist, 90.0));
+
+			for ( long t = from.first-1; t <= from.first+1; ++t ) {
+				auto it = _cells.lower_bound(Cell(t, from.second));
+				auto end = _cells.upper_bound(Cell(t, to.second));
+				for ( ; it != end; ++it ) {
+					events.insert(events.end(), it->second.begin(), it->second.end());
+				}
+			}
+		}
+		catch ( Core::ValueException & ) {}
+
+		// The pick sets of these events will be built while comparing
+		events.insert(events.end(), _unknownPicks.begin(), _unknownPicks.end());
+	}
+
+	// Picks
+	countMatchingPicks(origin, pickCache, matches);
+	for ( auto &[info, count] : matches ) {
+		if ( count >= _config->eventAssociation.minMatchingPicks ) {
+			events.push_back(info);
+		}
+	}
+
+	std::sort(events.begin(), events.end());
+	events.erase(std::unique(events.begin(), events.end()), events.end());
+
+	// Same order as iterating over the event cache
+	std::sort(events.begin(), events.end(),
+	          [](const EventInformation *a, const EventInformation *b) {
+		return a->event->publicID() < b->event->publicID();
+	});
+
+	Candidates result;
+	result.reserve(events.size());
+
+	for ( EventInformation *info : events ) {
+		auto it = matches.find(info);
+		auto entry = _entries.find(info);
+		result.push_back({
+			info, it != matches.end() ? it->second : 0,
+			entry != _entries.end() && !entry->second.dirtyPickSet
+		});
+	}
+
+	return result;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::index(Entry &entry) {
+	EventInformation *info = entry.info.get();
+
+	entry.dirtyPickSet = info->dirtyPickSet;
+	entry.matchable = info->preferredOrigin != nullptr;
+	entry.located = false;
+
+	if ( info->event ) {
+		Event *evt = info->event.get();
+		for ( size_t i = 0; i < evt->originReferenceCount(); ++i ) {
+			entry.originIDs.push_back(evt->originReference(i)->originID());
+			insert(_origins, entry.originIDs.back(), info);
+		}
+
+		for ( size_t i = 0; i < evt->focalMechanismReferenceCount(); ++i ) {
+			entry.fmIDs.push_back(evt->focalMechanismReference(i)->focalMechanismID());
+			insert(_focalMechanisms, entry.fmIDs.back(), info);
+		}
+	}
+
+	// Without preferred origin an event can't be matched
+	if ( !info->preferredOrigin ) {
+		return;
+	}
+
+	try {
+		entry.cell = cell(info->preferredOrigin->time().value().epoch(),
+		                  info->preferredOrigin->latitude().value());
+		entry.located = true;
+		_cells[entry.cell].push_back(info);
+	}
+	catch ( Core::ValueException & ) {}
+
+	if ( info->dirtyPickSet ) {
+		_unknownPicks.push_back(info);
+		return;
+	}
+
+	addPicks(entry);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::unindex(Entry &entry) {
+	EventInformation *info = entry.info.get();
+
+	for ( auto &id : entry.originIDs ) {
+		erase(_origins, id, info);
+	}
+	entry.originIDs.clear();
+
+	for ( auto &id : entry.fmIDs ) {
+		erase(_focalMechanisms, id, info);
+	}
+	entry.fmIDs.clear();
+
+	removePicks(entry);
+
+	if ( entry.located ) {
+		if ( auto it = _cells.find(entry.cell); it != _cells.end() ) {
+			eraseValue(it->second, info);
+			if ( it->second.empty() ) {
+				_cells.erase(it);
+			}
+		}
+		entry.located = false;
+	}
+
+	eraseValue(_unknownPicks, info);
+	entry.matchable = false;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::addPicks(Entry &entry) {
+	EventInformation *info = entry.info.get();
+
+	if ( _config->eventAssociation.maxMatchingPicksTimeDiff < 0 ) {
+		entry.pickIDs.assign(info->pickIDs.begin(), info->pickIDs.end());
+		for ( auto &id : entry.pickIDs ) {
+			_picks[id].push_back(info);
+		}
+		return;
+	}
+
+	// The same pick can be registered several times, e.g. if it is
+	// referenced by more than one origin. Each registration counts as
+	// in EventInformation::matchingPicks.
+	const string *lastStation = nullptr;
+	uint32_t stationKey = 0;
+
+	for ( auto &[station, stationPick] : info->picks ) {
+		// The picks are sorted by station
+		if ( !lastStation || *lastStation != station ) {
+			stationKey = acquireStation(station);
+			entry.stations.push_back(station);
+			lastStation = &station;
+		}
+
+		Core::Time time;
+		try {
+			time = stationPick.pick->time().value();
+		}
+		catch ( ... ) {}
+
+		StationPhase key = stationPhase(stationKey, stationPick.phase);
+		_pickTimes[key].push_back({ info, time });
+		entry.stationPhases.push_back(key);
+	}
+
+	std::sort(entry.stationPhases.begin(), entry.stationPhases.end());
+	entry.stationPhases.erase(std::unique(entry.stationPhases.begin(), entry.stationPhases.end()),
+	                          entry.stationPhases.end());
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::removePicks(Entry &entry) {
+	EventInformation *info = entry.info.get();
+
+	for ( auto &id : entry.pickIDs ) {
+		erase(_picks, id, info);
+	}
+	entry.pickIDs.clear();
+
+	for ( StationPhase key : entry.stationPhases ) {
+		auto it = _pickTimes.find(key);
+		if ( it == _pickTimes.end() ) {
+			continue;
+		}
+
+		auto &picks = it->second;
+		picks.erase(std::remove_if(picks.begin(), picks.end(),
+		                           [info](const PickTime &p) { return p.info == info; }),
+		            picks.end());
+		if ( picks.empty() ) {
+			_pickTimes.erase(it);
+		}
+	}
+	entry.stationPhases.clear();
+
+	for ( auto &station : entry.stations ) {
+		releaseStation(station);
+	}
+	entry.stations.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::countMatchingPicks(Origin *origin,
+                                    const EventInformation::PickCache *pickCache,
+                                    PickMatches &matches) const {
+	const auto &cfg = _config->eventAssociation;
+
+	// Per event the number of compared picks and the number of picks
+	// within the time difference of the current arrival
+	std::unordered_map<EventInformation*, std::pair<int, int>> hits;
+
+	for ( size_t i = 0; i < origin->arrivalCount(); ++i ) {
+		Arrival *arr = origin->arrival(i);
+		if ( !arr ) {
+			continue;
+		}
+
+		if ( !cfg.matchingLooseAssociatedPicks
+		  && Private::arrivalWeight(arr) == 0 ) {
+			continue;
+		}
+
+		if ( cfg.maxMatchingPicksTimeDiff < 0 ) {
+			if ( auto it = _picks.find(arr->pickID()); it != _picks.end() ) {
+				for ( EventInformation *info : it->second ) {
+					++matches[info];
+				}
+			}
+			continue;
+		}
+
+		PickPtr p;
+		if ( pickCache ) {
+			if ( auto it = pickCache->find(arr->pickID()); it != pickCache->end() ) {
+				p = it->second;
+			}
+		}
+		else {
+			p = _cache->get<Pick>(arr->pickID());
+		}
+
+		if ( !p ) {
+			SEISCOMP_WARNING("could not load origin pick %s", arr->pickID().c_str());
+			continue;
+		}
+
+		// No indexed event has picks of an unknown station
+		auto station = _stationKeys.find(Private::stationID(p.get()));
+		if ( station == _stationKeys.end() ) {
+			continue;
+		}
+
+		auto it = _pickTimes.find(stationPhase(station->second.key,
+		                                       Private::shortPhaseName(p.get())));
+		if ( it == _pickTimes.end() ) {
+			continue;
+		}
+
+		Core::Time time;
+		bool hasTime = true;
+		try {
+			time = p->time().value();
+		}
+		catch ( ... ) {
+			hasTime = false;
+		}
+
+		hits.clear();
+		for ( const PickTime &cmp : it->second ) {
+			auto &[cnt, hit] = hits[cmp.info];
+			++cnt;
+			if ( hasTime
+			  && fabs((double)(cmp.time - time)) <= cfg.maxMatchingPicksTimeDiff ) {
+				++hit;
+			}
+		}
+
+		for ( auto &[info, counts] : hits ) {
+			// No pick within the time difference
+			if ( !counts.second ) {
+				continue;
+			}
+
+			// With AND the difference to every pick of the station must
+			// lie within the threshold, with OR at least one pick must match
+			if ( !cfg.matchingPicksTimeDiffAND || counts.second == counts.first ) {
+				++matches[info];
+			}
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventIndex::Cell EventIndex::cell(double time, double latitude) const {
+	// An origin can only match an event within the maximum time span
+	// and distance, and the distance is not smaller than the latitude
+	// difference. With cells of that size only the adjacent cells need
+	// to be searched.
+	const double timeSpan = std::max(double(_config->eventAssociation.maxTimeDiff), 1.0);
+	const double band = std::max(_config->eventAssociation.maxDist, 1.0);
+
+	return Cell(static_cast<long>(std::floor(time / timeSpan)),
+	            static_cast<long>(std::floor((latitude + 90.0) / band)));
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+uint32_t EventIndex::acquireStation(const string &station) {
+	auto it = _stationKeys.find(station);
+	if ( it == _stationKeys.end() ) {
+		uint32_t key;
+		if ( _freeStationKeys.empty() ) {
+			key = static_cast<uint32_t>(_stationKeys.size());
+		}
+		else {
+			key = _freeStationKeys.back();
+			_freeStationKeys.pop_back();
+		}
+
+		it = _stationKeys.emplace(station, StationKey{key, 0}).first;
+	}
+
+	++it->second.events;
+	return it->second.key;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::releaseStation(const string &station) {
+	auto it = _stationKeys.find(station);
+	if ( it == _stationKeys.end() ) {
+		return;
+	}
+
+	// No picks of this station are indexed anymore, the key can be reused
+	if ( --it->second.events == 0 ) {
+		_freeStationKeys.push_back(it->second.key);
+		_stationKeys.erase(it);
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventIndex::StationPhase EventIndex::stationPhase(uint32_t station, char phase) {
+	return (StationPhase(station) << 8) | static_cast<unsigned char>(phase);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::insert(KeyIndex &index, const string &key, EventInformation *info) {
+	auto &events = index[key];
+	if ( std::find(events.begin(), events.end(), info) == events.end() ) {
+		events.push_back(info);
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventIndex::erase(KeyIndex &index, const string &key, EventInformation *info) {
+	if ( auto it = index.find(key); it != index.end() ) {
+		eraseValue(it->second, info);
+		if ( it->second.empty() ) {
+			index.erase(it);
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventInformation *EventIndex::find(const KeyIndex &index, const string &key,
+                                   bool origin) const {
+	auto it = index.find(key);
+	if ( it == index.end() ) {
+		return nullptr;
+	}
+
+	// Normally an object is referenced by one event only. Otherwise
+	// the first event in ID order wins as when searching the cache.
+	EventInformation *result = nullptr;
+	for ( EventInformation *info : it->second ) {
+		// Double check, the reference could have been removed since
+		// the last update
+		if ( !info->event
+		  || (origin && !info->event->originReference(key))
+		  || (!origin && !info->event->focalMechanismReference(key)) ) {
+			continue;
+		}
+
+		if ( !result || info->event->publicID() < result->event->publicID() ) {
+			result = info;
+		}
+	}
+
+	return result;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -0,0 +1,203 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#ifndef SEISCOMP_APPLICATIONS_EVENTINDEX_H__
+#define SEISCOMP_APPLICATIONS_EVENTINDEX_H__
+
+
+#include "eventinfo.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace Seiscomp {
+namespace Client {
+
+
+/**
+ * @brief Index of the cached events.
+ *
+ * The index allows to look up the event an origin or focal mechanism
+ * is associated with and to collect the events an origin can possibly
+ * match without comparing the origin against every cached event.
+ *
+ * Events are indexed by the IDs of their origin and focal mechanism
+ * references, by the origin time bucket and latitude band of their
+ * preferred origin and by their pick set. The pick set is indexed by
+ * pick ID or, if picks are compared by time, by station and phase
+ * along with the pick times. This way the matching picks of an origin
+ * are counted for all events at once with one lookup per arrival.
+ *
+ * The index is maintained incrementally. Events are added and removed
+ * when they enter or leave the event cache. Whenever the references,
+ * the preferred origin or the pick set of a cached event change, the
+ * event is invalidated, either by EventInformation::changed() or by
+ * the event tool. update() re-indexes the invalidated events only, so
+ * the cost of a lookup does not depend on the number of cached events.
+ */
+class EventIndex {
+	public:
+		struct Candidate {
+			EventInformation *info;
+			//! The number of matching picks as returned by
+			//! EventInformation::matchingPicks
+			size_t            matchingPicks;
+			//! Whether matchingPicks is valid. If the pick set of the
+			//! event has not been built yet, the event must count the
+			//! matching picks itself.
+			bool              pickSetIndexed;
+		};
+
+		using Candidates = std::vector<Candidate>;
+
+	public:
+		EventIndex(EventInformation::Cache *cache, const Config *cfg);
+		~EventIndex();
+
+	public:
+		//! Adds an event which has entered the event cache
+		void add(EventInformation *info);
+
+		//! Removes an event which has left the event cache
+		void remove(EventInformation *info);
+
+		//! Forces re-indexing of an event with the next update
+		void invalidate(EventInformation *info);
+
+		//! Invalidates the events referencing an origin, e.g. after the
+		//! origin has been updated in place
+		void invalidateOrigin(const std::string &originID);
+
+		//! Re-indexes all invalidated events
+		void update();
+
+		void clear();
+
+		//! Returns the event referencing an origin or nullptr
+		EventInformation *findByOrigin(const std::string &originID) const;
+
+		//! Returns the event referencing a focal mechanism or nullptr
+		EventInformation *findByFocalMechanism(const std::string &fmID) const;
+
+		/**
+		 * @brief Returns all events an origin might match either by
+		 *        time and location or by picks, sorted by event ID.
+		 * Events which can't be matched, e.g. because they don't have
+		 * a preferred origin, are not returned.
+		 * @param origin The origin to be associated
+		 * @param pickCache Optional picks of the origin
+		 */
+		Candidates candidates(DataModel::Origin *origin,
+		                      const EventInformation::PickCache *pickCache) const;
+
+
+	private:
+		// Time bucket and latitude band
+		using Cell = std::pair<long, long>;
+		using KeyIndex = std::unordered_map<std::string, std::vector<EventInformation*>>;
+
+		// Station key and short phase name
+		using StationPhase = uint64_t;
+
+		struct PickTime {
+			EventInformation *info;
+			Core::Time        time;
+		};
+
+		using PickTimeIndex = std::unordered_map<StationPhase, std::vector<PickTime>>;
+		using PickMatches = std::unordered_map<EventInformation*, size_t>;
+
+		struct Entry {
+			EventInformationPtr       info;
+			bool                      pending{false};
+
+			// The state the entry was built from
+			bool                      matchable{false};
+			bool                      dirtyPickSet{false};
+
+			// The keys the event is indexed with
+			std::vector<std::string>  originIDs;
+			std::vector<std::string>  fmIDs;
+			std::vector<std::string>  pickIDs;
+			std::vector<std::string>  stations;
+			std::vector<StationPhase> stationPhases;
+			bool                      located{false};
+			Cell                      cell;
+		};
+
+		// An interned station code with the number of indexed events
+		// which have picks of that station
+		struct StationKey {
+			uint32_t key;
+			size_t   events;
+		};
+
+		void index(Entry &entry);
+		void unindex(Entry &entry);
+
+		void addPicks(Entry &entry);
+		void removePicks(Entry &entry);
+
+		//! Counts the matching picks of an origin for all events with an
+		//! indexed pick set. Events without matching picks are not added.
+		void countMatchingPicks(DataModel::Origin *origin,
+		                        const EventInformation::PickCache *pickCache,
+		                        PickMatches &matches) const;
+
+		Cell cell(double time, double latitude) const;
+
+		uint32_t acquireStation(const std::string &station);
+		void releaseStation(const std::string &station);
+
+		static StationPhase stationPhase(uint32_t station, char phase);
+		static void insert(KeyIndex &index, const std::string &key, EventInformation *info);
+		static void erase(KeyIndex &index, const std::string &key, EventInformation *info);
+		EventInformation *find(const KeyIndex &index, const std::string &key,
+		                       bool origin) const;
+
+
+	private:
+		EventInformation::Cache                         *_cache;
+		const Config                                    *_config;
+
+		std::unordered_map<EventInformation*, Entry>     _entries;
+		// Events to be re-indexed with the next update
+		std::vector<EventInformation*>                   _pending;
+		KeyIndex                                         _origins;
+		KeyIndex                                         _focalMechanisms;
+		// Pick ID -> events
+		KeyIndex                                         _picks;
+		// Station and phase -> event picks
+		PickTimeIndex                                    _pickTimes;
+		// Network and station code -> station key. Keys of stations
+		// without indexed picks are released and reused.
+		std::unordered_map<std::string, StationKey>      _stationKeys;
+		std::vector<uint32_t>                            _freeStationKeys;
+		std::map<Cell, std::vector<EventInformation*>>   _cells;
+		// Events with a preferred origin but a pick set that has
+		// not been built yet
+		std::vector<EventInformation*>                   _unknownPicks;
+};
+
+
+}
+}
+
+
+#endif
@@ -17,6 +17,7 @@
 #include <seiscomp/utils/misc.h>
 
 #include "eventinfo.h"
+#include "eventindex.h"
 #include "util.h"
 
 #include <algorithm>
@@ -127,6 +128,8 @@ void EventInformation::load(DatabaseQuery *q, EventPtr &e, const string &self) {
 		}
 	}
 
+	changed();
+
 	// Read journal for event
 	if ( q ) {
 		auto dbit = q->getJournal(event->publicID());
@@ -148,7 +151,31 @@ void EventInformation::load(DatabaseQuery *q, EventPtr &e, const string &self) {
 void EventInformation::loadAssocations(DataModel::DatabaseQuery *q) {
 	if ( q && event ) {
 		q->load(event.get());
+		changed();
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventInformation::setPickSet(const std::vector<std::string> &ids) {
+	pickIDs.clear();
+	picks.clear();
+
+	for ( const auto &id : ids ) {
+		pickIDs.insert(id);
+		if ( cfg->eventAssociation.maxMatchingPicksTimeDiff >= 0 ) {
+			PickPtr p = cache->get<Pick>(id);
+			if ( p ) {
+				insertPick(p.get());
+			}
+		}
 	}
+
+	dirtyPickSet = false;
+	changed();
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -190,6 +217,7 @@ size_t EventInformation::matchingPicks(DataModel::DatabaseQuery *q,
 		}
 
 		dirtyPickSet = false;
+		changed();
 	}
 
 	size_t matches = 0;
@@ -235,29 +263,16 @@ size_t EventInformation::matchingPicks(DataModel::DatabaseQuery *q,
 				continue;
 			}
 
-			string id = p->waveformID().networkCode() + "." +
-			            p->waveformID().stationCode();
-
-			char code = ' ';
-			try {
-				code = Util::getShortPhaseName(p->phaseHint().code());
-			}
-			catch ( ... ) {}
+			char code = Private::shortPhaseName(p.get());
 
-			auto range = picks.equal_range(id);
+			auto range = picks.equal_range(Private::stationID(p.get()));
 			int hit = 0, cnt = 0;
 			for ( auto it = range.first; it != range.second; ++it ) {
-				Pick *cmp = it->second.get();
-				char cmpCode = ' ';
-				try {
-					cmpCode = Util::getShortPhaseName(cmp->phaseHint().code());
-				}
-				catch ( ... ) {}
-
-				if ( code != cmpCode ) {
+				if ( code != it->second.phase ) {
 					continue;
 				}
 
+				Pick *cmp = it->second.pick.get();
 				++cnt;
 				try {
 					double diff = fabs((double)(cmp->time().value() - p->time().value()));
@@ -307,6 +322,7 @@ bool EventInformation::associate(DataModel::Origin *o) {
 	if ( !event ) return false;
 
 	event->add(new OriginReference(o->publicID()));
+	changed();
 	for ( size_t i = 0; i < o->arrivalCount(); ++i ) {
 		if ( !o->arrival(i) ) {
 			continue;
@@ -342,6 +358,7 @@ bool EventInformation::associate(DataModel::FocalMechanism *fm) {
 	}
 
 	event->add(new FocalMechanismReference(fm->publicID()));
+	changed();
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -526,7 +543,17 @@ bool EventInformation::setEventOpComment(DataModel::JournalEntry *e, string &err
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void EventInformation::insertPick(Pick *p) {
-	string id = p->waveformID().networkCode() + "." + p->waveformID().stationCode();
-	picks.insert({ id, p });
+	picks.insert({ Private::stationID(p), { p, Private::shortPhaseName(p) } });
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventInformation::changed() {
+	if ( index ) {
+		index->invalidate(this);
+	}
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -27,16 +27,20 @@
 #include "constraints.h"
 #include "config.h"
 
+#include <cstdint>
 #include <list>
 #include <set>
 #include <map>
 #include <string>
+#include <vector>
 
 
 namespace Seiscomp {
 namespace Client {
 
 
+class EventIndex;
+
 DEFINE_SMARTPOINTER(EventInformation);
 
 struct EventInformation : public Seiscomp::Core::BaseObject {
@@ -66,6 +70,10 @@ struct EventInformation : public Seiscomp::Core::BaseObject {
 
 	void loadAssocations(DataModel::DatabaseQuery *q);
 
+	//! Sets the pick set from the pick IDs of the weighted arrivals of all
+	//! associated origins, e.g. loaded in bulk from the database
+	void setPickSet(const std::vector<std::string> &ids);
+
 	//! Returns the number of matching picks
 	size_t matchingPicks(DataModel::DatabaseQuery *q, DataModel::Origin *o,
 	                     const PickCache *cache);
@@ -82,10 +90,22 @@ struct EventInformation : public Seiscomp::Core::BaseObject {
 
 	void insertPick(DataModel::Pick *p);
 
+	//! Tells the event index that the references, the preferred origin
+	//! or the pick set have changed
+	void changed();
+
 	Cache                                 *cache;
 	Config                                *cfg;
 
-	typedef std::multimap<std::string, DataModel::PickPtr> PickAssociation;
+	//! A pick of the event with the pre-decoded short phase name of its
+	//! phase hint
+	struct StationPick {
+		DataModel::PickPtr pick;
+		char               phase;
+	};
+
+	//! Picks by station, see Private::stationID
+	typedef std::multimap<std::string, StationPick> PickAssociation;
 	bool                                   created{false};
 	std::set<std::string>                  pickIDs;
 	PickAssociation                        picks;
@@ -99,6 +119,9 @@ struct EventInformation : public Seiscomp::Core::BaseObject {
 
 	bool                                   aboutToBeRemoved{false};
 	bool                                   dirtyPickSet{false};
+
+	//! The index of the event cache if the event is cached
+	EventIndex                            *index{nullptr};
 };
 
 
@@ -0,0 +1,337 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT SCEVENT
+#include <seiscomp/logging/log.h>
+#include <seiscomp/datamodel/comment.h>
+#include <seiscomp/datamodel/eventdescription.h>
+#include <seiscomp/datamodel/focalmechanismreference.h>
+#include <seiscomp/datamodel/originreference.h>
+#include <seiscomp/utils/timer.h>
+#include <seiscomp/private/objectloader.h>
+
+#include "eventloader.h"
+
+#include <algorithm>
+#include <sstream>
+
+
+#define _T(name) q->driver()->convertColumnName(name)
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+using namespace std;
+using namespace Seiscomp;
+using namespace Seiscomp::DataModel;
+using namespace Seiscomp::Client;
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventLoader::EventLoader(EventInformation::Cache *cache, const Config *cfg)
+: _cache(cache), _config(cfg) {}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool EventLoader::load(DatabaseQuery *q, const TimeWindows &windows) {
+	clear();
+
+	if ( !q ) {
+		return false;
+	}
+
+	TimeWindows merged(windows);
+	std::sort(merged.begin(), merged.end(),
+	          [](const Core::TimeWindow &a, const Core::TimeWindow &b) {
+		return a.startTime() < b.startTime();
+	});
+
+	for ( const auto &window : merged ) {
+		if ( !_windows.empty() && window.startTime() <= _windows.back().endTime() ) {
+			if ( window.endTime() > _windows.back().endTime() ) {
+				_windows.back().setEndTime(window.endTime());
+			}
+		}
+		else {
+			_windows.push_back(window);
+		}
+	}
+
+	Util::StopWatch timer;
+
+	for ( const auto &window : _windows ) {
+		if ( !loadWindow(q, window) ) {
+			clear();
+			return false;
+		}
+	}
+
+	SEISCOMP_DEBUG("Loaded %zu events in %zu time window(s) from database in %fs",
+	               _entries.size(), _windows.size(), double(timer.elapsed()));
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool EventLoader::load(DatabaseQuery *q, const Core::TimeWindow &window) {
+	return load(q, TimeWindows{window});
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void EventLoader::clear() {
+	_windows.clear();
+	_entries.clear();
+	_picks.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool EventLoader::covers(const Core::TimeWindow &window) const {
+	for ( const auto &loaded : _windows ) {
+		if ( loaded.startTime() <= window.startTime()
+		  && loaded.endTime() >= window.endTime() ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+EventLoader::Entries EventLoader::events(const Core::TimeWindow &window) const {
+	Entries result;
+
+	for ( const auto &entry : _entries ) {
+		try {
+			const Core::Time &time = entry.preferredOrigin->time().value();
+			if ( time >= window.startTime() && time <= window.endTime() ) {
+				result.push_back(entry);
+			}
+		}
+		catch ( Core::ValueException & ) {}
+	}
+
+	return result;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool EventLoader::loadWindow(DatabaseQuery *q, const Core::TimeWindow &window) {
+	const string from = eventsFrom(q, window);
+	map<string, Event*> events;
+	map<string, Origin*> origins;
+	size_t first = _entries.size();
+
+	// Events
+	for ( auto it = q->getObjectIterator("select PEvent." + _T("publicID") + ",Event.* " + from,
+	                                     Event::TypeInfo()); *it; ++it ) {
+		EventPtr event = Event::Cast(*it);
+		if ( !event || events.find(event->publicID()) != events.end() ) {
+			continue;
+		}
+
+		events[event->publicID()] = event.get();
+		_entries.push_back({ event, nullptr, {} });
+	}
+
+	if ( events.empty() ) {
+		return true;
+	}
+
+	// Preferred origins
+	Private::readObjects(q, "select POrigin." + _T("publicID") + ",Origin.* " + from,
+	                     Origin::TypeInfo(), [&](PublicObject *object, bool) {
+		Origin *origin = Origin::Cast(object);
+		if ( !origin ) {
+			return;
+		}
+
+		origins[origin->publicID()] = origin;
+		_cache->feed(origin);
+
+		for ( auto e = _entries.begin() + first; e != _entries.end(); ++e ) {
+			if ( e->event->preferredOriginID() == origin->publicID() ) {
+				e->preferredOrigin = origin;
+			}
+		}
+	});
+
+	// Event children as loaded by DatabaseQuery::load(Event*)
+	loadChildren<OriginReference>(
+		q, "select OriginReference.*,PEvent." + _T("publicID") + " as parentID " + from +
+		   "join OriginReference on OriginReference._parent_oid=Event._oid",
+		events
+	);
+	loadChildren<FocalMechanismReference>(
+		q, "select FocalMechanismReference.*,PEvent." + _T("publicID") + " as parentID " + from +
+		   "join FocalMechanismReference on FocalMechanismReference._parent_oid=Event._oid",
+		events
+	);
+	loadChildren<EventDescription>(
+		q, "select EventDescription.*,PEvent." + _T("publicID") + " as parentID " + from +
+		   "join EventDescription on EventDescription._parent_oid=Event._oid",
+		events
+	);
+	loadChildren<Comment>(
+		q, "select Comment.*,PEvent." + _T("publicID") + " as parentID " + from +
+		   "join Comment on Comment._parent_oid=Event._oid",
+		events
+	);
+
+	// Arrivals and magnitudes of the preferred origins
+	loadChildren<Arrival>(
+		q, "select Arrival.*,POrigin." + _T("publicID") + " as parentID " + from +
+		   "join Arrival on Arrival._parent_oid=Origin._oid",
+		origins
+	);
+	loadChildren<Magnitude>(
+		q, "select PMagnitude." + _T("publicID") + ",Magnitude.*,"
+		   "POrigin." + _T("publicID") + " as parentID " + from +
+		   "join Magnitude on Magnitude._parent_oid=Origin._oid "
+		   "join PublicObject as PMagnitude on PMagnitude._oid=Magnitude._oid",
+		origins
+	);
+
+	// The pick set of all associated origins, see
+	// EventInformation::matchingPicks
+	const string arrivals =
+		"join OriginReference on OriginReference._parent_oid=Event._oid "
+		"join PublicObject as PAssociated on PAssociated." + _T("publicID") + "=OriginReference." + _T("originID") + " "
+		"join Arrival on Arrival._parent_oid=PAssociated._oid"
+		" and (Arrival." + _T("weight") + ">0 or Arrival." + _T("weight") + " is null) ";
+
+	map<string, vector<string>*> pickIDs;
+	for ( auto e = _entries.begin() + first; e != _entries.end(); ++e ) {
+		pickIDs[e->event->publicID()] = &e->pickIDs;
+	}
+
+	auto *db = q->driver();
+	string query = "select PEvent." + _T("publicID") + " as parentID,"
+	               "Arrival." + _T("pickID") + " as pickID " + from + arrivals;
+	if ( !db->beginQuery(query.c_str()) ) {
+		SEISCOMP_ERROR("Failed to query the picks of events");
+		return false;
+	}
+
+	while ( db->fetchRow() ) {
+		auto parentIdx = db->findColumn("parentID");
+		auto pickIdx = db->findColumn("pickID");
+		if ( parentIdx < 0 || pickIdx < 0 ) {
+			continue;
+		}
+
+		auto it = pickIDs.find(db->getRowFieldString(parentIdx));
+		if ( it != pickIDs.end() ) {
+			it->second->push_back(db->getRowFieldString(pickIdx));
+		}
+	}
+
+	db->endQuery();
+
+	if ( _config->eventAssociation.maxMatchingPicksTimeDiff >= 0 ) {
+		// Picks are compared by time, so the picks are needed as well
+		Private::readObjects(
+			q,
+			"select distinct PPick." + _T("publicID") + ",Pick.* " + from + arrivals +
+			"join PublicObject as PPick on PPick." + _T("publicID") + "=Arrival." + _T("pickID") + " "
+			"join Pick on Pick._oid=PPick._oid",
+			Pick::TypeInfo(), [&](PublicObject *object, bool) {
+			Pick *pick = Pick::Cast(object);
+			if ( !pick ) {
+				return;
+			}
+
+			_picks.push_back(pick);
+			_cache->feed(pick);
+		});
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+string EventLoader::eventsFrom(DatabaseQuery *q, const Core::TimeWindow &window) const {
+	ostringstream oss;
+	oss << "from Event "
+	       "join PublicObject as PEvent on PEvent._oid=Event._oid "
+	       "join PublicObject as POrigin on POrigin." << _T("publicID") << "=Event." << _T("preferredOriginID") << " "
+	       "join Origin on Origin._oid=POrigin._oid"
+	       " and Origin." << _T("time_value") << ">='" << q->toString(window.startTime()) << "'"
+	       " and Origin." << _T("time_value") << "<='" << q->toString(window.endTime()) << "' ";
+	return oss.str();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+template <typename T, typename P>
+size_t EventLoader::loadChildren(DatabaseQuery *q, const string &query,
+                                 const map<string, P*> &parents) {
+	auto *db = q->driver();
+	size_t count = 0;
+
+	for ( auto it = q->getObjectIterator(query, T::TypeInfo()); *it; ++it ) {
+		T *child = T::Cast(*it);
+		if ( !child ) {
+			continue;
+		}
+
+		auto idx = db->findColumn("parentID");
+		if ( idx < 0 ) {
+			continue;
+		}
+
+		auto parent = parents.find(db->getRowFieldString(idx));
+		if ( parent == parents.end() ) {
+			continue;
+		}
+
+		// Children which are present already are rejected
+		if ( parent->second->add(child) ) {
+			++count;
+		}
+	}
+
+	return count;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
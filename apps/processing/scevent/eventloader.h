@@ -0,0 +1,110 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#ifndef SEISCOMP_APPLICATIONS_EVENTLOADER_H__
+#define SEISCOMP_APPLICATIONS_EVENTLOADER_H__
+
+
+#include <seiscomp/core/timewindow.h>
+
+#include "eventinfo.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace Seiscomp {
+namespace Client {
+
+
+/**
+ * @brief Bulk loader of the events within time windows.
+ *
+ * Loading an event from the database one by one requires the event, its
+ * children, the preferred origin with arrivals and magnitudes and all
+ * associated origins with their arrivals to build the pick set, which are
+ * several queries per event and per associated origin. The loader fetches
+ * all that for all events of a time window with one query per table
+ * instead and keeps the results until the next load.
+ *
+ * Events are selected by the time of their preferred origin as with
+ * DatabaseQuery::getEvents.
+ */
+class EventLoader {
+	public:
+		struct Entry {
+			DataModel::EventPtr      event;
+			DataModel::OriginPtr     preferredOrigin;
+			//! The IDs of the picks of the arrivals with positive or
+			//! without weight of all associated origins
+			std::vector<std::string> pickIDs;
+		};
+
+		using Entries = std::vector<Entry>;
+		using TimeWindows = std::vector<Core::TimeWindow>;
+
+	public:
+		EventLoader(EventInformation::Cache *cache, const Config *cfg);
+
+	public:
+		//! Loads the events of all time windows. Overlapping time windows
+		//! are merged. Previously loaded events are released.
+		bool load(DataModel::DatabaseQuery *q, const TimeWindows &windows);
+		bool load(DataModel::DatabaseQuery *q, const Core::TimeWindow &window);
+
+		void clear();
+
+		//! Returns whether a time window has been loaded completely
+		bool covers(const Core::TimeWindow &window) const;
+
+		//! Returns the loaded events with a preferred origin within the
+		//! time window, ordered by load order
+		Entries events(const Core::TimeWindow &window) const;
+
+		//! Number of loaded events
+		size_t size() const { return _entries.size(); }
+
+
+	private:
+		bool loadWindow(DataModel::DatabaseQuery *q, const Core::TimeWindow &window);
+
+		//! The common from and join clause selecting the events of a time
+		//! window, Event and Origin refer to the event and its preferred
+		//! origin
+		std::string eventsFrom(DataModel::DatabaseQuery *q,
+		                       const Core::TimeWindow &window) const;
+
+		//! Loads objects of a type with the publicID of their parent,
+		//! returned as column parentID, and adds them to the parent
+		template <typename T, typename P>
+		size_t loadChildren(DataModel::DatabaseQuery *q, const std::string &query,
+		                    const std::map<std::string, P*> &parents);
+
+
+	private:
+		EventInformation::Cache       *_cache;
+		const Config                  *_config;
+		TimeWindows                    _windows;
+		Entries                        _entries;
+		// Keeps the picks registered as long as the events are loaded
+		std::vector<DataModel::PickPtr> _picks;
+};
+
+
+}
+}
+
+
+#endif
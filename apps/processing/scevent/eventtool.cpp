@@ -719,8 +719,8 @@ void EventTool::handleMessage(Core::Message *msg) {
 	_originBlackList.clear();
 
 	// Lock the entire association process and all the supporting data
-	// structures. Only tryToAssociate will also lock this mutex from
-	// within the REST API thread.
+	// structures. Only handleTimeout and tryToAssociate from within the
+	// REST API thread will also lock this mutex.
 	scoped_lock l(_associationMutex);
 
 	Application::handleMessage(msg);
@@ -814,6 +814,28 @@ void EventTool::handleMessage(Core::Message *msg) {
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void EventTool::handleTimeout() {
+	scoped_lock l(_associationMutex);
+
+	// The events of the database are loaded at most once for all delayed
+	// origins, as soon as the first origin does not match a cached event
+	_eventPrefetchWindows.clear();
+	if ( query() ) {
+		for ( const auto &delayed : _delayBuffer ) {
+			Origin *org = Origin::Cast(delayed.obj.get());
+			if ( org ) {
+				try {
+					_eventPrefetchWindows.push_back(
+						Core::TimeWindow(
+							org->time().value() - _config.eventAssociation.eventTimeBefore,
+							org->time().value() + _config.eventAssociation.eventTimeAfter
+						)
+					);
+				}
+				catch ( Core::ValueException & ) {}
+			}
+		}
+	}
+
 	// First pass: decrease delay time and try to associate
 	for ( auto it = _delayBuffer.begin(); it != _delayBuffer.end(); ) {
 		it->timeout -= DELAY_CHECK_INTERVAL;
@@ -879,6 +901,9 @@ void EventTool::handleTimeout() {
 			++it;
 	}
 
+	_eventPrefetchWindows.clear();
+	_prefetchedEvents.clear();
+
 	// Third pass: check pending event updates
 	for ( auto it = _delayEventBuffer.begin(); it != _delayEventBuffer.end(); ) {
 		it->timeout -= DELAY_CHECK_INTERVAL;
@@ -938,6 +963,7 @@ void EventTool::cleanUpEventCache() {
 		if ( it->second->aboutToBeRemoved ) {
 			SEISCOMP_DEBUG("... remove event %s from cache",
 			               it->second->event->publicID().c_str());
+			_eventIndex.remove(it->second.get());
 			_events.erase(it++);
 		}
 		else
@@ -1050,6 +1076,9 @@ void EventTool::addObject(const string &parentID, Object* object) {
 			cacheEvent(info);
 		}
 
+		// The reference has been added to the event already
+		_eventIndex.invalidate(info.get());
+
 		org = _cache.get<Origin>(ref->originID());
 
 		auto it = _adds.find(TodoEntry(org));
@@ -1086,6 +1115,9 @@ void EventTool::addObject(const string &parentID, Object* object) {
 			cacheEvent(info);
 		}
 
+		// The reference has been added to the event already
+		_eventIndex.invalidate(info.get());
+
 		fm = _cache.get<FocalMechanism>(fm_ref->focalMechanismID());
 
 		auto it = _adds.find(TodoEntry(fm));
@@ -1150,6 +1182,9 @@ void EventTool::updateObject(const std::string &parentID, Object* object) {
 				return;
 			}
 		}
+		// The origin has been updated in place, time and location of the
+		// events preferring it might have changed
+		_eventIndex.invalidateOrigin(org->publicID());
 		_updates.insert(TodoEntry(org));
 		_realUpdates.insert(TodoEntry(org));
 		SEISCOMP_DEBUG("* queued updated origin %s (%d/%lu)",
@@ -1263,11 +1298,13 @@ void EventTool::removeObject(const string &parentID, Object* object) {
 		}
 		else if ( !info->event ) {
 			info->dirtyPickSet = true;
+			_eventIndex.invalidate(info.get());
 			SEISCOMP_ERROR("event %s for OriginReference not found", parentID.c_str());
 			return;
 		}
 
 		info->dirtyPickSet = true;
+		_eventIndex.invalidate(info.get());
 
 		if ( info->event->originReferenceCount() == 0 ) {
 			SEISCOMP_DEBUG("%s: last origin reference removed, remove event",
@@ -1292,6 +1329,7 @@ void EventTool::removeObject(const string &parentID, Object* object) {
 			info->event->setPreferredMagnitudeID("");
 			info->preferredOrigin = nullptr;
 			info->preferredMagnitude = nullptr;
+			_eventIndex.invalidate(info.get());
 			Notifier::Enable();
 			// Select the preferred origin again among all remaining origins
 			updatePreferredOrigin(info.get());
@@ -1717,6 +1755,7 @@ bool EventTool::handleJournalEntry(DataModel::JournalEntry *entry) {
 				else {
 					Notifier::Enable();
 					sourceInfo->event->removeOriginReference(org->publicID());
+					_eventIndex.invalidate(sourceInfo.get());
 
 					// Remove all focal mechanism references that
 					// used this origin as trigger
@@ -1742,6 +1781,7 @@ bool EventTool::handleJournalEntry(DataModel::JournalEntry *entry) {
 						sourceInfo->event->setPreferredMagnitudeID("");
 						sourceInfo->preferredOrigin = nullptr;
 						sourceInfo->preferredMagnitude = nullptr;
+						_eventIndex.invalidate(sourceInfo.get());
 						// Select the preferred origin again among all remaining origins
 						updatePreferredOrigin(sourceInfo.get());
 					}
@@ -1805,6 +1845,7 @@ bool EventTool::handleJournalEntry(DataModel::JournalEntry *entry) {
 						Notifier::SetEnabled(true);
 						if ( info->event->removeOriginReference(org->publicID()) )
 							info->dirtyPickSet = true;
+						_eventIndex.invalidate(info.get());
 
 						// Remove all focal mechanism references that
 						// used this origin as trigger
@@ -1833,6 +1874,7 @@ bool EventTool::handleJournalEntry(DataModel::JournalEntry *entry) {
 							info->event->setPreferredMagnitudeID("");
 							info->preferredOrigin = nullptr;
 							info->preferredMagnitude = nullptr;
+							_eventIndex.invalidate(info.get());
 							// Select the preferred origin again among all remaining origins
 							updatePreferredOrigin(info.get());
 
@@ -2006,13 +2048,28 @@ EventInformationPtr EventTool::associateOrigin(Seiscomp::DataModel::Origin *orig
 		SEISCOMP_DEBUG("... search for origin's %s event in database", origin->publicID().c_str());
 
 		if ( query() ) {
-			// Look for events in a certain timewindow around the origintime
-			DatabaseIterator it = query()->getEvents(startTime, endTime);
+			// Look for events in a certain timewindow around the origintime.
+			// The events, their associations and pick sets are loaded in
+			// bulk, for delayed origins possibly already in advance.
+			Core::TimeWindow window(startTime, endTime);
+			EventLoader loader(&_cache, &_config);
+			const EventLoader *fetchedEvents = &_prefetchedEvents;
+
+			if ( !_prefetchedEvents.covers(window) ) {
+				if ( !_eventPrefetchWindows.empty() ) {
+					_eventPrefetchWindows.push_back(window);
+					_prefetchedEvents.load(query(), _eventPrefetchWindows);
+					_eventPrefetchWindows.clear();
+				}
 
-			std::vector<EventPtr> fetchedEvents;
-			for ( ; *it; ++it ) {
-				EventPtr e = Event::Cast(*it);
-				assert(e);
+				if ( !_prefetchedEvents.covers(window) ) {
+					loader.load(query(), window);
+					fetchedEvents = &loader;
+				}
+			}
+
+			for ( const auto &fetched : fetchedEvents->events(window) ) {
+				EventPtr e = fetched.event;
 
 				if ( isAgencyIDBlocked(objectAgencyID(e.get())) ) {
 					continue;
@@ -2024,16 +2081,13 @@ EventInformationPtr EventTool::associateOrigin(Seiscomp::DataModel::Origin *orig
 					continue;
 				}
 
-				fetchedEvents.push_back(e);
-			}
-
-			for ( size_t i = 0; i < fetchedEvents.size(); ++i ) {
 				// Load the eventinformation for this event
 				EventInformationPtr tmp = new EventInformation(
-					&_cache, &_config, query(), fetchedEvents[i], author()
+					&_cache, &_config, query(), e, author()
 				);
 				if ( tmp->valid() ) {
-					tmp->loadAssocations(query());
+					// The associations have been loaded along with the event
+					tmp->setPickSet(fetched.pickIDs);
 					MatchResult res = compare(tmp.get(), origin, pickCache);
 					if ( res > bestResult ) {
 						bestResult = res;
@@ -2449,8 +2503,10 @@ void EventTool::updatedFocalMechanism(FocalMechanism *focalMechanism, bool realF
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 EventTool::MatchResult EventTool::compare(EventInformation *info,
                                           Seiscomp::DataModel::Origin *origin,
-                                          const EventInformation::PickCache *cache) const {
-	size_t matchingPicks = info->matchingPicks(query(), origin, cache);
+                                          const EventInformation::PickCache *cache,
+                                          const size_t *indexedMatchingPicks) const {
+	size_t matchingPicks = indexedMatchingPicks ?
+		*indexedMatchingPicks : info->matchingPicks(query(), origin, cache);
 
 	MatchResult result = Nothing;
 
@@ -2600,12 +2656,16 @@ EventInformationPtr EventTool::findMatchingEvent(
 	MatchResult bestResult = Nothing;
 	EventInformationPtr bestInfo = nullptr;
 
-	for ( auto &[id, info] : _events ) {
+	// Only compare the events which can possibly match the origin
+	_eventIndex.update();
+	for ( auto &candidate : _eventIndex.candidates(origin, cache) ) {
+		EventInformation *info = candidate.info;
 		if ( info->event && isAgencyIDBlocked(objectAgencyID(info->event.get())) ) {
 			continue;
 		}
 
-		MatchResult res = compare(info.get(), origin, cache);
+		MatchResult res = compare(info, origin, cache,
+		                          candidate.pickSetIndexed ? &candidate.matchingPicks : nullptr);
 		if ( res > bestResult ) {
 			bestResult = res;
 			bestInfo = info;
@@ -2630,16 +2690,15 @@ EventInformationPtr EventTool::findMatchingEvent(
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 EventInformationPtr EventTool::findAssociatedEvent(DataModel::Origin *origin) {
-	for ( auto &[id, info] : _events ) {
-		if ( info->event->originReference(origin->publicID()) ) {
-			SEISCOMP_DEBUG("... feeding cache with event %s",
-			               info->event->publicID().c_str());
-			refreshEventCache(info);
-			return info;
-		}
+	_eventIndex.update();
+	EventInformationPtr info = _eventIndex.findByOrigin(origin->publicID());
+	if ( info ) {
+		SEISCOMP_DEBUG("... feeding cache with event %s",
+		               info->event->publicID().c_str());
+		refreshEventCache(info);
 	}
 
-	return nullptr;
+	return info;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -2648,16 +2707,15 @@ EventInformationPtr EventTool::findAssociatedEvent(DataModel::Origin *origin) {
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 EventInformationPtr EventTool::findAssociatedEvent(DataModel::FocalMechanism *fm) {
-	for ( auto &[id, info] : _events ) {
-		if ( info->event->focalMechanismReference(fm->publicID()) ) {
-			SEISCOMP_DEBUG("... feeding cache with event %s",
-			               info->event->publicID().c_str());
-			refreshEventCache(info);
-			return info;
-		}
+	_eventIndex.update();
+	EventInformationPtr info = _eventIndex.findByFocalMechanism(fm->publicID());
+	if ( info ) {
+		SEISCOMP_DEBUG("... feeding cache with event %s",
+		               info->event->publicID().c_str());
+		refreshEventCache(info);
 	}
 
-	return nullptr;
+	return info;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -2807,10 +2865,9 @@ Magnitude *EventTool::preferredMagnitude(Origin *origin) {
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 Event *EventTool::getEventForOrigin(const std::string &originID) {
-	for ( auto it = _events.begin(); it != _events.end(); ++it ) {
-		Event *evt = it->second->event.get();
-		if ( !evt ) continue;
-		if ( evt->originReference(originID) ) return evt;
+	_eventIndex.update();
+	if ( EventInformation *info = _eventIndex.findByOrigin(originID) ) {
+		return info->event.get();
 	}
 
 	return Event::Cast(query()->getEvent(originID));
@@ -2822,10 +2879,9 @@ Event *EventTool::getEventForOrigin(const std::string &originID) {
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 Event *EventTool::getEventForFocalMechanism(const std::string &fmID) {
-	for ( auto it = _events.begin(); it != _events.end(); ++it ) {
-		Event *evt = it->second->event.get();
-		if ( !evt ) continue;
-		if ( evt->focalMechanismReference(fmID) ) return evt;
+	_eventIndex.update();
+	if ( EventInformation *info = _eventIndex.findByFocalMechanism(fmID) ) {
+		return info->event.get();
 	}
 
 	return Event::Cast(query()->getEventForFocalMechanism(fmID));
@@ -2841,7 +2897,12 @@ void EventTool::cacheEvent(EventInformationPtr info) {
 	SEISCOMP_DEBUG("... caching event %s", info->event->publicID().c_str());
 
 	// Cache the complete event information
-	_events[info->event->publicID()] = info;
+	EventInformationPtr &cached = _events[info->event->publicID()];
+	if ( cached && cached != info ) {
+		_eventIndex.remove(cached.get());
+	}
+	cached = info;
+	_eventIndex.add(info.get());
 	refreshEventCache(info);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -2896,6 +2957,7 @@ EventInformationPtr EventTool::cachedEvent(const std::string &eventID) {
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool EventTool::removeCachedEvent(const std::string &eventID) {
 	if ( auto it = _events.find(eventID); it != _events.end() ) {
+		_eventIndex.remove(it->second.get());
 		_events.erase(it);
 		return true;
 	}
@@ -3011,6 +3073,7 @@ void EventTool::choosePreferred(EventInformation *info, Origin *origin,
 			needRegionNameUpdate = true;
 
 			info->preferredOrigin = origin;
+			_eventIndex.invalidate(info);
 			update = true;
 		}
 		else {
@@ -3563,6 +3626,7 @@ void EventTool::choosePreferred(EventInformation *info, Origin *origin,
 		needRegionNameUpdate = true;
 
 		info->preferredOrigin = origin;
+		_eventIndex.invalidate(info);
 
 		if ( mag ) {
 			if ( info->event->preferredMagnitudeID() != mag->publicID() ) {
@@ -4373,6 +4437,10 @@ bool EventTool::mergeEvents(EventInformation *target, EventInformation *source)
 			choosePreferred(target, fm.get());
 	}
 
+	// The references have been moved from the source to the target event
+	_eventIndex.invalidate(source);
+	_eventIndex.invalidate(target);
+
 	// Remove source event
 	SEISCOMP_INFO("%s: deleted", sourceEvent->publicID().c_str());
 	SEISCOMP_LOG(_infoChannel, "Delete event %s after merging",
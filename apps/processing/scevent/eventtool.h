@@ -31,6 +31,8 @@
 #include <thread>
 
 #include "eventinfo.h"
+#include "eventindex.h"
+#include "eventloader.h"
 #include "config.h"
 
 
@@ -107,7 +109,8 @@ class EventTool : public Application {
 		void updatedFocalMechanism(DataModel::FocalMechanism *, bool realFMUpdate);
 
 		MatchResult compare(EventInformation *info, DataModel::Origin *origin,
-		                    const EventInformation::PickCache *cache = nullptr) const;
+		                    const EventInformation::PickCache *cache = nullptr,
+		                    const size_t *indexedMatchingPicks = nullptr) const;
 
 		EventInformationPtr createEvent(DataModel::Origin *origin);
 		EventInformationPtr findMatchingEvent(DataModel::Origin *origin,
@@ -249,6 +252,10 @@ class EventTool : public Application {
 		ScoreProcessorPtr             _score;
 
 		EventMap                      _events;
+		mutable EventIndex            _eventIndex{&_cache, &_config};
+		// Events loaded in advance for the delayed origins
+		EventLoader                   _prefetchedEvents{&_cache, &_config};
+		EventLoader::TimeWindows      _eventPrefetchWindows;
 		DataModel::EventParametersPtr _ep;
 		DataModel::JournalingPtr      _journal;
 
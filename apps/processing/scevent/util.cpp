@@ -17,11 +17,13 @@
 
 #include <seiscomp/core/strings.h>
 #include <seiscomp/datamodel/origin.h>
+#include <seiscomp/datamodel/pick.h>
 #include <seiscomp/datamodel/focalmechanism.h>
 #include <seiscomp/datamodel/magnitude.h>
 #include <seiscomp/datamodel/event.h>
 #include <seiscomp/datamodel/databasearchive.h>
 #include <seiscomp/seismology/regions.h>
+#include <seiscomp/utils/misc.h>
 
 #define SEISCOMP_COMPONENT SCEVENT
 #include <seiscomp/logging/log.h>
@@ -288,6 +290,29 @@ double arrivalWeight(const DataModel::Arrival *arr, double defaultWeight) {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+string stationID(const DataModel::Pick *pick) {
+	return pick->waveformID().networkCode() + "." + pick->waveformID().stationCode();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+char shortPhaseName(const DataModel::Pick *pick) {
+	try {
+		return Util::getShortPhaseName(pick->phaseHint().code());
+	}
+	catch ( ... ) {}
+
+	return ' ';
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 int stationCount(const DataModel::Magnitude *mag) {
 	try {
@@ -26,6 +26,7 @@ namespace Seiscomp {
 namespace DataModel {
 
 class Arrival;
+class Pick;
 class Origin;
 class FocalMechanism;
 class Event;
@@ -58,6 +59,11 @@ std::string allocateEventID(DataModel::DatabaseArchive *,
 std::string region(const DataModel::Origin *origin);
 
 double arrivalWeight(const DataModel::Arrival *arr, double defaultWeight=1.);
+
+//! Returns the network and station code of a pick as NET.STA
+std::string stationID(const DataModel::Pick *pick);
+//! Returns the short phase name of the phase hint of a pick or ' '
+char shortPhaseName(const DataModel::Pick *pick);
 int stationCount(const DataModel::Magnitude *mag);
 int modePriority(const DataModel::Origin *origin);
 int modePriority(const DataModel::FocalMechanism *fm);
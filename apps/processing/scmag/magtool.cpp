@@ -171,6 +171,15 @@ bool hasHigherPriority(const DataModel::Amplitude *candidate,
 }
 
 
+// Station magnitudes of streams which are considered equivalent
+// (see equivalent()) share the same key
+std::string stationMagnitudeKey(const std::string &type,
+                                const DataModel::WaveformStreamID &wfid) {
+	return type + ' ' + wfid.networkCode() + '.' + wfid.stationCode() + '.' +
+	       wfid.channelCode().substr(0, 2);
+}
+
+
 //#define INVALID_MAG std::numeric_limits<double>::quiet_NaN()
 #define INVALID_MAG 0
 #define _T(name) db->convertColumnName(name)
@@ -319,6 +328,15 @@ void MagTool::setMinimumArrivalWeight(double w) {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void MagTool::setThreadCount(size_t n) {
+	_threadCount = n;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool MagTool::init(const MagnitudeTypes &mags, const Core::TimeSpan &expiry,
                    bool allowReprocessing, bool staticUpdate,
@@ -411,6 +429,7 @@ bool MagTool::init(const MagnitudeTypes &mags, const Core::TimeSpan &expiry,
 	}
 
 	SEISCOMP_INFO("Magnitude types to calculate:\n%s", logMagTypes.c_str());
+	_workers.start(_threadCount);
 	SEISCOMP_INFO("Magnitude types - averaging methods:\n%s", logMagAverageTypes.c_str());
 	SEISCOMP_INFO("Summary magnitude enabled:                         %s",
 	              _summaryMagnitudeEnabled?"yes":"no");
@@ -465,6 +484,7 @@ bool MagTool::init(const MagnitudeTypes &mags, const Core::TimeSpan &expiry,
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void MagTool::done() {
+	_workers.stop();
 	SEISCOMP_INFO("Shutting down MagTool\n - database accesses while runtime: %lu", (unsigned long)_dbAccesses);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -476,16 +496,8 @@ void MagTool::done() {
 DataModel::StationMagnitude *MagTool::getStationMagnitude(
         DataModel::Origin *origin,
         const DataModel::WaveformStreamID &wfid,
-        const string &type, double value, bool update) const {
-	StaMag *mag = nullptr;
-
-	for ( size_t i = 0; i < origin->stationMagnitudeCount(); ++i ) {
-		StaMag *stamag = origin->stationMagnitude(i);
-		if ( equivalent(stamag->waveformID(), wfid) && stamag->type() == type ) {
-			mag = stamag;
-			break;
-		}
-	}
+        const string &type, double value, bool update) {
+	StaMag *mag = findStationMagnitude(origin, wfid, type);
 
 	if ( !update && mag ) {
 		return nullptr;
@@ -545,7 +557,9 @@ DataModel::StationMagnitude *MagTool::getStationMagnitude(
 				origin->publicID().c_str(),
 				mag->parent()->publicID().c_str());
 		}
-		origin->add(mag);
+		if ( origin->add(mag) ) {
+			indexStationMagnitude(origin, mag);
+		}
 	}
 
 	//mag->setAmplitudeID(ampl->publicID());
@@ -561,15 +575,8 @@ DataModel::StationMagnitude *MagTool::getStationMagnitude(
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 DataModel::Magnitude *MagTool::getMagnitude(DataModel::Origin *origin,
                                             const std::string &type,
-                                            bool *newInstance) const {
-	DataModel::Magnitude *mag = nullptr;
-	for ( size_t i = 0; i < origin->magnitudeCount(); ++i ) {
-		NetMag *nmag = origin->magnitude(i);
-		if ( nmag->type() == type ) {
-			mag = nmag;
-			break;
-		}
-	}
+                                            bool *newInstance) {
+	DataModel::Magnitude *mag = findMagnitude(origin, type);
 
 	if ( !mag ) {
 		if ( SCCoreApp->hasCustomPublicIDPattern() ) {
@@ -594,7 +601,9 @@ DataModel::Magnitude *MagTool::getMagnitude(DataModel::Origin *origin,
 		ci.setAuthor(SCCoreApp->author());
 		mag->setCreationInfo(ci);
 		mag->setType(type);
-		origin->add(mag);
+		if ( origin->add(mag) ) {
+			indexMagnitude(origin, mag);
+		}
 
 		if ( newInstance ) {
 			*newInstance = true;
@@ -647,7 +656,7 @@ DataModel::Magnitude *MagTool::getMagnitude(DataModel::Origin *origin,
 DataModel::Magnitude *MagTool::getMagnitude(DataModel::Origin *origin,
                                             const string &type,
                                             double value,
-                                            bool* newInstance) const {
+                                            bool* newInstance) {
 	bool tmpNewInstance;
 	NetMag *mag = getMagnitude(origin, type, &tmpNewInstance);
 	if ( mag ) {
@@ -671,14 +680,200 @@ DataModel::Magnitude *MagTool::getMagnitude(DataModel::Origin *origin,
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+MagTool::MagnitudeIndex *MagTool::magnitudeIndex(DataModel::Origin *origin) {
+	// Only cached origins are indexed, the index entry is released when
+	// the origin leaves the cache
+	if ( !_objectCache.contains(origin) ) {
+		return nullptr;
+	}
+
+	auto &index = _magnitudeIndex[origin];
+	index.origin = origin;
+
+	// Station and network magnitudes are only appended by scmag but
+	// notifiers of other clients can add, remove or replace them as
+	// well. Hence the index is checked against the count and the last
+	// magnitude of the origin.
+	size_t count = origin->stationMagnitudeCount();
+	const StaMag *last = count ? origin->stationMagnitude(count-1) : nullptr;
+	if ( count != index.stationMagnitudeCount || last != index.lastStationMagnitude ) {
+		index.stationMagnitudes.clear();
+		for ( size_t i = 0; i < count; ++i ) {
+			StaMag *stamag = origin->stationMagnitude(i);
+			// The first one wins as with a linear search
+			index.stationMagnitudes.emplace(
+				stationMagnitudeKey(stamag->type(), stamag->waveformID()), stamag
+			);
+		}
+
+		index.stationMagnitudeCount = count;
+		index.lastStationMagnitude = last;
+	}
+
+	count = origin->magnitudeCount();
+	const NetMag *lastMag = count ? origin->magnitude(count-1) : nullptr;
+	if ( count != index.magnitudeCount || lastMag != index.lastMagnitude ) {
+		index.magnitudes.clear();
+		for ( size_t i = 0; i < count; ++i ) {
+			NetMag *netmag = origin->magnitude(i);
+			index.magnitudes.emplace(netmag->type(), netmag);
+		}
+
+		index.magnitudeCount = count;
+		index.lastMagnitude = lastMag;
+	}
+
+	return &index;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DataModel::StationMagnitude *MagTool::findStationMagnitude(
+        DataModel::Origin *origin,
+        const DataModel::WaveformStreamID &wfid,
+        const string &type) {
+	auto *index = magnitudeIndex(origin);
+	if ( index ) {
+		auto it = index->stationMagnitudes.find(stationMagnitudeKey(type, wfid));
+		if ( it == index->stationMagnitudes.end() ) {
+			return nullptr;
+		}
+
+		// Magnitudes might have been updated in place
+		if ( it->second->type() == type && equivalent(it->second->waveformID(), wfid) ) {
+			return it->second;
+		}
+
+		index->stationMagnitudeCount = 0;
+		index->lastStationMagnitude = nullptr;
+	}
+
+	for ( size_t i = 0; i < origin->stationMagnitudeCount(); ++i ) {
+		StaMag *stamag = origin->stationMagnitude(i);
+		if ( equivalent(stamag->waveformID(), wfid) && stamag->type() == type ) {
+			return stamag;
+		}
+	}
+
+	return nullptr;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+DataModel::Magnitude *MagTool::findMagnitude(DataModel::Origin *origin,
+                                             const string &type) {
+	auto *index = magnitudeIndex(origin);
+	if ( index ) {
+		auto it = index->magnitudes.find(type);
+		if ( it == index->magnitudes.end() ) {
+			return nullptr;
+		}
+
+		if ( it->second->type() == type ) {
+			return it->second;
+		}
+
+		index->magnitudeCount = 0;
+		index->lastMagnitude = nullptr;
+	}
+
+	for ( size_t i = 0; i < origin->magnitudeCount(); ++i ) {
+		NetMag *nmag = origin->magnitude(i);
+		if ( nmag->type() == type ) {
+			return nmag;
+		}
+	}
+
+	return nullptr;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void MagTool::indexStationMagnitude(DataModel::Origin *origin,
+                                    DataModel::StationMagnitude *mag) {
+	auto it = _magnitudeIndex.find(origin);
+	if ( it == _magnitudeIndex.end() ) {
+		return;
+	}
+
+	// Extend the index only if it was up to date before, otherwise
+	// it will be rebuilt with the next lookup
+	auto &index = it->second;
+	size_t count = origin->stationMagnitudeCount();
+	if ( count != index.stationMagnitudeCount + 1
+	  || origin->stationMagnitude(count-1) != mag
+	  || (count > 1 ? origin->stationMagnitude(count-2) : nullptr) != index.lastStationMagnitude ) {
+		return;
+	}
+
+	index.stationMagnitudes.emplace(stationMagnitudeKey(mag->type(), mag->waveformID()), mag);
+	index.stationMagnitudeCount = count;
+	index.lastStationMagnitude = mag;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void MagTool::indexMagnitude(DataModel::Origin *origin,
+                             DataModel::Magnitude *mag) {
+	auto it = _magnitudeIndex.find(origin);
+	if ( it == _magnitudeIndex.end() ) {
+		return;
+	}
+
+	auto &index = it->second;
+	size_t count = origin->magnitudeCount();
+	if ( count != index.magnitudeCount + 1
+	  || origin->magnitude(count-1) != mag
+	  || (count > 1 ? origin->magnitude(count-2) : nullptr) != index.lastMagnitude ) {
+		return;
+	}
+
+	index.magnitudes.emplace(mag->type(), mag);
+	index.magnitudeCount = count;
+	index.lastMagnitude = mag;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool MagTool::computeStationMagnitude(const DataModel::Amplitude *ampl,
                                       const DataModel::Origin *origin,
                                       const DataModel::SensorLocation *loc,
                                       double distance, double depth,
                                       MagnitudeList &mags) {
+	return computeStationMagnitude(_processors, fetchParams(ampl), ampl,
+	                               origin, loc, distance, depth, mags);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool MagTool::computeStationMagnitude(const ProcessorList &processors,
+                                      Util::KeyValues *params,
+                                      const DataModel::Amplitude *ampl,
+                                      const DataModel::Origin *origin,
+                                      const DataModel::SensorLocation *loc,
+                                      double distance, double depth,
+                                      MagnitudeList &mags) const {
 	const string &atype = ampl->type();
-	auto itp = _processors.equal_range(atype);
+	auto itp = processors.equal_range(atype);
 
 	double period = 0;
 	try {
@@ -692,8 +887,6 @@ bool MagTool::computeStationMagnitude(const DataModel::Amplitude *ampl,
 	}
 	catch ( ... ) {}
 
-	Util::KeyValues *params = fetchParams(ampl);
-
 	for ( auto it = itp.first; it != itp.second; ++it ) {
 		Settings settings(
 			SCCoreApp->configModuleName(),
@@ -1428,6 +1621,17 @@ bool MagTool::processOrigin(DataModel::Origin* origin) {
 
 	PickStreamMap pickStreamMap;
 
+	struct StationMagnitudeJob {
+		const DataModel::Amplitude *amplitude;
+		DataModel::SensorLocation  *loc;
+		double                      distance;
+		Util::KeyValues            *params{nullptr};
+		ProcessorList               processors;
+		MagnitudeList               mags;
+	};
+
+	vector<StationMagnitudeJob> jobs;
+
 	// find associated picks and amplitudes:
 	for ( int i = 0, arrivalCount = origin->arrivalCount(); i < arrivalCount; ++i ) {
 		const DataModel::Arrival *arr = origin->arrival(i);
@@ -1557,27 +1761,63 @@ bool MagTool::processOrigin(DataModel::Origin* origin) {
 			}
 		}
 
-		// Compute magnitudes of used amplitudes
 		for ( auto &amp_it : usedAmplitudes ) {
-			const DataModel::Amplitude *ampl  = amp_it.second;
-			const string &aid   = ampl->publicID();
-
-			MagnitudeList mags;
+			jobs.push_back({ amp_it.second, loc, distance });
+		}
+	}
 
-			if ( !computeStationMagnitude(ampl, origin, loc, distance, depth, mags) ) {
-				continue;
+	auto addStationMagnitudes = [&](const DataModel::Amplitude *ampl,
+	                                const MagnitudeList &mags) {
+		for ( const auto &entry : mags ) {
+			StaMagPtr stationMagnitude = getStationMagnitude(origin, ampl->waveformID(), entry.proc->type(), entry.value, _allowReprocessing);
+			if ( stationMagnitude ) {
+				entry.proc->finalizeMagnitude(stationMagnitude.get());
+				stationMagnitude->setAmplitudeID(ampl->publicID());
+				stationMagnitude->setPassedQC(entry.passedQC);
+				magTypes.insert(entry.proc->type());
 			}
+		}
+	};
 
-			for ( const auto &entry : mags ) {
-				StaMagPtr stationMagnitude = getStationMagnitude(origin, ampl->waveformID(), entry.proc->type(), entry.value, _allowReprocessing);
-				if ( stationMagnitude ) {
-					entry.proc->finalizeMagnitude(stationMagnitude.get());
-					stationMagnitude->setAmplitudeID(aid);
-					stationMagnitude->setPassedQC(entry.passedQC);
-					magTypes.insert(entry.proc->type());
+	// Compute magnitudes of used amplitudes
+	if ( _workers.threadCount() > 1 && jobs.size() > 1 ) {
+		// Processors are configured per station with setup() and are
+		// not shared between threads. Each amplitude gets its own
+		// instances which are kept until finalizeMagnitude has been
+		// called. Station parameters are cached by fetchParams and must
+		// be looked up before.
+		for ( auto &job : jobs ) {
+			job.params = fetchParams(job.amplitude);
+			auto itp = _processors.equal_range(job.amplitude->type());
+			for ( auto it = itp.first; it != itp.second; ++it ) {
+				MagnitudeProcessorPtr proc = MagnitudeProcessorFactory::Create(it->second->type().c_str());
+				if ( proc ) {
+					job.processors.emplace(it->first, proc);
 				}
 			}
 		}
+
+		_workers.run(jobs.size(), [this, origin, depth, &jobs](size_t from, size_t to) {
+			for ( size_t i = from; i < to; ++i ) {
+				auto &job = jobs[i];
+				computeStationMagnitude(job.processors, job.params, job.amplitude,
+				                        origin, job.loc, job.distance, depth,
+				                        job.mags);
+			}
+		});
+
+		// Add the station magnitudes in the same order as a single thread
+		for ( auto &job : jobs ) {
+			addStationMagnitudes(job.amplitude, job.mags);
+		}
+	}
+	else {
+		for ( auto &job : jobs ) {
+			if ( computeStationMagnitude(job.amplitude, origin, job.loc,
+			                             job.distance, depth, job.mags) ) {
+				addStationMagnitudes(job.amplitude, job.mags);
+			}
+		}
 	}
 
 	// loop over all magnitude types found so far
@@ -2193,26 +2433,16 @@ bool MagTool::feed(DataModel::Amplitude* amp, bool update, bool remove) {
 				staMag->setAmplitudeID(amp->publicID());
 				staMag->setPassedQC(entry.passedQC);
 
-				const string &mtype = staMag->type();
-				bool newInstance;
-				NetMagPtr netMag = getMagnitude(origin.get(), mtype, &newInstance);
-				if ( netMag ) {
-					computeNetworkMagnitude(origin.get(), mtype, netMag);
-					if ( !newInstance ) {
-						DataModel::touch(netMag.get());
-						netMag->update();
-						SCCoreApp->logObject(outputMagLog, Core::Time::UTC());
-						SC_FMT_DEBUG("U NETMAG {}: {}", netMag->publicID(), netMag->magnitude().value());
-					}
-
-					SEISCOMP_INFO("feed(Amplitude): %s Magnitude '%s' for Origin '%s'",
-					              newInstance?"created":"updated",
-					              mtype.c_str(),
-					              origin->publicID().c_str());
-
-					dumpOrigin(origin.get());
-					updateSummary = true;
+				// The network magnitude is computed once for all
+				// amplitudes of a batch, see flush()
+				auto pending = std::find_if(_pendingUpdates.begin(), _pendingUpdates.end(),
+				                            [&origin](const PendingUpdate &p) {
+					return p.origin == origin;
+				});
+				if ( pending == _pendingUpdates.end() ) {
+					pending = _pendingUpdates.insert(_pendingUpdates.end(), { origin, {} });
 				}
+				pending->types.insert(staMag->type());
 			}
 		}
 		else {
@@ -2344,6 +2574,48 @@ bool MagTool::feed(DataModel::Pick *pick) {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void MagTool::flush() {
+	PendingUpdates pendingUpdates;
+	pendingUpdates.swap(_pendingUpdates);
+
+	for ( auto &[origin, types] : pendingUpdates ) {
+		bool updateSummary = false;
+
+		for ( const auto &mtype : types ) {
+			bool newInstance;
+			NetMagPtr netMag = getMagnitude(origin.get(), mtype, &newInstance);
+			if ( !netMag ) {
+				continue;
+			}
+
+			computeNetworkMagnitude(origin.get(), mtype, netMag);
+			if ( !newInstance ) {
+				DataModel::touch(netMag.get());
+				netMag->update();
+				SCCoreApp->logObject(outputMagLog, Core::Time::UTC());
+				SC_FMT_DEBUG("U NETMAG {}: {}", netMag->publicID(), netMag->magnitude().value());
+			}
+
+			SEISCOMP_INFO("feed(Amplitude): %s Magnitude '%s' for Origin '%s'",
+			              newInstance?"created":"updated",
+			              mtype.c_str(),
+			              origin->publicID().c_str());
+
+			updateSummary = true;
+		}
+
+		if ( updateSummary ) {
+			dumpOrigin(origin.get());
+			computeSummaryMagnitude(origin.get());
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void MagTool::remove(DataModel::PublicObject *po) {
 	_objectCache.remove(po);
@@ -2365,6 +2637,8 @@ void MagTool::publicObjectRemoved(DataModel::PublicObject* po) {
 	OriginMap::iterator it = _orgs.find(po->publicID());
 	if ( it != _orgs.end() ) _orgs.erase(it);
 
+	_magnitudeIndex.erase(static_cast<const DataModel::Origin*>(DataModel::Origin::Cast(po)));
+
 	DataModel::Notifier::SetEnabled(saveState);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -20,6 +20,8 @@
 #include <string>
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include <seiscomp/datamodel/publicobjectcache.h>
 #include <seiscomp/datamodel/eventparameters.h>
@@ -32,6 +34,7 @@
 #include <seiscomp/datamodel/magnitude.h>
 #include <seiscomp/processing/magnitudeprocessor.h>
 #include <seiscomp/client/application.h>
+#include <seiscomp/private/workerpool.h>
 
 namespace Seiscomp {
 namespace Magnitudes {
@@ -106,6 +109,10 @@ class MagTool {
 
 		void setMinimumArrivalWeight(double);
 
+		// Number of threads to compute the station magnitudes of an
+		// origin with. Must be set before init.
+		void setThreadCount(size_t);
+
 		bool init(const MagnitudeTypes &mags, const Core::TimeSpan& expiry,
 		          bool allowReprocessing, bool staticUpdate, bool keepWeights, double warning);
 		void done();
@@ -114,6 +121,11 @@ class MagTool {
 		bool feed(DataModel::Pick*);
 		bool feed(DataModel::Amplitude*amp, bool update, bool remove);
 
+		// Recomputes the network and summary magnitudes of all origins
+		// which received new station magnitudes from amplitudes fed since
+		// the last call. Should be called after each batch of amplitudes.
+		void flush();
+
 		void remove(DataModel::PublicObject *po);
 
 
@@ -131,6 +143,32 @@ class MagTool {
 
 		typedef std::vector<MagnitudeEntry> MagnitudeList;
 
+		// Amplitude type -> magnitude processors
+		using ProcessorList = std::multimap<std::string, Processing::MagnitudeProcessorPtr>;
+
+		// Station magnitudes of an origin by type and stream and network
+		// magnitudes by type. The index is rebuilt whenever the magnitudes
+		// of the origin have been modified by someone else.
+		struct MagnitudeIndex {
+			DataModel::OriginPtr                                      origin;
+			size_t                                                    stationMagnitudeCount{0};
+			const DataModel::StationMagnitude                        *lastStationMagnitude{nullptr};
+			size_t                                                    magnitudeCount{0};
+			const DataModel::Magnitude                               *lastMagnitude{nullptr};
+			std::unordered_map<std::string, DataModel::StationMagnitude*> stationMagnitudes;
+			std::unordered_map<std::string, DataModel::Magnitude*>        magnitudes;
+		};
+
+		typedef std::unordered_map<const DataModel::Origin*, MagnitudeIndex> MagnitudeIndexMap;
+
+		// Magnitude types of an origin to be recomputed with the next flush
+		struct PendingUpdate {
+			DataModel::OriginPtr  origin;
+			std::set<std::string> types;
+		};
+
+		typedef std::vector<PendingUpdate> PendingUpdates;
+
 		void publicObjectRemoved(DataModel::PublicObject*);
 
 		bool _feed(DataModel::Amplitude*, bool update);
@@ -141,23 +179,48 @@ class MagTool {
 		DataModel::StationMagnitude*
 		getStationMagnitude(DataModel::Origin*,
 		                    const DataModel::WaveformStreamID&,
-		                    const std::string&, double, bool) const;
+		                    const std::string&, double, bool);
 
 		// like _getStationMagnitude
 		DataModel::Magnitude*
 		getMagnitude(DataModel::Origin*, const std::string&,
-		             double, bool* newInstance = NULL) const;
+		             double, bool* newInstance = NULL);
 
 		// like _getStationMagnitude, but no update will be made
 		DataModel::Magnitude*
 		getMagnitude(DataModel::Origin*, const std::string&,
-		             bool* newInstance = NULL) const;
+		             bool* newInstance = NULL);
+
+		// Returns the up to date magnitude index of an origin or nullptr
+		// if the origin is not cached
+		MagnitudeIndex *magnitudeIndex(DataModel::Origin*);
+
+		DataModel::StationMagnitude*
+		findStationMagnitude(DataModel::Origin*,
+		                     const DataModel::WaveformStreamID&,
+		                     const std::string&);
+		DataModel::Magnitude*
+		findMagnitude(DataModel::Origin*, const std::string&);
+
+		// Registers a magnitude which has just been added to an origin
+		void indexStationMagnitude(DataModel::Origin*, DataModel::StationMagnitude*);
+		void indexMagnitude(DataModel::Origin*, DataModel::Magnitude*);
 
 		bool computeStationMagnitude(const DataModel::Amplitude*,
 		                             const DataModel::Origin*,
 		                             const DataModel::SensorLocation *,
 		                              double, double, MagnitudeList&);
 
+		// Computes the station magnitudes with the given processors and
+		// station parameters. Does not modify any member and can be
+		// called concurrently for disjoint processors.
+		bool computeStationMagnitude(const ProcessorList &processors,
+		                             Util::KeyValues *params,
+		                             const DataModel::Amplitude*,
+		                             const DataModel::Origin*,
+		                             const DataModel::SensorLocation *,
+		                             double, double, MagnitudeList&) const;
+
 		bool computeNetworkMagnitude(DataModel::Origin*, const std::string&, DataModel::MagnitudePtr);
 		bool computeSummaryMagnitude(DataModel::Origin*);
 
@@ -197,7 +260,6 @@ class MagTool {
 
 	private:
 		using MagnitudeTypeList = Processing::MagnitudeProcessorFactory::ServiceNames;
-		using ProcessorList = std::multimap<std::string, Processing::MagnitudeProcessorPtr>;
 		using TypeList = std::set<std::string>;
 		using ParameterMap = std::map<std::string, Util::KeyValuesPtr>;
 		using ConsiderUnusedArrivals = std::map<std::string, bool>;
@@ -228,6 +290,12 @@ class MagTool {
 
 		ConsiderUnusedArrivals _considerUnusedArrivals;
 
+		MagnitudeIndexMap      _magnitudeIndex;
+		PendingUpdates         _pendingUpdates;
+
+		size_t                 _threadCount{1};
+		Private::WorkerPool    _workers;
+
 	public:
 		Client::Application::ObjectLog *inputPickLog;
 		Client::Application::ObjectLog *inputAmpLog;
@@ -257,6 +257,15 @@ class MagToolApp : public Seiscomp::Client::Application {
 				_magtool.setMinimumArrivalWeight(configGetDouble("minimumArrivalWeight"));
 			} catch ( ... ) {}
 
+			try {
+				int threads = configGetInt("magnitudes.threads");
+				if ( threads < 1 ) {
+					SEISCOMP_ERROR("magnitudes.threads: expected a value >= 1");
+					return false;
+				}
+				_magtool.setThreadCount(static_cast<size_t>(threads));
+			} catch ( ... ) {}
+
 
 			try {
 				std::vector<std::string> averages = configGetStrings("magnitudes.average");
@@ -434,6 +443,8 @@ class MagToolApp : public Seiscomp::Client::Application {
 				for ( size_t i = 0; i < ep->amplitudeCount(); ++i )
 					_magtool.feed(ep->amplitude(i), false, false);
 
+				_magtool.flush();
+
 				for ( size_t i = 0; i < ep->originCount(); ++i ) {
 					OriginPtr org = ep->origin(i);
 					SEISCOMP_INFO("Processing origin %s", org->publicID().c_str());
@@ -457,6 +468,12 @@ class MagToolApp : public Seiscomp::Client::Application {
 		}
 
 		void handleTimeout() {
+			// Update the magnitudes of all amplitudes received since the
+			// last timeout
+			Notifier::Enable();
+			_magtool.flush();
+			Notifier::Disable();
+
 			// Send out all available notifiers
 			NotifierMessagePtr xmsg = Notifier::GetMessage();
 			if ( xmsg ) {
@@ -476,6 +493,10 @@ class MagToolApp : public Seiscomp::Client::Application {
 
 			// All message handling is done so lets continue
 			if ( !_interval || _sendImmediately ) {
+				Notifier::Enable();
+				_magtool.flush();
+				Notifier::Disable();
+
 				NotifierMessagePtr xmsg = Notifier::GetMessage();
 				if (xmsg) {
 					if ( !commandline().hasOption("test") )
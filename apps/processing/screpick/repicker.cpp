@@ -24,7 +24,9 @@
 #include <seiscomp/io/recordstream.h>
 #include <seiscomp/utils/keyvalues.h>
 #include <seiscomp/utils/misc.h>
+#include <seiscomp/utils/timer.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include "repicker.h"
@@ -34,6 +36,16 @@ using namespace std;
 using namespace Seiscomp::DataModel;
 
 
+namespace {
+
+
+// Time windows of a stream which are less apart are requested at once
+const double MaxRequestGap = 60.0;
+
+
+}
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 namespace Seiscomp {
 namespace Applications {
@@ -63,6 +75,18 @@ void Repicker::Settings::accept(SettingsLinker &linker) {
 	            anyPhase, "Picker",
 	            "any-phase,A", "Allow any phase to be repicked and not just P."
 	);
+
+	linker & cfg(threads, "threads");
+	linker & cli(
+		threads, "Picker",
+		"threads", "Number of threads to run the pickers."
+	);
+
+	linker & cfg(batchSize, "batchSize");
+	linker & cli(
+		batchSize, "Picker",
+		"batch-size", "Number of picks whose data are requested at once."
+	);
 	linker & cliSwitch(
 	            formatted, "Output", "formatted,f",
 	            "Use formatted XML output. Otherwise XML is unformatted."
@@ -124,6 +148,16 @@ bool Repicker::validateParameters() {
 		return false;
 	}
 
+	if ( _settings.threads < 1 ) {
+		SEISCOMP_ERROR("threads: expected a value >= 1");
+		return false;
+	}
+
+	if ( _settings.batchSize < 1 ) {
+		SEISCOMP_ERROR("batchSize: expected a value >= 1");
+		return false;
+	}
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -137,13 +171,17 @@ bool Repicker::init() {
 		return false;
 	}
 
-	_picker = Processing::PickerFactory::Create(_settings.pickerInterface);
-	if ( !_picker ) {
+	// Each pick is processed by a picker of its own, check the interface
+	// once here
+	if ( !Processing::PickerPtr(Processing::PickerFactory::Create(_settings.pickerInterface)) ) {
 		SEISCOMP_ERROR("Picker interface '%s' is not available.",
 		               _settings.pickerInterface.c_str());
 		return false;
 	}
 
+	indexStationSetups();
+	_workers.start(static_cast<size_t>(_settings.threads));
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -177,280 +215,458 @@ bool Repicker::run() {
 
 	std::list<PickPtr> repickedPicks;
 
-	for ( size_t i = 0; i < ep->pickCount() && !isExitRequested(); ++i ) {
-		auto pick = ep->pick(i);
-		const auto &wid = pick->waveformID();
-
-		if ( !_settings.anyPhase ) {
-			try {
-				if ( Util::getShortPhaseName(pick->phaseHint().code()) != 'P' ) {
-					SEISCOMP_WARNING("%s: invalid phase '%s'",
-					                 pick->publicID(), pick->phaseHint().code());
-					++failedPicks;
-					continue;
-				}
-			}
-			catch ( ... ) {
-				// No set phase is OK
-			}
-		}
+	// Data read from stdin can be requested only once
+	size_t batchSize = static_cast<size_t>(_settings.batchSize);
+	if ( recordStreamURL() == "file://-" ) {
+		batchSize = std::max(batchSize, ep->pickCount());
+	}
 
-		_picker->reset();
-		_picker->setTrigger(pick->time().value());
+	Util::StopWatch timer;
+	std::vector<Job> jobs;
 
-		bool setupDisabled = false;
-		ConfigStation *config = nullptr;
+	for ( size_t i = 0; i < ep->pickCount() && !isExitRequested(); ) {
+		jobs.clear();
 
-		for ( size_t cs = 0; cs < configModule()->configStationCount(); ++cs ) {
-			auto configStation = configModule()->configStation(cs);
-			if ( configStation->networkCode() != wid.networkCode() ) {
+		for ( ; i < ep->pickCount() && jobs.size() < batchSize; ++i ) {
+			Job job;
+			job.pick = ep->pick(i);
+			if ( !prepare(job) ) {
+				++failedPicks;
 				continue;
 			}
 
-			if ( configStation->stationCode() != wid.stationCode() ) {
-				continue;
-			}
+			jobs.push_back(std::move(job));
+		}
 
-			if ( !configStation->enabled() ) {
-				setupDisabled = true;
-			}
-			else {
-				config = configStation;
-				break;
-			}
+		if ( !fetchRecords(jobs) ) {
+			return false;
 		}
 
-		Util::KeyValues keys;
+		if ( isExitRequested() ) {
+			break;
+		}
 
-		if ( !config ) {
-			if ( setupDisabled ) {
-				SEISCOMP_WARNING("%s.%s: station setup is disabled, ignoring pick %s",
-				                 wid.networkCode(), wid.stationCode(),
-				                 pick->publicID());
+		_workers.run(jobs.size(), [this, &jobs](size_t from, size_t to) {
+			for ( size_t j = from; j < to; ++j ) {
+				repick(jobs[j]);
+			}
+		});
+
+		for ( auto &job : jobs ) {
+			if ( !applyResult(job) ) {
 				++failedPicks;
 				continue;
 			}
-		}
-		else {
-			auto setup = findSetup(config, name(), true);
-			if ( setup ) {
-				keys.init(ParameterSet::Find(setup->parameterSetID()));
+
+			if ( job.gotPick ) {
+				repickedPicks.push_back(job.pick);
 			}
+
+			++processedPicks;
 		}
 
-		Processing::Settings procSettings(
-			configModuleName(),
-			wid.networkCode(), wid.stationCode(),
-			wid.locationCode(), wid.channelCode(),
-			&configuration(), &keys
-		);
-
-		auto loc = Client::Inventory::Instance()->getSensorLocation(pick);
-		if ( !loc ) {
-			SEISCOMP_WARNING("%s: no sensor location found in inventory: %s.%s.%s",
-			                 pick->publicID(), wid.networkCode(),
-			                 wid.stationCode(), wid.locationCode());
-			++failedPicks;
-			continue;
+		SEISCOMP_INFO("Processed %zu of %zu picks, %.1f picks/s",
+		              processedPicks + failedPicks, ep->pickCount(),
+		              (processedPicks + failedPicks) / std::max(double(timer.elapsed()), 1E-6));
+	}
+
+	jobs.clear();
+
+	if ( isExitRequested() ) {
+		cerr << "Aborted processing" << endl;
+		return false;
+	}
+
+	double elapsed = std::max(double(timer.elapsed()), 1E-6);
+
+	cerr << "Processed picks: " << processedPicks << endl;
+	cerr << "Failed picks: " << failedPicks << endl;
+	cerr << "Repicked picks: " << repickedPicks.size() << endl;
+	cerr << "Picks/s: " << (processedPicks + failedPicks) / elapsed << endl;
+
+	if ( _settings.repickedOnly ) {
+		// Release parameter set to prevent debug output
+		ep = nullptr;
+
+		ep = new EventParameters;
+		for ( const auto &pick : repickedPicks ) {
+			ep->add(pick.get());
 		}
+	}
 
-		ThreeComponents tc;
-		getThreeComponents(tc, loc,
-		                   wid.channelCode().substr(0, 2).c_str(),
-		                   pick->time().value());
-
-		for ( size_t i = 0; i < 3; ++i ) {
-			if ( tc.comps[i] ) {
-				_picker->streamConfig(static_cast<Processing::WaveformProcessor::Component>(i)).init(
-					wid.networkCode(), wid.stationCode(),
-					wid.locationCode(), tc.comps[i]->code(),
-					pick->time().value()
-				);
-			}
+	ar.create("-");
+	ar.setFormattedOutput(_settings.formatted);
+	ar << ep;
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Repicker::indexStationSetups() {
+	_stationSetups.clear();
+
+	auto module = configModule();
+	if ( !module ) {
+		return;
+	}
+
+	for ( size_t cs = 0; cs < module->configStationCount(); ++cs ) {
+		auto configStation = module->configStation(cs);
+		auto &setup = _stationSetups[configStation->networkCode() + "." +
+		                             configStation->stationCode()];
+
+		if ( setup.config ) {
+			continue;
 		}
 
-		if ( !_picker->setup(procSettings) ) {
-			SEISCOMP_WARNING("%s: picker failed to initialize: %s (%f)",
-			                 pick->publicID(),
-			                 _picker->status().toString(),
-			                 _picker->statusValue());
-			++failedPicks;
+		if ( !configStation->enabled() ) {
+			setup.disabled = true;
 			continue;
 		}
 
-		Processing::Picker::Result pickResult;
-		bool gotPick = false;
+		setup.config = configStation;
+		setup.disabled = false;
 
-		_picker->setPublishFunction([&pickResult, &gotPick](const Processing::Picker *, const Processing::Picker::Result &r) {
-			pickResult = r;
-			gotPick = true;
-		});
+		auto stationSetup = findSetup(configStation, name(), true);
+		if ( stationSetup ) {
+			setup.keys.init(ParameterSet::Find(stationSetup->parameterSetID()));
+		}
+	}
 
-		_picker->computeTimeWindow();
+	SEISCOMP_DEBUG("Indexed the setups of %zu stations", _stationSetups.size());
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
-		if ( _picker->isFinished() ) {
-			SEISCOMP_WARNING("%s: picker finished already: %s (%f)",
-			                 pick->publicID(),
-			                 _picker->status().toString(),
-			                 _picker->statusValue());
-			++failedPicks;
-			continue;
-		}
 
-		auto rs = IO::RecordStream::Open(recordStreamURL().c_str());
-		if ( !rs ) {
-			SEISCOMP_ERROR("Failed to open recordstream: %s",
-			               recordStreamURL());
-			return false;
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Repicker::prepare(Job &job) {
+	auto pick = job.pick.get();
+	const auto &wid = pick->waveformID();
+
+	if ( !_settings.anyPhase ) {
+		try {
+			if ( Util::getShortPhaseName(pick->phaseHint().code()) != 'P' ) {
+				SEISCOMP_WARNING("%s: invalid phase '%s'",
+				                 pick->publicID(), pick->phaseHint().code());
+				return false;
+			}
 		}
+		catch ( ... ) {
+			// No set phase is OK
+		}
+	}
+
+	Util::KeyValues noKeys;
+	const Util::KeyValues *keys = &noKeys;
 
-		if ( !rs->setTimeWindow(_picker->timeWindow()) ) {
-			SEISCOMP_WARNING("%s: picker failed to set data time window",
+	auto it = _stationSetups.find(wid.networkCode() + "." + wid.stationCode());
+	if ( it != _stationSetups.end() ) {
+		if ( it->second.disabled ) {
+			SEISCOMP_WARNING("%s.%s: station setup is disabled, ignoring pick %s",
+			                 wid.networkCode(), wid.stationCode(),
 			                 pick->publicID());
-			++failedPicks;
-			continue;
+			return false;
 		}
 
-		switch ( _picker->usedComponent() ) {
-			case Processing::WaveformProcessor::Vertical:
-			case Processing::WaveformProcessor::FirstHorizontal:
-			case Processing::WaveformProcessor::SecondHorizontal:
-				// Add stream as indicated in the pick stream
-				rs->addStream(wid.networkCode(), wid.stationCode(),
-				              wid.locationCode(), wid.channelCode());
-				break;
-			case Processing::WaveformProcessor::Horizontal:
-				// Use both horizontals
-				if ( !tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent] ||
-				     !tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent] ) {
-					SEISCOMP_WARNING("%s: picker failed to initialize: meta data not found for two horizontals: %s.%s.%s.%s",
-					                 pick->publicID(),
-					                 _picker->status().toString(),
-					                 _picker->statusValue(),
-					                 wid.networkCode(), wid.stationCode(),
-					                 wid.locationCode(), wid.channelCode().substr(0, 2));
-					++failedPicks;
-					continue;
-				}
-				rs->addStream(wid.networkCode(),
-				              wid.stationCode(),
-				              wid.locationCode(),
-				              tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent]->code());
-				rs->addStream(wid.networkCode(),
-				              wid.stationCode(),
-				              wid.locationCode(),
-				              tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent]->code());
-				break;
-			case Processing::WaveformProcessor::Any:
-				// Use all three components
-				if ( !tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent] ||
-				     !tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent] ||
-				     !tc.comps[Processing::WaveformProcessor::VerticalComponent] ) {
-					SEISCOMP_WARNING("%s: picker failed to initialize: meta data not found for three components",
-					                 pick->publicID(),
-					                 _picker->status().toString(),
-					                 _picker->statusValue(),
-					                 wid.networkCode(), wid.stationCode(),
-					                 wid.locationCode(), wid.channelCode().substr(0, 2));
-					++failedPicks;
-					continue;
-				}
-				rs->addStream(wid.networkCode(),
-				              wid.stationCode(),
-				              wid.locationCode(),
-				              tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent]->code());
-				rs->addStream(wid.networkCode(),
-				              wid.stationCode(),
-				              wid.locationCode(),
-				              tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent]->code());
-				rs->addStream(wid.networkCode(),
-				              wid.stationCode(),
-				              wid.locationCode(),
-				              tc.comps[Processing::WaveformProcessor::VerticalComponent]->code());
-				break;
+		keys = &it->second.keys;
+	}
+
+	Processing::Settings procSettings(
+		configModuleName(),
+		wid.networkCode(), wid.stationCode(),
+		wid.locationCode(), wid.channelCode(),
+		&configuration(), keys
+	);
+
+	auto loc = Client::Inventory::Instance()->getSensorLocation(pick);
+	if ( !loc ) {
+		SEISCOMP_WARNING("%s: no sensor location found in inventory: %s.%s.%s",
+		                 pick->publicID(), wid.networkCode(),
+		                 wid.stationCode(), wid.locationCode());
+		return false;
+	}
+
+	job.picker = Processing::PickerFactory::Create(_settings.pickerInterface);
+	if ( !job.picker ) {
+		SEISCOMP_ERROR("Picker interface '%s' is not available.",
+		               _settings.pickerInterface.c_str());
+		return false;
+	}
+
+	auto picker = job.picker.get();
+	picker->setTrigger(pick->time().value());
+
+	ThreeComponents tc;
+	getThreeComponents(tc, loc,
+	                   wid.channelCode().substr(0, 2).c_str(),
+	                   pick->time().value());
+
+	for ( size_t i = 0; i < 3; ++i ) {
+		if ( tc.comps[i] ) {
+			picker->streamConfig(static_cast<Processing::WaveformProcessor::Component>(i)).init(
+				wid.networkCode(), wid.stationCode(),
+				wid.locationCode(), tc.comps[i]->code(),
+				pick->time().value()
+			);
 		}
+	}
 
-		while ( auto rec = rs->next() ) {
-			_picker->feed(rec);
-			if ( _picker->isFinished() ) {
-				break;
+	if ( !picker->setup(procSettings) ) {
+		SEISCOMP_WARNING("%s: picker failed to initialize: %s (%f)",
+		                 pick->publicID(),
+		                 picker->status().toString(),
+		                 picker->statusValue());
+		return false;
+	}
+
+	picker->computeTimeWindow();
+
+	if ( picker->isFinished() ) {
+		SEISCOMP_WARNING("%s: picker finished already: %s (%f)",
+		                 pick->publicID(),
+		                 picker->status().toString(),
+		                 picker->statusValue());
+		return false;
+	}
+
+	switch ( picker->usedComponent() ) {
+		case Processing::WaveformProcessor::Vertical:
+		case Processing::WaveformProcessor::FirstHorizontal:
+		case Processing::WaveformProcessor::SecondHorizontal:
+			// Add stream as indicated in the pick stream
+			job.channels.push_back(wid.channelCode());
+			break;
+		case Processing::WaveformProcessor::Horizontal:
+			// Use both horizontals
+			if ( !tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent] ||
+			     !tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent] ) {
+				SEISCOMP_WARNING("%s: picker failed to initialize: meta data not found for two horizontals: %s.%s.%s.%s",
+				                 pick->publicID(),
+				                 wid.networkCode(), wid.stationCode(),
+				                 wid.locationCode(), wid.channelCode().substr(0, 2));
+				return false;
 			}
-		}
+			job.channels.push_back(tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent]->code());
+			job.channels.push_back(tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent]->code());
+			break;
+		case Processing::WaveformProcessor::Any:
+			// Use all three components
+			if ( !tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent] ||
+			     !tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent] ||
+			     !tc.comps[Processing::WaveformProcessor::VerticalComponent] ) {
+				SEISCOMP_WARNING("%s: picker failed to initialize: meta data not found for three components: %s.%s.%s.%s",
+				                 pick->publicID(),
+				                 wid.networkCode(), wid.stationCode(),
+				                 wid.locationCode(), wid.channelCode().substr(0, 2));
+				return false;
+			}
+			job.channels.push_back(tc.comps[Processing::WaveformProcessor::FirstHorizontalComponent]->code());
+			job.channels.push_back(tc.comps[Processing::WaveformProcessor::SecondHorizontalComponent]->code());
+			job.channels.push_back(tc.comps[Processing::WaveformProcessor::VerticalComponent]->code());
+			break;
+	}
 
-		if ( _picker->status() != Processing::WaveformProcessor::Finished ) {
-			SEISCOMP_WARNING("%s: picker did not finish: %s (%f)",
-			                 pick->publicID(),
-			                 _picker->status().toString(),
-			                 _picker->statusValue());
-			++failedPicks;
-			continue;
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Repicker::fetchRecords(std::vector<Job> &jobs) {
+	struct Stream {
+		const WaveformStreamID *wid;
+		std::string             channelCode;
+		// The time windows of the jobs requesting the stream
+		std::vector<std::pair<Core::TimeWindow, size_t>> windows;
+	};
+
+	std::map<std::string, Stream> streams;
+
+	for ( size_t j = 0; j < jobs.size(); ++j ) {
+		const auto &wid = jobs[j].pick->waveformID();
+		for ( const auto &channelCode : jobs[j].channels ) {
+			auto &stream = streams[wid.networkCode() + "." + wid.stationCode() + "." +
+			                       wid.locationCode() + "." + channelCode];
+			stream.wid = &wid;
+			stream.channelCode = channelCode;
+			stream.windows.push_back({ jobs[j].picker->timeWindow(), j });
 		}
+	}
+
+	if ( streams.empty() ) {
+		return true;
+	}
 
-		if ( gotPick ) {
-			TimeQuantity time;
-			time.setValue(pickResult.time);
+	IO::RecordStreamPtr rs = IO::RecordStream::Open(recordStreamURL().c_str());
+	if ( !rs ) {
+		SEISCOMP_ERROR("Failed to open recordstream: %s",
+		               recordStreamURL());
+		return false;
+	}
 
-			if ( pickResult.timeLowerUncertainty > 0 ) {
-				time.setLowerUncertainty(pickResult.timeLowerUncertainty);
+	// Overlapping or close time windows of a stream are merged into one
+	// request
+	size_t requests = 0;
+	for ( auto &item : streams ) {
+		auto &stream = item.second;
+		std::sort(stream.windows.begin(), stream.windows.end(),
+		          [](const std::pair<Core::TimeWindow, size_t> &lhs,
+		             const std::pair<Core::TimeWindow, size_t> &rhs) {
+			return lhs.first.startTime() < rhs.first.startTime();
+		});
+
+		auto addRequest = [&](const Core::Time &start, const Core::Time &end) {
+			rs->addStream(stream.wid->networkCode(), stream.wid->stationCode(),
+			              stream.wid->locationCode(), stream.channelCode,
+			              start, end);
+			++requests;
+		};
+
+		Core::Time start = stream.windows.front().first.startTime();
+		Core::Time end = stream.windows.front().first.endTime();
+
+		for ( const auto &window : stream.windows ) {
+			if ( window.first.startTime() - end > Core::TimeSpan(MaxRequestGap) ) {
+				addRequest(start, end);
+				start = window.first.startTime();
+				end = window.first.endTime();
 			}
-			if ( pickResult.timeUpperUncertainty > 0 ) {
-				time.setUpperUncertainty(pickResult.timeUpperUncertainty);
+			else if ( window.first.endTime() > end ) {
+				end = window.first.endTime();
 			}
+		}
 
-			pick->setTime(time);
-			pick->setMethodID(_picker->methodID());
-			pick->setFilterID(_picker->filterID());
+		addRequest(start, end);
+	}
 
-			if ( pickResult.slowness ) {
-				pick->setHorizontalSlowness(RealQuantity(*pickResult.slowness));
-			}
+	size_t recordCount = 0;
+
+	while ( !isExitRequested() ) {
+		RecordPtr rec = rs->next();
+		if ( !rec ) {
+			break;
+		}
+
+		auto it = streams.find(rec->streamID());
+		if ( it == streams.end() ) {
+			continue;
+		}
 
-			if ( pickResult.backAzimuth ) {
-				pick->setBackazimuth(RealQuantity(*pickResult.backAzimuth));
+		// Decode the data once before the record is shared by the
+		// worker threads
+		if ( !rec->data() ) {
+			continue;
+		}
+
+		for ( const auto &window : it->second.windows ) {
+			if ( window.first.startTime() >= rec->endTime() ) {
+				break;
 			}
 
-			if ( pickResult.polarity ) {
-				switch ( *pickResult.polarity ) {
-					case Processing::Picker::POSITIVE:
-						pick->setPolarity(PickPolarity(POSITIVE));
-						break;
-					case Processing::Picker::NEGATIVE:
-						pick->setPolarity(PickPolarity(NEGATIVE));
-						break;
-					case Processing::Picker::UNDECIDABLE:
-						pick->setPolarity(PickPolarity(UNDECIDABLE));
-						break;
-				}
+			if ( window.first.endTime() <= rec->startTime() ) {
+				continue;
 			}
 
-			repickedPicks.push_back(pick);
+			jobs[window.second].records.push_back(rec);
 		}
 
-		++processedPicks;
+		++recordCount;
 	}
 
-	if ( isExitRequested() ) {
-		cerr << "Aborted processing" << endl;
+	SEISCOMP_DEBUG("Requested %zu time windows of %zu streams for %zu picks, "
+	               "received %zu records",
+	               requests, streams.size(), jobs.size(), recordCount);
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void Repicker::repick(Job &job) {
+	job.picker->setPublishFunction([&job](const Processing::Picker *, const Processing::Picker::Result &r) {
+		job.result = r;
+		job.gotPick = true;
+	});
+
+	for ( const auto &rec : job.records ) {
+		job.picker->feed(rec.get());
+		if ( job.picker->isFinished() ) {
+			break;
+		}
+	}
+
+	job.records.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Repicker::applyResult(Job &job) {
+	auto pick = job.pick.get();
+	auto picker = job.picker.get();
+
+	if ( picker->status() != Processing::WaveformProcessor::Finished ) {
+		SEISCOMP_WARNING("%s: picker did not finish: %s (%f)",
+		                 pick->publicID(),
+		                 picker->status().toString(),
+		                 picker->statusValue());
 		return false;
 	}
 
-	cerr << "Processed picks: " << processedPicks << endl;
-	cerr << "Failed picks: " << failedPicks << endl;
-	cerr << "Repicked picks: " << repickedPicks.size() << endl;
+	if ( !job.gotPick ) {
+		return true;
+	}
 
-	if ( _settings.repickedOnly ) {
-		// Release parameter set to prevent debug output
-		ep = nullptr;
+	const auto &pickResult = job.result;
 
-		ep = new EventParameters;
-		for ( const auto &pick : repickedPicks ) {
-			ep->add(pick.get());
-		}
+	TimeQuantity time;
+	time.setValue(pickResult.time);
+
+	if ( pickResult.timeLowerUncertainty > 0 ) {
+		time.setLowerUncertainty(pickResult.timeLowerUncertainty);
+	}
+	if ( pickResult.timeUpperUncertainty > 0 ) {
+		time.setUpperUncertainty(pickResult.timeUpperUncertainty);
 	}
 
-	ar.create("-");
-	ar.setFormattedOutput(_settings.formatted);
-	ar << ep;
+	pick->setTime(time);
+	pick->setMethodID(picker->methodID());
+	pick->setFilterID(picker->filterID());
+
+	if ( pickResult.slowness ) {
+		pick->setHorizontalSlowness(RealQuantity(*pickResult.slowness));
+	}
+
+	if ( pickResult.backAzimuth ) {
+		pick->setBackazimuth(RealQuantity(*pickResult.backAzimuth));
+	}
+
+	if ( pickResult.polarity ) {
+		switch ( *pickResult.polarity ) {
+			case Processing::Picker::POSITIVE:
+				pick->setPolarity(PickPolarity(POSITIVE));
+				break;
+			case Processing::Picker::NEGATIVE:
+				pick->setPolarity(PickPolarity(NEGATIVE));
+				break;
+			case Processing::Picker::UNDECIDABLE:
+				pick->setPolarity(PickPolarity(UNDECIDABLE));
+				break;
+		}
+	}
 
 	return true;
 }
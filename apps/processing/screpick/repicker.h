@@ -13,7 +13,15 @@
 
 
 #include <seiscomp/client/application.h>
+#include <seiscomp/datamodel/configstation.h>
+#include <seiscomp/datamodel/pick.h>
 #include <seiscomp/processing/picker.h>
+#include <seiscomp/utils/keyvalues.h>
+#include <seiscomp/private/workerpool.h>
+
+#include <map>
+#include <string>
+#include <vector>
 
 
 namespace Seiscomp {
@@ -38,6 +46,46 @@ class Repicker : public Client::Application {
 		bool run() override;
 
 
+	// ----------------------------------------------------------------------
+	//  Private methods
+	// ----------------------------------------------------------------------
+	private:
+		// The configuration of a station, the first enabled one if
+		// several exist
+		struct StationSetup {
+			DataModel::ConfigStation *config{nullptr};
+			bool                      disabled{false};
+			Util::KeyValues           keys;
+		};
+
+		// A pick to be repicked with its own picker instance
+		struct Job {
+			DataModel::PickPtr         pick;
+			Processing::PickerPtr      picker;
+			// The channels of the pick location to request
+			std::vector<std::string>   channels;
+			std::vector<RecordPtr>     records;
+			Processing::Picker::Result result;
+			bool                       gotPick{false};
+		};
+
+		void indexStationSetups();
+
+		//! Creates and sets up the picker of a job, returns false if the
+		//! pick cannot be repicked
+		bool prepare(Job &job);
+
+		//! Requests the data of all jobs with one record stream and
+		//! distributes the records to the jobs
+		bool fetchRecords(std::vector<Job> &jobs);
+
+		//! Feeds the records of a job, called by the worker threads
+		void repick(Job &job);
+
+		//! Checks the picker state and updates the pick
+		bool applyResult(Job &job);
+
+
 	// ----------------------------------------------------------------------
 	//  Private members
 	// ----------------------------------------------------------------------
@@ -48,12 +96,15 @@ class Repicker : public Client::Application {
 			std::string epFile;
 			bool        formatted{false};
 			bool        repickedOnly{false};
+			int         threads{1};
+			int         batchSize{1000};
 
 			void accept(SettingsLinker &linker) override;
 		};
 
-		Settings              _settings;
-		Processing::PickerPtr _picker;
+		Settings                            _settings;
+		std::map<std::string, StationSetup> _stationSetups;
+		Private::WorkerPool                 _workers;
 };
 
 
@@ -19,6 +19,7 @@
 #include <seiscomp/system/environment.h>
 
 #include <seiscomp/datamodel/amplitude.h>
+#include <seiscomp/datamodel/comment.h>
 #include <seiscomp/datamodel/event.h>
 #include <seiscomp/datamodel/focalmechanism.h>
 #include <seiscomp/datamodel/momenttensor.h>
@@ -29,6 +30,8 @@
 #include <seiscomp/io/archive/xmlarchive.h>
 #include <seiscomp/logging/log.h>
 #include <seiscomp/utils/files.h>
+#include <seiscomp/utils/timer.h>
+#include <seiscomp/private/objectloader.h>
 
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/device/file.hpp>
@@ -60,6 +63,14 @@ using PropertyIndex = Diff3::PropertyIndex;
 PropertyIndex CreationInfoIndex;
 
 
+// Maximum number of responses waiting to be parsed and waiting to be
+// dispatched
+const size_t MaxPendingResponses = 2;
+
+// Number of publicIDs per prefetch query
+const size_t PrefetchChunkSize = 500;
+
+
 OPT(Core::Time) getLastModificationTime(const CreationInfo &ci) {
 	try {
 		return ci.modificationTime();
@@ -502,6 +513,8 @@ bool App::init() {
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool App::run() {
 	if ( _ep.empty() ) {
+		_parser = thread(bind(&App::parseResponses, this));
+
 		for ( auto &client : _clients ) {
 			client->run();
 		}
@@ -546,6 +559,8 @@ bool App::run() {
 
 			const string &epID = ep->publicID();
 
+			prefetch(ep.get(), true, true);
+
 			for ( size_t i = 0; i < ep->pickCount(); ++i ) {
 				diffPO(ep->pick(i), epID, notifiers, logNode.get());
 			}
@@ -604,6 +619,8 @@ bool App::run() {
 			ar & NAMED_OBJECT("", notifiers);
 			ar & NAMED_OBJECT("", journals);
 			ar.close();
+
+			_prefetched.clear();
 		}
 
 		return true;
@@ -633,6 +650,17 @@ void App::done() {
 
 	// Wait for threads to terminate
 	if ( _ep.empty() ) {
+		{
+			lock_guard<mutex> l(_pipelineMutex);
+			_parserExit = true;
+		}
+		// Wakes up the parser and clients waiting for a free slot
+		_pipelineCondition.notify_all();
+
+		if ( _parser.joinable() ) {
+			_parser.join();
+		}
+
 		for ( auto client : _clients ) {
 			client->join();
 		}
@@ -650,12 +678,81 @@ void App::done() {
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 void App::feed(QLClient *client, IO::QuakeLink::Response *response) {
-	_clientPublishMutex.lock();
+	unique_lock<mutex> l(_pipelineMutex);
+	_pipelineCondition.wait(l, [this]() {
+		return _parserExit || _receivedResponses.size() < MaxPendingResponses;
+	});
+
+	if ( _parserExit ) {
+		return;
+	}
+
+	QLMessage msg;
+	msg.client = client;
+	msg.response = response;
+	_receivedResponses.push_back(std::move(msg));
+	l.unlock();
+
+	_pipelineCondition.notify_all();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void App::parseResponses() {
+	while ( true ) {
+		QLMessage msg;
+
+		{
+			unique_lock<mutex> l(_pipelineMutex);
+			_pipelineCondition.wait(l, [this]() {
+				return _parserExit || !_receivedResponses.empty();
+			});
+
+			if ( _parserExit ) {
+				break;
+			}
+
+			msg = std::move(_receivedResponses.front());
+			_receivedResponses.pop_front();
+		}
+
+		// Allow the clients to receive the next response while this one
+		// is parsed
+		_pipelineCondition.notify_all();
+
+		const IO::QuakeLink::Response *response = msg.response.get();
+		if ( !response->disposed && response->type == IO::QuakeLink::ctXML ) {
+			Util::StopWatch timer;
+			msg.parsed = load(msg.ep, msg.ej, response->data, response->gzip);
+			msg.parseTime = double(timer.elapsed());
+		}
+
+		int notificationID = msg.client->notificationID();
+
+		{
+			unique_lock<mutex> l(_pipelineMutex);
+			_pipelineCondition.wait(l, [this]() {
+				return _parserExit || _parsedResponses.size() < MaxPendingResponses;
+			});
+
+			if ( _parserExit ) {
+				break;
+			}
+
+			_parsedResponses.push_back(std::move(msg));
+		}
 
-	Client::Notification n(client->notificationID(), response);
-	if ( !_queue.push(n) ) {
-		_clientPublishMutex.unlock();
+		// Notify the main thread, the responses are dispatched in the
+		// order they have been queued
+		if ( !_queue.push(Client::Notification(notificationID)) ) {
+			break;
+		}
 	}
+
+	SEISCOMP_DEBUG("parser thread finished");
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -678,8 +775,20 @@ bool App::dispatchNotification(int type, Core::BaseObject *obj) {
 	}
 
 	auto client = _clients[index];
-	auto msg = IO::QuakeLink::Response::Cast(obj);
-	if ( !msg ) {
+
+	QLMessage msg;
+	{
+		lock_guard<mutex> l(_pipelineMutex);
+		if ( !_parsedResponses.empty() ) {
+			msg = std::move(_parsedResponses.front());
+			_parsedResponses.pop_front();
+		}
+	}
+
+	// Allow the parser to continue with the next response
+	_pipelineCondition.notify_all();
+
+	if ( !msg.response || msg.client != client ) {
 		SEISCOMP_ERROR("received invalid message from host '%s'",
 		               client->config()->host.c_str());
 		return true;
@@ -688,15 +797,13 @@ bool App::dispatchNotification(int type, Core::BaseObject *obj) {
 	if ( client->config()->delay > 0 ) {
 		SEISCOMP_INFO("Delaying message from %s for %d seconds",
 		              client->config()->host, client->config()->delay);
-		_qlDelayBuffer.push_back({ client, msg, client->config()->delay });
+		msg.timeout = client->config()->delay;
+		_qlDelayBuffer.push_back(std::move(msg));
 	}
 	else {
-		handleQLMessage(client, msg);
+		handleQLMessage(msg);
 	}
 
-	// Allow new responses
-	_clientPublishMutex.unlock();
-
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -705,12 +812,13 @@ bool App::dispatchNotification(int type, Core::BaseObject *obj) {
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-bool App::handleQLMessage(QLClient *client, const IO::QuakeLink::Response *msg) {
-	bool res = dispatchResponse(client, msg);
+bool App::handleQLMessage(const QLMessage &msg) {
+	bool res = dispatchResponse(msg);
 
 	// The cache is only maintained for one particular dispatch run because
 	// updates of all objects are not captured.
 	_cache.clear();
+	_prefetched.clear();
 
 	return res;
 }
@@ -720,7 +828,9 @@ bool App::handleQLMessage(QLClient *client, const IO::QuakeLink::Response *msg)
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg) {
+bool App::dispatchResponse(const QLMessage &message) {
+	QLClient *client = message.client;
+	const IO::QuakeLink::Response *msg = message.response.get();
 	const HostConfig *config = client->config();
 	const RoutingTable &routing = config->routingTable;
 	RoutingTable::const_iterator rt_it;
@@ -735,9 +845,6 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 		logNode = new LogNode(DataModel::EventParameters::TypeInfo().className(),
 		                      _baseSettings.logging.verbosity > 3 ? LogNode::DIFFERENCES : LogNode::OPERATIONS);
 
-	EventParametersPtr ep;
-	JournalingPtr ej;
-
 	// event remove message
 	if ( msg->disposed ) {
 		if ( msg->type != IO::QuakeLink::ctText ) {
@@ -755,7 +862,8 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 		return false;
 	}
 
-	if ( !load(ep, ej, msg->data, msg->gzip) ) {
+	// parsed by the parser thread which already logged errors
+	if ( !message.parsed ) {
 		return false;
 	}
 
@@ -763,6 +871,8 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 		return false;
 	}
 
+	EventParametersPtr ep = message.ep;
+	JournalingPtr ej = message.ej;
 	const string &epID = ep->publicID();
 
 	// check if routing for EventParameters exists
@@ -772,9 +882,24 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 		epRouting = rt_it->second;
 	}
 
+	bool diffPicks = !epRouting.empty() ||
+	                 routing.find(Pick::TypeInfo().className()) != routing.end();
+	bool diffAmplitudes = !epRouting.empty() ||
+	                      routing.find(Amplitude::TypeInfo().className()) != routing.end();
+
+	// Load the local picks and amplitudes at once rather than one by one
+	Util::StopWatch timer;
+	size_t prefetched = prefetch(ep.get(), diffPicks, diffAmplitudes);
+	double prefetchTime = double(timer.elapsed());
+
+	if ( isExitRequested() ) {
+		return false;
+	}
+
+	timer.restart();
+
 	// Picks
-	if ( !epRouting.empty() ||
-		 routing.find(Pick::TypeInfo().className()) != routing.end() ) {
+	if ( diffPicks ) {
 		for ( size_t i = 0; i < ep->pickCount(); ++i ) {
 			if ( isExitRequested() ) {
 				return false;
@@ -784,8 +909,7 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 	}
 
 	// Amplitudes
-	if ( !epRouting.empty() ||
-		 routing.find(Amplitude::TypeInfo().className()) != routing.end() ) {
+	if ( diffAmplitudes ) {
 		for ( size_t i = 0; i < ep->amplitudeCount(); ++i ) {
 			if ( isExitRequested() ) {
 				return false;
@@ -834,6 +958,8 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 		return false;
 	}
 
+	double diffTime = double(timer.elapsed());
+
 	// log diffs
 	if ( logNode.get() && logNode->childCount() ) {
 		stringstream ss;
@@ -847,6 +973,10 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 		}
 	}
 
+	timer.restart();
+
+	bool res = false;
+
 	if ( !_test ) {
 		if ( sendNotifiers(config->syncEventAttributes ? ep.get() : nullptr, notifiers, routing) ) {
 			if ( config->syncEventAttributes ) {
@@ -887,7 +1017,7 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 			}
 			client->setLastUpdate(msg->timestamp);
 			writeLastUpdates();
-			return true;
+			res = true;
 		}
 	}
 	else {
@@ -898,10 +1028,17 @@ bool App::dispatchResponse(QLClient *client, const IO::QuakeLink::Response *msg)
 		}
 		client->setLastUpdate(msg->timestamp);
 		writeLastUpdates();
-		return true;
+		res = true;
 	}
 
-	return false;
+	SEISCOMP_INFO("Processed message from host '%s': parse %.3fs, "
+	              "prefetch %.3fs (%zu objects), diff %.3fs, send %.3fs "
+	              "(%zu notifiers)",
+	              config->host.c_str(), message.parseTime, prefetchTime,
+	              prefetched, diffTime, double(timer.elapsed()),
+	              notifiers.size());
+
+	return res;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -969,7 +1106,7 @@ void App::handleTimeout() {
 		auto &item = *it;
 		--item.timeout;
 		if ( item.timeout <= 0 ) {
-			handleQLMessage(item.client, item.response.get());
+			handleQLMessage(item);
 			it = _qlDelayBuffer.erase(it);
 		}
 		else {
@@ -1007,6 +1144,83 @@ void App::handleTimeout() {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t App::prefetch(const EventParameters *ep, bool picks, bool amplitudes) {
+	if ( !query() ) {
+		return 0;
+	}
+
+	size_t count = 0;
+
+	if ( picks ) {
+		vector<string> publicIDs;
+		publicIDs.reserve(ep->pickCount());
+		for ( size_t i = 0; i < ep->pickCount(); ++i ) {
+			publicIDs.push_back(ep->pick(i)->publicID());
+		}
+		count += prefetch<Pick>(publicIDs);
+	}
+
+	if ( amplitudes ) {
+		vector<string> publicIDs;
+		publicIDs.reserve(ep->amplitudeCount());
+		for ( size_t i = 0; i < ep->amplitudeCount(); ++i ) {
+			publicIDs.push_back(ep->amplitude(i)->publicID());
+		}
+		count += prefetch<Amplitude>(publicIDs);
+	}
+
+	return count;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+template <class T>
+size_t App::prefetch(const vector<string> &publicIDs) {
+	// Picks and amplitudes do not have other child objects than comments,
+	// so an object and its children are fetched with two queries per
+	// chunk of publicIDs instead of at least two queries per object.
+	auto *db = query()->driver();
+	vector<string> missing;
+
+	for ( const auto &publicID : publicIDs ) {
+		if ( _prefetched.find(publicID) != _prefetched.end() ) {
+			continue;
+		}
+
+		string escapedPublicID;
+		if ( !db->escape(escapedPublicID, publicID) ) {
+			// Left to be loaded by diffPO
+			continue;
+		}
+
+		missing.push_back(publicID);
+	}
+
+	// Registered instances are used as they are, their child objects are
+	// not loaded again as for cached objects
+	auto objects = Private::loadObjects<T>(query(), string(), missing,
+	                                       true, PrefetchChunkSize);
+	for ( const auto &object : objects ) {
+		_prefetched[object->publicID()] = object;
+		_cache.feed(object.get());
+	}
+
+	// Not found in the database
+	for ( const auto &publicID : missing ) {
+		_prefetched.insert({ publicID, nullptr });
+	}
+
+	return objects.size();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 template <class T>
 void App::diffPO(T *remotePO, const string &parentID, Notifiers &notifiers,
@@ -1015,15 +1229,23 @@ void App::diffPO(T *remotePO, const string &parentID, Notifiers &notifiers,
 		return;
 	}
 
-	// search corresponding object in cache
 	Core::SmartPointer<T> localPO;
-	localPO = T::Cast(_cache.find(remotePO->typeInfo(), remotePO->publicID()));
 
-	// if object was not found in cache but loaded from database, all of its
-	// child objects have to be loaded too
-	if ( localPO && !_cache.cached() && query() ) {
-		query()->load(localPO.get());
-		PublicObjectCacheFeeder(_cache).feed(localPO.get(), true);
+	auto it = _prefetched.find(remotePO->publicID());
+	if ( it != _prefetched.end() ) {
+		// prefetched along with its child objects or known to be missing
+		localPO = T::Cast(it->second.get());
+	}
+	else {
+		// search corresponding object in cache
+		localPO = T::Cast(_cache.find(remotePO->typeInfo(), remotePO->publicID()));
+
+		// if object was not found in cache but loaded from database, all of its
+		// child objects have to be loaded too
+		if ( localPO && !_cache.cached() && query() ) {
+			query()->load(localPO.get());
+			PublicObjectCacheFeeder(_cache).feed(localPO.get(), true);
+		}
 	}
 
 	MyDiff diff(_config);
@@ -25,8 +25,13 @@
 #include <seiscomp/datamodel/publicobjectcache.h>
 #include <seiscomp/datamodel/diff.h>
 
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 namespace Seiscomp {
 
@@ -66,6 +71,17 @@ class App : public Client::Application {
 		using LogNode = DataModel::Diff2::LogNode;
 		using LogNodePtr = DataModel::Diff2::LogNodePtr;
 
+		struct QLMessage {
+			QLClient *client{nullptr};
+			IO::QuakeLink::ResponsePtr response;
+			// Set by the parser thread
+			DataModel::EventParametersPtr ep;
+			DataModel::JournalingPtr ej;
+			bool parsed{false};
+			double parseTime{0};
+			int timeout{0};
+		};
+
 		void createCommandLineDescription() override;
 
 		bool init() override;
@@ -78,8 +94,20 @@ class App : public Client::Application {
 		void removeObject(const std::string& parentID, DataModel::Object *obj) override;
 		void handleTimeout() override;
 
-		bool handleQLMessage(QLClient *client, const IO::QuakeLink::Response *msg);
-		bool dispatchResponse(QLClient *client, const IO::QuakeLink::Response *response);
+		bool handleQLMessage(const QLMessage &msg);
+		bool dispatchResponse(const QLMessage &msg);
+
+		//! Parses the responses received by the clients, runs in its
+		//! own thread
+		void parseResponses();
+
+		//! Loads the local counterparts of the remote picks and amplitudes
+		//! in bulk, see diffPO. Returns the number of objects found.
+		size_t prefetch(const DataModel::EventParameters *ep,
+		                bool picks, bool amplitudes);
+
+		template <class T>
+		size_t prefetch(const std::vector<std::string> &publicIDs);
 
 		template <class T>
 		void diffPO(T *remotePO, const std::string &parentID,
@@ -124,18 +152,24 @@ class App : public Client::Application {
 
 		using EventDelayBuffer = std::map<std::string, EventDelayItem>;
 
-		struct QLMessage {
-			QLClient *client;
-			IO::QuakeLink::ResponsePtr response;
-			int timeout;
-		};
-
 		using QLResponseBuffer = std::list<QLMessage>;
+		using QLMessageQueue = std::deque<QLMessage>;
+		using PrefetchedObjects = std::unordered_map<std::string, DataModel::PublicObjectPtr>;
 
 		Config                   _config;
 		QLClients                _clients;
 		NoCache                  _cache;
-		std::mutex               _clientPublishMutex;
+		// Local objects loaded by prefetch, nullptr if an object does
+		// not exist locally. Cleared along with the cache.
+		PrefetchedObjects        _prefetched;
+		// Responses are passed from the client threads to the parser
+		// thread and from there to the main thread
+		std::mutex               _pipelineMutex;
+		std::condition_variable  _pipelineCondition;
+		QLMessageQueue           _receivedResponses;
+		QLMessageQueue           _parsedResponses;
+		std::thread              _parser;
+		bool                     _parserExit{false};
 		std::string              _lastUpdateFile;
 		EventDelayBuffer         _eventDelayBuffer;
 		QLResponseBuffer         _qlDelayBuffer;
@@ -0,0 +1,255 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT SCARDAC
+
+#include "chunkstate.h"
+
+#include <seiscomp/logging/log.h>
+#include <seiscomp/utils/files.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace Seiscomp {
+namespace DataAvailability {
+
+namespace {
+
+const int StateFileVersion = 1;
+const char *TimeFormat = "%FT%T.%fZ";
+
+bool readTime(istream &is, Core::Time &time) {
+	string str;
+	return (is >> str) && time.fromString(str.c_str(), TimeFormat);
+}
+
+} // ns anonymous
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool ChunkStateFile::load(const string &filename, float jitter) {
+	lock_guard<mutex> lock(_mutex);
+
+	_jitter = jitter;
+	_extents.clear();
+
+	ifstream ifs(filename.c_str());
+	if ( !ifs.is_open() ) {
+		SEISCOMP_INFO("Chunk state file %s not found, starting with empty "
+		              "state", filename.c_str());
+		return true;
+	}
+
+	string line, key;
+	int lineNum = 0;
+	int version = 0;
+	ExtentState *extent = nullptr;
+
+	while ( getline(ifs, line) ) {
+		++lineNum;
+		if ( line.empty() || line[0] == '#' ) {
+			continue;
+		}
+
+		istringstream iss(line);
+		iss >> key;
+
+		if ( key == "version" ) {
+			if ( !(iss >> version) || version != StateFileVersion ) {
+				SEISCOMP_WARNING("Unsupported chunk state file version, "
+				                 "discarding state: %s", filename.c_str());
+				_extents.clear();
+				return true;
+			}
+		}
+		else if ( key == "jitter" ) {
+			float fileJitter;
+			if ( !(iss >> fileJitter) || fileJitter != jitter ) {
+				SEISCOMP_INFO("Jitter changed since chunk state file was "
+				              "written, discarding state: %s",
+				              filename.c_str());
+				_extents.clear();
+				return true;
+			}
+		}
+		else if ( key == "extent" ) {
+			string sid;
+			ExtentState state;
+			if ( !(iss >> sid) || !readTime(iss, state.lastScan) ) {
+				break;
+			}
+			extent = &(_extents[sid] = state);
+		}
+		else if ( key == "chunk" && extent ) {
+			ChunkState state;
+			string quality, name;
+			if ( !(iss >> state.size) || !readTime(iss, state.mtime) ||
+			     !(iss >> state.offset) || !readTime(iss, state.lastRecordEnd) ||
+			     !(iss >> state.segments) || !readTime(iss, state.tail.start) ||
+			     !readTime(iss, state.tail.end) ||
+			     !readTime(iss, state.tail.updated) ||
+			     !(iss >> state.tail.sampleRate >> quality) ) {
+				break;
+			}
+
+			// the chunk name is the remainder of the line
+			iss >> ws;
+			getline(iss, name);
+			if ( name.empty() ) {
+				break;
+			}
+
+			state.tail.quality = quality == "-" ? "" : quality;
+			extent->chunks[name] = state;
+		}
+		else {
+			break;
+		}
+
+		line.clear();
+	}
+
+	if ( !line.empty() ) {
+		SEISCOMP_ERROR("Invalid line #%i in chunk state file %s", lineNum,
+		               filename.c_str());
+		_extents.clear();
+		return false;
+	}
+
+	if ( version != StateFileVersion ) {
+		SEISCOMP_WARNING("Missing version in chunk state file, discarding "
+		                 "state: %s", filename.c_str());
+		_extents.clear();
+		return true;
+	}
+
+	SEISCOMP_INFO("Read state of %zu extents from chunk state file %s",
+	              _extents.size(), filename.c_str());
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool ChunkStateFile::save(const string &filename) const {
+	lock_guard<mutex> lock(_mutex);
+
+	auto slash = filename.rfind('/');
+	if ( slash != string::npos && slash > 0 ) {
+		Util::createPath(filename.substr(0, slash));
+	}
+
+	// write state to temporary file
+	string tmpFile = filename + ".tmp";
+	ofstream ofs(tmpFile.c_str(), ios::trunc);
+	if ( !ofs.good() ) {
+		SEISCOMP_ERROR("Could not open file '%s' for writing", tmpFile.c_str());
+		return false;
+	}
+
+	ofs << "# scardac chunk state, do not edit" << endl
+	    << "version " << StateFileVersion << endl
+	    << "jitter " << setprecision(9) << _jitter << endl
+	    << setprecision(17);
+
+	for ( const auto &item : _extents ) {
+		ofs << "extent " << item.first << " "
+		    << item.second.lastScan.toString(TimeFormat) << endl;
+
+		for ( const auto &chunk : item.second.chunks ) {
+			const auto &state = chunk.second;
+			ofs << "chunk " << state.size << " "
+			    << state.mtime.toString(TimeFormat) << " "
+			    << state.offset << " "
+			    << state.lastRecordEnd.toString(TimeFormat) << " "
+			    << state.segments << " "
+			    << state.tail.start.toString(TimeFormat) << " "
+			    << state.tail.end.toString(TimeFormat) << " "
+			    << state.tail.updated.toString(TimeFormat) << " "
+			    << state.tail.sampleRate << " "
+			    << (state.tail.quality.empty() ? "-" : state.tail.quality) << " "
+			    << chunk.first << endl;
+		}
+	}
+
+	if ( !ofs.good() ) {
+		SEISCOMP_ERROR("Could not write to file '%s'", tmpFile.c_str());
+		return false;
+	}
+	ofs.close();
+
+	// move temporary file
+	if ( ::rename(tmpFile.c_str(), filename.c_str()) ) {
+		SEISCOMP_ERROR("Could not rename temporary file '%s' to '%s'",
+		               tmpFile.c_str(), filename.c_str());
+		return false;
+	}
+
+	SEISCOMP_INFO("Wrote state of %zu extents to chunk state file %s",
+	              _extents.size(), filename.c_str());
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool ChunkStateFile::get(const string &streamID, ExtentState &state) const {
+	lock_guard<mutex> lock(_mutex);
+
+	auto it = _extents.find(streamID);
+	if ( it == _extents.end() ) {
+		return false;
+	}
+
+	state = it->second;
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void ChunkStateFile::set(const string &streamID, ExtentState state) {
+	lock_guard<mutex> lock(_mutex);
+	_extents[streamID] = std::move(state);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void ChunkStateFile::remove(const string &streamID) {
+	lock_guard<mutex> lock(_mutex);
+	_extents.erase(streamID);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+} // ns DataAvailability
+} // ns Seiscomp
@@ -0,0 +1,105 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+#ifndef SEISCOMP_DATAAVAILABILITY_CHUNKSTATE_H
+#define SEISCOMP_DATAAVAILABILITY_CHUNKSTATE_H
+
+#include <seiscomp/core/datetime.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace Seiscomp {
+namespace DataAvailability {
+
+/**
+ * @brief Summary of a data segment as stored in the database
+ */
+struct SegmentSummary {
+	Core::Time  start;
+	Core::Time  end;
+	Core::Time  updated;
+	double      sampleRate{0};
+	std::string quality;
+
+	//! A summary without sampling rate is unset
+	bool valid() const { return sampleRate > 0; }
+};
+
+/**
+ * @brief State of a data chunk after it has been synchronized with the
+ * database
+ */
+struct ChunkState {
+	size_t          size{0};
+	Core::Time      mtime;
+	//! Offset behind the last record read, 0 if the chunk can't be
+	//! continued
+	size_t          offset{0};
+	Core::Time      lastRecordEnd;
+	//! Number of segments and last segment of the chunk, the tail is only
+	//! set for the last chunk of an extent
+	size_t          segments{0};
+	SegmentSummary  tail;
+};
+
+/**
+ * @brief State of all chunks of an extent. It is only valid as long as
+ * the last scan time matches the one of the extent stored in the database.
+ */
+struct ExtentState {
+	using Chunks = std::map<std::string, ChunkState>;
+
+	Core::Time      lastScan;
+	Chunks          chunks;
+
+	const ChunkState *chunk(const std::string &name) const {
+		auto it = chunks.find(name);
+		return it != chunks.end() ? &it->second : nullptr;
+	}
+};
+
+/**
+ * @brief Thread safe store of extent states persisted in a text file
+ */
+class ChunkStateFile {
+	public:
+		/**
+		 * @brief Reads the extent states from file. States written with
+		 * a different jitter are discarded.
+		 * @param filename The file name
+		 * @param jitter The jitter of the current run
+		 * @return False if the file exists but could not be read
+		 */
+		bool load(const std::string &filename, float jitter);
+
+		//! Writes the extent states to file
+		bool save(const std::string &filename) const;
+
+		bool get(const std::string &streamID, ExtentState &state) const;
+		void set(const std::string &streamID, ExtentState state);
+		void remove(const std::string &streamID);
+
+	private:
+		using Extents = std::map<std::string, ExtentState>;
+
+		mutable std::mutex  _mutex;
+		float               _jitter{0};
+		Extents             _extents;
+};
+
+} // ns DataAvailability
+} // ns Seiscomp
+
+#endif // SEISCOMP_DATAAVAILABILITY_CHUNKSTATE_H
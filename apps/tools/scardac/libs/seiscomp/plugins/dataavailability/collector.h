@@ -39,8 +39,13 @@
  2
    - Add setStartTime() and setEndTime() methods
 
+ 3
+   - Add setDeepScan() method
+   - Add chunkSize() and beginAt() methods
+   - Add RecordIterator::offset() method
+
  */
-#define SCARDAC_API_VERSION 2
+#define SCARDAC_API_VERSION 3
 
 
 namespace Seiscomp {
@@ -82,6 +87,16 @@ class SC_DAPLUGIN_API Collector : public Core::InterruptibleObject {
 				virtual double sampleRate() const = 0;
 				virtual const std::string& quality() const = 0;
 
+				/**
+				 * @brief Return the chunk offset behind the current record,
+				 *        e.g., the file position. The offset may be passed
+				 *        to Collector::beginAt to continue reading after
+				 *        this record.
+				 * @return The offset or 0 if not supported.
+				 * @since SCARDAC API 3
+				 */
+				virtual size_t offset() const;
+
 				void handleInterrupt(int sig) override;
 
 			protected:
@@ -137,6 +152,16 @@ class SC_DAPLUGIN_API Collector : public Core::InterruptibleObject {
 		 */
 		virtual void setEndTime(Core::Time endTime);
 
+		/**
+		 * @brief Request a deep scan of the data chunks. By default a
+		 *        collector may derive the record meta data from the record
+		 *        headers only. In deep-scan mode the records are fully
+		 *        decoded.
+		 * @param deepScan Enable or disable the deep scan.
+		 * @since SCARDAC API 3
+		 */
+		virtual void setDeepScan(bool deepScan);
+
 		/**
 		 * @brief Reset all internal buffers and states except for the source.
 		 */
@@ -180,6 +205,15 @@ class SC_DAPLUGIN_API Collector : public Core::InterruptibleObject {
 		 */
 		virtual Core::Time chunkMTime(const std::string &chunk);
 
+		/**
+		 * @brief Return the chunk's size, e.g., the file size in bytes.
+		 * @param chunk The chunk ID, e.g., the file name relative to the
+		 *        archive base path.
+		 * @return Chunk size or 0 if unknown.
+		 * @since SCARDAC API 3
+		 */
+		virtual size_t chunkSize(const std::string &chunk);
+
 
 		/**
 		 * @brief Open a data chunk for record-based iteration.
@@ -192,6 +226,23 @@ class SC_DAPLUGIN_API Collector : public Core::InterruptibleObject {
 		virtual RecordIterator* begin(const std::string &chunk,
 	                                  const DataModel::WaveformStreamID &wid) = 0;
 
+		/**
+		 * @brief Open a data chunk for record-based iteration starting at
+		 *        a specific offset, see RecordIterator::offset.
+		 * @param chunk The chunk ID, e.g., the file name relative to the
+		 *        archive base path.
+		 * @param wid The waveform stream ID corresponding to the chunk
+		 * @param offset The chunk offset of the first record to read
+		 * @return The data chunk iterator or nullptr if the chunk could not be
+		 *         opened at the given offset. The ownership is transferred to
+		 *         the caller. The default implementation supports offset 0
+		 *         only.
+		 * @since SCARDAC API 3
+		 */
+		virtual RecordIterator* beginAt(const std::string &chunk,
+		                                const DataModel::WaveformStreamID &wid,
+		                                size_t offset);
+
 		/**
 		 * @brief threadSafe Define whether or not a collector instance may
 		 * be used by multiple threads simultaneously. Thread-safty is only
@@ -245,6 +296,7 @@ class SC_DAPLUGIN_API Collector : public Core::InterruptibleObject {
 
 		OPT(Core::Time) _startTime;
 		OPT(Core::Time) _endTime;
+		bool            _deepScan{false};
 };
 
 
@@ -24,6 +24,8 @@
 #include <seiscomp/logging/log.h>
 #include <seiscomp/system/environment.h>
 
+#include <cctype>
+#include <cstring>
 #include <utility>
 #include <vector>
 
@@ -39,6 +41,55 @@ REGISTER_DATAAVAILABILITY_COLLECTOR(SDSCollector, "sds");
 namespace {
 
 
+// Length of the fixed section of the miniSEED 2 data header
+const size_t FixedHeaderLength = 48;
+// Number of bytes searched for blockettes
+const size_t MaxHeaderLength = 512;
+// Step width used to find the next record after an invalid header
+const size_t MinRecordLength = 64;
+const size_t BlockSize = 1 << 16;
+
+
+uint16_t read16(const unsigned char *p, bool swap) {
+	return swap ? uint16_t(p[0] | (p[1] << 8)) : uint16_t((p[0] << 8) | p[1]);
+}
+
+
+uint32_t read32(const unsigned char *p, bool swap) {
+	return swap ? uint32_t(p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24))
+	            : uint32_t((uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+
+double nominalSampleRate(int16_t factor, int16_t multiplier) {
+	if ( factor > 0 && multiplier > 0 ) {
+		return double(factor) * multiplier;
+	}
+	if ( factor > 0 && multiplier < 0 ) {
+		return -double(factor) / multiplier;
+	}
+	if ( factor < 0 && multiplier > 0 ) {
+		return -double(multiplier) / factor;
+	}
+	if ( factor < 0 && multiplier < 0 ) {
+		return 1.0 / (double(factor) * multiplier);
+	}
+
+	return 0;
+}
+
+
+// Compares a space padded header field with a stream code
+bool equalCode(const unsigned char *field, size_t length, const string &code) {
+	while ( length > 0 && (field[length-1] == ' ' || field[length-1] == '\0') ) {
+		--length;
+	}
+
+	return code.size() == length &&
+	       code.compare(0, length, reinterpret_cast<const char*>(field), length) == 0;
+}
+
+
 } // ns anonymous
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -149,6 +200,340 @@ const std::string& SDSCollector::RecordIterator::quality() const {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+SDSCollector::HeaderIterator::HeaderIterator(string file,
+                                    const DataModel::WaveformStreamID &wid,
+                                    size_t offset)
+: _file(std::move(file)), _sid(streamID(wid)), _wid(wid) {
+	_stream.open(_file.c_str(), ios::in | ios::binary);
+	if ( !_stream.is_open() ) {
+		throw CollectorException("could not open record file");
+	}
+
+	_stream.seekg(0, ios::end);
+	_fileSize = _stream.tellg();
+	if ( static_cast<streamoff>(offset) > _fileSize ) {
+		throw CollectorException("offset behind end of file");
+	}
+
+	_stream.seekg(static_cast<streamoff>(offset), ios::beg);
+	_offset = static_cast<streamoff>(offset);
+
+	_buffer.resize(BlockSize);
+
+	// Continuing at an offset requires a valid record at this position,
+	// there is no fallback to decoding the entire file
+	if ( offset ) {
+		bool match;
+		if ( !fill(FixedHeaderLength) || !readHeader(match) ) {
+			throw CollectorException("no record header found at offset");
+		}
+		_records = 1;
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool SDSCollector::HeaderIterator::valid() const {
+	return _fallback ? _fallback->valid() : _valid;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool SDSCollector::HeaderIterator::fill(size_t size) {
+	if ( _pos + size <= _size ) {
+		return true;
+	}
+
+	if ( _pos >= _size ) {
+		// The current record starts behind the buffered data
+		if ( _pos > _size ) {
+			_stream.seekg(static_cast<streamoff>(_pos - _size), ios::cur);
+		}
+		_size = 0;
+	}
+	else {
+		_size -= _pos;
+		memmove(_buffer.data(), _buffer.data() + _pos, _size);
+	}
+
+	_offset += static_cast<streamoff>(_pos);
+	_pos = 0;
+
+	if ( _stream.good() ) {
+		_stream.read(_buffer.data() + _size,
+		             static_cast<streamsize>(_buffer.size() - _size));
+		_size += static_cast<size_t>(_stream.gcount());
+	}
+
+	return size <= _size;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t SDSCollector::HeaderIterator::readHeader(bool &match) {
+	// Blockettes are searched within the buffered part of the header
+	fill(MaxHeaderLength);
+
+	size_t available = min(_size - _pos, MaxHeaderLength);
+	const auto *hdr = reinterpret_cast<const unsigned char*>(_buffer.data() + _pos);
+
+	// Sequence number, data quality indicator and reserved byte
+	for ( size_t i = 0; i < 6; ++i ) {
+		if ( !isdigit(hdr[i]) && hdr[i] != ' ' && hdr[i] != '\0' ) {
+			return 0;
+		}
+	}
+
+	if ( hdr[6] != 'D' && hdr[6] != 'R' && hdr[6] != 'Q' && hdr[6] != 'M' ) {
+		return 0;
+	}
+
+	if ( hdr[7] != ' ' && hdr[7] != '\0' ) {
+		return 0;
+	}
+
+	// The byte order is detected from a plausible start time like libmseed
+	// does it
+	auto plausible = [hdr](bool swap) {
+		uint16_t year = read16(hdr + 20, swap);
+		uint16_t doy = read16(hdr + 22, swap);
+		return year >= 1900 && year <= 2100 && doy >= 1 && doy <= 366;
+	};
+
+	bool swap = false;
+	if ( !plausible(swap) ) {
+		swap = true;
+		if ( !plausible(swap) ) {
+			return 0;
+		}
+	}
+
+	int year = read16(hdr + 20, swap);
+	int doy = read16(hdr + 22, swap);
+	int hour = hdr[24];
+	int minute = hdr[25];
+	int second = hdr[26];
+	int fract = read16(hdr + 28, swap);
+	if ( hour > 23 || minute > 59 || second > 60 || fract > 9999 ) {
+		return 0;
+	}
+
+	uint16_t samples = read16(hdr + 30, swap);
+	auto factor = static_cast<int16_t>(read16(hdr + 32, swap));
+	auto multiplier = static_cast<int16_t>(read16(hdr + 34, swap));
+	uint8_t activityFlags = hdr[36];
+	auto timeCorrection = static_cast<int32_t>(read32(hdr + 40, swap));
+
+	// Blockettes 100 (sample rate), 1000 (record length) and 1001
+	// (microseconds)
+	size_t length = 0;
+	int usecOffset = 0;
+	double sampleRate = nominalSampleRate(factor, multiplier);
+
+	size_t blockette = read16(hdr + 46, swap);
+	while ( blockette >= FixedHeaderLength && blockette + 4 <= available ) {
+		uint16_t type = read16(hdr + blockette, swap);
+		size_t nextBlockette = read16(hdr + blockette + 2, swap);
+
+		if ( type == 1000 && blockette + 8 <= available ) {
+			uint8_t exponent = hdr[blockette + 6];
+			if ( exponent >= 6 && exponent <= 20 ) {
+				length = size_t(1) << exponent;
+			}
+		}
+		else if ( type == 100 && blockette + 8 <= available ) {
+			uint32_t bits = read32(hdr + blockette + 4, swap);
+			float rate;
+			memcpy(&rate, &bits, sizeof(rate));
+			sampleRate = rate;
+		}
+		else if ( type == 1001 && blockette + 8 <= available ) {
+			usecOffset = static_cast<int8_t>(hdr[blockette + 5]);
+		}
+
+		if ( nextBlockette <= blockette ) {
+			break;
+		}
+
+		blockette = nextBlockette;
+	}
+
+	if ( length < FixedHeaderLength ) {
+		return 0;
+	}
+
+	match = equalCode(hdr + 18, 2, _wid.networkCode()) &&
+	        equalCode(hdr + 8, 5, _wid.stationCode()) &&
+	        equalCode(hdr + 13, 2, _wid.locationCode()) &&
+	        equalCode(hdr + 15, 3, _wid.channelCode());
+	if ( !match ) {
+		return length;
+	}
+
+	int64_t usecs = ((int64_t(doy - 1) * 24 + hour) * 60 + minute) * 60 + second;
+	usecs = usecs * 1000000 + fract * 100 + usecOffset;
+	// Time correction not applied yet
+	if ( !(activityFlags & 0x02) ) {
+		usecs += int64_t(timeCorrection) * 100;
+	}
+
+	int64_t secs = usecs / 1000000;
+	usecs %= 1000000;
+	if ( usecs < 0 ) {
+		usecs += 1000000;
+		--secs;
+	}
+
+	_startTime = Core::Time(year, 1, 1) +
+	             Core::TimeSpan(static_cast<long>(secs), static_cast<long>(usecs));
+	_sampleRate = sampleRate;
+	_endTime = _startTime;
+	if ( _sampleRate > 0 ) {
+		_endTime += Core::TimeSpan(samples / _sampleRate);
+	}
+	_quality.assign(1, static_cast<char>(hdr[6]));
+
+	return length;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool SDSCollector::HeaderIterator::next() {
+	if ( _fallback ) {
+		return _fallback->next();
+	}
+
+	_valid = false;
+
+	while ( !_abortRequested ) {
+		// Skip the previous record
+		_pos += _recordLength;
+		_recordLength = 0;
+
+		if ( !fill(FixedHeaderLength) ) {
+			return false;
+		}
+
+		bool match = false;
+		size_t length = readHeader(match);
+		if ( !length ) {
+			if ( !_records ) {
+				SEISCOMP_DEBUG("%s: No miniSEED 2 header found, decoding "
+				               "records of file: %s", _sid.c_str(),
+				               _file.c_str());
+				_stream.close();
+				try {
+					_fallback = new SDSCollector::RecordIterator(_file, _wid);
+				}
+				catch ( CollectorException &e ) {
+					SEISCOMP_WARNING("%s: %s: %s", _sid.c_str(), _file.c_str(),
+					                 e.what());
+					return false;
+				}
+
+				return _fallback->next();
+			}
+
+			if ( !_resync ) {
+				SEISCOMP_WARNING("%s: Invalid record header at offset %ld "
+				                 "while reading file: %s", _sid.c_str(),
+				                 static_cast<long>(_offset + static_cast<streamoff>(_pos)),
+				                 _file.c_str());
+				_resync = true;
+			}
+
+			_recordLength = MinRecordLength;
+			continue;
+		}
+
+		if ( _offset + static_cast<streamoff>(_pos + length) > _fileSize ) {
+			SEISCOMP_WARNING("%s: Truncated record at offset %ld while "
+			                 "reading file: %s", _sid.c_str(),
+			                 static_cast<long>(_offset + static_cast<streamoff>(_pos)),
+			                 _file.c_str());
+			return false;
+		}
+
+		++_records;
+		_resync = false;
+		_recordLength = length;
+
+		if ( match ) {
+			_valid = true;
+			return true;
+		}
+	}
+
+	// only reached if abort was requested
+	return false;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+const Core::Time& SDSCollector::HeaderIterator::startTime() const {
+	return _fallback ? _fallback->startTime() : _startTime;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+const Core::Time& SDSCollector::HeaderIterator::endTime() const {
+	return _fallback ? _fallback->endTime() : _endTime;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+double SDSCollector::HeaderIterator::sampleRate() const {
+	return _fallback ? _fallback->sampleRate() : _sampleRate;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+const std::string& SDSCollector::HeaderIterator::quality() const {
+	return _fallback ? _fallback->quality() : _quality;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t SDSCollector::HeaderIterator::offset() const {
+	if ( _fallback ) {
+		return 0;
+	}
+
+	return static_cast<size_t>(_offset) + _pos + _recordLength;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool SDSCollector::setSource(const char *source) {
 	if ( !Collector::setSource(source) ) {
@@ -370,11 +755,49 @@ Core::Time SDSCollector::chunkMTime(const std::string &chunk) {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t SDSCollector::chunkSize(const std::string &chunk) {
+	boost::system::error_code ec;
+	auto size = fs::file_size(_basePath / SC_FS_PATH(chunk), ec);
+	if ( ec ) {
+		SEISCOMP_WARNING("Could not read size of file: %s", chunk.c_str());
+		return 0;
+	}
+
+	return static_cast<size_t>(size);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 Collector::RecordIterator*
 SDSCollector::begin(const std::string &chunk,
                     const DataModel::WaveformStreamID &wid) {
-	return new RecordIterator((_basePath / SC_FS_PATH(chunk)).string(), wid);
+	auto file = (_basePath / SC_FS_PATH(chunk)).string();
+	if ( _deepScan ) {
+		return new RecordIterator(file, wid);
+	}
+
+	return new HeaderIterator(file, wid);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+Collector::RecordIterator*
+SDSCollector::beginAt(const std::string &chunk,
+                      const DataModel::WaveformStreamID &wid, size_t offset) {
+	// The decoding iterator reads entire files only
+	if ( _deepScan ) {
+		return offset ? nullptr : begin(chunk, wid);
+	}
+
+	return new HeaderIterator((_basePath / SC_FS_PATH(chunk)).string(), wid,
+	                          offset);
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -29,6 +29,7 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <fstream>
 #include <vector>
 
 
@@ -73,6 +74,74 @@ class SDSCollector : public Collector {
 				std::string         _quality;
 		};
 
+		/**
+		 * @brief Iterates over the miniSEED 2 records of a file by reading
+		 * the fixed section of the data header and the blockettes 100, 1000
+		 * and 1001 only. The sample data is not decoded, the end time is
+		 * derived from the sample count and sampling rate. If the first
+		 * record of the file is not a valid miniSEED 2 record the file is
+		 * read with a decoding RecordIterator instead. Reading may start at
+		 * the offset of a previous iteration.
+		 */
+		class HeaderIterator : public Collector::RecordIterator {
+			public:
+				/**
+				 * @brief HeaderIterator
+				 * @param file The absolute file path
+				 * @param wid StreamID the file is expected to contain data for
+				 */
+				HeaderIterator(std::string file,
+				               const DataModel::WaveformStreamID &wid,
+				               size_t offset = 0);
+
+			public:
+				~HeaderIterator() override = default;
+
+				bool valid() const override;
+				bool next() override;
+				const Core::Time& startTime() const override;
+				const Core::Time& endTime() const override;
+				double sampleRate() const override;
+				const std::string& quality() const override;
+				size_t offset() const override;
+
+			protected:
+				//! Makes sure that size bytes starting at the current
+				//! record are buffered
+				bool fill(size_t size);
+				//! Parses the header of the current record and returns the
+				//! record length or 0 if no valid header was found. Match is
+				//! set if the record belongs to the expected stream.
+				size_t readHeader(bool &match);
+
+			protected:
+				std::string         _file;
+				std::string         _sid;
+				DataModel::WaveformStreamID _wid;
+				std::ifstream       _stream;
+				std::streamoff      _fileSize{0};
+
+				// Read buffer, _offset is the file offset of the first byte,
+				// _pos the buffer position of the current record
+				std::vector<char>   _buffer;
+				std::streamoff      _offset{0};
+				size_t              _pos{0};
+				size_t              _size{0};
+				size_t              _recordLength{0};
+				size_t              _records{0};
+				bool                _resync{false};
+
+				// Decoding iterator used if the file does not contain
+				// miniSEED 2 records
+				Collector::RecordIteratorPtr _fallback;
+
+				bool                _valid{false};
+				Core::Time          _startTime;
+				Core::Time          _endTime;
+				double              _sampleRate{0};
+				std::string         _quality;
+		};
+
 
 	public:
 		SDSCollector() = default;
@@ -89,9 +158,14 @@ class SDSCollector : public Collector {
 		bool chunkTimeWindow(Core::TimeWindow &window,
 		                     const std::string &chunk) override;
 		Core::Time chunkMTime(const std::string &chunk) override;
+		size_t chunkSize(const std::string &chunk) override;
 		Collector::RecordIterator* begin(
 		        const std::string &chunk,
 		        const DataModel::WaveformStreamID &wid) override;
+		Collector::RecordIterator* beginAt(
+		        const std::string &chunk,
+		        const DataModel::WaveformStreamID &wid,
+		        size_t offset) override;
 		bool threadSafe() const override;
 
 	protected:
@@ -28,6 +28,8 @@
 
 #include <seiscomp/logging/log.h>
 
+#include <seiscomp/system/environment.h>
+
 #include <ctime>
 #include <functional>
 #include <vector>
@@ -117,8 +119,9 @@ bool parseDate(OPT(Core::Time) &time, const string &timeStr, const char *desc) {
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-Worker::Worker(const SCARDAC *app, int id, Collector *collector)
-: _app(app), _id(id), _collector(collector) {}
+Worker::Worker(const SCARDAC *app, int id, Collector *collector,
+               ChunkStateFile *states)
+: _app(app), _id(id), _collector(collector), _states(states) {}
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
 
@@ -139,6 +142,20 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 	_segmentsStore.clear();
 	_segmentsRemove.clear();
 
+	auto now = Core::Time::UTC();
+
+	// The chunk state of the previous run is only used if the extent was
+	// not modified since, it is recorded again once the extent has been
+	// synchronized
+	ExtentState state;
+	ExtentState newState;
+	bool trusted = false;
+	if ( _states ) {
+		trusted = foundInDB && _states->get(_sid, state) &&
+		          state.lastScan == _extent->lastScan();
+		_states->remove(_sid);
+	}
+
 	SEISCOMP_INFO("[%i] %s: Start processing", _id, _sid.c_str());
 	Collector::DataChunks chunks;
 	_collector->collectChunks(chunks, _extent->waveformID());
@@ -155,6 +172,11 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 		               chunks.back().c_str());
 	}
 
+	if ( trusted && !_app->_deepScan &&
+	     skipUnchangedExtent(chunks, state, now) ) {
+		return;
+	}
+
 	// database segment iterator, limited by scan window (if any)
 	DatabaseIterator db_seg_it;
 
@@ -203,8 +225,8 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 		return;
 	}
 
-	auto now = Core::Time::UTC();
 	auto mtime = now;
+	size_t size = 0;
 	Segments segments;
 	Core::TimeWindow chunkWindow;
 	Core::TimeWindow nextChunkWindow;
@@ -213,6 +235,8 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 	DataSegmentPtr dbSeg = nullptr;
 	DataSegmentPtr prevChunkSeg = nullptr;
 	string readTrigger;
+	bool modified = false;
+	bool chunksRead = false;
 
 	if ( _app->_startTime ) {
 		prevChunkEndTime = *_app->_startTime;
@@ -228,6 +252,7 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 		nextChunkWindow = {};
 		readTrigger = !foundInDB ? "new extent" :
 		              _app->_deepScan ? "deep-scan" : "";
+		modified = false;
 		nextChunk = next(chunk);
 
 		if ( nextChunk != chunks.end() ) {
@@ -255,13 +280,26 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 			mtime = now;
 		}
 
+		// chunk state of previous run, a chunk with equal size and mtime
+		// is considered unchanged even if modified after the last scan
+		// started
+		const ChunkState *chunkState = nullptr;
+		bool unchanged = false;
+		if ( _states ) {
+			size = _collector->chunkSize(*chunk);
+			chunkState = trusted ? state.chunk(*chunk) : nullptr;
+			unchanged = chunkState && size && chunkState->size == size &&
+			            chunkState->mtime == mtime;
+		}
+
 		if ( readTrigger.empty() && (
 		         !_app->_mtimeEnd || mtime <= _app->_mtimeEnd) ) {
 			if ( _app->_mtimeStart && mtime >= _app->_mtimeStart ) {
 				readTrigger = "mtime > modified since";
 			}
-			else if ( mtime > _extent->lastScan() ) {
+			else if ( mtime > _extent->lastScan() && !unchanged ) {
 				readTrigger = "mtime > last scan";
+				modified = true;
 			}
 		}
 
@@ -309,9 +347,28 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 			               _id, _sid.c_str(), mtime.iso().c_str(),
 			               _app->_mtimeEnd && mtime > _app->_mtimeEnd ?
 			                   "> mtime window" :
-			               _app->_mtimeStart ? "< mtime window" : "< last scan",
+			               _app->_mtimeStart ? "< mtime window" :
+			               unchanged ? "unchanged" : "< last scan",
 			               chunk->c_str());
 
+			if ( _states ) {
+				auto &chunkNewState = newState.chunks[*chunk];
+				if ( unchanged ) {
+					chunkNewState = *chunkState;
+				}
+				else {
+					chunkNewState.size = size;
+					chunkNewState.mtime = mtime;
+				}
+
+				// the tail of a chunk might have been modified by reading
+				// preceding chunks
+				if ( chunksRead || nextChunk != chunks.cend() ) {
+					chunkNewState.offset = 0;
+					chunkNewState.tail = {};
+				}
+			}
+
 			// previous chunk was read and last segment was not committed yet
 			if ( prevChunkSeg ) {
 				diffSegment(db_seg_it, prevChunkSeg.get(), true);
@@ -332,14 +389,63 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 			continue;
 		}
 
+		ChunkState chunkNewState;
+		chunkNewState.size = size;
+		chunkNewState.mtime = mtime;
+
+		// records were appended to the last chunk: continue reading at the
+		// offset of the previous run starting with the last segment
+		bool appended = false;
+		if ( modified && chunkState && !chunksRead && !prevChunkSeg &&
+		     nextChunk == chunks.cend() && chunkState->offset &&
+		     chunkState->tail.valid() &&
+		     chunkState->tail.end == chunkState->lastRecordEnd &&
+		     size > chunkState->size ) {
+			const auto &tail = chunkState->tail;
+			DataSegmentPtr tailSeg = new DataSegment();
+			tailSeg->setStart(tail.start);
+			tailSeg->setEnd(tail.end);
+			tailSeg->setUpdated(tail.updated);
+			tailSeg->setSampleRate(tail.sampleRate);
+			tailSeg->setQuality(tail.quality);
+
+			SEISCOMP_DEBUG("[%i] %s: Reading chunk at offset %zu (%s, "
+			               "size %zu -> %zu): %s", _id, _sid.c_str(),
+			               chunkState->offset, readTrigger.c_str(),
+			               chunkState->size, size, chunk->c_str());
+			chunkNewState.offset = chunkState->offset;
+			if ( readChunkSegments(segments, *chunk, tailSeg, mtime,
+			                       chunkWindow, chunkNewState) ) {
+				appended = true;
+				if ( chunkState->segments ) {
+					chunkNewState.segments += chunkState->segments - 1;
+				}
+
+				// DB segments ahead of the tail are not affected
+				for ( ; !_app->_exitRequested && *db_seg_it; ++db_seg_it ) {
+					dbSeg = DataSegment::Cast(*db_seg_it);
+					if ( dbSeg->start() >= tail.start ) {
+						break;
+					}
+
+					++_segCount;
+				}
+			}
+		}
+
+		chunksRead = true;
+
 		// read segments from chunk
-		SEISCOMP_DEBUG("[%i] %s: Reading chunk (%s): %s",
-		               _id, _sid.c_str(), readTrigger.c_str(),
-		               chunk->c_str());
-		if ( !readChunkSegments(segments, *chunk, prevChunkSeg, mtime,
-		                        chunkWindow) ) {
-			// TODO: Truncate DB segment to window start time
-			continue;
+		if ( !appended ) {
+			SEISCOMP_DEBUG("[%i] %s: Reading chunk (%s): %s",
+			               _id, _sid.c_str(), readTrigger.c_str(),
+			               chunk->c_str());
+			chunkNewState.offset = 0;
+			if ( !readChunkSegments(segments, *chunk, prevChunkSeg, mtime,
+			                        chunkWindow, chunkNewState) ) {
+				// TODO: Truncate DB segment to window start time
+				continue;
+			}
 		}
 
 		// process chunk segments
@@ -420,6 +526,24 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 			// diff database segments up to current chunk segment
 			diffSegment(db_seg_it, it->get());
 		}
+
+		if ( _states ) {
+			// the last segment of the last chunk is not modified any further
+			const auto &tailSeg = segments.back();
+			if ( nextChunk == chunks.cend() && !tailSeg->outOfOrder() ) {
+				auto &tail = chunkNewState.tail;
+				tail.start = tailSeg->start();
+				tail.end = tailSeg->end();
+				tail.updated = tailSeg->updated();
+				tail.sampleRate = tailSeg->sampleRate();
+				tail.quality = tailSeg->quality();
+			}
+			else {
+				chunkNewState.offset = 0;
+			}
+
+			newState.chunks[*chunk] = chunkNewState;
+		}
 	}
 
 	// remove trailing database segments
@@ -438,6 +562,13 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 		// update extent's last scan time
 		_extent->setLastScan(now);
 		syncExtent();
+
+		// record chunk state unless the extent was removed or is incomplete
+		if ( _states && !_app->_exitRequested && !_segmentOverflow &&
+		     _extent->dataAttributeExtentCount() ) {
+			newState.lastScan = now;
+			_states->set(_sid, std::move(newState));
+		}
 	}
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -445,6 +576,44 @@ void Worker::processExtent(DataExtent *extent, bool foundInDB) {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool Worker::skipUnchangedExtent(const Collector::DataChunks &chunks,
+                                 const ExtentState &state,
+                                 const Core::Time &now) {
+	if ( chunks.empty() || chunks.size() != state.chunks.size() ) {
+		return false;
+	}
+
+	for ( const auto &chunk : chunks ) {
+		if ( _app->_exitRequested ) {
+			return false;
+		}
+
+		const auto *chunkState = state.chunk(chunk);
+		if ( !chunkState || chunkState->size != _collector->chunkSize(chunk) ||
+		     chunkState->mtime != _collector->chunkMTime(chunk) ) {
+			return false;
+		}
+	}
+
+	SEISCOMP_INFO("[%i] %s: All %zu data chunks unchanged since last scan",
+	              _id, _sid.c_str(), chunks.size());
+
+	// only the last scan time needs to be updated
+	_extent->setLastScan(now);
+	if ( writeExtent(OP_UPDATE) ) {
+		ExtentState newState = state;
+		newState.lastScan = now;
+		_states->set(_sid, std::move(newState));
+	}
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 bool Worker::dbConnect() {
 	while ( !_app->_exitRequested &&
@@ -534,18 +703,31 @@ DatabaseIterator Worker::dbSegments(size_t &segmentsOutside) {
 bool Worker::readChunkSegments(Segments &segments, const std::string &chunk,
                                DataModel::DataSegmentPtr chunkSeg,
                                const Core::Time &mtime,
-                               const Core::TimeWindow &window) {
+                               const Core::TimeWindow &window,
+                               ChunkState &state) {
 	segments.clear();
 
 	Collector::RecordIteratorPtr rec;
 	try {
-		rec = _collector->begin(chunk, _extent->waveformID());
+		if ( state.offset ) {
+			rec = _collector->beginAt(chunk, _extent->waveformID(),
+			                          state.offset);
+		}
+		else {
+			rec = _collector->begin(chunk, _extent->waveformID());
+		}
 	} catch ( CollectorException &e) {
 		SEISCOMP_WARNING("[%i] %s: %s: %s",
 		                 _id, _sid.c_str(), chunk.c_str(), e.what());
 		return false;
 	}
 
+	if ( !rec ) {
+		SEISCOMP_WARNING("[%i] %s: Could not read chunk at offset %zu: %s",
+		                 _id, _sid.c_str(), state.offset, chunk.c_str());
+		return false;
+	}
+
 	DataModel::DataSegmentPtr segment = chunkSeg;
 	double jitter = segment ? _app->_jitter / segment->sampleRate() : 0;
 
@@ -641,6 +823,7 @@ bool Worker::readChunkSegments(Segments &segments, const std::string &chunk,
 
 		++records;
 		availability += (rec->endTime() - rec->startTime()).length();
+		state.lastRecordEnd = rec->endTime();
 //		SEISCOMP_DEBUG("%s - %s (%.3fs)", it->startTime().iso().c_str(),
 //		               it->endTime().iso().c_str(),
 //		               (it->endTime() - it->startTime()).length());
@@ -654,6 +837,8 @@ bool Worker::readChunkSegments(Segments &segments, const std::string &chunk,
 
 	segments.emplace_back(segment.get());
 
+	state.offset = rec->offset();
+
 	// sort segment vector according start time if out of order data
 	// was detected
 	if ( outOfOrder > 0 ) {
@@ -698,6 +883,8 @@ bool Worker::readChunkSegments(Segments &segments, const std::string &chunk,
 	               outOfOrder, dropped, rateChanges, qualityChanges, records,
 	               availability / static_cast<double>(window.length()) * 100.0, availability);
 
+	state.segments = segments.size();
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -1156,7 +1343,8 @@ void SCARDAC::createCommandLineDescription() {
 	                        &_exclude);
 	commandline().addOption("Collector", "deep-scan",
 	                        "Process all data chunks independent of their "
-	                        "modification time.");
+	                        "modification time and decode all records instead "
+	                        "of reading the record headers only.");
 	commandline().addOption("Collector", "modified-since",
 	                        "Only read chunks modified after specific date "
 	                        "given as date string or as number of days before "
@@ -1168,6 +1356,14 @@ void SCARDAC::createCommandLineDescription() {
 	                        "given as date string or as number of days before "
 	                        "now. Unused in deep-scan mode.",
 	                        &_modifiedUntil);
+	commandline().addOption("Collector", "state-file",
+	                        "File to keep the size, modification time and "
+	                        "read offset of all data chunks between runs. "
+	                        "Unchanged chunks are skipped and records appended "
+	                        "to the last chunk of a stream are read "
+	                        "incrementally. Unused if a start, end or "
+	                        "modification time is given.",
+	                        &_stateFile);
 	commandline().addOption("Collector", "generate-test-data",
 	                        "For each stream in inventory generate test data. "
 	                        "Format: days,gaps,gapseconds,overlaps,"
@@ -1266,6 +1462,11 @@ bool SCARDAC::initConfiguration() {
 	}
 	catch (...) {}
 
+	try {
+		_stateFile = SCCoreApp->configGetString("stateFile");
+	}
+	catch (...) {}
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -1334,6 +1535,17 @@ bool SCARDAC::validateParameters() {
 		}
 	}
 
+	// chunk states describe the entire extent
+	if ( !_stateFile.empty() ) {
+		if ( _startTime || _endTime || _mtimeStart || _mtimeEnd ) {
+			SEISCOMP_INFO("State file ignored, scan limited by time window");
+		}
+		else {
+			_stateFile = Environment::Instance()->absolutePath(_stateFile);
+			_useChunkStates = true;
+		}
+	}
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -1362,7 +1574,7 @@ bool SCARDAC::run() {
 	// print configuration
 	string cfgMtime;
 	if ( _deepScan ) {
-		cfgMtime = "         : ignored";
+		cfgMtime = "         : ignored, records decoded";
 	}
 	else {
 		stringstream oss;
@@ -1397,6 +1609,7 @@ bool SCARDAC::run() {
   jitter        : %f
   max segments  : %zu
   nslc list     : %s
+  state file    : %s
   data filter
     start time  : %s
     end time    : %s
@@ -1408,6 +1621,7 @@ bool SCARDAC::run() {
 	              (_wfidFile.empty()
 	                       ?string("obtained by archive scan")
 	                       :_wfidFile).c_str(),
+	              (_useChunkStates ? _stateFile : string("-")).c_str(),
 	              (_startTime?_startTime->iso():string("-")).c_str(),
 	              (_endTime?_endTime->iso():string("-")).c_str(),
 	              cfgInclude.c_str(), cfgExclude.c_str(), cfgMtime.c_str());
@@ -1421,7 +1635,11 @@ bool SCARDAC::run() {
 	}
 
 	// update collector's time window
-	setTimeWindow(_collector.get());
+	setupCollector(_collector.get());
+
+	if ( _useChunkStates && !_chunkStates.load(_stateFile, _jitter) ) {
+		return false;
+	}
 
 	// disable public object cache
 	PublicObject::SetRegistrationEnabled(false);
@@ -1537,6 +1755,10 @@ bool SCARDAC::run() {
 
 	_workQueue.reset();
 
+	if ( _useChunkStates && !_chunkStates.save(_stateFile) ) {
+		return false;
+	}
+
 	return true;
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -1564,7 +1786,9 @@ void SCARDAC::done() {
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-void SCARDAC::setTimeWindow(Collector *collector) {
+void SCARDAC::setupCollector(Collector *collector) {
+	collector->setDeepScan(_deepScan);
+
 	if ( _startTime ) {
 		collector->setStartTime(*_startTime);
 	}
@@ -1583,9 +1807,10 @@ void SCARDAC::processExtents(int threadID) {
 	auto *collector = _collector.get();
 	if ( threadID > 1 && !_collector->threadSafe() ) {
 		collector = Collector::Open(_archive.c_str());
-		setTimeWindow(collector);
+		setupCollector(collector);
 	}
-	Worker worker(this, threadID, collector);
+	Worker worker(this, threadID, collector,
+	              _useChunkStates ? &_chunkStates : nullptr);
 
 	WorkQueueItem item;
 	while ( !_exitRequested ) {
@@ -16,6 +16,8 @@
 
 #include <seiscomp/plugins/dataavailability/collector.h>
 
+#include "chunkstate.h"
+
 #include <seiscomp/client/application.h>
 #include <seiscomp/client/queue.h>
 #include <seiscomp/client/queue.ipp>
@@ -43,7 +45,8 @@ class SCARDAC;
 
 class Worker {
 	public:
-		Worker(const SCARDAC *app, int id, Collector *collector);
+		Worker(const SCARDAC *app, int id, Collector *collector,
+		       ChunkStateFile *states = nullptr);
 
 		void processExtent(DataModel::DataExtent *extent, bool foundInDB);
 
@@ -56,7 +59,11 @@ class Worker {
 		bool readChunkSegments(Segments &segments, const std::string &chunk,
 		                       DataModel::DataSegmentPtr chunkSeg,
 		                       const Core::Time &mtime,
-		                       const Core::TimeWindow &window);
+		                       const Core::TimeWindow &window,
+		                       ChunkState &state);
+		bool skipUnchangedExtent(const Collector::DataChunks &chunks,
+		                         const ExtentState &state,
+		                         const Core::Time &now);
 
 		void diffSegment(DataModel::DatabaseIterator &db_seg_it,
 		                 DataModel::DataSegment *chunkSeg, bool extent = false);
@@ -70,6 +77,7 @@ class Worker {
 		const SCARDAC*                  _app{nullptr};
 		int                             _id{0};
 		CollectorPtr                    _collector;
+		ChunkStateFile                 *_states{nullptr};
 
 		// initialized by first processExtent call and reused subsequently
 		DataModel::DatabaseReaderPtr    _db;
@@ -122,7 +130,7 @@ class SCARDAC : public Client::Application {
 		bool run() override;
 		void done() override;
 
-		void setTimeWindow(Collector *collector);
+		void setupCollector(Collector *collector);
 		void processExtents(int threadID);
 		bool generateTestData();
 
@@ -149,6 +157,8 @@ class SCARDAC : public Client::Application {
 		std::string     _modifiedUntil;
 		OPT(Core::Time) _mtimeStart;
 		OPT(Core::Time) _mtimeEnd;
+		std::string     _stateFile;
+		bool            _useChunkStates{false};
 
 		Util::WildcardStringFirewall         _wfidFirewall;
 
@@ -157,6 +167,10 @@ class SCARDAC : public Client::Application {
 
 		DataModel::DataAvailabilityPtr       _dataAvailability{nullptr};
 
+		// Chunk states of previous runs, read and written if a state file
+		// is configured
+		ChunkStateFile                       _chunkStates;
+
 		// Thread safe queue of extends to process
 		Client::ThreadedQueue<WorkQueueItem> _workQueue;
 
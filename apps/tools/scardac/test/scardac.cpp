@@ -380,6 +380,88 @@ BOOST_AUTO_TEST_CASE(basic) {
 
 
 
+//<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+BOOST_AUTO_TEST_CASE(headerscan) {
+	// SHZ: the file of the basic archive
+	// SHN: the records of SHZ with a gap of 60s after the fifth record and
+	//      a sampling rate of 100Hz in the last three records
+	// SHE: the record times of SHZ without blockette 1000, the record
+	//      length is unknown to the header scan which falls back to
+	//      decoding the records
+	auto *env = Environment::Instance();
+	auto deepDBPath = env->configDir() + "/seiscomp-deep.db";
+	{
+		std::ifstream src(env->installDir() + "/seiscomp.db", std::ios::binary);
+		std::ofstream dst(deepDBPath, std::ios::binary);
+		dst << src.rdbuf();
+	}
+	auto deepDBURI = "sqlite3://" + deepDBPath;
+
+	string ctx("header scan");
+	BOOST_TEST_MESSAGE(ctx);
+	DataModel::DatabaseReaderPtr reader = runApp(dbURI, {appName});
+
+	DataModel::DataAvailabilityPtr da = reader->loadDataAvailability();
+	BOOST_ASSERT_MSG(da, "Could not load data availability");
+	BOOST_REQUIRE_EQUAL(da->dataExtentCount(), 3);
+
+	map<string, DataModel::DataExtent*> extents;
+	for ( size_t i = 0; i < da->dataExtentCount(); ++i ) {
+		auto *ext = da->dataExtent(i);
+		reader->load(ext);
+		extents[ext->waveformID().channelCode()] = ext;
+	}
+
+	auto extent = [&extents](const string &channel) {
+		auto it = extents.find(channel);
+		BOOST_REQUIRE_MESSAGE(it != extents.end(), "No extent found: " << channel);
+		return it->second;
+	};
+
+	// basic
+	for ( const auto &channel : { "SHZ", "SHE" } ) {
+		auto *ext = extent(channel);
+		BOOST_CHECK_EQUAL(ext->dataAttributeExtentCount(), 1);
+		BOOST_REQUIRE_EQUAL(ext->dataSegmentCount(), 1);
+		BOOST_CHECK_EQUAL(ext->start().iso(), "2019-08-02T17:59:58.217999Z");
+		BOOST_CHECK_EQUAL(ext->end().iso(), "2019-08-02T18:01:04.837999Z");
+		BOOST_CHECK_EQUAL(ext->dataSegment(0)->sampleRate(), 50.0);
+	}
+
+	// gap and change of sampling rate
+	auto *ext = extent("SHN");
+	BOOST_CHECK_EQUAL(ext->start().iso(), "2019-08-02T17:59:58.217999Z");
+	BOOST_CHECK_EQUAL(ext->end().iso(), "2019-08-02T18:02:01.897999Z");
+	BOOST_CHECK_EQUAL(ext->dataAttributeExtentCount(), 2);
+	BOOST_REQUIRE_EQUAL(ext->dataSegmentCount(), 5);
+
+	const char *segments[5][2] = {
+		{ "2019-08-02T17:59:58.217999Z", "2019-08-02T18:00:30.897999Z" },
+		{ "2019-08-02T18:01:30.897999Z", "2019-08-02T18:01:47.797999Z" },
+		{ "2019-08-02T18:01:47.797999Z", "2019-08-02T18:01:50.427999Z" },
+		{ "2019-08-02T18:01:53.057999Z", "2019-08-02T18:01:56.007999Z" },
+		{ "2019-08-02T18:01:58.957999Z", "2019-08-02T18:02:01.897999Z" }
+	};
+
+	for ( size_t i = 0; i < 5; ++i ) {
+		auto *seg = ext->dataSegment(i);
+		BOOST_CHECK_EQUAL(seg->start().iso(), segments[i][0]);
+		BOOST_CHECK_EQUAL(seg->end().iso(), segments[i][1]);
+		BOOST_CHECK_EQUAL(seg->sampleRate(), i < 2 ? 50.0 : 100.0);
+	}
+
+	// A deep scan into another database must yield the same extents and
+	// segments
+	ctx = "deep scan";
+	BOOST_TEST_MESSAGE(ctx);
+	reader = runApp(deepDBURI, {appName, "--deep-scan", "-d", deepDBURI});
+	checkEqual(reader, da, ctx);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+
+
+
+
 //<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 BOOST_AUTO_TEST_CASE(nslc) {
 	auto mseedFile = archiveDir + "/2019/AM/R0F05/SHZ.D/AM.R0F05.00.SHZ.D.2019.214";
@@ -734,6 +816,97 @@ BOOST_AUTO_TEST_CASE(timewindow) {
 
 
 
+//<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+BOOST_AUTO_TEST_CASE(incremental) {
+	auto mseedFile = archiveDir + "/2023/AM/R0F05/SHZ.D/AM.R0F05.00.SHZ.D.2023.242";
+	auto stateFile = Environment::Instance()->configDir() + "/scardac.state";
+
+	SC_FS_DECLARE_PATH(statePath, stateFile);
+	if ( fs::exists(statePath) ) {
+		fs::remove(statePath);
+	}
+
+	// offset of last chunk in state file
+	auto stateOffset = [&stateFile, &mseedFile]() -> size_t {
+		ifstream ifs(stateFile);
+		auto fileName = mseedFile.substr(mseedFile.rfind('/'));
+		string line, key, size, mtime;
+		size_t offset = 0;
+		while ( getline(ifs, line) ) {
+			if ( line.size() > fileName.size() &&
+			     line.compare(line.size() - fileName.size(),
+			                  fileName.size(), fileName) == 0 ) {
+				istringstream iss(line);
+				iss >> key >> size >> mtime >> offset;
+			}
+		}
+		return offset;
+	};
+
+	// truncate last file at a record boundary
+	string data;
+	{
+		ifstream ifs(mseedFile, ios::binary);
+		data.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+	}
+	BOOST_REQUIRE(data.size() > 1024);
+	size_t cut = data.size() / 1024 * 512;
+	{
+		ofstream ofs(mseedFile, ios::binary | ios::trunc);
+		ofs.write(data.data(), static_cast<streamsize>(cut));
+	}
+
+	string ctx("initial scan");
+	BOOST_TEST_MESSAGE(ctx);
+	DataModel::DatabaseReaderPtr reader;
+	reader = runApp(dbURI, {appName, "--state-file", stateFile});
+
+	DataModel::DataAvailabilityPtr da = reader->loadDataAvailability();
+	BOOST_ASSERT_MSG(da, "Could not load data availability");
+	BOOST_ASSERT_MSG(da->dataExtentCount(), "No extent found");
+	auto *ext = da->dataExtent(0);
+	BOOST_CHECK(ext->end() < Core::Time(2023, 8, 30, 1, 0, 5, 581000));
+	BOOST_CHECK_EQUAL(stateOffset(), cut);
+
+	// append remaining records
+	ctx = "records appended";
+	BOOST_TEST_MESSAGE(ctx);
+	{
+		ofstream ofs(mseedFile, ios::binary | ios::app);
+		ofs.write(data.data() + cut, static_cast<streamsize>(data.size() - cut));
+	}
+	auto lastScan = ext->lastScan();
+	lastScan.setUSecs(0);
+	auto future = lastScan + Core::TimeSpan(1, 0);
+	boost::filesystem::last_write_time(mseedFile, future.epochSeconds());
+
+	reader = runApp(dbURI, {appName, "--state-file", stateFile});
+	da = reader->loadDataAvailability();
+	BOOST_ASSERT_MSG(da, "Could not load data availability");
+	BOOST_ASSERT_MSG(da->dataExtentCount(), "No extent found");
+	ext = da->dataExtent(0);
+	reader->load(ext);
+	BOOST_CHECK_EQUAL(ext->end().iso(), "2023-08-30T01:00:05.581Z");
+	BOOST_CHECK_EQUAL(ext->updated().iso(), future.iso());
+	BOOST_CHECK_EQUAL(stateOffset(), data.size());
+
+	// unchanged chunks, only the last scan time is updated
+	ctx = "unchanged";
+	BOOST_TEST_MESSAGE(ctx);
+	reader = runApp(dbURI, {appName, "--state-file", stateFile});
+	checkEqual(reader, da, ctx);
+
+	// a full scan yields the same result
+	ctx = "deep scan";
+	BOOST_TEST_MESSAGE(ctx);
+	reader = runApp(dbURI, {appName, "--deep-scan"});
+	checkEqual(reader, da, ctx);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+
+
+
+
 //<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 BOOST_AUTO_TEST_CASE(streamfilter) {
 	BOOST_TEST_MESSAGE("initial scan");
@@ -15,6 +15,7 @@
 
 #include <seiscomp/logging/log.h>
 #include <seiscomp/client/application.h>
+#include <seiscomp/io/archive/binarchive.h>
 #include <seiscomp/io/archive/xmlarchive.h>
 #include <seiscomp/messaging/connection.h>
 #include <seiscomp/utils/timer.h>
@@ -23,6 +24,10 @@
 #include <seiscomp/datamodel/diff.h>
 #include <seiscomp/datamodel/eventparameters_package.h>
 
+#include <streambuf>
+#include <unordered_map>
+#include <unordered_set>
+
 
 using namespace std;
 using namespace Seiscomp;
@@ -32,6 +37,33 @@ using namespace Seiscomp::DataModel;
 typedef map<string, string> RoutingTable;
 
 
+// Number of publicIDs per bulk query in merge mode
+const size_t BulkQuerySize = 500;
+
+
+/** Counts the bytes written to it */
+class ByteCounter : public streambuf {
+	public:
+		size_t count() const { return _count; }
+
+	protected:
+		streamsize xsputn(const char *, streamsize n) override {
+			_count += n;
+			return n;
+		}
+
+		int_type overflow(int_type c) override {
+			if ( !traits_type::eq_int_type(c, traits_type::eof()) ) {
+				++_count;
+			}
+			return traits_type::not_eof(c);
+		}
+
+	private:
+		size_t _count{0};
+};
+
+
 class BaseObjectDispatcher : protected Visitor {
 	// ----------------------------------------------------------------------
 	//  X'struction
@@ -43,6 +75,7 @@ class BaseObjectDispatcher : protected Visitor {
 		, _connection(connection)
 		, _errors(0)
 		, _count(0)
+		, _messages(0)
 		, _test(test)
 		, _createNotifier(false) {}
 
@@ -59,6 +92,7 @@ class BaseObjectDispatcher : protected Visitor {
 		virtual bool operator()(Object *object) {
 			_errors = 0;
 			_count = 0;
+			_messages = 0;
 			_loggedObjects.clear();
 
 			if ( _createNotifier ) {
@@ -67,6 +101,9 @@ class BaseObjectDispatcher : protected Visitor {
 
 			object->accept(this);
 
+			// Send what is left over
+			flush();
+
 			return _errors == 0;
 		}
 
@@ -87,12 +124,24 @@ class BaseObjectDispatcher : protected Visitor {
 			_ignoreTypes = types;
 		}
 
+		//! Packs consecutive notifiers of the same group into one message
+		//! up to maxNotifiers notifiers and up to maxBytes bytes of the
+		//! binary encoded notifiers. A limit of 0 means no limit.
+		void setBatching(size_t maxNotifiers, size_t maxBytes) {
+			_batching = true;
+			_batchMaxNotifiers = maxNotifiers;
+			_batchMaxBytes = maxBytes;
+		}
+
 		//! Returns the number of handled objects
 		int count() const { return _count; }
 
 		//! Returns the number of errors while writing
 		int errors() const { return _errors; }
 
+		//! Returns the number of messages sent
+		int messages() const { return _messages; }
+
 
 	// ----------------------------------------------------------------------
 	//  Protected interface
@@ -153,6 +202,104 @@ class BaseObjectDispatcher : protected Visitor {
 			SEISCOMP_INFO("%s", ss.str().c_str());
 		}
 
+		//! Adds a notifier to the current message and sends the message
+		//! if the group changes or if a batch limit is reached
+		bool queue(const string &group, Notifier *notifier) {
+			if ( _batch && group != _batchGroup ) {
+				flush();
+			}
+
+			size_t bytes = _batchMaxBytes ? encodedSize(notifier) : 0;
+			if ( _batch && _batchMaxBytes && _batchBytes + bytes > _batchMaxBytes ) {
+				flush();
+			}
+
+			if ( !_batch ) {
+				_batch = new NotifierMessage;
+				_batchGroup = group;
+				_batchBytes = 0;
+			}
+
+			_batch->attach(notifier);
+			_batchBytes += bytes;
+
+			if ( _batchMaxNotifiers && _batch->size() >= static_cast<int>(_batchMaxNotifiers) ) {
+				return flush();
+			}
+
+			return true;
+		}
+
+		//! Sends the current message
+		bool flush() {
+			if ( !_batch ) {
+				return true;
+			}
+
+			NotifierMessagePtr msg = _batch;
+			_batch = nullptr;
+
+			if ( _test ) {
+				SEISCOMP_DEBUG("Would send %d notifiers to %s group",
+				               msg->size(), _batchGroup.c_str());
+				++_messages;
+				return true;
+			}
+
+			SEISCOMP_DEBUG("Send %d notifiers to %s group",
+			               msg->size(), _batchGroup.c_str());
+
+			if ( send(_batchGroup, msg.get()) ) {
+				++_messages;
+				return true;
+			}
+
+			_errors += msg->size();
+			return false;
+		}
+
+		virtual bool send(const string &group, NotifierMessage *msg) {
+			size_t counter = 0;
+			while ( counter <= 4 ) {
+				if ( _connection->send(group, msg) ) {
+					return true;
+				}
+
+				if ( msg->size() == 1 ) {
+					SEISCOMP_ERROR("Could not send object %s to %s@%s",
+					               (*msg->begin())->object()->className(),
+					               group.c_str(), _connection->source().c_str());
+				}
+				else {
+					SEISCOMP_ERROR("Could not send %d notifiers to %s@%s",
+					               msg->size(), group.c_str(),
+					               _connection->source().c_str());
+				}
+
+				if ( _connection->isConnected() ) {
+					break;
+				}
+
+				++counter;
+				sleep(1);
+			}
+
+			return false;
+		}
+
+		static size_t encodedSize(Notifier *notifier) {
+			ByteCounter counter;
+			IO::BinaryArchive ar;
+			if ( !ar.create(&counter) ) {
+				return 0;
+			}
+
+			NotifierPtr tmp(notifier);
+			ar << tmp;
+			ar.close();
+			return counter.count();
+		}
+
 
 	// ----------------------------------------------------------------------
 	//  Protected members
@@ -161,12 +308,20 @@ class BaseObjectDispatcher : protected Visitor {
 		Client::Connection        *_connection;
 		int                        _errors;
 		int                        _count;
+		int                        _messages;
 		RoutingTable               _routingTable;
 		bool                       _test;
 		std::set<std::string>      _loggedObjects;
 		bool                       _createNotifier;
 		int                        _ignoreTypes{};
 		NotifierMessagePtr         _outputNotifier;
+		// Without batching every notifier is sent on its own
+		bool                       _batching{false};
+		size_t                     _batchMaxNotifiers{1};
+		size_t                     _batchMaxBytes{0};
+		NotifierMessagePtr         _batch;
+		string                     _batchGroup;
+		size_t                     _batchBytes{0};
 };
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -263,28 +418,7 @@ class ObjectDispatcherV1 : public BaseObjectDispatcher {
 				return true;
 			}
 
-			NotifierMessage notifierMessage;
-			notifierMessage.attach(notif.get());
-
-			size_t counter = 0;
-			while ( counter <= 4 ) {
-				if ( _connection->send(targetIt->second, &notifierMessage) ) {
-					return true;
-				}
-
-				SEISCOMP_ERROR("Could not send object %s to %s@%s",
-				               object->className(), targetIt->second.c_str(),
-				               _connection->source().c_str());
-				if ( _connection->isConnected() ) {
-					break;
-				}
-
-				++counter;
-				sleep(1);
-			}
-
-			++_errors;
-			return false;
+			return queue(targetIt->second, notif.get());
 		}
 
 
@@ -389,28 +523,11 @@ class ObjectDispatcherV2 : public BaseObjectDispatcher {
 				return _operation != OP_REMOVE;
 			}
 
-			NotifierMessage notifierMessage;
-			notifierMessage.attach(notif.get());
-
-			size_t counter = 0;
-			while ( counter <= 4 ) {
-				if ( _connection->send(targetIt->second, &notifierMessage) ) {
-					return _operation != OP_REMOVE;
-				}
-
-				SEISCOMP_ERROR("Could not send object %s to %s@%s",
-				               object->className(), targetIt->second.c_str(),
-				               _connection->source().c_str());
-				if ( _connection->isConnected() ) {
-					break;
-				}
-
-				++counter;
-				sleep(1);
+			if ( !queue(targetIt->second, notif.get()) ) {
+				return false;
 			}
 
-			++_errors;
-			return false;
+			return _operation != OP_REMOVE;
 		}
 
 
@@ -427,6 +544,34 @@ class ObjectDispatcherV2 : public BaseObjectDispatcher {
 
 
 
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+class PublicObjectCollector : protected Visitor {
+	public:
+		//! Collects the publicIDs of all public objects below object
+		//! grouped by class name
+		PublicObjectCollector(Object *object, map<string, vector<string>> &publicIDs)
+		: Visitor(), _publicIDs(publicIDs) {
+			object->accept(this);
+		}
+
+	protected:
+		bool visit(PublicObject *po) {
+			if ( po->parent() ) {
+				_publicIDs[po->className()].push_back(po->publicID());
+			}
+			return true;
+		}
+
+		virtual void visit(Object*) {}
+
+	private:
+		map<string, vector<string>> &_publicIDs;
+};
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 class ObjectMerger : public BaseObjectDispatcher {
 	// ----------------------------------------------------------------------
@@ -437,9 +582,11 @@ class ObjectMerger : public BaseObjectDispatcher {
 		             DatabaseReader *db, bool test, bool allowRemove)
 		: BaseObjectDispatcher(Visitor::TM_TOPDOWN, connection, test)
 		, _db(db)
-		, _msgCount(0)
-		, _allowRemove(allowRemove)
-		{}
+		, _allowRemove(allowRemove) {
+			// Without batching all notifiers of a public object go into
+			// one message
+			_batchMaxNotifiers = 0;
+		}
 
 
 	// ----------------------------------------------------------------------
@@ -447,11 +594,10 @@ class ObjectMerger : public BaseObjectDispatcher {
 	// ----------------------------------------------------------------------
 	public:
 		bool operator()(Object *object) {
-			_msgCount = 0;
-
+			checkStoredObjects(object);
 			bool ret = BaseObjectDispatcher::operator()(object);
-
-			flush();
+			_checked.clear();
+			_storedParents.clear();
 			return ret;
 		}
 
@@ -462,7 +608,9 @@ class ObjectMerger : public BaseObjectDispatcher {
 	protected:
 		bool visit(PublicObject *po) {
 			// Each PublicObject in a single message
-			flush();
+			if ( !_batching ) {
+				flush();
+			}
 
 			PublicObject *parent = po->parent();
 
@@ -502,14 +650,37 @@ class ObjectMerger : public BaseObjectDispatcher {
 
 			_targetGroup = targetIt->second;
 
-			PublicObjectPtr stored = _db->loadObject(po->typeInfo(), po->publicID());
+			PublicObjectPtr stored;
+			string storedParent;
 
-			if ( !stored ) {
-				write(parent, po, OP_ADD);
-				return true;
+			if ( _checked.find(po->publicID()) != _checked.end() ) {
+				auto it = _storedParents.find(po->publicID());
+				if ( it == _storedParents.end() ) {
+					write(parent, po, OP_ADD);
+					return true;
+				}
+
+				storedParent = it->second;
+				if ( storedParent == parent->publicID() ) {
+					// Only objects to be compared are loaded
+					stored = _db->loadObject(po->typeInfo(), po->publicID());
+					if ( !stored ) {
+						write(parent, po, OP_ADD);
+						return true;
+					}
+				}
+			}
+			else {
+				stored = _db->loadObject(po->typeInfo(), po->publicID());
+
+				if ( !stored ) {
+					write(parent, po, OP_ADD);
+					return true;
+				}
+
+				storedParent = _db->parentPublicID(stored.get());
 			}
 
-			string storedParent = _db->parentPublicID(stored.get());
 			if ( storedParent != parent->publicID() ) {
 				// Instead of losing information due to a re-parent
 				// we just create a new publicID and so a copy of the underlying
@@ -542,7 +713,9 @@ class ObjectMerger : public BaseObjectDispatcher {
 
 				po = PublicObject::Cast(n->object());
 				if ( po != nullptr ) {
-					flush();
+					if ( !_batching ) {
+						flush();
+					}
 					targetIt = _routingTable.find(po->className());
 					if ( targetIt != _routingTable.end() && targetIt->second != _targetGroup )
 						_targetGroup = targetIt->second;
@@ -589,43 +762,95 @@ class ObjectMerger : public BaseObjectDispatcher {
 				return true;
 			}
 
-			if ( !_msg ) _msg = new NotifierMessage;
-
-			_msg->attach(notif.get());
+			queue(_targetGroup, notif.get());
 
 			return false;
 		}
 
-		void flush() {
-			if ( !_msg || _createNotifier ) { // redundant check but better safe...
-				return;
+		bool send(const string &group, NotifierMessage *msg) override {
+			while ( !SCCoreApp->isExitRequested() ) {
+				if ( _connection->send(group, msg) ) {
+					return true;
+				}
+
+				SEISCOMP_ERROR("Could not send message to %s@%s",
+				               group.c_str(), _connection->source().c_str());
+
+				sleep(1);
 			}
-			if ( _test ) {
-				SEISCOMP_DEBUG("Would send %d notifiers to %s group",
-				               _msg->size(), _targetGroup.c_str());
-				++_msgCount;
-				_msg = nullptr;
+
+			return false;
+		}
+
+		//! Looks up which public objects of the document exist in the
+		//! database along with their parent publicID with one query per
+		//! type and chunk of publicIDs. Objects which are not stored are
+		//! not loaded at all then, see visit.
+		void checkStoredObjects(Object *object) {
+			_checked.clear();
+			_storedParents.clear();
+
+			DatabaseInterface *db = _db ? _db->driver() : nullptr;
+			if ( !db ) {
 				return;
 			}
 
-			SEISCOMP_DEBUG("Send %d notifiers to %s group",
-			               _msg->size(), _targetGroup.c_str());
+			Util::StopWatch timer;
+			map<string, vector<string>> publicIDs;
+			PublicObjectCollector(object, publicIDs);
+
+			for ( const auto &[table, ids] : publicIDs ) {
+				for ( size_t from = 0; from < ids.size(); from += BulkQuerySize ) {
+					size_t to = min(from + BulkQuerySize, ids.size());
+					vector<string> chunk;
+					string in;
+
+					for ( size_t i = from; i < to; ++i ) {
+						string escapedPublicID;
+						if ( !db->escape(escapedPublicID, ids[i]) ) {
+							// Left to be loaded one by one
+							continue;
+						}
+
+						if ( !in.empty() ) {
+							in += ",";
+						}
+						in += "'" + escapedPublicID + "'";
+						chunk.push_back(ids[i]);
+					}
 
-			while ( !SCCoreApp->isExitRequested() ) {
-				if ( _connection->send(_targetGroup.c_str(), _msg.get()) ) {
-					_msg = nullptr;
-					++_msgCount;
-					return;
-				}
+					if ( chunk.empty() ) {
+						continue;
+					}
 
-				SEISCOMP_ERROR("Could not send message to %s@%s",
-				               _targetGroup.c_str(), _connection->source().c_str());
+					string query =
+						"select PObject." + db->convertColumnName("publicID") + ","
+						"PParent." + db->convertColumnName("publicID") + " "
+						"from " + table + " "
+						"join PublicObject as PObject on PObject._oid=" + table + "._oid "
+						"join PublicObject as PParent on PParent._oid=" + table + "._parent_oid "
+						"where PObject." + db->convertColumnName("publicID") + " in (" + in + ")";
+
+					if ( !db->beginQuery(query.c_str()) ) {
+						SEISCOMP_WARNING("Failed to query stored %s objects, check "
+						                 "them one by one", table.c_str());
+						continue;
+					}
 
-				sleep(1);
+					while ( db->fetchRow() ) {
+						_storedParents[db->getRowFieldString(0)] = db->getRowFieldString(1);
+					}
+
+					db->endQuery();
+
+					_checked.insert(chunk.begin(), chunk.end());
+				}
 			}
 
-			_msg = nullptr;
-			++_errors;
+			SEISCOMP_INFO("Found %d of %d objects in database in %s",
+			              static_cast<int>(_storedParents.size()),
+			              static_cast<int>(_checked.size()),
+			              (Core::Time() + timer.elapsed()).toString("%T.%f").c_str());
 		}
 
 		void logObject(Object *object, Operation op, const std::string &group) {
@@ -641,11 +866,13 @@ class ObjectMerger : public BaseObjectDispatcher {
 	// ----------------------------------------------------------------------
 	private:
 		DatabaseReader     *_db;
-		NotifierMessagePtr  _msg;
-		int                 _msgCount;
 		string              _targetGroup;
 		string              _inputIndent;
 		bool                _allowRemove;
+		// PublicIDs looked up by checkStoredObjects and the parent
+		// publicIDs of those which are stored
+		unordered_set<string>         _checked;
+		unordered_map<string, string> _storedParents;
 };
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -730,6 +957,16 @@ class DispatchTool : public Seiscomp::Client::Application {
 			                        "object:group pairs.",
 			                        &_routingTableStr, false);
 			commandline().addOption("Dispatch", "test", "Do not send any object.");
+			commandline().addOption("Dispatch", "batch-size",
+			                        "Pack up to this number of notifiers "
+			                        "for the same group into one message. "
+			                        "0 for no limit.",
+			                        &_batchSize);
+			commandline().addOption("Dispatch", "batch-bytes",
+			                        "Pack notifiers for the same group into one "
+			                        "message up to this number of bytes. "
+			                        "0 for no limit.",
+			                        &_batchBytes);
 		}
 
 
@@ -870,6 +1107,13 @@ class DispatchTool : public Seiscomp::Client::Application {
 				dispatcher->setCreateNotifierMsg(true);
 				SEISCOMP_INFO("XML output enabled, not messages will be sent");
 			}
+			else if ( commandline().hasOption("batch-size")
+			       || commandline().hasOption("batch-bytes") ) {
+				dispatcher->setBatching(_batchSize, _batchBytes);
+				SEISCOMP_INFO("Batching enabled: up to %s notifiers and %s bytes per message",
+				              _batchSize ? Core::toString(_batchSize).c_str() : "any",
+				              _batchBytes ? Core::toString(_batchBytes).c_str() : "any");
+			}
 
 			unsigned int totalCount = ObjectCounter(doc.get()).count();
 
@@ -894,11 +1138,16 @@ class DispatchTool : public Seiscomp::Client::Application {
 				ar.close();
 			}
 
+			double elapsed = double(timer.elapsed());
+
 			SEISCOMP_INFO("While dispatching %d/%d objects %d errors occured",
 			              dispatcher->count(), totalCount, dispatcher->errors());
 			SEISCOMP_INFO("Time needed to dispatch %d objects: %s",
 			              dispatcher->count(),
 			              (Core::Time() + timer.elapsed()).toString("%T.%f"));
+			SEISCOMP_INFO("Sent %d messages, %.1f objects/s",
+			              dispatcher->messages(),
+			              elapsed > 0 ? dispatcher->count() / elapsed : 0.0);
 
 			delete dispatcher;
 
@@ -914,6 +1163,8 @@ class DispatchTool : public Seiscomp::Client::Application {
 		string               _routingTableStr;
 		RoutingTable         _routingTable;
 		Operation            _operation;
+		size_t               _batchSize{0};
+		size_t               _batchBytes{0};
 
 };
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -16,7 +16,6 @@
 
 #include <seiscomp/logging/log.h>
 #include <seiscomp/client/application.h>
-#include <seiscomp/io/archive/xmlarchive.h>
 #include <seiscomp/datamodel/inventory.h>
 #include <seiscomp/datamodel/config.h>
 #include <seiscomp/datamodel/journaling.h>
@@ -30,12 +29,18 @@
 #include <seiscomp/datamodel/magnitude.h>
 #include <seiscomp/datamodel/stationmagnitude.h>
 #include <seiscomp/datamodel/amplitude.h>
+#include <seiscomp/datamodel/comment.h>
 #include <seiscomp/datamodel/focalmechanism.h>
 #include <seiscomp/datamodel/momenttensor.h>
+#include <seiscomp/private/objectloader.h>
+#include <seiscomp/private/streamwriter.h>
 
 #include <set>
 
 
+#define _T(name) query()->driver()->convertColumnName(name)
+
+
 using namespace std;
 using namespace Seiscomp;
 using namespace Seiscomp::Core;
@@ -43,6 +48,41 @@ using namespace Seiscomp::IO;
 using namespace Seiscomp::DataModel;
 
 
+// Number of events or origins whose picks and amplitudes are loaded at once
+static const size_t BulkEventCount = 50;
+
+// Number of IDs per bulk query
+static const size_t BulkQuerySize = 500;
+
+
+static void removeAllObjects(Seiscomp::DataModel::EventParameters *ep) {
+
+	while ( ep->pickCount() > 0 ) {
+		ep->removePick(ep->pickCount() - 1);
+	}
+
+	while ( ep->amplitudeCount() > 0 ) {
+		ep->removeAmplitude(ep->amplitudeCount() - 1);
+	}
+
+	while ( ep->readingCount() > 0 ) {
+		ep->removeReading(ep->readingCount() - 1);
+	}
+
+	while ( ep->originCount() > 0 ) {
+		ep->removeOrigin(ep->originCount() - 1);
+	}
+
+	while ( ep->focalMechanismCount() > 0 ) {
+		ep->removeFocalMechanism(ep->focalMechanismCount() - 1);
+	}
+
+	while ( ep->eventCount() > 0 ) {
+		ep->removeEvent(ep->eventCount() - 1);
+	}
+}
+
+
 static void removeAllArrivals(Seiscomp::DataModel::Origin *origin) {
 
 	while ( origin->arrivalCount() > 0 ) {
@@ -383,47 +423,59 @@ class XMLDump : public Seiscomp::Client::Application {
 			return true;
 		}
 
-		bool write(PublicObject *po) {
-			if ( !_archive ) {
-				_archive = new XMLArchive();
-				_archive->setFormattedOutput(_settings.formatted);
-
-				if ( _settings.prependDatasize ) {
-					if ( !_archive->create(&_archiveBuf) ) {
-						SEISCOMP_ERROR("Could not create output file '%s'",
-						               _settings.outputFile);
-						delete _archive;
-						_archive = nullptr;
-						return false;
-					}
-				}
-				else {
-					if ( !_archive->create(_settings.outputFile.c_str()) ) {
-						SEISCOMP_ERROR("Could not create output file '%s'",
-						               _settings.outputFile);
-						delete _archive;
-						_archive = nullptr;
-						return false;
-					}
+		bool openArchive() {
+			if ( _writer.isOpen() ) {
+				return true;
+			}
+
+			_writer.setFormattedOutput(_settings.formatted);
+			_writer.setCompression(_settings.gzip);
+			_writer.setBinary(_settings.binary);
+
+			if ( _settings.prependDatasize ) {
+				if ( !_writer.create(&_archiveBuf) ) {
+					SEISCOMP_ERROR("Could not create output file '%s'",
+					               _settings.outputFile);
+					return false;
 				}
 			}
+			else if ( !_writer.create(_settings.outputFile) ) {
+				return false;
+			}
+
+			return true;
+		}
 
+		bool write(PublicObject *po) {
+			if ( !openArchive() ) {
+				return false;
+			}
 
 			if ( po ) {
-				*_archive << po;
+				return _writer.write(po);
+			}
+
+			return true;
+		}
+
+		//! Writes the objects collected in the event parameters so far and
+		//! removes them. All event parameters written until the archive
+		//! is flushed end up in one EventParameters element.
+		bool writeEventParameters(EventParameters *ep) {
+			if ( !openArchive() || !_writer.writeChildren(ep) ) {
+				return false;
 			}
 
+			removeAllObjects(ep);
 			return true;
 		}
 
 		bool flushArchive() {
-			if ( !_archive ) {
+			if ( !_writer.isOpen() ) {
 				return false;
 			}
 
-			_archive->close();
-			delete _archive;
-			_archive = nullptr;
+			_writer.close();
 
 			if ( !_settings.prependDatasize ) {
 				return true;
@@ -678,7 +730,36 @@ class XMLDump : public Seiscomp::Client::Application {
 				}
 			}
 
-			return write(inv.get());
+			if ( !openArchive() ) {
+				return false;
+			}
+
+			// Write the networks one by one instead of serializing the
+			// whole inventory at once
+			vector<NetworkPtr> networks;
+			for ( size_t i = 0; i < inv->networkCount(); ++i ) {
+				networks.push_back(inv->network(i));
+			}
+
+			while ( inv->networkCount() > 0 ) {
+				inv->removeNetwork(inv->networkCount() - 1);
+			}
+
+			if ( !_writer.writeChildren(inv.get()) ) {
+				return false;
+			}
+
+			for ( auto &network : networks ) {
+				inv->add(network.get());
+				if ( !_writer.writeChildren(inv.get()) ) {
+					return false;
+				}
+
+				inv->removeNetwork(network.get());
+				network = nullptr;
+			}
+
+			return true;
 		}
 
 
@@ -811,6 +892,7 @@ class XMLDump : public Seiscomp::Client::Application {
 					ep = new EventParameters;
 				}
 
+				size_t count = 0;
 				for ( const auto &publicID : _eventIDs ) {
 					EventPtr event = Event::Cast(PublicObjectPtr(
 						query()->getObject(Event::TypeInfo(), publicID)));
@@ -820,7 +902,16 @@ class XMLDump : public Seiscomp::Client::Application {
 					else {
 						SEISCOMP_ERROR("Event with ID '%s' has not been found", publicID.c_str());
 					}
+
+					if ( ++count % BulkEventCount == 0 ) {
+						loadRequested(ep.get());
+						if ( !writeEventParameters(ep.get()) ) {
+							return false;
+						}
+					}
 				}
+
+				loadRequested(ep.get());
 			}
 
 			if ( ! _originIDs.empty() ) {
@@ -829,6 +920,7 @@ class XMLDump : public Seiscomp::Client::Application {
 					ep = new EventParameters;
 				}
 
+				size_t count = 0;
 				for ( const auto &publicID : _originIDs ) {
 					OriginPtr origin = Origin::Cast(PublicObjectPtr(
 						query()->getObject(Origin::TypeInfo(), publicID)));
@@ -838,7 +930,16 @@ class XMLDump : public Seiscomp::Client::Application {
 					else {
 						SEISCOMP_ERROR("Origin with ID '%s' has not been found", publicID.c_str());
 					}
+
+					if ( ++count % BulkEventCount == 0 ) {
+						loadRequested(ep.get());
+						if ( !writeEventParameters(ep.get()) ) {
+							return false;
+						}
+					}
 				}
+
+				loadRequested(ep.get());
 			}
 
 			if ( !_pickIDs.empty() ) {
@@ -850,6 +951,7 @@ class XMLDump : public Seiscomp::Client::Application {
 				for ( const auto &publicID : _pickIDs ) {
 					if ( _pickIDSet.find(publicID) != _pickIDSet.end() ) {
 						SEISCOMP_INFO("Pick '%s' already exported", publicID.c_str());
+						continue;
 					}
 
 					PickPtr pick = Pick::Cast(PublicObjectPtr(
@@ -864,7 +966,7 @@ class XMLDump : public Seiscomp::Client::Application {
 				}
 			}
 
-			if ( ep && !write(ep.get()) ) {
+			if ( ep && !writeEventParameters(ep.get()) ) {
 				return false;
 			}
 
@@ -943,7 +1045,8 @@ class XMLDump : public Seiscomp::Client::Application {
 
 			EventParametersPtr ep = new EventParameters;
 			addEvent(ep.get(), e);
-			write(ep.get()) && flushArchive();
+			loadRequested(ep.get());
+			writeEventParameters(ep.get()) && flushArchive();
 		}
 
 
@@ -967,24 +1070,7 @@ class XMLDump : public Seiscomp::Client::Application {
 
 			if ( _settings.withPicks ) {
 				for ( size_t a = 0; a < origin->arrivalCount(); ++a ) {
-					const string &pickID = origin->arrival(a)->pickID();
-					if ( _pickIDSet.find(pickID) != _pickIDSet.end() ) {
-						continue;
-					}
-
-					PickPtr pick = Pick::Cast(PublicObjectPtr(
-						query()->getObject(Pick::TypeInfo(), pickID)));
-					if ( !pick ) {
-						SEISCOMP_WARNING("Pick with id '%s' not found", pickID.c_str());
-						continue;
-					}
-
-					query()->load(pick.get());
-
-					if ( !pick->eventParameters() ) {
-						ep->add(pick.get());
-					}
-					_pickIDSet.insert(pickID);
+					requestPick(origin->arrival(a)->pickID());
 				}
 			}
 
@@ -1009,45 +1095,14 @@ class XMLDump : public Seiscomp::Client::Application {
 							continue;
 						}
 
-						if (_amplitudeIDSet.find(amplitudeID) != _amplitudeIDSet.end()) {
-							continue;
-						}
-
-						AmplitudePtr amplitude = Amplitude::Cast(PublicObjectPtr(
-							query()->getObject(Amplitude::TypeInfo(), amplitudeID)));
-						if ( !amplitude ) {
-							SEISCOMP_WARNING("Amplitude with id '%s' not found",
-									 amplitudeID.c_str());
-							continue;
-						}
-
-						if ( !amplitude->eventParameters() ) {
-							ep->add(amplitude.get());
-						}
-
-						_amplitudeIDSet.insert(amplitudeID);
+						requestAmplitude(amplitudeID);
 					}
 				}
 			}
 
 			if ( _settings.withAmplitudes && !_settings.withStationMagnitudes ) {
 				// Extract all amplitudes for all picks
-				for ( size_t p = 0; p < ep->pickCount(); ++p ) {
-					Pick *pick = ep->pick(p);
-					DatabaseIterator it = query()->getAmplitudesForPick(pick->publicID());
-					for ( ; *it; ++it ) {
-						auto *amplitude = Amplitude::Cast(*it);
-						if (_amplitudeIDSet.find(amplitude->publicID()) != _amplitudeIDSet.end()) {
-							continue;
-						}
-
-						if ( amplitude ) {
-							ep->add(amplitude);
-						}
-
-						_amplitudeIDSet.insert(amplitude->publicID());
-					}
-				}
+				requestPickAmplitudes();
 			}
 		}
 
@@ -1146,25 +1201,7 @@ class XMLDump : public Seiscomp::Client::Application {
 
 				if ( _settings.withPicks ) {
 					for ( size_t a = 0; a < origin->arrivalCount(); ++a ) {
-						const string &pickID = origin->arrival(a)->pickID();
-						if ( _pickIDSet.find(pickID) != _pickIDSet.end() ) {
-							continue;
-						}
-
-						PickPtr pick = Pick::Cast(PublicObjectPtr(
-							query()->getObject(Pick::TypeInfo(), pickID)));
-						if ( !pick ) {
-							SEISCOMP_WARNING("Pick with id '%s' not found",
-									 pickID.c_str());
-							continue;
-						}
-
-						query()->load(pick.get());
-
-						if ( !pick->eventParameters() ) {
-							ep->add(pick.get());
-						}
-						_pickIDSet.insert(pickID);
+						requestPick(origin->arrival(a)->pickID());
 					}
 				}
 
@@ -1187,24 +1224,8 @@ class XMLDump : public Seiscomp::Client::Application {
 								               staMag->publicID().c_str());
 								continue;
 							}
-							if ( _amplitudeIDSet.find(amplitudeID) != _amplitudeIDSet.end() ) {
-								continue;
-							}
-
-							AmplitudePtr amplitude = Amplitude::Cast(PublicObjectPtr(
-								query()->getObject(Amplitude::TypeInfo(), amplitudeID)));
-
-							if ( !amplitude ) {
-								SEISCOMP_WARNING("Amplitude with id '%s' not found",
-										 amplitudeID.c_str());
-								continue;
-							}
 
-							if ( !amplitude->eventParameters() ) {
-								ep->add(amplitude.get());
-							}
-
-							_amplitudeIDSet.insert(amplitudeID);
+							requestAmplitude(amplitudeID);
 						}
 					}
 				}
@@ -1214,22 +1235,7 @@ class XMLDump : public Seiscomp::Client::Application {
 
 			if ( _settings.withAmplitudes && !_settings.withStationMagnitudes ) {
 				// Extract all amplitudes for all picks
-				for ( size_t p = 0; p < ep->pickCount(); ++p ) {
-					Pick *pick = ep->pick(p);
-					DatabaseIterator it = query()->getAmplitudesForPick(pick->publicID());
-					for ( ; *it; ++it ) {
-						auto *amplitude = Amplitude::Cast(*it);
-						if (_amplitudeIDSet.find(amplitude->publicID()) != _amplitudeIDSet.end()) {
-							continue;
-						}
-
-						if ( amplitude ) {
-							ep->add(amplitude);
-						}
-
-						_amplitudeIDSet.insert(amplitude->publicID());
-					}
-				}
+				requestPickAmplitudes();
 			}
 
 			if ( !_settings.withFocalMechanisms ) {
@@ -1368,6 +1374,127 @@ class XMLDump : public Seiscomp::Client::Application {
 		}
 
 
+		//! Requests a pick to be dumped along with its comments, see
+		//! loadRequested
+		void requestPick(const string &pickID) {
+			if ( !_pickIDSet.insert(pickID).second ) {
+				return;
+			}
+
+			_requestedPicks.push_back(pickID);
+		}
+
+
+		//! Requests an amplitude to be dumped
+		void requestAmplitude(const string &amplitudeID) {
+			if ( !_amplitudeIDSet.insert(amplitudeID).second ) {
+				return;
+			}
+
+			_requestedAmplitudes.push_back({ amplitudeID, false });
+		}
+
+
+		//! Requests all amplitudes of the requested picks to be dumped
+		void requestPickAmplitudes() {
+			for ( const auto &pickID : _requestedPicks ) {
+				if ( _amplitudePickIDSet.insert(pickID).second ) {
+					_requestedAmplitudes.push_back({ pickID, true });
+				}
+			}
+		}
+
+
+		//! Loads the requested picks and amplitudes with a few queries
+		//! for all of them rather than with a query per object and adds
+		//! them to the event parameters in order of request.
+		void loadRequested(EventParameters *ep) {
+			if ( !_requestedPicks.empty() ) {
+				map<string, PickPtr> picks;
+				for ( auto &pick : Private::loadObjects<Pick>(query(), string(), _requestedPicks,
+				                                              true, BulkQuerySize) ) {
+					picks[pick->publicID()] = pick;
+				}
+
+				for ( const auto &pickID : _requestedPicks ) {
+					auto it = picks.find(pickID);
+					if ( it == picks.end() ) {
+						SEISCOMP_WARNING("Pick with id '%s' not found", pickID.c_str());
+						continue;
+					}
+
+					if ( !it->second->eventParameters() ) {
+						ep->add(it->second.get());
+					}
+				}
+
+				_requestedPicks.clear();
+			}
+
+			if ( !_requestedAmplitudes.empty() ) {
+				vector<string> amplitudeIDs, pickIDs;
+				for ( const auto &[id, byPick] : _requestedAmplitudes ) {
+					if ( byPick ) {
+						// Only amplitudes of dumped picks
+						auto pick = Pick::Find(id);
+						if ( pick && pick->eventParameters() == ep ) {
+							pickIDs.push_back(id);
+						}
+					}
+					else {
+						amplitudeIDs.push_back(id);
+					}
+				}
+
+				map<string, AmplitudePtr> amplitudes;
+				for ( auto &amplitude : Private::loadObjects<Amplitude>(query(), string(), amplitudeIDs,
+				                                                        false, BulkQuerySize) ) {
+					amplitudes[amplitude->publicID()] = amplitude;
+				}
+
+				map<string, vector<AmplitudePtr>> pickAmplitudes;
+				for ( auto &amplitude : Private::loadObjects<Amplitude>(query(), "Amplitude." + _T("pickID"),
+				                                                        pickIDs, false, BulkQuerySize) ) {
+					pickAmplitudes[amplitude->pickID()].push_back(amplitude);
+				}
+
+				for ( const auto &[id, byPick] : _requestedAmplitudes ) {
+					if ( !byPick ) {
+						auto it = amplitudes.find(id);
+						if ( it == amplitudes.end() ) {
+							SEISCOMP_WARNING("Amplitude with id '%s' not found",
+							                 id.c_str());
+							continue;
+						}
+
+						if ( !it->second->eventParameters() ) {
+							ep->add(it->second.get());
+						}
+
+						continue;
+					}
+
+					auto it = pickAmplitudes.find(id);
+					if ( it == pickAmplitudes.end() ) {
+						continue;
+					}
+
+					for ( auto &amplitude : it->second ) {
+						if ( !_amplitudeIDSet.insert(amplitude->publicID()).second ) {
+							continue;
+						}
+
+						if ( !amplitude->eventParameters() ) {
+							ep->add(amplitude.get());
+						}
+					}
+				}
+
+				_requestedAmplitudes.clear();
+			}
+		}
+
+
 	private:
 		struct Settings : AbstractSettings {
 			void accept(SettingsLinker &linker) override {
@@ -1513,6 +1640,16 @@ class XMLDump : public Seiscomp::Client::Application {
 					prependDatasize,
 					"Output", "prepend-datasize",
 					"Prepend a line with the length of the XML string."
+				)
+				& cliSwitch(
+					gzip,
+					"Output", "gzip",
+					"Compress the output with gzip."
+				)
+				& cliSwitch(
+					binary,
+					"Output", "binary",
+					"Write binary archives instead of XML."
 				);
 			}
 
@@ -1538,6 +1675,8 @@ class XMLDump : public Seiscomp::Client::Application {
 			bool   withRoot{false};
 
 			bool   formatted{false};
+			bool   gzip{false};
+			bool   binary{false};
 
 			string outputFile;
 			string publicIDParam;
@@ -1556,8 +1695,14 @@ class XMLDump : public Seiscomp::Client::Application {
 		set<string> _pickIDSet;
 		set<string> _amplitudeIDSet;
 
-		XMLArchive *_archive{nullptr};
-		stringbuf _archiveBuf;
+		// Picks and amplitudes to be loaded by loadRequested. Amplitudes
+		// are requested by publicID or by pickID.
+		vector<string>             _requestedPicks;
+		vector<pair<string, bool>> _requestedAmplitudes;
+		set<string>                _amplitudePickIDSet;
+
+		Private::StreamWriter _writer;
+		stringbuf                  _archiveBuf;
 };
 
 
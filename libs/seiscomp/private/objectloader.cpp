@@ -0,0 +1,136 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT ObjectLoader
+#include <seiscomp/logging/log.h>
+#include <seiscomp/datamodel/comment.h>
+
+#include "objectloader.h"
+
+#include <algorithm>
+#include <map>
+
+
+using namespace std;
+
+
+namespace Seiscomp {
+namespace Private {
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+size_t readObjects(DataModel::DatabaseQuery *query, const string &statement,
+                   const Core::RTTI &type, const ObjectFunc &func) {
+	size_t count = 0;
+
+	for ( auto it = query->getObjectIterator(statement, type); *it; ++it ) {
+		DataModel::PublicObjectPtr object = DataModel::PublicObject::Cast(*it);
+		if ( !object ) {
+			continue;
+		}
+
+		func(object.get(), !it.cached());
+		++count;
+	}
+
+	return count;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+vector<DataModel::PublicObjectPtr>
+loadObjects(DataModel::DatabaseQuery *query, const Core::RTTI &type,
+            const string &column, const vector<string> &values,
+            bool withComments, size_t chunkSize) {
+	vector<DataModel::PublicObjectPtr> objects;
+	auto *db = query->driver();
+	const string table = type.className();
+	const string alias = "P" + table;
+	const string publicID = alias + "." + db->convertColumnName("publicID");
+	const string from =
+		" from " + table +
+		" join PublicObject as " + alias + " on " + alias + "._oid=" + table + "._oid";
+	const string key = column.empty() ? publicID : column;
+
+	chunkSize = max(chunkSize, size_t(1));
+
+	for ( size_t i = 0; i < values.size(); i += chunkSize ) {
+		string in;
+		for ( size_t j = i; j < min(i + chunkSize, values.size()); ++j ) {
+			string escaped;
+			if ( !db->escape(escaped, values[j]) ) {
+				SEISCOMP_WARNING("Invalid ID '%s'", values[j].c_str());
+				continue;
+			}
+
+			if ( !in.empty() ) {
+				in += ",";
+			}
+			in += "'" + escaped + "'";
+		}
+
+		if ( in.empty() ) {
+			continue;
+		}
+
+		const string where = " where " + key + " in (" + in + ")";
+		map<string, DataModel::PublicObject*> read;
+
+		readObjects(query, "select " + publicID + "," + table + ".*" + from + where, type,
+		            [&](DataModel::PublicObject *object, bool isRead) {
+			if ( isRead ) {
+				read[object->publicID()] = object;
+			}
+
+			objects.push_back(object);
+		});
+
+		if ( !withComments || read.empty() ) {
+			continue;
+		}
+
+		for ( auto it = query->getObjectIterator(
+			"select Comment.*," + publicID + " as parentID" + from +
+			" join Comment on Comment._parent_oid=" + table + "._oid" + where,
+			DataModel::Comment::TypeInfo()); *it; ++it ) {
+			DataModel::CommentPtr comment = DataModel::Comment::Cast(*it);
+			if ( !comment ) {
+				continue;
+			}
+
+			auto idx = db->findColumn("parentID");
+			if ( idx < 0 ) {
+				continue;
+			}
+
+			auto parent = read.find(db->getRowFieldString(idx));
+			if ( parent != read.end() ) {
+				comment->attachTo(parent->second);
+			}
+		}
+	}
+
+	return objects;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+}
+}
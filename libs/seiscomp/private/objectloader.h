@@ -0,0 +1,98 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+
+
+#ifndef SEISCOMP_PRIVATE_OBJECTLOADER_H__
+#define SEISCOMP_PRIVATE_OBJECTLOADER_H__
+
+
+#include <seiscomp/datamodel/databasequery.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace Seiscomp {
+namespace Private {
+
+
+/**
+ * @brief Called with each object of a query.
+ * @param object The object
+ * @param read False if the object was registered already. The iterator
+ *        returns the registered instance then, whose child objects must
+ *        not be added again.
+ */
+using ObjectFunc = std::function<void(DataModel::PublicObject *object, bool read)>;
+
+
+/**
+ * @brief Reads the public objects of a query.
+ *
+ * The database iterator returns the registered instance of an object
+ * whose publicID is known already and registers all objects it reads.
+ * Looking up the publicID after reading therefore always finds an
+ * instance. Whether an object has been read from the database is
+ * told by the iterator only and passed to the function.
+ *
+ * @return The number of objects
+ */
+size_t readObjects(DataModel::DatabaseQuery *query, const std::string &statement,
+                   const Core::RTTI &type, const ObjectFunc &func);
+
+
+/**
+ * @brief Loads public objects of a type in bulk.
+ *
+ * The objects whose column, the publicID if empty, matches one of the
+ * values are loaded with one query per chunk of values. If withComments
+ * is set, the comments of the objects read from the database are loaded
+ * with another query per chunk. Registered instances keep their
+ * comments. Values which cannot be escaped are skipped.
+ *
+ * @param column The column in the form Table.column as converted by the
+ *        database driver
+ */
+std::vector<DataModel::PublicObjectPtr>
+loadObjects(DataModel::DatabaseQuery *query, const Core::RTTI &type,
+            const std::string &column, const std::vector<std::string> &values,
+            bool withComments, size_t chunkSize = 500);
+
+
+//! Typed version of loadObjects
+template <typename T>
+std::vector<Core::SmartPointer<T>>
+loadObjects(DataModel::DatabaseQuery *query, const std::string &column,
+            const std::vector<std::string> &values, bool withComments,
+            size_t chunkSize = 500) {
+	std::vector<Core::SmartPointer<T>> objects;
+	for ( const auto &object : loadObjects(query, T::TypeInfo(), column,
+	                                       values, withComments, chunkSize) ) {
+		T *typed = T::Cast(object.get());
+		if ( typed ) {
+			objects.push_back(typed);
+		}
+	}
+
+	return objects;
+}
+
+
+}
+}
+
+
+#endif
@@ -0,0 +1,327 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#include <seiscomp/logging/log.h>
+#include <seiscomp/io/archive/xmlarchive.h>
+
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include "streamwriter.h"
+
+
+namespace io = boost::iostreams;
+
+
+namespace Seiscomp {
+namespace Private {
+
+
+namespace {
+
+
+const char *Whitespace = " \t\r\n";
+
+
+// Returns the position after the last non-whitespace character before pos
+size_t trimBack(const std::string &str, size_t pos) {
+	if ( pos == 0 ) {
+		return 0;
+	}
+
+	size_t p = str.find_last_not_of(Whitespace, pos - 1);
+	return p == std::string::npos ? 0 : p + 1;
+}
+
+
+}
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+StreamWriter::~StreamWriter() {
+	close();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool StreamWriter::create(const std::string &filename) {
+	close();
+
+	_out.reset(new OutputStream);
+	if ( _gzip ) {
+		_out->push(io::gzip_compressor());
+	}
+
+	if ( filename == "-" ) {
+		_out->push(std::cout);
+	}
+	else {
+		io::file_sink sink(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+		if ( !sink.is_open() ) {
+			SEISCOMP_ERROR("Could not create output file '%s'", filename.c_str());
+			_out.reset();
+			return false;
+		}
+
+		_out->push(sink);
+	}
+
+	return open();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool StreamWriter::create(std::streambuf *buf) {
+	close();
+
+	_out.reset(new OutputStream);
+	if ( _gzip ) {
+		_out->push(io::gzip_compressor());
+	}
+
+	_out->push(*buf);
+
+	return open();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool StreamWriter::open() {
+	if ( _binary ) {
+		_binaryArchive.reset(new IO::BinaryArchive);
+		if ( !_binaryArchive->create(_out->rdbuf()) ) {
+			SEISCOMP_ERROR("Could not create binary archive");
+			_binaryArchive.reset();
+			_out.reset();
+			return false;
+		}
+	}
+
+	_headerWritten = false;
+	_footer.clear();
+	_openRootID.clear();
+	_openRootEndTag.clear();
+	_open = true;
+
+	return true;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool StreamWriter::write(DataModel::PublicObject *root) {
+	if ( !_open ) {
+		return false;
+	}
+
+	if ( _binary ) {
+		*_binaryArchive << root;
+		return _binaryArchive->success();
+	}
+
+	return writeXML(root, false);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool StreamWriter::writeChildren(DataModel::PublicObject *root) {
+	if ( !_open ) {
+		return false;
+	}
+
+	if ( _binary ) {
+		*_binaryArchive << root;
+		return _binaryArchive->success();
+	}
+
+	return writeXML(root, true);
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool StreamWriter::writeXML(DataModel::PublicObject *root, bool keepOpen) {
+	std::stringbuf buf;
+	IO::XMLArchive ar;
+	ar.setFormattedOutput(_formatted);
+	if ( !ar.create(&buf) ) {
+		SEISCOMP_ERROR("Could not create XML archive");
+		return false;
+	}
+
+	ar << root;
+	ar.close();
+
+	const std::string doc = buf.str();
+
+	// The document consists of the XML declaration, the seiscomp start
+	// tag, the root element and the seiscomp end tag
+	size_t elementStart = doc.find("<seiscomp");
+	if ( elementStart != std::string::npos ) {
+		elementStart = doc.find('>', elementStart);
+	}
+
+	size_t docEnd = doc.rfind("</seiscomp>");
+	if ( elementStart == std::string::npos || docEnd == std::string::npos
+	  || docEnd <= elementStart ) {
+		SEISCOMP_ERROR("Failed to serialize %s %s",
+		               root->className(), root->publicID().c_str());
+		return false;
+	}
+
+	++elementStart;
+	// Whitespace in front of an end tag is written along with the tag
+	docEnd = std::max(trimBack(doc, docEnd), elementStart);
+
+	if ( !_headerWritten ) {
+		*_out << doc.substr(0, elementStart);
+		_footer = doc.substr(docEnd);
+		_headerWritten = true;
+	}
+
+	if ( !keepOpen ) {
+		closeRoot();
+		*_out << doc.substr(elementStart, docEnd - elementStart);
+		return _out->good();
+	}
+
+	size_t tagStart = doc.find('<', elementStart);
+	size_t tagEnd = tagStart == std::string::npos ? tagStart : doc.find('>', tagStart);
+	if ( tagEnd == std::string::npos || tagEnd >= docEnd ) {
+		SEISCOMP_ERROR("Failed to serialize %s %s",
+		               root->className(), root->publicID().c_str());
+		return false;
+	}
+
+	std::string startTag, endTag;
+	size_t childrenStart, childrenEnd;
+
+	if ( doc[tagEnd-1] == '/' ) {
+		// A root without children is written as empty element
+		size_t nameEnd = doc.find_first_of(" \t\r\n/>", tagStart + 1);
+		startTag = doc.substr(elementStart, tagEnd - 1 - elementStart) + ">";
+		endTag = doc.substr(elementStart, tagStart - elementStart)
+		       + "</" + doc.substr(tagStart + 1, nameEnd - tagStart - 1) + ">";
+		childrenStart = childrenEnd = tagEnd + 1;
+	}
+	else {
+		size_t endTagStart = doc.rfind("</", docEnd - 1);
+		if ( endTagStart == std::string::npos || endTagStart <= tagEnd ) {
+			SEISCOMP_ERROR("Failed to serialize %s %s",
+			               root->className(), root->publicID().c_str());
+			return false;
+		}
+
+		childrenStart = tagEnd + 1;
+		childrenEnd = std::max(trimBack(doc, endTagStart), childrenStart);
+		startTag = doc.substr(elementStart, childrenStart - elementStart);
+		endTag = doc.substr(childrenEnd, docEnd - childrenEnd);
+	}
+
+	std::string rootID = std::string(root->className()) + "/" + root->publicID();
+	if ( rootID != _openRootID ) {
+		closeRoot();
+		*_out << startTag;
+		_openRootID = rootID;
+		_openRootEndTag = endTag;
+	}
+
+	*_out << doc.substr(childrenStart, childrenEnd - childrenStart);
+
+	return _out->good();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void StreamWriter::closeRoot() {
+	if ( _openRootID.empty() ) {
+		return;
+	}
+
+	*_out << _openRootEndTag;
+	_openRootID.clear();
+	_openRootEndTag.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+bool StreamWriter::close() {
+	if ( !_open ) {
+		return false;
+	}
+
+	if ( _binary ) {
+		_binaryArchive->close();
+		_binaryArchive.reset();
+	}
+	else if ( _headerWritten ) {
+		closeRoot();
+		*_out << _footer;
+	}
+	else {
+		// Nothing has been written, output an empty document
+		std::stringbuf buf;
+		IO::XMLArchive ar;
+		ar.setFormattedOutput(_formatted);
+		if ( ar.create(&buf) ) {
+			ar.close();
+			*_out << buf.str();
+		}
+	}
+
+	_out->flush();
+	bool success = _out->good();
+
+	// Removes the devices from the chain which completes the gzip stream
+	_out->reset();
+	_out.reset();
+	_open = false;
+
+	return success;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+}
+}
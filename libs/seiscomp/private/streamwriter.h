@@ -0,0 +1,115 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#ifndef SEISCOMP_PRIVATE_STREAMWRITER_H__
+#define SEISCOMP_PRIVATE_STREAMWRITER_H__
+
+
+#include <seiscomp/datamodel/publicobject.h>
+#include <seiscomp/io/archive/binarchive.h>
+
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <memory>
+#include <streambuf>
+#include <string>
+
+
+namespace Seiscomp {
+namespace Private {
+
+
+/**
+ * @brief Writes SCML documents incrementally.
+ *
+ * XMLArchive builds the whole document in memory and writes it when the
+ * archive is closed. The stream writer serializes the root objects, e.g.
+ * EventParameters or Inventory, in parts instead: writeChildren writes the
+ * current children of a root and keeps the root element open so that the
+ * caller can remove the written children and add new ones. The document
+ * is completed by close. Hence only the objects of one part are held in
+ * memory and the output can be consumed while it is written.
+ *
+ * The XML output is one valid SCML document. The children of a root may
+ * be interleaved by type, e.g. picks may follow origins. The binary output
+ * is a sequence of archived root objects, one for each call of write and
+ * writeChildren, which are read one after another with IO::BinaryArchive.
+ * Both can be compressed with gzip.
+ */
+class StreamWriter {
+	public:
+		StreamWriter() = default;
+		StreamWriter(const StreamWriter&) = delete;
+		StreamWriter &operator=(const StreamWriter&) = delete;
+		~StreamWriter();
+
+
+	public:
+		void setFormattedOutput(bool formatted) { _formatted = formatted; }
+		void setCompression(bool gzip) { _gzip = gzip; }
+		void setBinary(bool binary) { _binary = binary; }
+
+		//! Creates the output file, '-' refers to stdout
+		bool create(const std::string &filename);
+		//! Writes to a stream buffer which must exist until the writer
+		//! is closed
+		bool create(std::streambuf *buf);
+
+		bool isOpen() const { return _open; }
+
+		//! Writes a root object with all its children
+		bool write(DataModel::PublicObject *root);
+
+		//! Writes the current children of a root object. The element of
+		//! the root is kept open for subsequent calls with the same root
+		//! until another root is written or the writer is closed.
+		bool writeChildren(DataModel::PublicObject *root);
+
+		//! Completes the document and flushes the output
+		bool close();
+
+
+	private:
+		bool open();
+		bool writeXML(DataModel::PublicObject *root, bool keepOpen);
+		void closeRoot();
+
+
+	private:
+		using OutputStream = boost::iostreams::filtering_ostream;
+
+		bool                              _formatted{false};
+		bool                              _gzip{false};
+		bool                              _binary{false};
+		bool                              _open{false};
+
+		std::unique_ptr<OutputStream>     _out;
+		std::unique_ptr<IO::BinaryArchive> _binaryArchive;
+
+		// The XML declaration and the seiscomp start tag are written
+		// with the first object, the end tag when the writer is closed
+		bool                              _headerWritten{false};
+		std::string                       _footer;
+
+		// The root element kept open by writeChildren
+		std::string                       _openRootID;
+		std::string                       _openRootEndTag;
+};
+
+
+}
+}
+
+
+#endif
@@ -0,0 +1,108 @@
+-- The tables of the SeisComP schema 0.12.1 needed to store picks and their
+-- comments, taken from the sqlite3 schema without indexes and triggers.
+
+CREATE TABLE Meta (
+	name CHAR NOT NULL,
+	value VARCHAR NOT NULL,
+	PRIMARY KEY(name)
+);
+CREATE TABLE Object (
+	_oid INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL,
+	_timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+);
+CREATE TABLE PublicObject (
+	_oid INTEGER NOT NULL,
+	publicID VARCHAR(255) NOT NULL,
+	PRIMARY KEY(_oid),
+	UNIQUE(publicID),
+	FOREIGN KEY(_oid)
+	  REFERENCES Object(_oid)
+	  ON DELETE CASCADE
+);
+CREATE TABLE Pick (
+	_oid INTEGER NOT NULL,
+	_parent_oid INTEGER NOT NULL,
+	_last_modified TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+	time_value DATETIME NOT NULL,
+	time_value_ms INTEGER NOT NULL,
+	time_uncertainty DOUBLE UNSIGNED,
+	time_lowerUncertainty DOUBLE UNSIGNED,
+	time_upperUncertainty DOUBLE UNSIGNED,
+	time_confidenceLevel DOUBLE UNSIGNED,
+	time_pdf_variable_content BLOB,
+	time_pdf_probability_content BLOB,
+	time_pdf_used INTEGER(1) NOT NULL DEFAULT '0',
+	waveformID_networkCode CHAR NOT NULL,
+	waveformID_stationCode CHAR NOT NULL,
+	waveformID_locationCode CHAR,
+	waveformID_channelCode CHAR,
+	waveformID_resourceURI VARCHAR,
+	filterID VARCHAR,
+	methodID VARCHAR,
+	horizontalSlowness_value DOUBLE,
+	horizontalSlowness_uncertainty DOUBLE UNSIGNED,
+	horizontalSlowness_lowerUncertainty DOUBLE UNSIGNED,
+	horizontalSlowness_upperUncertainty DOUBLE UNSIGNED,
+	horizontalSlowness_confidenceLevel DOUBLE UNSIGNED,
+	horizontalSlowness_pdf_variable_content BLOB,
+	horizontalSlowness_pdf_probability_content BLOB,
+	horizontalSlowness_pdf_used INTEGER(1) NOT NULL DEFAULT '0',
+	horizontalSlowness_used INTEGER(1) NOT NULL DEFAULT '0',
+	backazimuth_value DOUBLE,
+	backazimuth_uncertainty DOUBLE UNSIGNED,
+	backazimuth_lowerUncertainty DOUBLE UNSIGNED,
+	backazimuth_upperUncertainty DOUBLE UNSIGNED,
+	backazimuth_confidenceLevel DOUBLE UNSIGNED,
+	backazimuth_pdf_variable_content BLOB,
+	backazimuth_pdf_probability_content BLOB,
+	backazimuth_pdf_used INTEGER(1) NOT NULL DEFAULT '0',
+	backazimuth_used INTEGER(1) NOT NULL DEFAULT '0',
+	slownessMethodID VARCHAR,
+	onset VARCHAR(64),
+	phaseHint_code CHAR,
+	phaseHint_used INTEGER(1) NOT NULL DEFAULT '0',
+	polarity VARCHAR(64),
+	evaluationMode VARCHAR(64),
+	evaluationStatus VARCHAR(64),
+	creationInfo_agencyID VARCHAR,
+	creationInfo_agencyURI VARCHAR,
+	creationInfo_author VARCHAR,
+	creationInfo_authorURI VARCHAR,
+	creationInfo_creationTime DATETIME,
+	creationInfo_creationTime_ms INTEGER,
+	creationInfo_modificationTime DATETIME,
+	creationInfo_modificationTime_ms INTEGER,
+	creationInfo_version VARCHAR,
+	creationInfo_used INTEGER(1) NOT NULL DEFAULT '0',
+	PRIMARY KEY(_oid),
+	FOREIGN KEY(_oid)
+		REFERENCES Object(_oid)
+		ON DELETE CASCADE
+);
+CREATE TABLE Comment (
+	_oid INTEGER NOT NULL,
+	_parent_oid INTEGER NOT NULL,
+	_last_modified TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+	text BLOB NOT NULL,
+	id VARCHAR,
+	start DATETIME,
+	start_ms INTEGER,
+	end DATETIME,
+	end_ms INTEGER,
+	creationInfo_agencyID VARCHAR,
+	creationInfo_agencyURI VARCHAR,
+	creationInfo_author VARCHAR,
+	creationInfo_authorURI VARCHAR,
+	creationInfo_creationTime DATETIME,
+	creationInfo_creationTime_ms INTEGER,
+	creationInfo_modificationTime DATETIME,
+	creationInfo_modificationTime_ms INTEGER,
+	creationInfo_version VARCHAR,
+	creationInfo_used INTEGER(1) NOT NULL DEFAULT '0',
+	PRIMARY KEY(_oid),
+	FOREIGN KEY(_oid)
+		REFERENCES Object(_oid)
+		ON DELETE CASCADE,
+	UNIQUE(_parent_oid,id)
+);
+INSERT INTO Meta(name,value) VALUES ('Schema-Version','0.12.1');
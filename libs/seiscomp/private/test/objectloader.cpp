@@ -0,0 +1,199 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_TEST_MODULE test_private_objectloader
+
+#include <seiscomp/unittest/unittests.h>
+#include <seiscomp/datamodel/comment.h>
+#include <seiscomp/datamodel/databasearchive.h>
+#include <seiscomp/datamodel/eventparameters.h>
+#include <seiscomp/datamodel/pick.h>
+#include <seiscomp/io/database.h>
+#include <seiscomp/system/pluginregistry.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <seiscomp/private/objectloader.h>
+
+
+// Bulk loading of picks with their comments from a sqlite3 database as
+// done by ql2sc and scxmldump. A pick which exists in the database with a
+// comment must be loaded with the comment, otherwise ql2sc adds the
+// comment again. A pick which is registered already is returned as is
+// and must not get its comments a second time.
+
+
+using namespace std;
+using namespace Seiscomp;
+using namespace Seiscomp::DataModel;
+
+
+namespace {
+
+
+const char *DatabaseFile = "objectloader-test.db";
+
+
+IO::DatabaseInterfacePtr openDatabase() {
+	remove(DatabaseFile);
+
+	System::PluginRegistry::Instance()->addPluginName("dbsqlite3");
+	System::PluginRegistry::Instance()->loadPlugins();
+
+	IO::DatabaseInterfacePtr db = IO::DatabaseInterface::Open(
+		(string("sqlite3://") + DatabaseFile).c_str()
+	);
+	BOOST_REQUIRE(db);
+
+	// The statements of the schema end with a semicolon at the end of
+	// a line
+	ifstream ifs("data/schema.sql");
+	BOOST_REQUIRE(ifs.good());
+
+	string line, statement;
+	while ( getline(ifs, line) ) {
+		if ( line.compare(0, 2, "--") == 0 ) {
+			continue;
+		}
+
+		statement += line + "\n";
+		if ( !line.empty() && line[line.size()-1] == ';' ) {
+			BOOST_REQUIRE_MESSAGE(db->execute(statement.c_str()), statement);
+			statement.clear();
+		}
+	}
+
+	return db;
+}
+
+
+PickPtr createPick(const string &publicID, const string &station) {
+	PickPtr pick = Pick::Create(publicID);
+	pick->setTime(TimeQuantity(Core::Time(1577836800, 0)));
+	pick->setWaveformID(WaveformStreamID("XX", station, "", "HHZ", ""));
+	return pick;
+}
+
+
+// Writes Pick/1 with a comment and Pick/2 without. The objects are
+// destroyed afterwards, they are not registered anymore.
+void writePicks(IO::DatabaseInterface *db) {
+	EventParametersPtr ep = new EventParameters;
+
+	PickPtr pick = createPick("Pick/1", "ABC");
+	CommentPtr comment = new Comment;
+	comment->setId("quality");
+	comment->setText("impulsive");
+	pick->add(comment.get());
+	ep->add(pick.get());
+
+	ep->add(createPick("Pick/2", "DEF").get());
+
+	DatabaseArchive archive(db);
+	DatabaseObjectWriter writer(archive);
+	BOOST_REQUIRE(writer(ep.get()));
+}
+
+
+}
+
+
+BOOST_AUTO_TEST_SUITE(seiscomp_private_objectloader)
+
+
+BOOST_AUTO_TEST_CASE(commentedPick) {
+	IO::DatabaseInterfacePtr db = openDatabase();
+	writePicks(db.get());
+	BOOST_REQUIRE(!Pick::Find("Pick/1"));
+
+	DatabaseQuery query(db.get());
+	auto picks = Private::loadObjects<Pick>(&query, string(),
+	                                        { "Pick/1", "Pick/2", "Pick/3" }, true);
+	BOOST_REQUIRE_EQUAL(picks.size(), 2);
+
+	PickPtr pick1 = Pick::Find("Pick/1");
+	PickPtr pick2 = Pick::Find("Pick/2");
+	BOOST_REQUIRE(pick1);
+	BOOST_REQUIRE(pick2);
+	BOOST_REQUIRE_EQUAL(pick1->commentCount(), 1);
+	BOOST_CHECK_EQUAL(pick1->comment(0)->id(), "quality");
+	BOOST_CHECK_EQUAL(pick1->comment(0)->text(), "impulsive");
+	BOOST_CHECK_EQUAL(pick2->commentCount(), 0);
+
+	// The registered instances are returned again and keep their comment
+	auto again = Private::loadObjects<Pick>(&query, string(), { "Pick/1", "Pick/2" }, true);
+	BOOST_REQUIRE_EQUAL(again.size(), 2);
+	for ( const PickPtr &pick : again ) {
+		BOOST_CHECK(pick == pick1 || pick == pick2);
+	}
+	BOOST_CHECK_EQUAL(pick1->commentCount(), 1);
+
+	picks.clear();
+	again.clear();
+	pick1 = pick2 = nullptr;
+
+	// Selected by another column and without comments
+	picks = Private::loadObjects<Pick>(
+		&query, "Pick." + db->convertColumnName("waveformID_stationCode"),
+		{ "ABC" }, false
+	);
+	BOOST_REQUIRE_EQUAL(picks.size(), 1);
+	BOOST_CHECK_EQUAL(picks[0]->publicID(), "Pick/1");
+	BOOST_CHECK_EQUAL(picks[0]->commentCount(), 0);
+
+	picks.clear();
+	db->disconnect();
+	remove(DatabaseFile);
+}
+
+
+BOOST_AUTO_TEST_CASE(readFlag) {
+	IO::DatabaseInterfacePtr db = openDatabase();
+	writePicks(db.get());
+
+	DatabaseQuery query(db.get());
+	const string statement =
+		"select PPick." + db->convertColumnName("publicID") + ",Pick.* from Pick "
+		"join PublicObject as PPick on PPick._oid=Pick._oid";
+
+	PickPtr registered = createPick("Pick/2", "DEF");
+	vector<PublicObjectPtr> objects;
+	size_t read = 0;
+
+	size_t count = Private::readObjects(&query, statement, Pick::TypeInfo(),
+	                                    [&](PublicObject *object, bool isRead) {
+		objects.push_back(object);
+		if ( isRead ) {
+			++read;
+			BOOST_CHECK_EQUAL(object->publicID(), "Pick/1");
+		}
+		else {
+			BOOST_CHECK(object == registered.get());
+		}
+	});
+
+	BOOST_CHECK_EQUAL(count, 2);
+	BOOST_CHECK_EQUAL(read, 1);
+
+	objects.clear();
+	registered = nullptr;
+	db->disconnect();
+	remove(DatabaseFile);
+}
+
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+#define SEISCOMP_COMPONENT WorkerPool
+#include <seiscomp/logging/log.h>
+
+#include "workerpool.h"
+
+#include <algorithm>
+
+
+namespace Seiscomp {
+namespace Private {
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+WorkerPool::~WorkerPool() {
+	stop();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void WorkerPool::start(size_t threadCount) {
+	stop();
+
+	// Workers wait for the first run() after the current generation.
+	// Starting from 0 they would take an already finished run() after a
+	// restart as new job and break the busy count.
+	_exit = false;
+	for ( size_t i = 1; i < threadCount; ++i ) {
+		_threads.emplace_back(&WorkerPool::work, this, _generation);
+	}
+
+	if ( threadCount > 1 ) {
+		SEISCOMP_DEBUG("Started worker pool with %d threads", int(threadCount));
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void WorkerPool::stop() {
+	if ( _threads.empty() ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+	_wakeUp.notify_all();
+
+	for ( auto &thread : _threads ) {
+		thread.join();
+	}
+
+	_threads.clear();
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void WorkerPool::run(size_t n, const Job &job, size_t chunk) {
+	if ( !n ) {
+		return;
+	}
+
+	if ( _threads.empty() || n == 1 ) {
+		job(0, n);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_job = &job;
+		_size = n;
+		_chunk = std::max<size_t>(1, chunk);
+		_next = 0;
+		_busy = _threads.size();
+		++_generation;
+	}
+	_wakeUp.notify_all();
+
+	process();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_finished.wait(lock, [this] { return _busy == 0; });
+	_job = nullptr;
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void WorkerPool::work(unsigned long generation) {
+	while ( true ) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wakeUp.wait(lock, [this, generation] {
+				return _exit || _generation != generation;
+			});
+
+			if ( _exit ) {
+				return;
+			}
+
+			generation = _generation;
+		}
+
+		process();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if ( --_busy == 0 ) {
+				_finished.notify_one();
+			}
+		}
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+
+// >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+void WorkerPool::process() {
+	while ( true ) {
+		size_t from = _next.fetch_add(_chunk);
+		if ( from >= _size ) {
+			break;
+		}
+
+		(*_job)(from, std::min(from + _chunk, _size));
+	}
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+}
+}
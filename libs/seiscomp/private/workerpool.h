@@ -0,0 +1,98 @@
+/***************************************************************************
+ * Copyright (C) GFZ Potsdam                                               *
+ * All rights reserved.                                                    *
+ *                                                                         *
+ * GNU Affero General Public License Usage                                 *
+ * This file may be used under the terms of the GNU Affero                 *
+ * Public License version 3.0 as published by the Free Software Foundation *
+ * and appearing in the file LICENSE included in the packaging of this     *
+ * file. Please review the following information to ensure the GNU Affero  *
+ * Public License version 3.0 requirements will be met:                    *
+ * https://www.gnu.org/licenses/agpl-3.0.html.                             *
+ ***************************************************************************/
+
+
+
+
+#ifndef SEISCOMP_PRIVATE_WORKERPOOL_H__
+#define SEISCOMP_PRIVATE_WORKERPOOL_H__
+
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Seiscomp {
+namespace Private {
+
+
+/**
+ * @brief A minimal fork/join pool for data parallel loops.
+ *
+ * run() processes the indexes [0,n) by the worker threads and the
+ * calling thread and returns after all indexes have been processed.
+ * Each index is processed by exactly one thread. The caller is
+ * responsible for writing results to disjoint locations and for
+ * merging them afterwards in index order.
+ *
+ * The pool is shared by several applications of this package and is
+ * not part of the public API.
+ */
+class WorkerPool {
+	public:
+		//! Job to process the half-open index range [from,to)
+		using Job = std::function<void(size_t from, size_t to)>;
+
+	public:
+		WorkerPool() = default;
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool &operator=(const WorkerPool&) = delete;
+		~WorkerPool();
+
+	public:
+		//! (Re)starts the pool with the given total number of threads
+		//! including the calling thread. With 0 or 1 thread everything
+		//! is done by the calling thread.
+		void start(size_t threadCount);
+		void stop();
+
+		//! Total number of threads including the calling thread
+		size_t threadCount() const { return _threads.size() + 1; }
+
+		//! Processes the indexes [0,n) in chunks of the given size. A
+		//! chunk size of 1 balances uneven work per index best, larger
+		//! chunks reduce the synchronization overhead of many small
+		//! work items.
+		void run(size_t n, const Job &job, size_t chunk = 1);
+
+	private:
+		void work(unsigned long generation);
+		void process();
+
+	private:
+		std::vector<std::thread> _threads;
+		std::mutex               _mutex;
+		std::condition_variable  _wakeUp;
+		std::condition_variable  _finished;
+
+		// The current job, valid between wake-up and completion
+		const Job               *_job{nullptr};
+		size_t                   _size{0};
+		size_t                   _chunk{1};
+		std::atomic<size_t>      _next{0};
+
+		size_t                   _busy{0};
+		unsigned long            _generation{0};
+		bool                     _exit{false};
+};
+
+
+}
+}
+
+
+#endif
@@ -131,6 +131,7 @@ void readConfig(ILOC_CONF &cfg, const Config::Config &config, const string &pref
 	GET_CFG_STRUCT(NAcells);
 	GET_CFG_STRUCT(NAinitialSample);
 	GET_CFG_STRUCT(NAnextSample);
+	GET_CFG_STRUCT(NAthreads);
 
 	// depth resolution
 	GET_CFG_STRUCT(MinDepthPhases);
@@ -216,6 +217,7 @@ void initConfig(ILOC_CONF &cfg, const Config::Config *config,
 	cfg.NAcells = 25;
 	cfg.NAinitialSample = 1000;
 	cfg.NAnextSample = 100;
+	cfg.NAthreads = 1;
 
 	// depth resolution
 	cfg.MinDepthPhases = 3;
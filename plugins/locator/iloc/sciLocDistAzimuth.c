@@ -88,7 +88,7 @@ double iLoc_DistAzimuth(double slat, double slon, double elat, double elon,
     double cslat = 0., sslat = 0., cdlon = 0., sdlon = 0., rdlon = 0.;
     double geoc_slat = 0., geoc_elat = 0.;
     double xazi = 0., xbaz = 0., yazi = 0., ybaz = 0., delta = 0., cdel = 0.;
-    static double celat = 0., selat = 0.;
+    double celat = 0., selat = 0.;
     double f = (1. - ILOC_FLATTENING) * (1. - ILOC_FLATTENING);
     if (fabs(slat - elat) < ILOC_DEPSILON && fabs(slon - elon) < ILOC_DEPSILON) {
         delta = 0.0;
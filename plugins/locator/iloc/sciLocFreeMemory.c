@@ -214,6 +214,10 @@ void iLoc_FreeTTtables(int numPhaseTT, ILOC_TT_TABLE *TTtables)
     int i, ndists = 0;
     for (i = 0; i < numPhaseTT; i++) {
         if ((ndists = TTtables[i].ndel) == 0) continue;
+        if (TTtables[i].spline != NULL) {
+            iLoc_Free(TTtables[i].spline[0]);
+            iLoc_Free(TTtables[i].spline);
+        }
         iLoc_FreeFloatMatrix(TTtables[i].dtdh);
         iLoc_FreeFloatMatrix(TTtables[i].dtdd);
         iLoc_FreeFloatMatrix(TTtables[i].tt);
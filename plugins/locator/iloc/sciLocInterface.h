@@ -228,6 +228,7 @@ typedef struct iLocConfig {
     int NAinitialSample;                       /* number of initial samples */
     int NAnextSample;                       /* number of subsequent samples */
     int NAcells;                         /* number of cells to be resampled */
+    int NAthreads;      /* number of threads evaluating the sample models */
 /*
  *  ETOPO parameters
  */
@@ -609,6 +610,22 @@ typedef struct TravelTimeInfo {
     double SSurfVel;               /* Sg velocity for elevation corrections */
     ILOC_PHASELIST *PhaseTT;      /* list of phases with travel-time tables */
 } ILOC_TTINFO;
+/*
+ *
+ * Natural spline segment of a TT table row in delta direction
+ *   The spline through the delta samples around a distance interval
+ *   is fixed by the interval and the depth, hence its second derivatives
+ *   at the bracketing samples are computed once when the tables are loaded.
+ *
+ */
+typedef struct TTspline {
+    int klo;    /* lower bracketing delta sample, -1 if too few samples */
+    int khi;                              /* upper bracketing delta sample */
+    double tt[2];       /* second derivatives of travel time at klo, khi */
+    double dtdd[2];            /* second derivatives of dtdd at klo, khi */
+    double dtdh[2];            /* second derivatives of dtdh at klo, khi */
+    double bpdel[2];          /* second derivatives of bpdel at klo, khi */
+} ILOC_TT_SPLINE;
 /*
  *
  * Travel time tables (input)
@@ -627,6 +644,7 @@ typedef struct TTtables {
     double **bpdel;        /* depth phase bounce point distance table [deg] */
     double **dtdd;                     /* horizontal slowness table [s/deg] */
     double **dtdh;                        /* vertical slowness table [s/km] */
+    ILOC_TT_SPLINE **spline;    /* spline segments [ndel - 1][ndep] or NULL */
 } ILOC_TT_TABLE;
 /*
  *
@@ -946,6 +964,7 @@ int iLoc_GetTravelTimePrediction(ILOC_CONF *iLocConfig, ILOC_HYPO *Hypocenter,
 double iLoc_GetEtopoCorrection(ILOC_CONF *iLocConfig, int ips, double rayp,
         double bplat, double bplon, short int **topo,
         double Psurfvel, double Ssurfvel, double *tcorw);
+int iLoc_SetTTSplines(int numPhaseTT, ILOC_TT_TABLE *TTtables);
 
 /*
  * sciLocTravelTimeAPI.c
@@ -28,6 +28,49 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "sciLocInterface.h"
+#include <pthread.h>
+
+/*
+ *  forward problem arguments shared by the threads computing sample misfits
+ */
+typedef struct NAForward {
+    pthread_mutex_t lock;                    /* protects the sample counter */
+    int threaded;                          /* misfits computed by threads? */
+    int next;                                /* next sample to be evaluated */
+    int ns;                                            /* number of samples */
+    int ntot;                                /* number of collected samples */
+    double *misfit;                                       /* sample misfits */
+    double **na_models;                                    /* sample models */
+    ILOC_NASPACE *nasp;
+    ILOC_CONF *iLocConfig;
+    ILOC_HYPO *grds;
+    ILOC_ASSOC *pgs;
+    ILOC_STA *StaLocs;
+    ILOC_PHASEIDINFO *PhaseIdInfo;
+    ILOC_READING *rdindx;
+    ILOC_EC_COEF *ec;
+    ILOC_TTINFO *TTInfo;
+    ILOC_TT_TABLE *TTtables;
+    ILOC_TTINFO *LocalTTInfo;
+    ILOC_TT_TABLE *LocalTTtables;
+    short int **topo;
+    double **distmatrix;
+    ILOC_VARIOGRAM *variogram;
+    ILOC_STAORDER *staorder;
+    int is2nderiv;
+    int DoCorr;
+} NA_FORWARD;
+
+/*
+ *  work arrays of a thread computing sample misfits
+ */
+typedef struct NAWorker {
+    pthread_t thread;
+    NA_FORWARD *fwd;
+    ILOC_ASSOC *pset;                /* phases w.r.t. the trial hypocentre */
+    ILOC_PHADEF *PhaDef;                    /* defining phases work array */
+    int ownPhaDef;                              /* PhaDef allocated here? */
+} NA_WORKER;
 
 /*
  * Functions:
@@ -62,6 +105,10 @@
  *    WriteNAModels
  *    NAForwardProblem
  *    dosamples
+ *    NAAllocWorkers
+ *    NAFreeWorkers
+ *    NAForwardSamples
+ *    NAForwardThread
  */
 static int na_initialize(ILOC_CONF *iLocConfig, ILOC_NASPACE *nasp, double *xcur,
         ILOC_SOBOL *sas);
@@ -95,11 +142,17 @@ static double dranq1(unsigned long seed);
 static double ranfib(int init, unsigned long seed);
 static double dosamples(int i, int ntot, double *na_model, ILOC_NASPACE *nasp,
         ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *pgs,
-        ILOC_STA *StaLocs, ILOC_PHASEIDINFO *PhaseIdInfo, ILOC_READING *rdindx,
-        ILOC_EC_COEF *ec, ILOC_TTINFO *TTInfo, ILOC_TT_TABLE *TTtables,
-        ILOC_TTINFO *LocalTTInfo, ILOC_TT_TABLE *LocalTTtables,
-        short int **topo, double **distmatrix, ILOC_VARIOGRAM *variogram,
-        ILOC_STAORDER *staorder, ILOC_PHADEF *PhaDef, int is2nderiv, int DoCorr);
+        ILOC_ASSOC *pset, ILOC_STA *StaLocs, ILOC_PHASEIDINFO *PhaseIdInfo,
+        ILOC_READING *rdindx, ILOC_EC_COEF *ec, ILOC_TTINFO *TTInfo,
+        ILOC_TT_TABLE *TTtables, ILOC_TTINFO *LocalTTInfo,
+        ILOC_TT_TABLE *LocalTTtables, short int **topo, double **distmatrix,
+        ILOC_VARIOGRAM *variogram, ILOC_STAORDER *staorder,
+        ILOC_PHADEF *PhaDef, int is2nderiv, int DoCorr);
+static NA_WORKER *NAAllocWorkers(int nthreads, NA_FORWARD *fwd, int numPhase,
+        int numPhaDef, ILOC_PHADEF *PhaDef);
+static void NAFreeWorkers(int nthreads, NA_WORKER *workers);
+static void NAForwardSamples(int nthreads, NA_WORKER *workers);
+static void *NAForwardThread(void *arg);
 static double NAForwardProblem(ILOC_CONF *iLocConfig, ILOC_HYPO *grds,
         ILOC_ASSOC *pset, ILOC_STA *StaLocs, ILOC_PHASEIDINFO *PhaseIdInfo,
         ILOC_READING *rdindx, ILOC_EC_COEF *ec, ILOC_TTINFO *TTInfo,
@@ -230,6 +283,9 @@ int iLoc_SetNASearchSpace(ILOC_CONF *iLocConfig, ILOC_HYPO *grds,
  *        searches in 4D (lat, lon, OT, depth) by default
  *        reidentifies phases w.r.t. each trial hypocentre
  *        accounting for correlated errors may be turned off for speed
+ *        misfits of the models of a sample are computed by NAthreads
+ *            threads; the models are generated sequentially, so the
+ *            results do not depend on the number of threads
  *  Input Arguments:
  *     iLocConfig    - pointer to  ILOC_CONF structure
  *     grds          - pointer to ILOC_HYPO structure
@@ -256,8 +312,8 @@ int iLoc_SetNASearchSpace(ILOC_CONF *iLocConfig, ILOC_HYPO *grds,
  *  Calls:
  *     iLoc_AllocateFloatMatrix, iLoc_Free, iLoc_FreeFloatMatrix, iLoc_Readings,
  *     iLoc_GetdUGapSgap, iLoc_SortAssocsNN, na_initialize, na_initial_sample,
- *     na_sample, do_samples, na_misfits, transform2raw, tolatlon,
- *     NAForwardProblem
+ *     na_sample, na_misfits, transform2raw, tolatlon, NAForwardProblem,
+ *     NAAllocWorkers, NAFreeWorkers, NAForwardSamples
  *
  */
 int iLoc_NASearch(ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *Assocs,
@@ -287,12 +343,22 @@ int iLoc_NASearch(ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *Assocs,
     int ntot = 0, ncald = 0, nupd = 0, nc = 0, nu = 0, ksta = 0;
     int iter = 0, i, j, ns = 0, nd = 0, np = 0, nrd = 0, nrank = 0;
     int DoCorr = iLocConfig->DoCorrelatedErrors;
+    int nthreads = iLocConfig->NAthreads;
+    NA_FORWARD fwd;
+    NA_WORKER *workers = (NA_WORKER *)NULL;
     ILOC_SOBOL sas;
     ntotal = iLocConfig->NAinitialSample + 1 +
              iLocConfig->NAnextSample * iLocConfig->NAiterMax;
     nsamp = ILOC_MAX(iLocConfig->NAnextSample, iLocConfig->NAinitialSample + 1);
     nd = nasp->nd;
     sas.n = nd * iLocConfig->NAcells;
+/*
+ *  RSTT predictions use the global state of the SLBM library
+ */
+    if (nthreads < 1 || iLocConfig->UseRSTT)
+        nthreads = 1;
+    if (nthreads > nsamp)
+        nthreads = nsamp;
 /*
  *  sanity checks
  */
@@ -409,11 +475,47 @@ int iLoc_NASearch(ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *Assocs,
         iLoc_Free(rdindx);
         return ILOC_MEMORY_ALLOCATION_ERROR;
     }
+/*
+ *  work arrays of the threads computing the sample misfits
+ */
+    if ((workers = NAAllocWorkers(nthreads, &fwd, grds->numPhase,
+                                  TTInfo->numPhaseTT, PhaDef)) == NULL) {
+        fprintf(stderr, "iLoc_NASearch: cannot allocate memory!\n");
+        iLoc_Free(pgs);
+        iLoc_Free(iwork_NA1); iLoc_Free(iwork_NA2); iLoc_Free(work_NA2);
+        iLoc_Free(misfit); iLoc_Free(mfitord); iLoc_Free(dlist);
+        iLoc_FreeFloatMatrix(na_models);
+        iLoc_FreeLongMatrix(sas.iv);
+        iLoc_Free(sas.pol); iLoc_Free(sas.mdeg);
+        iLoc_Free(rdindx);
+        return ILOC_MEMORY_ALLOCATION_ERROR;
+    }
+    fwd.misfit = misfit;
+    fwd.na_models = na_models;
+    fwd.nasp = nasp;
+    fwd.iLocConfig = iLocConfig;
+    fwd.grds = grds;
+    fwd.pgs = pgs;
+    fwd.StaLocs = StaLocs;
+    fwd.PhaseIdInfo = PhaseIdInfo;
+    fwd.rdindx = rdindx;
+    fwd.ec = ec;
+    fwd.TTInfo = TTInfo;
+    fwd.TTtables = TTtables;
+    fwd.LocalTTInfo = LocalTTInfo;
+    fwd.LocalTTtables = LocalTTtables;
+    fwd.topo = topo;
+    fwd.distmatrix = distmatrix;
+    fwd.variogram = variogram;
+    fwd.staorder = staorder;
+    fwd.is2nderiv = is2nderiv;
+    fwd.DoCorr = DoCorr;
     mfitmin = 1e6;
 /*
  *  initialize NA routines
  */
     if (na_initialize(iLocConfig, nasp, xcur, &sas)) {
+        NAFreeWorkers(nthreads, workers);
         iLoc_Free(pgs);
         iLoc_Free(iwork_NA1); iLoc_Free(iwork_NA2); iLoc_Free(work_NA2);
         iLoc_Free(misfit); iLoc_Free(mfitord); iLoc_Free(dlist);
@@ -448,14 +550,9 @@ int iLoc_NASearch(ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *Assocs,
 /*
  *      calculate model misfits
  */
-        for (i = 0; i < ns; i++) {
-            misfit[ntot + i] = dosamples((int)i, ntot, na_models[ntot + i],
-                                    nasp, iLocConfig, grds, pgs, StaLocs,
-                                    PhaseIdInfo, rdindx, ec, TTInfo, TTtables,
-                                    LocalTTInfo, LocalTTtables, topo,
-                                    distmatrix, variogram, staorder, PhaDef,
-                                    is2nderiv, DoCorr);
-        }
+        fwd.ns = ns;
+        fwd.ntot = ntot;
+        NAForwardSamples(nthreads, workers);
 /*
  *      misfit statistics
  */
@@ -484,6 +581,7 @@ int iLoc_NASearch(ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *Assocs,
 /*
  *  free memory
  */
+    NAFreeWorkers(nthreads, workers);
     iLoc_FreeFloatMatrix(na_models);
     iLoc_Free(iwork_NA1); iLoc_Free(iwork_NA2); iLoc_Free(work_NA2);
     iLoc_Free(misfit); iLoc_Free(mfitord); iLoc_Free(dlist);
@@ -510,6 +608,7 @@ int iLoc_NASearch(ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *Assocs,
  *     iLocConfig    - pointer to  ILOC_CONF structure
  *     grds          - pointer to ILOC_HYPO structure
  *     pgs           - array of ILOC_ASSOC structures
+ *     pset          - ILOC_ASSOC work array of the calling thread
  *     StaLocs       - array of ILOC_STA structures
  *     PhaseIdInfo   - pointer to ILOC_PHASEIDINFO structure
  *     rdindx        - array of ILOC_READING structures
@@ -522,32 +621,29 @@ int iLoc_NASearch(ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *Assocs,
  *     distmatrix    - station separation matrix
  *     variogram     - pointer to ILOC_VARIOGRAM structure
  *     staorder      - array of staorder structures (nearest-neighbour order)
+ *     PhaDef        - ILOC_PHADEF work array of the calling thread
  *     is2nderiv     - calculate second derivatives [0/1]]
  *     DoCorr        - account for correlated errors?
  *  Return:
  *     misfit - Lp-norm misfit of the sample model
  *  Called by:
- *     iLoc_NASearch
+ *     NAForwardThread
  *  Calls:
- *     NAForwardProblem, tolatlon, transform2raw, iLoc_Free
+ *     NAForwardProblem, tolatlon, transform2raw
  */
 static double dosamples(int i, int ntot, double *na_model, ILOC_NASPACE *nasp,
         ILOC_CONF *iLocConfig, ILOC_HYPO *grds, ILOC_ASSOC *pgs,
-        ILOC_STA *StaLocs, ILOC_PHASEIDINFO *PhaseIdInfo, ILOC_READING *rdindx,
-        ILOC_EC_COEF *ec, ILOC_TTINFO *TTInfo, ILOC_TT_TABLE *TTtables,
-        ILOC_TTINFO *LocalTTInfo, ILOC_TT_TABLE *LocalTTtables,
-        short int **topo, double **distmatrix, ILOC_VARIOGRAM *variogram,
-        ILOC_STAORDER *staorder, ILOC_PHADEF *PhaDef, int is2nderiv, int DoCorr)
+        ILOC_ASSOC *pset, ILOC_STA *StaLocs, ILOC_PHASEIDINFO *PhaseIdInfo,
+        ILOC_READING *rdindx, ILOC_EC_COEF *ec, ILOC_TTINFO *TTInfo,
+        ILOC_TT_TABLE *TTtables, ILOC_TTINFO *LocalTTInfo,
+        ILOC_TT_TABLE *LocalTTtables, short int **topo, double **distmatrix,
+        ILOC_VARIOGRAM *variogram, ILOC_STAORDER *staorder,
+        ILOC_PHADEF *PhaDef, int is2nderiv, int DoCorr)
 {
     ILOC_HYPO s;
-    ILOC_ASSOC *pset = (ILOC_ASSOC *)NULL;
     double model_raw[ILOC_NA_MAXND];
     double misfit = 9999.;
     int k;
-    if ((pset = (ILOC_ASSOC *)calloc(grds->numPhase, sizeof(ILOC_ASSOC))) == NULL) {
-        fprintf(stderr, "dosamples: cannot allocate memory!\n");
-        return misfit;
-    }
 /*
  *  make a copy of defining phases and the solution
  *  in order to not to interfere with phase identifications
@@ -566,10 +662,156 @@ static double dosamples(int i, int ntot, double *na_model, ILOC_NASPACE *nasp,
                    rdindx, ec, TTInfo, TTtables, LocalTTInfo, LocalTTtables,
                    topo, distmatrix, variogram, staorder, PhaDef, nasp,
                    is2nderiv, model_raw, DoCorr);
-    iLoc_Free(pset);
     return misfit;
 }
 
+/*
+ *  Title:
+ *     NAAllocWorkers
+ *  Synopsis:
+ *     Allocates the work arrays of the threads computing sample misfits.
+ *     Each thread gets its own copy of the phases and its own PhaDef
+ *     array as both are modified by the forward problem. The first
+ *     thread is the calling thread and uses the PhaDef of the caller.
+ *  Input Arguments:
+ *     nthreads  - number of threads
+ *     fwd       - pointer to NA_FORWARD structure
+ *     numPhase  - number of phases used in the NA search
+ *     numPhaDef - PhaDef dimension
+ *     PhaDef    - array of ILOC_PHADEF structures
+ *  Return:
+ *     array of NA_WORKER structures or NULL on error
+ *  Called by:
+ *     iLoc_NASearch
+ *  Calls:
+ *     NAFreeWorkers
+ */
+static NA_WORKER *NAAllocWorkers(int nthreads, NA_FORWARD *fwd, int numPhase,
+        int numPhaDef, ILOC_PHADEF *PhaDef)
+{
+    NA_WORKER *workers = (NA_WORKER *)NULL;
+    int k;
+    if ((workers = (NA_WORKER *)calloc(nthreads, sizeof(NA_WORKER))) == NULL)
+        return workers;
+    for (k = 0; k < nthreads; k++) {
+        workers[k].fwd = fwd;
+        workers[k].pset = (ILOC_ASSOC *)calloc(numPhase, sizeof(ILOC_ASSOC));
+        if (k) {
+            workers[k].PhaDef = (ILOC_PHADEF *)calloc(numPhaDef,
+                                                      sizeof(ILOC_PHADEF));
+            workers[k].ownPhaDef = 1;
+        }
+        else
+            workers[k].PhaDef = PhaDef;
+        if (workers[k].pset == NULL || workers[k].PhaDef == NULL) {
+            NAFreeWorkers(k + 1, workers);
+            return (NA_WORKER *)NULL;
+        }
+    }
+    return workers;
+}
+
+/*
+ *  Title:
+ *     NAFreeWorkers
+ *  Synopsis:
+ *     Frees the work arrays of the threads computing sample misfits.
+ *  Input Arguments:
+ *     nthreads - number of threads
+ *     workers  - array of NA_WORKER structures
+ *  Called by:
+ *     iLoc_NASearch, NAAllocWorkers
+ *  Calls:
+ *     iLoc_Free
+ */
+static void NAFreeWorkers(int nthreads, NA_WORKER *workers)
+{
+    int k;
+    if (workers == NULL)
+        return;
+    for (k = 0; k < nthreads; k++) {
+        iLoc_Free(workers[k].pset);
+        if (workers[k].ownPhaDef)
+            iLoc_Free(workers[k].PhaDef);
+    }
+    iLoc_Free(workers);
+}
+
+/*
+ *  Title:
+ *     NAForwardSamples
+ *  Synopsis:
+ *     Computes the misfits of the models of the current sample.
+ *     The calling thread and nthreads - 1 additional threads take the
+ *     next model to be evaluated until all models of the sample are done.
+ *     The misfit of a model does not depend on the thread computing it.
+ *     Should a thread fail to start, the remaining threads do its share.
+ *  Input Arguments:
+ *     nthreads - number of threads
+ *     workers  - array of NA_WORKER structures
+ *  Called by:
+ *     iLoc_NASearch
+ *  Calls:
+ *     NAForwardThread
+ */
+static void NAForwardSamples(int nthreads, NA_WORKER *workers)
+{
+    NA_FORWARD *fwd = workers[0].fwd;
+    int k, nstarted = 1;
+    fwd->next = 0;
+    fwd->threaded = 0;
+    if (nthreads > 1 && pthread_mutex_init(&fwd->lock, NULL) == 0)
+        fwd->threaded = 1;
+    if (fwd->threaded) {
+        for (nstarted = 1; nstarted < nthreads; nstarted++) {
+            if (pthread_create(&workers[nstarted].thread, NULL,
+                               NAForwardThread, &workers[nstarted]))
+                break;
+        }
+    }
+    NAForwardThread(&workers[0]);
+    for (k = 1; k < nstarted; k++)
+        pthread_join(workers[k].thread, NULL);
+    if (fwd->threaded)
+        pthread_mutex_destroy(&fwd->lock);
+}
+
+/*
+ *  Title:
+ *     NAForwardThread
+ *  Synopsis:
+ *     Computes the misfits of sample models until none is left.
+ *  Input Arguments:
+ *     arg - pointer to NA_WORKER structure
+ *  Return:
+ *     NULL
+ *  Called by:
+ *     NAForwardSamples
+ *  Calls:
+ *     dosamples
+ */
+static void *NAForwardThread(void *arg)
+{
+    NA_WORKER *worker = (NA_WORKER *)arg;
+    NA_FORWARD *fwd = worker->fwd;
+    int i;
+    for (;;) {
+        if (fwd->threaded) pthread_mutex_lock(&fwd->lock);
+        i = fwd->next++;
+        if (fwd->threaded) pthread_mutex_unlock(&fwd->lock);
+        if (i >= fwd->ns)
+            break;
+        fwd->misfit[fwd->ntot + i] = dosamples(i, fwd->ntot,
+                fwd->na_models[fwd->ntot + i], fwd->nasp, fwd->iLocConfig,
+                fwd->grds, fwd->pgs, worker->pset, fwd->StaLocs,
+                fwd->PhaseIdInfo, fwd->rdindx, fwd->ec, fwd->TTInfo,
+                fwd->TTtables, fwd->LocalTTInfo, fwd->LocalTTtables,
+                fwd->topo, fwd->distmatrix, fwd->variogram, fwd->staorder,
+                worker->PhaDef, fwd->is2nderiv, fwd->DoCorr);
+    }
+    return NULL;
+}
+
 /*
  *  Title:
  *     NAForwardProblem
@@ -314,6 +314,7 @@ void iLoc_PrintIOstructures(ILOC_CONF *iLocConfig, ILOC_HYPO *Hypocenter,
         fprintf(stderr, "    NAinitialSample=%d\n", iLocConfig->NAinitialSample);
         fprintf(stderr, "    NAnextSample=%d\n", iLocConfig->NAnextSample);
         fprintf(stderr, "    NAcells=%d\n", iLocConfig->NAcells);
+        fprintf(stderr, "    NAthreads=%d\n", iLocConfig->NAthreads);
         fprintf(stderr, "  DoNotRenamePhases=%d\n", iLocConfig->DoNotRenamePhases);
         fprintf(stderr, "  DoCorrelatedErrors=%d\n", iLocConfig->DoCorrelatedErrors);
         fprintf(stderr, "  SigmaThreshold=%.1f\n", iLocConfig->SigmaThreshold);
@@ -391,6 +392,7 @@ void iLoc_PrintIOstructures(ILOC_CONF *iLocConfig, ILOC_HYPO *Hypocenter,
         fprintf(stderr, "    NAinitialSample=%d\n", iLocConfig->NAinitialSample);
         fprintf(stderr, "    NAnextSample=%d\n", iLocConfig->NAnextSample);
         fprintf(stderr, "    NAcells=%d\n", iLocConfig->NAcells);
+        fprintf(stderr, "    NAthreads=%d\n", iLocConfig->NAthreads);
         fprintf(stderr, "  DoNotRenamePhases=%d\n", iLocConfig->DoNotRenamePhases);
         fprintf(stderr, "  DoCorrelatedErrors=%d\n", iLocConfig->DoCorrelatedErrors);
         fprintf(stderr, "  SigmaThreshold=%.1f\n", iLocConfig->SigmaThreshold);
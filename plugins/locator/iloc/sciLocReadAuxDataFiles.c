@@ -108,6 +108,7 @@ static double **ReadDefaultDepthGrid(char *filename, double *gres, int *ngrid);
  *     ReadEllipticityCorrections
  *     ReadTTtables
  *     iLoc_GenerateLocalTTtables
+ *     iLoc_SetTTSplines
  *     ReadRSTTModel
  */
 int iLoc_ReadAuxDataFiles(ILOC_CONF *iLocConfig, ILOC_PHASEIDINFO *PhaseIdInfo,
@@ -250,6 +251,19 @@ int iLoc_ReadAuxDataFiles(ILOC_CONF *iLocConfig, ILOC_PHASEIDINFO *PhaseIdInfo,
         iLoc_FreeEllipticityCorrections(TTInfo->numECPhases, *ec);
         return ILOC_FAILURE;
     }
+/*
+ *  precompute spline coefficients for TT table interpolation
+ */
+    if (iLoc_SetTTSplines(TTInfo->numPhaseTT, *TTtables)) {
+        iLoc_Free(TTInfo->PhaseTT);
+        iLoc_FreePhaseIdInfo(PhaseIdInfo);
+        iLoc_FreeFlinnEngdahl(fe);
+        iLoc_FreeDefaultDepth(DefaultDepth);
+        iLoc_FreeVariogram(Variogram);
+        iLoc_FreeEllipticityCorrections(TTInfo->numECPhases, *ec);
+        iLoc_FreeTTtables(TTInfo->numPhaseTT, *TTtables);
+        return ILOC_FAILURE;
+    }
 /*
  *
  *  Read local velocity model specific files
@@ -287,6 +301,18 @@ int iLoc_ReadAuxDataFiles(ILOC_CONF *iLocConfig, ILOC_PHASEIDINFO *PhaseIdInfo,
             iLoc_Free(LocalTTInfo->PhaseTT);
             return ILOC_FAILURE;
         }
+        if (iLoc_SetTTSplines(LocalTTInfo->numPhaseTT, *LocalTTtables)) {
+            iLoc_Free(TTInfo->PhaseTT);
+            iLoc_FreePhaseIdInfo(PhaseIdInfo);
+            iLoc_FreeFlinnEngdahl(fe);
+            iLoc_FreeDefaultDepth(DefaultDepth);
+            iLoc_FreeVariogram(Variogram);
+            iLoc_FreeEllipticityCorrections(TTInfo->numECPhases, *ec);
+            iLoc_FreeTTtables(TTInfo->numPhaseTT, *TTtables);
+            iLoc_Free(LocalTTInfo->PhaseTT);
+            iLoc_FreeTTtables(LocalTTInfo->numPhaseTT, *LocalTTtables);
+            return ILOC_FAILURE;
+        }
     }
     if (iLocConfig->UseRSTT) {
 /*
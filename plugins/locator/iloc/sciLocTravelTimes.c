@@ -35,6 +35,7 @@
  *    iLoc_TravelTimeResiduals
  *    iLoc_GetTravelTimePrediction
  *    iLoc_GetEtopoCorrection
+ *    iLoc_SetTTSplines
  */
 
 /*
@@ -42,6 +43,9 @@
  *    GetTTResidual
  *    isRSTT
  *    GetTravelTimeTableValue
+ *    DeltaWindow
+ *    SetSplineSegment
+ *    SplineSegmentValue
  *    TravelTimeCorrections
  *    GetElevationCorrection
  *    GetLastLag
@@ -59,6 +63,11 @@ static int isRSTT(ILOC_CONF *iLocConfig, ILOC_ASSOC *Assoc, double depth);
 static double GetTravelTimeTableValue(double depth, double delta,
         ILOC_TT_TABLE *TTtable, int iszderiv, double *dtdd, double *dtdh,
         double *bpdel, int is2nderiv, double *d2tdd, double *d2tdh);
+static void DeltaWindow(int idel, int ndel, int *ilo, int *ihi);
+static void SetSplineSegment(double **table, int j, int m, int *idx,
+        double *x, int klo, int khi, double *d2);
+static double SplineSegmentValue(double xp, double *x, double **table, int j,
+        int klo, int khi, double *d2);
 static void TravelTimeCorrections(ILOC_CONF *iLocConfig, ILOC_HYPO *Hypocenter,
         ILOC_ASSOC *Assoc, ILOC_STA *StaLoc, ILOC_EC_COEF *ec, short int **topo,
         double Psurfvel, double Ssurfvel);
@@ -676,12 +685,14 @@ static int isRSTT(ILOC_CONF *iLocConfig, ILOC_ASSOC *Assoc, double depth)
  *  Called by:
  *     iLoc_GetTravelTimePrediction
  *  Calls:
- *     iLoc_FloatBracket, iLoc_SplineCoeffs, iLoc_SplineInterpolation
+ *     iLoc_FloatBracket, iLoc_SplineCoeffs, iLoc_SplineInterpolation,
+ *     DeltaWindow, SplineSegmentValue
  */
 static double GetTravelTimeTableValue(double depth, double delta,
         ILOC_TT_TABLE *TTtable, int iszderiv, double *dtdd, double *dtdh,
         double *bpdel, int is2nderiv, double *d2tdd, double *d2tdh)
 {
+    ILOC_TT_SPLINE *seg = (ILOC_TT_SPLINE *)NULL;
     int i, j, k, m, ilo, ihi, jlo, jhi, idel, jdep, ndep, ndel;
     int exactdelta = 0, exactdepth = 0, isbounce = 0;
     double ttim = -1., dydx = 0., d2ydx = 0.;
@@ -734,23 +745,9 @@ static double GetTravelTimeTableValue(double depth, double delta,
         }
         exactdelta = 1;
     }
-    else if (ndel <= ILOC_DELTASAMPLES) {
-        ilo = 0;
-        ihi = ndel;
-        idel = ilo;
-    }
     else {
         idel = ilo;
-        ilo = idel - ILOC_DELTASAMPLES / 2 + 1;
-        ihi = idel + ILOC_DELTASAMPLES / 2 + 1;
-        if (ilo < 0) {
-            ilo = 0;
-            ihi = ilo + ILOC_DELTASAMPLES;
-        }
-        if (ihi > ndel - 1) {
-            ihi = ndel;
-            ilo = ihi - ILOC_DELTASAMPLES;
-        }
+        DeltaWindow(idel, ndel, &ilo, &ihi);
     }
 /*
  *  depth range
@@ -824,6 +821,28 @@ static double GetTravelTimeTableValue(double depth, double delta,
                 hz[k] = TTtable->dtdh[idel][j];
             k++;
         }
+/*
+ *      precomputed spline segment in delta
+ */
+        else if (!exactdelta && TTtable->spline != NULL) {
+            seg = &TTtable->spline[idel][j];
+            if (seg->klo < 0)
+                continue;
+            z[k] = TTtable->depths[j];
+            tz[k] = SplineSegmentValue(delta, TTtable->deltas, TTtable->tt,
+                                       j, seg->klo, seg->khi, seg->tt);
+            if (isbounce)
+                pz[k] = SplineSegmentValue(delta, TTtable->deltas,
+                                           TTtable->bpdel, j, seg->klo,
+                                           seg->khi, seg->bpdel);
+            dz[k] = SplineSegmentValue(delta, TTtable->deltas, TTtable->dtdd,
+                                       j, seg->klo, seg->khi, seg->dtdd);
+            if (iszderiv)
+                hz[k] = SplineSegmentValue(delta, TTtable->deltas,
+                                           TTtable->dtdh, j, seg->klo,
+                                           seg->khi, seg->dtdh);
+            k++;
+        }
 /*
  *      spline interpolation in delta
  */
@@ -923,6 +942,200 @@ static double GetTravelTimeTableValue(double depth, double delta,
     return ttim;
 }
 
+/*
+ *  Title:
+ *     iLoc_SetTTSplines
+ *  Synopsis:
+ *     Precomputes the spline segments of TT tables in delta direction.
+ *     For each delta interval and depth sample the natural spline through
+ *         the valid delta samples of the interpolation window is calculated
+ *         once, and its second derivatives at the samples bracketing the
+ *         interval are stored. GetTravelTimeTableValue then interpolates
+ *         in delta without solving for the spline coefficients at every
+ *         call. The results are identical to the direct interpolation.
+ *  Input Arguments:
+ *     numPhaseTT - number of TT tables
+ *     TTtables   - array of ILOC_TT_TABLE structures
+ *  Output Arguments:
+ *     TTtables   - array of ILOC_TT_TABLE structures with spline segments
+ *  Return:
+ *     Success/error
+ *  Called by:
+ *     iLoc_ReadAuxDataFiles
+ *  Calls:
+ *     DeltaWindow, iLoc_FloatBracket, SetSplineSegment
+ */
+int iLoc_SetTTSplines(int numPhaseTT, ILOC_TT_TABLE *TTtables)
+{
+    ILOC_TT_TABLE *TTtable = (ILOC_TT_TABLE *)NULL;
+    ILOC_TT_SPLINE *seg = (ILOC_TT_SPLINE *)NULL;
+    int ind, i, j, k, m, n, ilo, ihi, klo, khi, ndel, ndep;
+    int idx[ILOC_DELTASAMPLES];
+    double x[ILOC_DELTASAMPLES];
+    for (ind = 0; ind < numPhaseTT; ind++) {
+        TTtable = &TTtables[ind];
+        TTtable->spline = (ILOC_TT_SPLINE **)NULL;
+        ndel = TTtable->ndel;
+        ndep = TTtable->ndep;
+        if (ndel < 2 || ndep < 1)
+            continue;
+/*
+ *      memory allocation
+ */
+        n = ndel - 1;
+        if ((TTtable->spline = (ILOC_TT_SPLINE **)calloc(n,
+                                 sizeof(ILOC_TT_SPLINE *))) == NULL) {
+            fprintf(stderr, "iLoc_SetTTSplines: cannot allocate memory\n");
+            return ILOC_MEMORY_ALLOCATION_ERROR;
+        }
+        if ((TTtable->spline[0] = (ILOC_TT_SPLINE *)calloc(n * ndep,
+                                    sizeof(ILOC_TT_SPLINE))) == NULL) {
+            fprintf(stderr, "iLoc_SetTTSplines: cannot allocate memory\n");
+            iLoc_Free(TTtable->spline);
+            TTtable->spline = (ILOC_TT_SPLINE **)NULL;
+            return ILOC_MEMORY_ALLOCATION_ERROR;
+        }
+        for (i = 1; i < n; i++)
+            TTtable->spline[i] = TTtable->spline[i - 1] + ndep;
+/*
+ *      spline segments for each delta interval and depth sample
+ */
+        for (i = 0; i < n; i++) {
+            DeltaWindow(i, ndel, &ilo, &ihi);
+            for (j = 0; j < ndep; j++) {
+                seg = &TTtable->spline[i][j];
+                seg->klo = seg->khi = -1;
+                for (m = 0, k = ilo; k < ihi; k++) {
+                    if (TTtable->tt[k][j] < 0)
+                        continue;
+                    idx[m] = k;
+                    x[m] = TTtable->deltas[k];
+                    m++;
+                }
+                if (m < ILOC_MINSAMPLES)
+                    continue;
+/*
+ *              the bracketing samples are the same for any delta
+ *              in the interval
+ */
+                iLoc_FloatBracket(TTtable->deltas[i], m, x, &klo, &khi);
+                seg->klo = idx[klo];
+                seg->khi = idx[khi];
+                SetSplineSegment(TTtable->tt, j, m, idx, x, klo, khi, seg->tt);
+                SetSplineSegment(TTtable->dtdd, j, m, idx, x, klo, khi,
+                                 seg->dtdd);
+                if (TTtable->dtdh != NULL)
+                    SetSplineSegment(TTtable->dtdh, j, m, idx, x, klo, khi,
+                                     seg->dtdh);
+                if (TTtable->isbounce && TTtable->bpdel != NULL)
+                    SetSplineSegment(TTtable->bpdel, j, m, idx, x, klo, khi,
+                                     seg->bpdel);
+            }
+        }
+    }
+    return ILOC_SUCCESS;
+}
+
+/*
+ *  Title:
+ *     DeltaWindow
+ *  Synopsis:
+ *     Returns the delta samples used for spline interpolation in a delta
+ *         interval. The window of ILOC_DELTASAMPLES samples is centred on
+ *         the interval and shifted at the ends of the table.
+ *  Input Arguments:
+ *     idel - index of the lower delta sample of the interval
+ *     ndel - number of delta samples
+ *  Output Arguments:
+ *     ilo  - first delta sample of the window
+ *     ihi  - delta sample after the window
+ *  Called by:
+ *     GetTravelTimeTableValue, iLoc_SetTTSplines
+ */
+static void DeltaWindow(int idel, int ndel, int *ilo, int *ihi)
+{
+    if (ndel <= ILOC_DELTASAMPLES) {
+        *ilo = 0;
+        *ihi = ndel;
+        return;
+    }
+    *ilo = idel - ILOC_DELTASAMPLES / 2 + 1;
+    *ihi = idel + ILOC_DELTASAMPLES / 2 + 1;
+    if (*ilo < 0) {
+        *ilo = 0;
+        *ihi = *ilo + ILOC_DELTASAMPLES;
+    }
+    if (*ihi > ndel - 1) {
+        *ihi = ndel;
+        *ilo = *ihi - ILOC_DELTASAMPLES;
+    }
+}
+
+/*
+ *  Title:
+ *     SetSplineSegment
+ *  Synopsis:
+ *     Calculates the natural spline through the valid delta samples of a
+ *         table row and returns its second derivatives at the bracketing
+ *         samples.
+ *  Input Arguments:
+ *     table - TT table (tt, dtdd, dtdh or bpdel)
+ *     j     - depth sample
+ *     m     - number of valid delta samples
+ *     idx   - indices of the valid delta samples
+ *     x     - deltas of the valid delta samples
+ *     klo   - lower bracketing sample in x
+ *     khi   - upper bracketing sample in x
+ *  Output Arguments:
+ *     d2    - second derivatives at klo and khi
+ *  Called by:
+ *     iLoc_SetTTSplines
+ *  Calls:
+ *     iLoc_SplineCoeffs
+ */
+static void SetSplineSegment(double **table, int j, int m, int *idx,
+        double *x, int klo, int khi, double *d2)
+{
+    double y[ILOC_DELTASAMPLES], d2y[ILOC_DELTASAMPLES], tmp[ILOC_DELTASAMPLES];
+    int i;
+    for (i = 0; i < m; i++)
+        y[i] = table[idx[i]][j];
+    iLoc_SplineCoeffs(m, x, y, d2y, tmp);
+    d2[0] = d2y[klo];
+    d2[1] = d2y[khi];
+}
+
+/*
+ *  Title:
+ *     SplineSegmentValue
+ *  Synopsis:
+ *     Returns the value of a precomputed spline segment in delta.
+ *     Same arithmetic as iLoc_SplineInterpolation.
+ *  Input Arguments:
+ *     xp    - delta to be interpolated
+ *     x     - delta samples
+ *     table - TT table (tt, dtdd, dtdh or bpdel)
+ *     j     - depth sample
+ *     klo   - lower bracketing delta sample
+ *     khi   - upper bracketing delta sample
+ *     d2    - second derivatives at klo and khi
+ *  Return:
+ *     interpolated table value
+ *  Called by:
+ *     GetTravelTimeTableValue
+ */
+static double SplineSegmentValue(double xp, double *x, double **table, int j,
+        int klo, int khi, double *d2)
+{
+    double h = 0., a = 0., b = 0., c = 0., d = 0.;
+    h = x[khi] - x[klo];
+    a = (x[khi] - xp) / h;
+    b = (xp - x[klo]) / h;
+    c = (a * a * a - a) * h * h / 6.;
+    d = (b * b * b - b) * h * h / 6.;
+    return a * table[klo][j] + b * table[khi][j] + c * d2[0] + d * d2[1];
+}
+
 /*
  *  Title:
  *     TravelTimeCorrections